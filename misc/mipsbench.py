@@ -0,0 +1,137 @@
+#!/usr/bin/python
+
+# Copyright (C) 2013-2015 by Massachusetts Institute of Technology
+#
+# This file is part of zsim.
+#
+# zsim is free software; you can redistribute it and/or modify it under the
+# terms of the GNU General Public License as published by the Free Software
+# Foundation, version 2.
+#
+# If you use this software in your research, we request that you reference
+# the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+# Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+# source of the simulator in any publications that use this software, and that
+# you send us a citation of your work.
+#
+# zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+# WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program. If not, see <http://www.gnu.org/licenses/>.
+
+# Measures simulation speed (MIPS over bound+weave time) for each core type,
+# with the regular per-access analysis calls and with the instrumentation
+# modes that avoid them (sim.bufferAccesses, sim.filterFastPath), and with
+# pipelined weave phases (sim.pipelinedWeave), and without weave events for
+# private cache hits (sim.elidePrivateHits, needs --timingCaches). Since these
+# modes change contention simulation, also reports how much simulated cycles
+# deviate from the base mode, and how many weave phase events each mode
+# simulated.
+
+import os, re, shutil, subprocess, sys, tempfile
+from optparse import OptionParser
+
+parser = OptionParser(usage="%prog [options] -- command [args]")
+parser.add_option("--zsim", default="./build/opt/zsim", dest="zsim", help="zsim binary")
+parser.add_option("--cores", default="Simple,Timing,OOO", dest="cores", help="Comma-separated core types")
+parser.add_option("--modes", default="base,bufferAccesses,filterFastPath,pipelinedWeave,elidePrivateHits", dest="modes", help="Comma-separated modes")
+parser.add_option("--threads", type="int", default=1, dest="threads", help="Simulated cores")
+parser.add_option("--maxInstrs", type="int", default=1000000000, dest="maxInstrs", help="Stop after this many total instructions")
+parser.add_option("--timingCaches", action="store_true", default=False, dest="timingCaches", help="Use Timing L2s and L3")
+parser.add_option("--reps", type="int", default=1, dest="reps", help="Runs per configuration (reports the best)")
+(opts, args) = parser.parse_args()
+
+if not args:
+    parser.error("Need a command to simulate")
+
+cfgTemplate = """
+sys = {
+    lineSize = 64;
+    frequency = 2400;
+
+    cores = {
+        c = {
+            type = "%(core)s";
+            cores = %(threads)d;
+            icache = "l1i";
+            dcache = "l1d";
+        };
+    };
+
+    caches = {
+        l1d = { caches = %(threads)d; size = 32768; array = { type = "SetAssoc"; ways = 8; }; latency = 4; };
+        l1i = { caches = %(threads)d; size = 32768; array = { type = "SetAssoc"; ways = 4; }; latency = 3; };
+        l2 = { caches = %(threads)d; type = "%(cacheType)s"; size = 262144; latency = 7; array = { type = "SetAssoc"; ways = 8; }; children = "l1i|l1d"; };
+        l3 = { caches = 1; type = "%(cacheType)s"; banks = 4; size = 8388608; latency = 27; array = { type = "SetAssoc"; hash = "H3"; ways = 16; }; children = "l2"; };
+    };
+
+    mem = { latency = 120; type = "WeaveMD1"; boundLatency = 100; bandwidth = 12800; };
+};
+
+sim = {
+    phaseLength = 10000;
+    maxTotalInstrs = %(maxInstrs)dL;
+    %(modeOpt)s
+};
+
+process0 = {
+    command = "%(command)s";
+};
+"""
+
+# Returns (instrs, core cycles, bound+weave ns, weave event sims) from the last dump in zsim.out
+def parseStats(outFile):
+    dumps = open(outFile).read().split("===")
+    dumps = [d for d in dumps if "time:" in d]
+    if not dumps:
+        raise Exception("No stats in " + outFile)
+    last = dumps[-1]
+    instrs = sum(int(x) for x in re.findall(r"^\s+instrs: (\d+)", last, re.M))
+    cycles = sum(int(x) for x in re.findall(r"^\s+cycles: (\d+)", last, re.M))
+    bound = int(re.search(r"^\s+bound: (\d+)", last, re.M).group(1))
+    weave = int(re.search(r"^\s+weave: (\d+)", last, re.M).group(1))
+    sims = sum(int(x) for x in re.findall(r"^\s+sims: (\d+)", last, re.M))
+    return (instrs, cycles, bound + weave, sims)
+
+def run(core, mode):
+    modeOpt = "" if mode == "base" else "%s = True;" % mode
+    cfg = cfgTemplate % {"core" : core, "threads" : opts.threads, "maxInstrs" : opts.maxInstrs,
+                         "cacheType" : "Timing" if opts.timingCaches else "Simple",
+                         "modeOpt" : modeOpt, "command" : " ".join(args).replace('"', '\\"')}
+    best = None
+    for rep in range(opts.reps):
+        runDir = tempfile.mkdtemp(prefix="mipsbench-")
+        ret = -1
+        try:
+            cfgFile = os.path.join(runDir, "bench.cfg")
+            open(cfgFile, "w").write(cfg)
+            with open(os.path.join(runDir, "stdout"), "w") as out:
+                ret = subprocess.call([os.path.abspath(opts.zsim), cfgFile], cwd=runDir, stdout=out, stderr=subprocess.STDOUT)
+            if ret != 0:
+                print("%s/%s: zsim exited with %d, see %s" % (core, mode, ret, runDir))
+                return None
+            (instrs, cycles, ns, sims) = parseStats(os.path.join(runDir, "zsim.out"))
+            mips = instrs*1e3/ns if ns else 0.0
+            if best is None or mips > best[3]: best = (instrs, cycles, ns, mips, sims)
+        finally:
+            if ret == 0: shutil.rmtree(runDir)
+    return best
+
+# IPC, not raw cycles: runs may stop at slightly different instruction counts
+print("%-8s %-16s %14s %10s %8s %8s %9s %14s" % ("core", "mode", "instrs", "time (s)", "MIPS", "speedup", "IPC err", "weave sims"))
+for core in opts.cores.split(","):
+    baseMips = None
+    baseIpc = None
+    for mode in opts.modes.split(","):
+        res = run(core, mode)
+        if res is None: continue
+        (instrs, cycles, ns, mips, sims) = res
+        ipc = float(instrs)/cycles if cycles else 0.0
+        if mode == "base": (baseMips, baseIpc) = (mips, ipc)
+        speedup = ("%7.2fx" % (mips/baseMips)) if baseMips else "      -"
+        ipcErr = ("%8.3f%%" % (100.0*(ipc - baseIpc)/baseIpc)) if baseIpc else "        -"
+        print("%-8s %-16s %14d %10.2f %8.2f %8s %9s %14d" % (core, mode, instrs, ns/1e9, mips, speedup, ipcErr, sims))
+        sys.stdout.flush()
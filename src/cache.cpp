@@ -27,6 +27,7 @@
 #include "hash.h"
 
 #include "event_recorder.h"
+#include "mem_sampler.h"
 #include "timing_event.h"
 #include "zsim.h"
 
@@ -65,6 +66,7 @@ uint64_t Cache::access(MemReq& req) {
         bool updateReplacement = (req.type == GETS) || (req.type == GETX);
         int32_t lineId = array->lookup(req.lineAddr, &req, updateReplacement);
         respCycle += accLat;
+        if (unlikely(zinfo->memSampler != nullptr) && updateReplacement) zinfo->memSampler->noteAccess(req.srcId, name, lineId != -1);
 
         if (lineId == -1 && cc->shouldAllocate(req)) {
             //Make space for new line
@@ -125,8 +127,8 @@ uint64_t Cache::access(MemReq& req) {
     return respCycle;
 }
 
-void Cache::startInvalidate() {
-    cc->startInv(); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
+void Cache::startInvalidate(Address lineAddr) {
+    cc->startInv(lineAddr); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
 }
 
 uint64_t Cache::finishInvalidate(const InvReq& req) {
@@ -67,14 +67,14 @@ class Cache : public BaseCache {
 
         //NOTE: reqWriteback is pulled up to true, but not pulled down to false.
         virtual uint64_t invalidate(const InvReq& req) {
-            startInvalidate();
+            startInvalidate(req.lineAddr);
             return finishInvalidate(req);
         }
 
     protected:
         void initCacheStats(AggregateStat* cacheStat);
 
-        void startInvalidate(); // grabs cc's downLock
+        void startInvalidate(Address lineAddr); // grabs cc's downLock for lineAddr
         uint64_t finishInvalidate(const InvReq& req); // performs inv and releases downLock
 };
 
@@ -0,0 +1,672 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cache_builder.h"
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <unistd.h>
+#include "bithacks.h"
+#include "cache.h"
+#include "cache_arrays.h"
+#include "config.h"
+#include "dramsim_mem_ctrl.h"
+#include "event_queue.h"
+#include "filter_cache.h"
+#include "galloc.h"
+#include "hash.h"
+#include "ideal_arrays.h"
+#include "log.h"
+#include "mem_ctrl_builder.h"
+#include "network.h"
+#include "part_repl_policies.h"
+#include "prefetcher.h"
+#include "repl_policies.h"
+#include "str.h"
+#include "timing_cache.h"
+#include "trace_driver.h"
+#include "tracing_cache.h"
+#include "vmem.h"
+#include "zsim.h"
+
+using std::list;
+using std::string;
+using std::stringstream;
+using std::unordered_map;
+using std::vector;
+
+BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name, uint32_t bankSize, bool isTerminal, uint32_t domain) {
+    string type = config.get<const char*>(prefix + "type", "Simple");
+    // Shortcut for TraceDriven type
+    if (type == "TraceDriven") {
+        assert(zinfo->traceDriven);
+        assert(isTerminal);
+        return new TraceDriverProxyCache(name);
+    }
+
+    uint32_t lineSize = zinfo->lineSize;
+    assert(lineSize > 0); //avoid config deps
+    if (bankSize % lineSize != 0) panic("%s: Bank size must be a multiple of line size", name.c_str());
+
+    uint32_t numLines = bankSize/lineSize;
+
+    //Array
+    uint32_t numHashes = 1;
+    uint32_t ways = config.get<uint32_t>(prefix + "array.ways", 4);
+    string arrayType = config.get<const char*>(prefix + "array.type", "SetAssoc");
+    uint32_t candidates = (arrayType == "Z")? config.get<uint32_t>(prefix + "array.candidates", 16) : ways;
+
+    //Need to know number of hash functions before instantiating array
+    if (arrayType == "SetAssoc") {
+        numHashes = 1;
+    } else if (arrayType == "Z") {
+        numHashes = ways;
+        assert(ways > 1);
+    } else if (arrayType == "IdealLRU" || arrayType == "IdealLRUPart") {
+        ways = numLines;
+        numHashes = 0;
+    } else {
+        panic("%s: Invalid array type %s", name.c_str(), arrayType.c_str());
+    }
+
+    // Power of two sets check; also compute setBits, will be useful later
+    uint32_t numSets = numLines/ways;
+    uint32_t setBits = 31 - __builtin_clz(numSets);
+    if ((1u << setBits) != numSets) panic("%s: Number of sets must be a power of two (you specified %d sets)", name.c_str(), numSets);
+
+    //Hash function
+    HashFamily* hf = nullptr;
+    string hashType = config.get<const char*>(prefix + "array.hash", (arrayType == "Z")? "H3" : "None"); //zcaches must be hashed by default
+    if (numHashes) {
+        if (hashType == "None") {
+            if (arrayType == "Z") panic("ZCaches must be hashed!"); //double check for stupid user
+            assert(numHashes == 1);
+            hf = new IdHashFamily;
+        } else if (hashType == "H3") {
+            //STL hash function
+            size_t seed = std::_Fnv_hash_bytes(prefix.c_str(), prefix.size()+1, 0xB4AC5B);
+            //info("%s -> %lx", prefix.c_str(), seed);
+            hf = new H3HashFamily(numHashes, setBits, 0xCAC7EAFFA1 + seed /*make randSeed depend on prefix*/);
+        } else if (hashType == "SHA1") {
+            hf = new SHA1HashFamily(numHashes);
+        } else {
+            panic("%s: Invalid value %s on array.hash", name.c_str(), hashType.c_str());
+        }
+    }
+
+    //Replacement policy
+    string replType = config.get<const char*>(prefix + "repl.type", (arrayType == "IdealLRUPart")? "IdealLRUPart" : "LRU");
+    ReplPolicy* rp = nullptr;
+
+    //CC lock striping (see striped_lock.h); only arrays and policies that keep all state of a set within the set support it
+    uint32_t lockStripes = config.get<uint32_t>(prefix + "lockStripes", 1);
+    if (lockStripes > 1) {
+        if (arrayType != "SetAssoc") panic("%s: lockStripes requires a SetAssoc array, %s given", name.c_str(), arrayType.c_str());
+        if (replType != "LRU" && replType != "LRUNoSh") panic("%s: lockStripes requires LRU or LRUNoSh replacement, %s given", name.c_str(), replType.c_str());
+        if (!isPow2(lockStripes) || lockStripes > numSets) panic("%s: lockStripes (%d) must be a power of 2 no larger than the number of sets (%d)", name.c_str(), lockStripes, numSets);
+    }
+    bool profileLocks = config.get<bool>("sim.profileCCLocks", false);
+
+    if (replType == "LRU" || replType == "LRUNoSh") {
+        bool sharersAware = (replType == "LRU") && !isTerminal;
+        bool concurrentSets = lockStripes > 1;
+        if (sharersAware) {
+            rp = new LRUReplPolicy<true>(numLines, concurrentSets);
+        } else {
+            rp = new LRUReplPolicy<false>(numLines, concurrentSets);
+        }
+    } else if (replType == "LFU") {
+        rp = new LFUReplPolicy(numLines);
+    } else if (replType == "LRUProfViol") {
+        ProfViolReplPolicy< LRUReplPolicy<true> >* pvrp = new ProfViolReplPolicy< LRUReplPolicy<true> >(numLines);
+        pvrp->init(numLines);
+        rp = pvrp;
+    } else if (replType == "TreeLRU") {
+        rp = new TreeLRUReplPolicy(numLines, candidates);
+    } else if (replType == "NRU") {
+        rp = new NRUReplPolicy(numLines, candidates);
+    } else if (replType == "Rand") {
+        rp = new RandReplPolicy(candidates);
+    } else if (replType == "WayPart" || replType == "Vantage" || replType == "IdealLRUPart") {
+        if (replType == "WayPart" && arrayType != "SetAssoc") panic("WayPart replacement requires SetAssoc array");
+
+        //Partition mapper
+        // TODO: One partition mapper per cache (not bank).
+        string partMapper = config.get<const char*>(prefix + "repl.partMapper", "Core");
+        PartMapper* pm = nullptr;
+        if (partMapper == "Core") {
+            pm = new CorePartMapper(zinfo->numCores); //NOTE: If the cache is not fully shared, trhis will be inefficient...
+        } else if (partMapper == "InstrData") {
+            pm = new InstrDataPartMapper();
+        } else if (partMapper == "InstrDataCore") {
+            pm = new InstrDataCorePartMapper(zinfo->numCores);
+        } else if (partMapper == "Process") {
+            pm = new ProcessPartMapper(zinfo->numProcs);
+        } else if (partMapper == "InstrDataProcess") {
+            pm = new InstrDataProcessPartMapper(zinfo->numProcs);
+        } else if (partMapper == "ProcessGroup") {
+            pm = new ProcessGroupPartMapper();
+        } else {
+            panic("Invalid repl.partMapper %s on %s", partMapper.c_str(), name.c_str());
+        }
+
+        // Partition monitor
+        uint32_t umonLines = config.get<uint32_t>(prefix + "repl.umonLines", 256);
+        uint32_t umonWays = config.get<uint32_t>(prefix + "repl.umonWays", ways);
+        uint32_t buckets;
+        if (replType == "WayPart") {
+            buckets = ways; //not an option with WayPart
+        } else { //Vantage or Ideal
+            buckets = config.get<uint32_t>(prefix + "repl.buckets", 256);
+        }
+
+        PartitionMonitor* mon = new UMonMonitor(numLines, umonLines, umonWays, pm->getNumPartitions(), buckets);
+
+        //Finally, instantiate the repl policy
+        PartReplPolicy* prp;
+        double allocPortion = 1.0;
+        if (replType == "WayPart") {
+            //if set, drives partitioner but doesn't actually do partitioning
+            bool testMode = config.get<bool>(prefix + "repl.testMode", false);
+            prp = new WayPartReplPolicy(mon, pm, numLines, ways, testMode);
+        } else if (replType == "IdealLRUPart") {
+            prp = new IdealLRUPartReplPolicy(mon, pm, numLines, buckets);
+        } else { //Vantage
+            uint32_t assoc = (arrayType == "Z")? candidates : ways;
+            allocPortion = .85;
+            bool smoothTransients = config.get<bool>(prefix + "repl.smoothTransients", false);
+            prp = new VantageReplPolicy(mon, pm, numLines, assoc, (uint32_t)(allocPortion * 100), 10, 50, buckets, smoothTransients);
+        }
+        rp = prp;
+
+        // Partitioner
+        // TODO: Depending on partitioner type, we want one per bank or one per cache.
+        // Peekahead gives the same allocations as Lookahead, but is much faster with many partitions/buckets
+        string partitionerType = config.get<const char*>(prefix + "repl.partitioner", "Lookahead");
+        LookaheadPartitioner* p = nullptr;
+        if (partitionerType == "Lookahead") {
+            p = new LookaheadPartitioner(prp, pm->getNumPartitions(), buckets, 1, allocPortion);
+        } else if (partitionerType == "Peekahead") {
+            p = new PeekaheadPartitioner(prp, pm->getNumPartitions(), buckets, 1, allocPortion);
+        } else {
+            panic("Invalid repl.partitioner %s on %s", partitionerType.c_str(), name.c_str());
+        }
+
+        // Record miss curves (e.g., to benchmark partitioners offline with partbench)
+        if (config.get<bool>(prefix + "repl.dumpCurves", false)) {
+            g_string curvesFile = g_string(zinfo->outputDir) + "/" + name + ".curves";
+            p->setCurvesFile(curvesFile.c_str());
+        }
+
+        //Schedule its tick
+        uint32_t interval = config.get<uint32_t>(prefix + "repl.interval", 5000); //phases
+        zinfo->eventQueue->insert(new Partitioner::PartitionEvent(p, interval));
+    } else {
+        panic("%s: Invalid replacement type %s", name.c_str(), replType.c_str());
+    }
+    assert(rp);
+
+
+    //Alright, build the array
+    CacheArray* array = nullptr;
+    if (arrayType == "SetAssoc") {
+        array = new SetAssocArray(numLines, ways, rp, hf);
+    } else if (arrayType == "Z") {
+        array = new ZArray(numLines, ways, candidates, rp, hf);
+    } else if (arrayType == "IdealLRU") {
+        assert(replType == "LRU");
+        assert(!hf);
+        IdealLRUArray* ila = new IdealLRUArray(numLines);
+        rp = ila->getRP();
+        array = ila;
+    } else if (arrayType == "IdealLRUPart") {
+        assert(!hf);
+        IdealLRUPartReplPolicy* irp = dynamic_cast<IdealLRUPartReplPolicy*>(rp);
+        if (!irp) panic("IdealLRUPart array needs IdealLRUPart repl policy!");
+        array = new IdealLRUPartArray(numLines, irp);
+    } else {
+        panic("This should not happen, we already checked for it!"); //unless someone changed arrayStr...
+    }
+
+    //Latency
+    uint32_t latency = config.get<uint32_t>(prefix + "latency", 10);
+    uint32_t accLat = (isTerminal)? 0 : latency; //terminal caches has no access latency b/c it is assumed accLat is hidden by the pipeline
+    uint32_t invLat = latency;
+
+    // Inclusion?
+    bool nonInclusiveHack = config.get<bool>(prefix + "nonInclusiveHack", false);
+    if (nonInclusiveHack) assert(type == "Simple" && !isTerminal);
+
+    // Finally, build the cache
+    Cache* cache;
+    CC* cc;
+    if (isTerminal) {
+        cc = new MESITerminalCC(numLines, name, lockStripes, hf, profileLocks);
+    } else {
+        cc = new MESICC(numLines, nonInclusiveHack, name, lockStripes, hf, profileLocks);
+    }
+    rp->setCC(cc);
+    if (!isTerminal) {
+        if (type == "Simple") {
+            cache = new Cache(numLines, cc, array, rp, accLat, invLat, name);
+        } else if (type == "Timing") {
+            uint32_t mshrs = config.get<uint32_t>(prefix + "mshrs", 16);
+            uint32_t tagLat = config.get<uint32_t>(prefix + "tagLat", 5);
+            uint32_t timingCandidates = config.get<uint32_t>(prefix + "timingCandidates", candidates);
+            // By default, a group with one single-bank cache per core is private (e.g., per-core L2s)
+            bool isPrivate = config.get<bool>(prefix + "private",
+                    config.get<uint32_t>(prefix + "caches", 1) == zinfo->numCores && config.get<uint32_t>(prefix + "banks", 1) == 1);
+            bool elideHits = isPrivate && config.get<bool>("sim.elidePrivateHits", false);
+            cache = new TimingCache(numLines, cc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, elideHits, name);
+        } else if (type == "Tracing") {
+            g_string traceFile = config.get<const char*>(prefix + "traceFile","");
+            if (traceFile.empty()) traceFile = g_string(zinfo->outputDir) + "/" + name + ".trace";
+            cache = new TracingCache(numLines, cc, array, rp, accLat, invLat, traceFile, name);
+        } else {
+            panic("Invalid cache type %s", type.c_str());
+        }
+    } else {
+        //Filter cache optimization
+        if (type != "Simple") panic("Terminal cache %s can only have type == Simple", name.c_str());
+        if (arrayType != "SetAssoc" || hashType != "None" || replType != "LRU") panic("Invalid FilterCache config %s", name.c_str());
+        cache = new FilterCache(numSets, numLines, cc, array, rp, accLat, invLat, name);
+    }
+
+#if 0
+    info("Built L%d bank, %d bytes, %d lines, %d ways (%d candidates if array is Z), %s array, %s hash, %s replacement, accLat %d, invLat %d name %s",
+            level, bankSize, numLines, ways, candidates, arrayType.c_str(), hashType.c_str(), replType.c_str(), accLat, invLat, name.c_str());
+#endif
+
+    return cache;
+}
+
+/* Parallel construction (sim.initThreads) */
+
+// A bank whose construction was deferred to run in parallel with others
+struct BankBuildTask {
+    CacheGroup* cg;
+    uint32_t cache, bank;
+    string prefix;
+    g_string name;
+    uint32_t bankSize;
+    bool isTerminal;
+    uint32_t domain;
+};
+
+// Runs func(0..numTasks-1) on the calling thread and up to numThreads-1 helpers, which claim tasks in order
+template <typename F>
+class ParallelTasks {
+    private:
+        F& func;
+        const uint32_t numTasks;
+        volatile uint32_t nextTask;
+        volatile uint32_t runningHelpers;
+
+        void work() {
+            while (true) {
+                uint32_t task = __sync_fetch_and_add(&nextTask, 1);
+                if (task >= numTasks) break;
+                func(task);
+            }
+        }
+
+        static void helperThread(void* arg) {
+            ParallelTasks* pt = static_cast<ParallelTasks*>(arg);
+            pt->work();
+            __sync_fetch_and_sub(&pt->runningHelpers, 1);  // last access, pt may go away after this
+        }
+
+    public:
+        ParallelTasks(F& _func, uint32_t _numTasks) : func(_func), numTasks(_numTasks), nextTask(0), runningHelpers(0) {}
+
+        void run(uint32_t numThreads, BuildThreadSpawnFn spawnThread) {
+            uint32_t helpers = spawnThread? std::min(numThreads, numTasks) : 1;
+            helpers = helpers? helpers - 1 : 0;
+            runningHelpers = helpers;
+            for (uint32_t i = 0; i < helpers; i++) spawnThread(helperThread, this);
+            work();
+            while (runningHelpers) usleep(100);
+        }
+};
+
+template <typename F>
+static void RunParallel(uint32_t numTasks, uint32_t numThreads, BuildThreadSpawnFn spawnThread, F func) {
+    ParallelTasks<F> pt(func, numTasks);
+    pt.run(numThreads, spawnThread);
+}
+
+// If deferred is non-null, builds only the first bank, and appends the others to deferred
+static CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal, vector<BankBuildTask>* deferred) {
+    CacheGroup* cgp = new CacheGroup;
+    CacheGroup& cg = *cgp;
+
+    string prefix = "sys.caches." + name + ".";
+
+    bool isPrefetcher = config.get<bool>(prefix + "isPrefetcher", false);
+    if (isPrefetcher) { //build a prefetcher group
+        uint32_t prefetchers = config.get<uint32_t>(prefix + "prefetchers", 1);
+        uint32_t entries = config.get<uint32_t>(prefix + "entries", 16);
+        uint32_t pageLines = config.get<uint32_t>(prefix + "pageLines", 64);
+        cg.resize(prefetchers);
+        for (vector<BaseCache*>& bg : cg) bg.resize(1);
+        for (uint32_t i = 0; i < prefetchers; i++) {
+            stringstream ss;
+            ss << name << "-" << i;
+            g_string pfName(ss.str().c_str());
+            cg[i][0] = new StreamPrefetcher(pfName, entries, pageLines);
+        }
+        return cgp;
+    }
+
+    uint32_t size = config.get<uint32_t>(prefix + "size", 64*1024);
+    uint32_t banks = config.get<uint32_t>(prefix + "banks", 1);
+    uint32_t caches = config.get<uint32_t>(prefix + "caches", 1);
+
+    uint32_t bankSize = size/banks;
+    if (size % banks != 0) {
+        panic("%s: banks (%d) does not divide the size (%d bytes)", name.c_str(), banks, size);
+    }
+
+    cg.resize(caches);
+    for (vector<BaseCache*>& bg : cg) bg.resize(banks);
+
+    // Tracing caches register their trace writers in zinfo, so they are always built serially
+    string type = config.get<const char*>(prefix + "type", "Simple");
+    if (type == "Tracing" || type == "TraceDriven") deferred = nullptr;
+
+    for (uint32_t i = 0; i < caches; i++) {
+        for (uint32_t j = 0; j < banks; j++) {
+            stringstream ss;
+            ss << name << "-" << i;
+            if (banks > 1) {
+                ss << "b" << j;
+            }
+            g_string bankName(ss.str().c_str());
+            uint32_t domain = (i*banks + j)*zinfo->numDomains/(caches*banks); //(banks > 1)? nextDomain() : (i*banks + j)*zinfo->numDomains/(caches*banks);
+            if (deferred && (i || j)) {
+                deferred->push_back({cgp, i, j, prefix, bankName, bankSize, isTerminal, domain});
+            } else {
+                cg[i][j] = BuildCacheBank(config, prefix, bankName, bankSize, isTerminal, domain);
+            }
+        }
+    }
+
+    return cgp;
+}
+
+CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal) {
+    return BuildCacheGroup(config, name, isTerminal, nullptr);
+}
+
+CacheHierarchy::~CacheHierarchy() {
+    for (auto& kv : groups) delete kv.second;
+}
+
+CacheHierarchy* BuildCacheHierarchy(Config& config, BuildThreadSpawnFn spawnThread) {
+    CacheHierarchy* hier = new CacheHierarchy();
+    hier->buildThreads = std::max(config.get<uint32_t>("sim.initThreads", 1), 1u);
+    hier->spawnThread = spawnThread;
+    if (!spawnThread) hier->buildThreads = 1;
+    unordered_map<string, string>& parentMap = hier->parents; //child -> parent
+    unordered_map<string, vector<vector<string>>>& childMap = hier->children; //parent -> children (a parent may have multiple children)
+
+    auto parseChildren = [](string children) {
+        // 1st dim: concatenated caches; 2nd dim: interleaved caches
+        // Example: "l2-beefy l1i-wimpy|l1d-wimpy" produces [["l2-beefy"], ["l1i-wimpy", "l1d-wimpy"]]
+        // If there are 2 of each cache, the final vector will be l2-beefy-0 l2-beefy-1 l1i-wimpy-0 l1d-wimpy-0 l1i-wimpy-1 l1d-wimpy-1
+        vector<string> concatGroups = ParseList<string>(children);
+        vector<vector<string>> cVec;
+        for (string cg : concatGroups) cVec.push_back(ParseList<string>(cg, "|"));
+        return cVec;
+    };
+
+    // If a network file is specified, build a Network
+    string networkFile = config.get<const char*>("sys.networkFile", "");
+    Network* network = (networkFile != "")? new Network(networkFile.c_str()) : nullptr;
+
+    // Build the caches
+    vector<const char*>& cacheGroupNames = hier->groupNames;
+    config.subgroups("sys.caches", cacheGroupNames);
+    string prefix = "sys.caches.";
+
+    for (const char* grp : cacheGroupNames) {
+        string group(grp);
+        if (group == "mem") panic("'mem' is an invalid cache group name");
+        if (childMap.count(group)) panic("Duplicate cache group %s", (prefix + group).c_str());
+
+        string children = config.get<const char*>(prefix + group + ".children", "");
+        childMap[group] = parseChildren(children);
+        for (auto v : childMap[group]) for (auto child : v) {
+            if (parentMap.count(child)) {
+                panic("Cache group %s can have only one parent (%s and %s found)", child.c_str(), parentMap[child].c_str(), grp);
+            }
+            parentMap[child] = group;
+        }
+    }
+
+    // Check that children are valid (another cache)
+    for (auto& it : parentMap) {
+        bool found = false;
+        for (auto& grp : cacheGroupNames) found |= it.first == grp;
+        if (!found) panic("%s has invalid child %s", it.second.c_str(), it.first.c_str());
+    }
+
+    // Get the (single) LLC
+    vector<string> parentlessCacheGroups;
+    for (auto& it : childMap) if (!parentMap.count(it.first)) parentlessCacheGroups.push_back(it.first);
+    if (parentlessCacheGroups.size() != 1) panic("Only one last-level cache allowed, found: %s", Str(parentlessCacheGroups).c_str());
+    hier->llc = parentlessCacheGroups[0];
+    const string& llc = hier->llc;
+
+    auto isTerminal = [&](string group) -> bool {
+        return hier->isTerminal(group);
+    };
+
+    // Build each of the groups, starting with the LLC
+    unordered_map<string, CacheGroup*>& cMap = hier->groups;
+    vector<BankBuildTask> deferredBanks;
+    bool parallel = hier->buildThreads > 1;
+    list<string> fringe;  // FIFO
+    fringe.push_back(llc);
+    while (!fringe.empty()) {
+        string group = fringe.front();
+        fringe.pop_front();
+        if (cMap.count(group)) panic("The cache 'tree' has a loop at %s", group.c_str());
+        cMap[group] = BuildCacheGroup(config, group, isTerminal(group), parallel? &deferredBanks : nullptr);
+        for (auto& childVec : childMap[group]) fringe.insert(fringe.end(), childVec.begin(), childVec.end());
+    }
+
+    if (!deferredBanks.empty()) {
+        auto buildBank = [&](uint32_t i) {
+            BankBuildTask& t = deferredBanks[i];
+            (*t.cg)[t.cache][t.bank] = BuildCacheBank(config, t.prefix, t.name, t.bankSize, t.isTerminal, t.domain);
+        };
+        RunParallel(deferredBanks.size(), hier->buildThreads, spawnThread, buildBank);
+        info("Built %ld cache banks on %d threads", deferredBanks.size() + cMap.size(), hier->buildThreads);
+    }
+
+    //Check single LLC
+    if (cMap[llc]->size() != 1) panic("Last-level cache %s must have caches = 1, but %ld were specified", llc.c_str(), cMap[llc]->size());
+
+    /* Since we have checked for no loops, parent is mandatory, and all parents are checked valid,
+     * it follows that we have a fully connected tree finishing at the LLC.
+     */
+
+    //Build the memory controllers
+    uint32_t memControllers = config.get<uint32_t>("sys.mem.controllers", 1);
+    assert(memControllers > 0);
+
+    g_vector<MemObject*>& mems = hier->mems;
+    mems.resize(memControllers);
+
+    for (uint32_t i = 0; i < memControllers; i++) {
+        stringstream ss;
+        ss << "mem-" << i;
+        g_string name(ss.str().c_str());
+        //uint32_t domain = nextDomain(); //i*zinfo->numDomains/memControllers;
+        uint32_t domain = i*zinfo->numDomains/memControllers;
+        mems[i] = BuildMemoryController(config, zinfo->lineSize, zinfo->freqMHz, domain, name);
+    }
+
+    //With NUMA nodes, each node gets an equal share of the controllers
+    uint32_t numNodes = zinfo->vm? zinfo->vm->getNumNodes() : 1;
+    bool splitAddrs = config.get<bool>("sys.mem.splitAddrs", true);
+    if (numNodes > 1) {
+        if (memControllers == 1 || !splitAddrs) {
+            warn("sys.vm.numaNodes = %d, but memory addresses are not split across controllers; NUMA placement has no effect", numNodes);
+            numNodes = 1;
+        } else if (memControllers % numNodes) {
+            warn("sys.mem.controllers (%d) is not a multiple of sys.vm.numaNodes (%d); NUMA placement has no effect", memControllers, numNodes);
+            numNodes = 1;
+        }
+    }
+
+    if (memControllers > 1) {
+        if (splitAddrs) {
+            uint32_t nodeLineShift = (numNodes > 1)? zinfo->vm->getNodeLineShift(ilog2(zinfo->lineSize)) : 0;
+            MemObject* splitter = new SplitAddrMemory(mems, "mem-splitter", numNodes, nodeLineShift);
+            mems.resize(1);
+            mems[0] = splitter;
+        }
+    }
+
+    //Connect everything
+    bool printHierarchy = config.get<bool>("sim.printHierarchy", false);
+
+    // mem to llc is a bit special, only one llc
+    uint32_t childId = 0;
+    for (BaseCache* llcBank : (*cMap[llc])[0]) {
+        llcBank->setParents(childId++, mems, network);
+    }
+
+    // Rest of caches
+    for (const char* grp : cacheGroupNames) {
+        if (isTerminal(grp)) continue; //skip terminal caches
+
+        CacheGroup& parentCaches = *cMap[grp];
+        uint32_t parents = parentCaches.size();
+        assert(parents);
+
+        // Linearize concatenated / interleaved caches from childMap cacheGroups
+        CacheGroup childCaches;
+
+        for (auto childVec : childMap[grp]) {
+            if (!childVec.size()) continue;
+            size_t vecSize = cMap[childVec[0]]->size();
+            for (string child : childVec) {
+                if (cMap[child]->size() != vecSize) {
+                    panic("In interleaved group %s, %s has a different number of caches", Str(childVec).c_str(), child.c_str());
+                }
+            }
+
+            CacheGroup interleavedGroup;
+            for (uint32_t i = 0; i < vecSize; i++) {
+                for (uint32_t j = 0; j < childVec.size(); j++) {
+                    interleavedGroup.push_back(cMap[childVec[j]]->at(i));
+                }
+            }
+
+            childCaches.insert(childCaches.end(), interleavedGroup.begin(), interleavedGroup.end());
+        }
+
+        uint32_t children = childCaches.size();
+        assert(children);
+
+        uint32_t childrenPerParent = children/parents;
+        if (children % parents != 0) {
+            panic("%s has %d caches and %d children, they are non-divisible. "
+                  "Use multiple groups for non-homogeneous children per parent!", grp, parents, children);
+        }
+
+        for (uint32_t p = 0; p < parents; p++) {
+            g_vector<MemObject*> parentsVec;
+            parentsVec.insert(parentsVec.end(), parentCaches[p].begin(), parentCaches[p].end()); //BaseCache* to MemObject* is a safe cast
+
+            uint32_t childId = 0;
+            g_vector<BaseCache*> childrenVec;
+            for (uint32_t c = p*childrenPerParent; c < (p+1)*childrenPerParent; c++) {
+                for (BaseCache* bank : childCaches[c]) {
+                    bank->setParents(childId++, parentsVec, network);
+                    childrenVec.push_back(bank);
+                }
+            }
+
+            if (printHierarchy) {
+                vector<string> cacheNames;
+                std::transform(childrenVec.begin(), childrenVec.end(), std::back_inserter(cacheNames),
+                        [](BaseCache* c) -> string { string s = c->getName(); return s; });
+
+                string parentName = parentCaches[p][0]->getName();
+                if (parentCaches[p].size() > 1) {
+                    parentName += "..";
+                    parentName += parentCaches[p][parentCaches[p].size()-1]->getName();
+                }
+                info("Hierarchy: %s -> %s", Str(cacheNames).c_str(), parentName.c_str());
+            }
+
+            for (BaseCache* bank : parentCaches[p]) {
+                bank->setChildren(childrenVec, network);
+            }
+        }
+    }
+
+    //Check that all the terminal caches have a single bank
+    for (const char* grp : cacheGroupNames) {
+        if (isTerminal(grp)) {
+            uint32_t banks = (*cMap[grp])[0].size();
+            if (banks != 1) panic("Terminal cache group %s needs to have a single bank, has %d", grp, banks);
+        }
+    }
+
+    return hier;
+}
+
+void InitCacheHierarchyStats(const CacheHierarchy* hier, AggregateStat* parentStat) {
+    // Create the group stats in order, then fill them in parallel
+    vector<CacheGroup*> groups;
+    vector<AggregateStat*> groupStats;
+    for (const char* group : hier->groupNames) {
+        CacheGroup* cg = hier->groups.at(group);
+        AggregateStat* groupStat = new AggregateStat(true);
+        groupStat->init(gm_strdup(group), "Cache stats");
+        uint32_t banks = 0;
+        for (vector<BaseCache*>& bg : *cg) banks += bg.size();
+        groupStat->reserve(banks);  // a single allocation for the children
+        parentStat->append(groupStat);
+        groups.push_back(cg);
+        groupStats.push_back(groupStat);
+    }
+
+    auto initGroupStats = [&](uint32_t g) {
+        for (vector<BaseCache*>& banks : *groups[g]) for (BaseCache* bank : banks) bank->initStats(groupStats[g]);
+    };
+    RunParallel(groups.size(), hier->buildThreads, hier->spawnThread, initGroupStats);
+
+    AggregateStat* memStat = new AggregateStat(true);
+    memStat->init("mem", "Memory controller stats");
+    for (auto mem : hier->mems) mem->initStats(memStat);
+    parentStat->append(memStat);
+}
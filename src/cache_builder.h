@@ -0,0 +1,85 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHE_BUILDER_H_
+#define CACHE_BUILDER_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+
+class AggregateStat;
+class BaseCache;
+class Config;
+class MemObject;
+
+/* Builds the cache hierarchy (sys.caches) and memory controllers (sys.mem)
+ * from the config, and connects them. This does not depend on Pin, so
+ * standalone drivers (e.g., cachebench) can build the same hierarchy as
+ * SimInit, then connect their own requestors to the terminal caches.
+ */
+
+typedef std::vector<std::vector<BaseCache*>> CacheGroup;  // [cache][bank]
+
+// Spawns a helper thread that runs func(arg); zsim uses Pin internal threads
+typedef void (*BuildThreadSpawnFn)(void (*func)(void*), void* arg);
+
+struct CacheHierarchy {
+    std::vector<const char*> groupNames;  // in config order
+    std::unordered_map<std::string, CacheGroup*> groups;
+    std::unordered_map<std::string, std::string> parents;  // child -> parent group
+    std::unordered_map<std::string, std::vector<std::vector<std::string>>> children;  // parent -> [concatenated][interleaved] children
+    g_vector<MemObject*> mems;  // a single splitter with multiple controllers and sys.mem.splitAddrs
+    std::string llc;
+    uint32_t buildThreads;  // sim.initThreads, also used to init stats
+    BuildThreadSpawnFn spawnThread;
+
+    bool isTerminal(const std::string& group) const {
+        auto it = children.find(group);
+        return it == children.end() || it->second.empty();
+    }
+
+    ~CacheHierarchy();  // deletes the cache groups, not the caches
+};
+
+BaseCache* BuildCacheBank(Config& config, const std::string& prefix, g_string& name, uint32_t bankSize, bool isTerminal, uint32_t domain);
+
+CacheGroup* BuildCacheGroup(Config& config, const std::string& name, bool isTerminal);
+
+/* Needs zinfo's lineSize, numCores, numDomains, freqMHz and (if used) vm, eventQueue and contentionSim.
+ * With sim.initThreads > 1, builds cache banks on that many threads (the caller and helpers started
+ * with spawnThread). Each group's first bank is still built serially, in the same order as a serial
+ * build, so config errors, defaults and out.cfg do not change; the other banks, which read the same
+ * settings, are then built in any order, and end up identical to a serially-built bank.
+ */
+CacheHierarchy* BuildCacheHierarchy(Config& config, BuildThreadSpawnFn spawnThread = nullptr);
+
+// Appends one stat per cache group, then the memory controllers' stats. Groups init their stats in parallel, like BuildCacheHierarchy.
+void InitCacheHierarchyStats(const CacheHierarchy* hier, AggregateStat* parentStat);
+
+#endif  // CACHE_BUILDER_H_
@@ -0,0 +1,453 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Cache hierarchy microbenchmark. Builds the caches and memory controllers of
+ * a zsim config with the same code as SimInit, and drives them without Pin:
+ * each host thread plays a simple blocking core, issuing loads and stores to
+ * one of the terminal (L1d) caches. Threads run the bound phase concurrently
+ * and synchronize every phase, so coherence and cache locks see the same
+ * kind of concurrency as in a full simulation. Weave-phase models (Timing
+ * caches, Weave/DDR memory) get their events simulated between phases.
+ *
+ * Reports host accesses/sec overall and per cache level, hit rates, weave
+ * phase event simulations, and, with sim.profileCCLocks = true, how often and
+ * how long threads waited on each level's locks. Use it to benchmark cache-side changes in isolation.
+ * -P period (or sim.memSampling.period) turns on the memory access sampler,
+ * to measure its overhead; the profile goes to ./zsim-memprof.txt.
+ *
+ * Patterns (footprint -f is in KB; per thread unless noted):
+ *   zipf:     Zipf-distributed lines (exponent -a) over a footprint shared
+ *             by all threads, spread across the address space
+ *   stride:   sweeps a private footprint with a stride of -S bytes
+ *   chase:    follows a random cyclic permutation of a private footprint
+ *   prodcons: pairs of threads; even threads store to a ring of lines that
+ *             the next odd thread loads from (ignores -w)
+ *   trace:    replays a zsim access trace (-T, e.g. from a Tracing cache);
+ *             stream i goes to thread i % threads, GETX and PUTX records
+ *             become stores and the rest loads
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "access_tracing.h"
+#include "bithacks.h"
+#include "cache_builder.h"
+#include "config.h"
+#include "contention_sim.h"
+#include "event_queue.h"
+#include "event_recorder.h"
+#include "filter_cache.h"
+#include "galloc.h"
+#include "log.h"
+#include "mem_sampler.h"
+#include "profile_stats.h"
+#include "standalone_threads.h"
+#include "stats.h"
+#include "timing_event.h"
+#include "zsim.h"
+
+using std::string;
+using std::vector;
+
+// Process-wide globals (see zsim.h); a single process
+GlobSimInfo* zinfo;
+uint32_t procIdx = 0;
+uint32_t lineBits;
+uint64_t procMask = 0;
+
+struct Params {
+    const char* configFile = nullptr;
+    const char* dcache = nullptr;  // terminal cache group, defaults to the first core group's dcache
+    const char* traceFile = nullptr;
+    string pattern = "zipf";
+    uint32_t threads = 0;  // 0 -> one per cache in the dcache group
+    uint64_t accesses = 1000000;  // per thread
+    uint32_t writePct = 20;
+    uint32_t footprintKB = 1024;
+    double alpha = 0.99;
+    uint32_t stride = 64;
+    uint64_t seed = 1;
+    int64_t samplingPeriod = -1;  // -1 -> sim.memSampling.period
+};
+
+static inline uint64_t Rnd(uint64_t& s) {
+    s = s*6364136223846793005ULL + 1442695040888963407ULL;
+    return s >> 33;
+}
+
+// Produces the (byte) addresses of one thread
+class Generator {
+    private:
+        const Params& p;
+        uint32_t tid;
+        uint64_t s;
+        uint64_t lines;
+        uint32_t lineBits;
+        uint64_t i;
+        Address base;
+        Address cur;
+        vector<uint32_t> next;  // chase permutation
+        vector<AccessRecord> recs;  // trace
+
+    public:
+        Generator(const Params& _p, uint32_t _tid, uint32_t lineSize) : p(_p), tid(_tid), i(0), cur(0) {
+            s = p.seed*1000003 + tid;
+            lineBits = ilog2(lineSize);
+            lines = std::max(((uint64_t)p.footprintKB << 10) >> lineBits, 1ul);
+            base = ((Address)(tid + 1)) << 32;  // private regions, 4GB apart
+            if (p.pattern == "chase") {
+                if (lines > (1ul << 32)) panic("chase footprint too large");
+                // Sattolo's algorithm, gives a single cycle through all lines
+                next.resize(lines);
+                for (uint64_t l = 0; l < lines; l++) next[l] = l;
+                for (uint64_t l = lines - 1; l > 0; l--) std::swap(next[l], next[Rnd(s) % l]);
+            }
+        }
+
+        void addRecord(const AccessRecord& rec) {recs.push_back(rec);}
+        uint64_t numRecords() const {return recs.size();}
+
+        // Returns the address and sets isWrite
+        inline Address nextAddr(bool& isWrite) {
+            Address lineAddr;
+            isWrite = Rnd(s) % 100 < p.writePct;
+            if (p.pattern == "zipf") {
+                // Inverse CDF of the continuous approximation of Zipf over [1, lines]
+                double u = (Rnd(s) + 0.5)/(1ul << 31);
+                double a = 1.0 - p.alpha;
+                uint64_t rank = (fabs(a) < 1e-6)? (uint64_t)pow(lines, u) : (uint64_t)pow((pow(lines, a) - 1.0)*u + 1.0, 1.0/a);
+                // Scatter ranks so hot lines do not all fall in the same sets
+                lineAddr = ((rank*0x9E3779B97F4A7C15ULL) >> 20) % (lines << 4);
+            } else if (p.pattern == "stride") {
+                lineAddr = base + ((i*p.stride) >> lineBits) % lines;
+            } else if (p.pattern == "chase") {
+                cur = next[cur];
+                lineAddr = base + cur;
+            } else if (p.pattern == "prodcons") {
+                Address ring = ((Address)(tid/2 + 1)) << 36;  // shared by each pair
+                lineAddr = ring + i % lines;
+                isWrite = (tid % 2 == 0);
+            } else {
+                assert(p.pattern == "trace");
+                const AccessRecord& rec = recs[i];
+                lineAddr = rec.lineAddr;
+                isWrite = (rec.type == GETX || rec.type == PUTX);
+            }
+            i++;
+            return lineAddr << lineBits;
+        }
+};
+
+struct ThreadState {
+    uint32_t tid;
+    FilterCache* dcache;
+    EventRecorder* evRec;
+    Generator* gen;
+    uint64_t accesses;  // to issue
+    uint64_t issued;
+    uint64_t curCycle;
+    uint64_t latCycles;
+} ATTR_LINE_ALIGNED;
+
+static pthread_barrier_t phaseBarrier;
+static volatile uint64_t phaseLimit;
+static volatile bool terminate = false;
+
+static void* BenchThread(void* arg) {
+    ThreadState* ts = static_cast<ThreadState*>(arg);
+    while (true) {
+        pthread_barrier_wait(&phaseBarrier);  // phase start
+        if (terminate) break;
+        uint64_t limit = phaseLimit;
+        while (ts->curCycle < limit && ts->issued < ts->accesses) {
+            bool isWrite;
+            Address addr = ts->gen->nextAddr(isWrite);
+            uint64_t startCycle = ts->curCycle;
+            uint64_t respCycle = isWrite? ts->dcache->store(addr, startCycle) : ts->dcache->load(addr, startCycle);
+            if (ts->evRec && ts->evRec->hasRecord()) {
+                TimingRecord tr = ts->evRec->popRecord();
+                IssueEvent* iss = new (ts->evRec) IssueEvent();  // root of the access's weave-phase events
+                iss->setMinStartCycle(tr.reqCycle);
+                iss->addChild(tr.startEvent, ts->evRec);
+                iss->queue(tr.reqCycle);
+            }
+            ts->latCycles += respCycle - startCycle;
+            ts->curCycle = respCycle + 1;  // one cycle per instruction between accesses
+            ts->issued++;
+        }
+        pthread_barrier_wait(&phaseBarrier);  // phase end
+    }
+    return nullptr;
+}
+
+// Per-level totals, summed over the scalar stats of a cache group
+struct LevelStats {
+    uint64_t hits, misses;
+    uint64_t lockAcqs, lockWaits, lockWaitCycles;
+    bool lockProfile;
+};
+
+static void SumLevelStats(Stat* s, bool inLock, LevelStats& ls) {
+    if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
+        bool isLock = strcmp(as->name(), "bottomLock") == 0 || strcmp(as->name(), "topLock") == 0;
+        ls.lockProfile |= isLock;
+        for (uint32_t i = 0; i < as->curSize(); i++) SumLevelStats(as->get(i), inLock || isLock, ls);
+    } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(s)) {
+        const char* n = ss->name();
+        if (inLock) {
+            if (strcmp(n, "acq") == 0) ls.lockAcqs += ss->get();
+            else if (strcmp(n, "waits") == 0) ls.lockWaits += ss->get();
+            else if (strcmp(n, "waitCycles") == 0) ls.lockWaitCycles += ss->get();
+        } else if (!strcmp(n, "fhGETS") || !strcmp(n, "fhGETX") || !strcmp(n, "hGETS") || !strcmp(n, "hGETX")) {
+            ls.hits += ss->get();
+        } else if (!strcmp(n, "mGETS") || !strcmp(n, "mGETXIM") || !strcmp(n, "mGETXSM")) {
+            ls.misses += ss->get();
+        }
+    }
+}
+
+// Weave phase event simulations, summed over all domains (contention.domain-N.sims)
+static uint64_t CountWeaveSims() {
+    uint64_t sims = 0;
+    for (uint32_t i = 0; i < zinfo->rootStat->curSize(); i++) {
+        AggregateStat* cs = dynamic_cast<AggregateStat*>(zinfo->rootStat->get(i));
+        if (!cs || strcmp(cs->name(), "contention") != 0) continue;
+        for (uint32_t d = 0; d < cs->curSize(); d++) {
+            AggregateStat* ds = dynamic_cast<AggregateStat*>(cs->get(d));
+            for (uint32_t j = 0; ds && j < ds->curSize(); j++) {
+                ScalarStat* ss = dynamic_cast<ScalarStat*>(ds->get(j));
+                if (ss && strcmp(ss->name(), "sims") == 0) sims += ss->get();
+            }
+        }
+    }
+    return sims;
+}
+
+static uint32_t CountCores(Config& config) {
+    uint32_t numCores = 0;
+    vector<const char*> groups;
+    config.subgroups("sys.cores", groups);
+    for (const char* group : groups) numCores += config.get<uint32_t>(string("sys.cores.") + group + ".cores", 1);
+    return numCores;
+}
+
+static void usage(const char* argv0) {
+    info("Drives the cache hierarchy of a zsim config with synthetic accesses or a trace from multiple threads");
+    info("Usage: %s config [-d dcacheGroup] [-t threads] [-p zipf|stride|chase|prodcons|trace] [-T trace] [-n accessesPerThread] "
+            "[-w write%%] [-f footprintKB] [-a zipfAlpha] [-S strideBytes] [-s seed] [-P memSamplingPeriod]", argv0);
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog("");  // no log header
+
+    Params p;
+    if (argc < 2 || argv[1][0] == '-') usage(argv[0]);
+    p.configFile = argv[1];
+    for (int i = 2; i < argc; i++) {
+        if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 >= argc) usage(argv[0]);
+        const char* v = argv[++i];
+        switch (argv[i-1][1]) {
+            case 'd': p.dcache = v; break;
+            case 't': p.threads = strtoul(v, nullptr, 0); break;
+            case 'p': p.pattern = v; break;
+            case 'T': p.traceFile = v; p.pattern = "trace"; break;
+            case 'n': p.accesses = strtoul(v, nullptr, 0); break;
+            case 'w': p.writePct = strtoul(v, nullptr, 0); break;
+            case 'f': p.footprintKB = strtoul(v, nullptr, 0); break;
+            case 'a': p.alpha = strtod(v, nullptr); break;
+            case 'S': p.stride = strtoul(v, nullptr, 0); break;
+            case 's': p.seed = strtoul(v, nullptr, 0); break;
+            case 'P': p.samplingPeriod = strtoul(v, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (p.pattern != "zipf" && p.pattern != "stride" && p.pattern != "chase" && p.pattern != "prodcons" && p.pattern != "trace") usage(argv[0]);
+    if (p.pattern == "trace" && !p.traceFile) usage(argv[0]);
+
+    Config config(p.configFile);
+    gm_init(((size_t)config.get<uint32_t>("sim.gmMBytes", (1 << 10))) << 20);
+
+    // The parts of SimInit the memory hierarchy depends on
+    zinfo = gm_calloc<GlobSimInfo>();
+    zinfo->outputDir = gm_strdup(".");
+    zinfo->numCores = CountCores(config);
+    if (!zinfo->numCores) panic("Config must define some core classes in sys.cores");
+    zinfo->numDomains = 1;  // the driver's events do not cross domains
+    zinfo->numProcs = 1;
+    zinfo->maxProcs = 1;
+    zinfo->phaseLength = config.get<uint32_t>("sim.phaseLength", 10000);
+    zinfo->nextPhaseLength = zinfo->phaseLength;
+    zinfo->maxPhaseLength = zinfo->phaseLength;
+    zinfo->freqMHz = config.get<uint32_t>("sys.frequency", 2000);
+    zinfo->lineSize = config.get<uint32_t>("sys.lineSize", 64);
+    lineBits = ilog2(zinfo->lineSize);
+    zinfo->placement = nullptr;
+    zinfo->vm = nullptr;
+    if (config.get<bool>("sys.vm.enable", false)) warn("sys.vm is not supported, accesses use physical addresses");
+    zinfo->eventRecorders = gm_calloc<EventRecorder*>(zinfo->numCores);
+    zinfo->eventQueue = new EventQueue();
+    zinfo->traceWriters = new g_vector<AccessTraceWriter*>();  // Tracing caches
+
+    zinfo->rootStat = new AggregateStat();
+    zinfo->rootStat->init("root", "Stats");
+    zinfo->contentionSim = new ContentionSim(1, 1, false, SpawnThread);
+    zinfo->contentionSim->initStats(zinfo->rootStat);
+
+    // Memory access sampling, as in SimInit; accesses have no PCs, so the profile is by data object
+    uint32_t samplingPeriod = (p.samplingPeriod >= 0)? p.samplingPeriod : config.get<uint32_t>("sim.memSampling.period", 0);
+    if (samplingPeriod) {
+        zinfo->memSampler = new MemSampler(config, zinfo->numCores, samplingPeriod, SpawnThread);
+        zinfo->memSampler->initStats(zinfo->rootStat);
+    }
+
+    uint64_t buildStartNs = getNs();
+    CacheHierarchy* hier = BuildCacheHierarchy(config, SpawnThread);
+    InitCacheHierarchyStats(hier, zinfo->rootStat);
+    info("Built the cache hierarchy in %.3f s (sim.initThreads = %d)", (getNs() - buildStartNs)/1e9, hier->buildThreads);
+
+    // Pick the terminal cache group threads access
+    string dcache;
+    if (p.dcache) {
+        dcache = p.dcache;
+    } else {
+        vector<const char*> coreGroups;
+        config.subgroups("sys.cores", coreGroups);
+        dcache = config.get<const char*>(string("sys.cores.") + coreGroups[0] + ".dcache", "");
+    }
+    if (!hier->groups.count(dcache) || !hier->isTerminal(dcache)) panic("%s is not a terminal cache group", dcache.c_str());
+    CacheGroup& dgroup = *hier->groups[dcache];
+    if (!p.threads) p.threads = dgroup.size();
+    if (p.threads > dgroup.size()) panic("%d threads, but %s has only %ld caches", p.threads, dcache.c_str(), dgroup.size());
+
+    vector<ThreadState*> states;
+    for (uint32_t t = 0; t < p.threads; t++) {
+        ThreadState* ts = gm_memalign<ThreadState>(CACHE_LINE_BYTES, 1);
+        memset(ts, 0, sizeof(ThreadState));
+        ts->tid = t;
+        ts->dcache = dynamic_cast<FilterCache*>(dgroup[t][0]);
+        assert(ts->dcache);
+        ts->dcache->setSourceId(t);
+        if (zinfo->memSampler) ts->dcache->setSampler(zinfo->memSampler);
+        ts->evRec = new EventRecorder();
+        ts->evRec->setSourceId(t);
+        zinfo->eventRecorders[t] = ts->evRec;
+        ts->gen = new Generator(p, t, zinfo->lineSize);
+        ts->accesses = p.accesses;
+        ts->curCycle = zinfo->phaseLength;  // leave the first phase empty
+        states.push_back(ts);
+    }
+
+    if (p.pattern == "trace") {
+        AccessTraceReader tr(p.traceFile);
+        info("Trace %s: %ld records, %d streams", p.traceFile, tr.getNumRecords(), tr.getNumChildren());
+        while (!tr.empty()) {
+            AccessRecord rec = tr.read();
+            Generator* gen = states[rec.childId % p.threads]->gen;
+            if (gen->numRecords() < p.accesses) gen->addRecord(rec);
+        }
+        for (ThreadState* ts : states) ts->accesses = ts->gen->numRecords();
+    }
+
+    info("%s: %d threads on %s, %s pattern, %ld accesses/thread", p.configFile, p.threads, dcache.c_str(), p.pattern.c_str(), p.accesses);
+
+    pthread_barrier_init(&phaseBarrier, nullptr, p.threads + 1);
+    vector<pthread_t> threads(p.threads);
+    for (uint32_t t = 0; t < p.threads; t++) {
+        if (pthread_create(&threads[t], nullptr, BenchThread, states[t]) != 0) panic("pthread_create failed");
+    }
+
+    uint64_t boundNs = 0;
+    uint64_t weaveNs = 0;
+    uint64_t limit = 0;
+    while (true) {
+        limit += zinfo->phaseLength;
+        phaseLimit = limit;
+        uint64_t startNs = getNs();
+        pthread_barrier_wait(&phaseBarrier);  // phase start
+        pthread_barrier_wait(&phaseBarrier);  // phase end
+        boundNs += getNs() - startNs;
+
+        // End of phase actions, as in EndOfPhaseActions
+        startNs = getNs();
+        zinfo->contentionSim->simulatePhase(limit);
+        weaveNs += getNs() - startNs;
+        zinfo->numPhases++;
+        zinfo->globPhaseCycles = limit;
+        zinfo->eventQueue->tick();
+
+        bool done = true;
+        for (ThreadState* ts : states) done &= ts->issued == ts->accesses;
+        if (done) break;
+    }
+    terminate = true;
+    pthread_barrier_wait(&phaseBarrier);
+    for (pthread_t th : threads) pthread_join(th, nullptr);
+    for (AccessTraceWriter* t : *zinfo->traceWriters) t->dump(false);
+    if (zinfo->memSampler) zinfo->memSampler->dump();
+
+    uint64_t issued = 0;
+    uint64_t latCycles = 0;
+    uint64_t maxCycle = 0;
+    for (ThreadState* ts : states) {
+        issued += ts->issued;
+        latCycles += ts->latCycles;
+        maxCycle = std::max(maxCycle, ts->curCycle);
+    }
+
+    info("%ld accesses, %ld phases, %ld simulated cycles, %.1f cycles/access, bound %.3f s, weave %.3f s (%ld event sims), %.2f Maccesses/s",
+            issued, zinfo->numPhases, maxCycle, ((double)latCycles)/std::max(issued, 1ul), boundNs/1e9, weaveNs/1e9,
+            CountWeaveSims(), issued*1e3/std::max(boundNs + weaveNs, 1ul));
+
+    // Levels from the L1s up; all accesses/sec are over bound phase time
+    printf("%-10s %12s %8s %12s %12s %8s %14s\n", "level", "accesses", "hit%", "Macc/s", "lockAcqs", "waits%", "waitCyc/acc");
+    bool lockProfile = false;
+    vector<string> levels = {dcache};
+    while (hier->parents.count(levels.back())) levels.push_back(hier->parents.at(levels.back()));
+    for (const string& level : levels) {
+        LevelStats ls = {};
+        for (uint32_t i = 0; i < zinfo->rootStat->curSize(); i++) {
+            Stat* s = zinfo->rootStat->get(i);
+            if (level == s->name()) SumLevelStats(s, false, ls);
+        }
+        uint64_t acc = ls.hits + ls.misses;
+        printf("%-10s %12ld %8.2f %12.2f", level.c_str(), acc, acc? 100.0*ls.hits/acc : 0.0, acc*1e3/std::max(boundNs, 1ul));
+        lockProfile |= ls.lockProfile;
+        if (ls.lockProfile) {
+            printf(" %12ld %8.2f %14.1f\n", ls.lockAcqs, ls.lockAcqs? 100.0*ls.lockWaits/ls.lockAcqs : 0.0,
+                    ((double)ls.lockWaitCycles)/std::max(acc, 1ul));
+        } else {
+            printf(" %12s %8s %14s\n", "-", "-", "-");
+        }
+    }
+    if (!lockProfile) info("Set sim.profileCCLocks = true for lock contention stats");
+    return 0;
+}
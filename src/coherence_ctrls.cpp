@@ -25,7 +25,9 @@
 
 #include "coherence_ctrls.h"
 #include "cache.h"
+#include "mem_sampler.h"
 #include "network.h"
+#include "zsim.h"
 
 /* Do a simple XOR block hash on address to determine its bank. Hacky for now,
  * should probably have a class that deals with this with a real hash function
@@ -50,6 +52,8 @@ void MESIBottomCC::init(const g_vector<MemObject*>& _parents, Network* network,
         parents[p] = _parents[p];
         parentRTTs[p] = (network)? network->getRTT(name, parents[p]->getName()) : 0;
     }
+    // Parent caches release our lock while they serve our requests (see MESICC::startAccess); other memory objects don't
+    parentsUnlock = parents.size() && dynamic_cast<BaseCache*>(parents[0]);
 }
 
 
@@ -61,20 +65,21 @@ uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool
         *state = M; //Silent E->M transition (at eviction); now we'll do a PUTX
     }
     uint64_t respCycle = cycle;
+    uint32_t stripe = ccLock.stripeOf(wbLineAddr);  // same set as the access that evicts it, so we hold this stripe
     switch (*state) {
         case I:
             break; //Nothing to do
         case S:
         case E:
             {
-                MemReq req = {wbLineAddr, PUTS, selfId, state, cycle, &ccLock, *state, srcId, 0 /*no flags*/};
-                respCycle = parents[getParentId(wbLineAddr)]->access(req);
+                MemReq req = {wbLineAddr, PUTS, selfId, state, cycle, ccLock.get(stripe), *state, srcId, 0 /*no flags*/};
+                respCycle = accessParent(getParentId(wbLineAddr), req, stripe);
             }
             break;
         case M:
             {
-                MemReq req = {wbLineAddr, PUTX, selfId, state, cycle, &ccLock, *state, srcId, 0 /*no flags*/};
-                respCycle = parents[getParentId(wbLineAddr)]->access(req);
+                MemReq req = {wbLineAddr, PUTX, selfId, state, cycle, ccLock.get(stripe), *state, srcId, 0 /*no flags*/};
+                respCycle = accessParent(getParentId(wbLineAddr), req, stripe);
             }
             break;
 
@@ -91,7 +96,7 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
         // A PUTS/PUTX does nothing w.r.t. higher coherence levels --- it dies here
         case PUTS: //Clean writeback, nothing to do (except profiling)
             assert(*state != I);
-            profPUTS.inc();
+            profInc(profPUTS);
             break;
         case PUTX: //Dirty writeback
             assert(*state == M || *state == E);
@@ -99,34 +104,36 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
                 //Silent transition, record that block was written to
                 *state = M;
             }
-            profPUTX.inc();
+            profInc(profPUTX);
             break;
         case GETS:
             if (*state == I) {
                 uint32_t parentId = getParentId(lineAddr);
-                MemReq req = {lineAddr, GETS, selfId, state, cycle, &ccLock, *state, srcId, flags};
-                uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
+                uint32_t stripe = ccLock.stripeOf(lineAddr);
+                MemReq req = {lineAddr, GETS, selfId, state, cycle, ccLock.get(stripe), *state, srcId, flags};
+                uint32_t nextLevelLat = accessParent(parentId, req, stripe) - cycle;
                 uint32_t netLat = parentRTTs[parentId];
-                profGETNextLevelLat.inc(nextLevelLat);
-                profGETNetLat.inc(netLat);
+                profInc(profGETNextLevelLat, nextLevelLat);
+                profInc(profGETNetLat, netLat);
                 respCycle += nextLevelLat + netLat;
-                profGETSMiss.inc();
+                profInc(profGETSMiss);
                 assert(*state == S || *state == E);
             } else {
-                profGETSHit.inc();
+                profInc(profGETSHit);
             }
             break;
         case GETX:
             if (*state == I || *state == S) {
                 //Profile before access, state changes
-                if (*state == I) profGETXMissIM.inc();
-                else profGETXMissSM.inc();
+                if (*state == I) profInc(profGETXMissIM);
+                else profInc(profGETXMissSM);
                 uint32_t parentId = getParentId(lineAddr);
-                MemReq req = {lineAddr, GETX, selfId, state, cycle, &ccLock, *state, srcId, flags};
-                uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
+                uint32_t stripe = ccLock.stripeOf(lineAddr);
+                MemReq req = {lineAddr, GETX, selfId, state, cycle, ccLock.get(stripe), *state, srcId, flags};
+                uint32_t nextLevelLat = accessParent(parentId, req, stripe) - cycle;
                 uint32_t netLat = parentRTTs[parentId];
-                profGETNextLevelLat.inc(nextLevelLat);
-                profGETNetLat.inc(netLat);
+                profInc(profGETNextLevelLat, nextLevelLat);
+                profInc(profGETNetLat, netLat);
                 respCycle += nextLevelLat + netLat;
             } else {
                 if (*state == E) {
@@ -139,7 +146,7 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
                      */
                     *state = M;
                 }
-                profGETXHit.inc();
+                profInc(profGETXHit);
             }
             assert_msg(*state == M, "Wrong final state on GETX, lineId %d numLines %d, finalState %s", lineId, numLines, MESIStateName(*state));
             break;
@@ -168,17 +175,17 @@ void MESIBottomCC::processInval(Address lineAddr, uint32_t lineId, InvType type,
             assert_msg(*state == E || *state == M, "Invalid state %s", MESIStateName(*state));
             if (*state == M) *reqWriteback = true;
             *state = S;
-            profINVX.inc();
+            profInc(profINVX);
             break;
         case INV: //invalidate
             assert(*state != I);
             if (*state == M) *reqWriteback = true;
             *state = I;
-            profINV.inc();
+            profInc(profINV);
             break;
         case FWD: //forward
             assert_msg(*state == S, "Invalid state %s on FWD", MESIStateName(*state));
-            profFWD.inc();
+            profInc(profFWD);
             break;
         default: panic("!?");
     }
@@ -190,8 +197,9 @@ uint64_t MESIBottomCC::processNonInclusiveWriteback(Address lineAddr, AccessType
     if (!nonInclusiveHack) panic("Non-inclusive %s on line 0x%lx, this cache should be inclusive", AccessTypeName(type), lineAddr);
 
     //info("Non-inclusive wback, forwarding");
-    MemReq req = {lineAddr, type, selfId, state, cycle, &ccLock, *state, srcId, flags | MemReq::NONINCLWB};
-    uint64_t respCycle = parents[getParentId(lineAddr)]->access(req);
+    uint32_t stripe = ccLock.stripeOf(lineAddr);
+    MemReq req = {lineAddr, type, selfId, state, cycle, ccLock.get(stripe), *state, srcId, flags | MemReq::NONINCLWB};
+    uint64_t respCycle = accessParent(getParentId(lineAddr), req, stripe);
     return respCycle;
 }
 
@@ -234,6 +242,7 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
             }
         }
         assert(sentInvs == e->numSharers);
+        if (unlikely(zinfo->memSampler != nullptr)) zinfo->memSampler->noteInvalidations(srcId, sentInvs);
         if (type == INV) {
             e->numSharers = 0;
         } else {
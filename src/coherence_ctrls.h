@@ -33,7 +33,9 @@
 #include "locks.h"
 #include "memory_hierarchy.h"
 #include "pad.h"
+#include "repl_meta.h"
 #include "stats.h"
+#include "striped_lock.h"
 
 //TODO: Now that we have a pure CC interface, the MESI controllers should go on different files.
 
@@ -53,12 +55,15 @@ class CC : public GlobAlloc {
         virtual void endAccess(const MemReq& req) = 0;
 
         //Inv methods
-        virtual void startInv() = 0;
+        virtual void startInv(Address lineAddr) = 0;
         virtual uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) = 0;
 
         //Repl policy interface
         virtual uint32_t numSharers(uint32_t lineId) = 0;
         virtual bool isValid(uint32_t lineId) = 0;
+
+        //If set, the CC keeps the valid bit and sharer count of each line it touches up to date in meta
+        virtual void setReplMeta(ReplMeta* meta) = 0;
 };
 
 
@@ -95,18 +100,20 @@ class MESIBottomCC : public GlobAlloc {
         Counter profGETNextLevelLat, profGETNetLat;
 
         bool nonInclusiveHack;
+        bool atomicProf;  // with lock stripes, accesses to different sets update counters concurrently
+        bool parentsUnlock;  // parents are caches, which release our lock while they serve our requests
 
-        PAD();
-        lock_t ccLock;
-        PAD();
+        StripedLock ccLock;
 
     public:
-        MESIBottomCC(uint32_t _numLines, uint32_t _selfId, bool _nonInclusiveHack) : numLines(_numLines), selfId(_selfId), nonInclusiveHack(_nonInclusiveHack) {
+        MESIBottomCC(uint32_t _numLines, uint32_t _selfId, bool _nonInclusiveHack, uint32_t lockStripes, HashFamily* lockHf, bool profileLocks)
+            : numLines(_numLines), selfId(_selfId), nonInclusiveHack(_nonInclusiveHack), atomicProf(lockStripes > 1), parentsUnlock(false),
+              ccLock(lockStripes, lockHf, profileLocks)
+        {
             array = gm_calloc<MESIState>(numLines);
             for (uint32_t i = 0; i < numLines; i++) {
                 array[i] = I;
             }
-            futex_init(&ccLock);
         }
 
         void init(const g_vector<MemObject*>& _parents, Network* network, const char* name);
@@ -142,6 +149,8 @@ class MESIBottomCC : public GlobAlloc {
             parentStat->append(&profFWD);
             parentStat->append(&profGETNextLevelLat);
             parentStat->append(&profGETNetLat);
+
+            ccLock.initStats(parentStat, "bottomLock", "Bottom CC lock stats");
         }
 
         uint64_t processEviction(Address wbLineAddr, uint32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId);
@@ -154,12 +163,16 @@ class MESIBottomCC : public GlobAlloc {
 
         uint64_t processNonInclusiveWriteback(Address lineAddr, AccessType type, uint64_t cycle, MESIState* state, uint32_t srcId, uint32_t flags);
 
-        inline void lock() {
-            futex_lock(&ccLock);
+        inline uint32_t lockStripe(Address lineAddr) {
+            return ccLock.stripeOf(lineAddr);
         }
 
-        inline void unlock() {
-            futex_unlock(&ccLock);
+        inline void lock(uint32_t stripe) {
+            ccLock.lock(stripe);
+        }
+
+        inline void unlock(uint32_t stripe) {
+            ccLock.unlock(stripe);
         }
 
         /* Replacement policy query interface */
@@ -171,6 +184,18 @@ class MESIBottomCC : public GlobAlloc {
 
     private:
         uint32_t getParentId(Address lineAddr);
+
+        inline void profInc(Counter& c, uint64_t delta = 1) {
+            if (atomicProf) c.atomicInc(delta);
+            else c.inc(delta);
+        }
+
+        inline uint64_t accessParent(uint32_t parentId, MemReq& req, uint32_t stripe) {
+            if (parentsUnlock) ccLock.pauseHold(stripe);
+            uint64_t respCycle = parents[parentId]->access(req);
+            if (parentsUnlock) ccLock.resumeHold(stripe);
+            return respCycle;
+        }
 };
 
 
@@ -204,18 +229,20 @@ class MESITopCC : public GlobAlloc {
 
         bool nonInclusiveHack;
 
-        PAD();
-        lock_t ccLock;
-        PAD();
+        StripedLock ccLock;
 
     public:
-        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack) : numLines(_numLines), nonInclusiveHack(_nonInclusiveHack) {
+        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack, uint32_t lockStripes, HashFamily* lockHf, bool profileLocks)
+            : numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), ccLock(lockStripes, lockHf, profileLocks)
+        {
             array = gm_calloc<Entry>(numLines);
             for (uint32_t i = 0; i < numLines; i++) {
                 array[i].clear();
             }
+        }
 
-            futex_init(&ccLock);
+        void initStats(AggregateStat* parentStat) {
+            ccLock.initStats(parentStat, "topLock", "Top CC lock stats");
         }
 
         void init(const g_vector<BaseCache*>& _children, Network* network, const char* name);
@@ -227,12 +254,13 @@ class MESITopCC : public GlobAlloc {
 
         uint64_t processInval(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId);
 
-        inline void lock() {
-            futex_lock(&ccLock);
+        // Stripes map like the bottom CC's (see MESICC::startAccess)
+        inline void lock(uint32_t stripe) {
+            ccLock.lock(stripe);
         }
 
-        inline void unlock() {
-            futex_unlock(&ccLock);
+        inline void unlock(uint32_t stripe) {
+            ccLock.unlock(stripe);
         }
 
         /* Replacement policy query interface */
@@ -278,28 +306,38 @@ class MESICC : public CC {
     private:
         MESITopCC* tcc;
         MESIBottomCC* bcc;
+        ReplMeta* meta;
         uint32_t numLines;
         bool nonInclusiveHack;
         g_string name;
 
+        uint32_t lockStripes;
+        HashFamily* lockHf;
+        bool profileLocks;
+
+        inline void syncMeta(int32_t lineId) {
+            if (meta && lineId != -1) meta->setCoherence(lineId, bcc->isValid(lineId), tcc->numSharers(lineId));
+        }
+
     public:
         //Initialization
-        MESICC(uint32_t _numLines, bool _nonInclusiveHack, g_string& _name) : tcc(nullptr), bcc(nullptr),
-            numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), name(_name) {}
+        MESICC(uint32_t _numLines, bool _nonInclusiveHack, g_string& _name, uint32_t _lockStripes = 1, HashFamily* _lockHf = nullptr, bool _profileLocks = false)
+            : tcc(nullptr), bcc(nullptr), meta(nullptr), numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), name(_name),
+              lockStripes(_lockStripes), lockHf(_lockHf), profileLocks(_profileLocks) {}
 
         void setParents(uint32_t childId, const g_vector<MemObject*>& parents, Network* network) {
-            bcc = new MESIBottomCC(numLines, childId, nonInclusiveHack);
+            bcc = new MESIBottomCC(numLines, childId, nonInclusiveHack, lockStripes, lockHf, profileLocks);
             bcc->init(parents, network, name.c_str());
         }
 
         void setChildren(const g_vector<BaseCache*>& children, Network* network) {
-            tcc = new MESITopCC(numLines, nonInclusiveHack);
+            tcc = new MESITopCC(numLines, nonInclusiveHack, lockStripes, lockHf, profileLocks);
             tcc->init(children, network, name.c_str());
         }
 
         void initStats(AggregateStat* cacheStat) {
-            //no tcc stats
             bcc->initStats(cacheStat);
+            tcc->initStats(cacheStat);  // only lock stats
         }
 
         //Access methods
@@ -314,8 +352,9 @@ class MESICC : public CC {
                 futex_unlock(req.childLock);
             }
 
-            tcc->lock(); //must lock tcc FIRST
-            bcc->lock();
+            uint32_t stripe = bcc->lockStripe(req.lineAddr);
+            tcc->lock(stripe); //must lock tcc FIRST
+            bcc->lock(stripe);
 
             /* The situation is now stable, true race-wise. No one can touch the child state, because we hold
              * both parent's locks. So, we first handle races, which may cause us to skip the access.
@@ -341,6 +380,7 @@ class MESICC : public CC {
             bool lowerLevelWriteback = false;
             uint64_t evCycle = tcc->processEviction(wbLineAddr, lineId, &lowerLevelWriteback, startCycle, triggerReq.srcId); //1. if needed, send invalidates/downgrades to lower level
             evCycle = bcc->processEviction(wbLineAddr, lineId, lowerLevelWriteback, evCycle, triggerReq.srcId); //2. if needed, write back line to upper level
+            syncMeta(lineId);
             return evCycle;
         }
 
@@ -376,6 +416,7 @@ class MESICC : public CC {
                     }
                 }
             }
+            syncMeta(lineId);
             return respCycle;
         }
 
@@ -385,41 +426,54 @@ class MESICC : public CC {
                 futex_lock(req.childLock);
             }
 
-            bcc->unlock();
-            tcc->unlock();
+            uint32_t stripe = bcc->lockStripe(req.lineAddr);
+            bcc->unlock(stripe);
+            tcc->unlock(stripe);
         }
 
         //Inv methods
-        void startInv() {
-            bcc->lock(); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
+        void startInv(Address lineAddr) {
+            bcc->lock(bcc->lockStripe(lineAddr)); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
         }
 
         uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) {
             uint64_t respCycle = tcc->processInval(req.lineAddr, lineId, req.type, req.writeback, startCycle, req.srcId); //send invalidates or downgrades to children
             bcc->processInval(req.lineAddr, lineId, req.type, req.writeback); //adjust our own state
+            syncMeta(lineId);
 
-            bcc->unlock();
+            bcc->unlock(bcc->lockStripe(req.lineAddr));
             return respCycle;
         }
 
         //Repl policy interface
         uint32_t numSharers(uint32_t lineId) {return tcc->numSharers(lineId);}
         bool isValid(uint32_t lineId) {return bcc->isValid(lineId);}
+        void setReplMeta(ReplMeta* _meta) {meta = _meta;}
 };
 
 // Terminal CC, i.e., without children --- accepts GETS/X, but not PUTS/X
 class MESITerminalCC : public CC {
     private:
         MESIBottomCC* bcc;
+        ReplMeta* meta;
         uint32_t numLines;
         g_string name;
 
+        uint32_t lockStripes;
+        HashFamily* lockHf;
+        bool profileLocks;
+
+        inline void syncMeta(int32_t lineId) {
+            if (meta && lineId != -1) meta->setCoherence(lineId, bcc->isValid(lineId), 0);
+        }
+
     public:
         //Initialization
-        MESITerminalCC(uint32_t _numLines, const g_string& _name) : bcc(nullptr), numLines(_numLines), name(_name) {}
+        MESITerminalCC(uint32_t _numLines, const g_string& _name, uint32_t _lockStripes = 1, HashFamily* _lockHf = nullptr, bool _profileLocks = false)
+            : bcc(nullptr), meta(nullptr), numLines(_numLines), name(_name), lockStripes(_lockStripes), lockHf(_lockHf), profileLocks(_profileLocks) {}
 
         void setParents(uint32_t childId, const g_vector<MemObject*>& parents, Network* network) {
-            bcc = new MESIBottomCC(numLines, childId, false /*inclusive*/);
+            bcc = new MESIBottomCC(numLines, childId, false /*inclusive*/, lockStripes, lockHf, profileLocks);
             bcc->init(parents, network, name.c_str());
         }
 
@@ -443,7 +497,7 @@ class MESITerminalCC : public CC {
                 futex_unlock(req.childLock);
             }
 
-            bcc->lock();
+            bcc->lock(bcc->lockStripe(req.lineAddr));
 
             /* The situation is now stable, true race-wise. No one can touch the child state, because we hold
              * both parent's locks. So, we first handle races, which may cause us to skip the access.
@@ -459,6 +513,7 @@ class MESITerminalCC : public CC {
         uint64_t processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle) {
             bool lowerLevelWriteback = false;
             uint64_t endCycle = bcc->processEviction(wbLineAddr, lineId, lowerLevelWriteback, startCycle, triggerReq.srcId); //2. if needed, write back line to upper level
+            syncMeta(lineId);
             return endCycle;  // critical path unaffected, but TimingCache needs it
         }
 
@@ -468,6 +523,7 @@ class MESITerminalCC : public CC {
             //if needed, fetch line or upgrade miss from upper level
             uint64_t respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, req.flags);
             //at this point, the line is in a good state w.r.t. upper levels
+            syncMeta(lineId);
             return respCycle;
         }
 
@@ -476,23 +532,25 @@ class MESITerminalCC : public CC {
             if (req.childLock) {
                 futex_lock(req.childLock);
             }
-            bcc->unlock();
+            bcc->unlock(bcc->lockStripe(req.lineAddr));
         }
 
         //Inv methods
-        void startInv() {
-            bcc->lock();
+        void startInv(Address lineAddr) {
+            bcc->lock(bcc->lockStripe(lineAddr));
         }
 
         uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) {
             bcc->processInval(req.lineAddr, lineId, req.type, req.writeback); //adjust our own state
-            bcc->unlock();
+            syncMeta(lineId);
+            bcc->unlock(bcc->lockStripe(req.lineAddr));
             return startCycle; //no extra delay in terminal caches
         }
 
         //Repl policy interface
         uint32_t numSharers(uint32_t lineId) {return 0;} //no sharers
         bool isValid(uint32_t lineId) {return bcc->isValid(lineId);}
+        void setReplMeta(ReplMeta* _meta) {meta = _meta;}
 };
 
 #endif  // COHERENCE_CTRLS_H_
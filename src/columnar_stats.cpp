@@ -0,0 +1,102 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include "flat_stats.h"
+#include "galloc.h"
+#include "log.h"
+#include "pad.h"
+#include "stats.h"
+
+/* Columnar binary stats: a header, a table of NUL-terminated flattened stat
+ * names (see FlatStats), and then one row of numCols little-endian uint64_t
+ * per dump, starting at dataOffset. The data is a plain 2D array, so it can
+ * be mapped without parsing, e.g., in Python:
+ *
+ *   rows = np.memmap(f, dtype=np.uint64, mode="r", offset=dataOffset)
+ *   df = pd.DataFrame(rows[:len(rows)//numCols*numCols].reshape(-1, numCols), columns=names)
+ *
+ * Truncating to whole rows makes reading while zsim appends safe.
+ */
+
+#define COLUMNAR_STATS_MAGIC "ZSIMCOL"  // NUL-terminated, fills the 8-byte magic
+#define COLUMNAR_STATS_VERSION 1
+
+struct ColumnarStatsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numCols;
+    uint64_t namesOffset;
+    uint64_t dataOffset;  // cache line-aligned
+};
+
+class ColumnarBackendImpl : public GlobAlloc {
+    private:
+        FlatStats* stats;
+        uint64_t* row;
+        StatsOutputBuffer* out;
+        size_t bytesPerWrite;
+
+    public:
+        ColumnarBackendImpl(const char* filename, AggregateStat* rootStat, size_t _bytesPerWrite) : bytesPerWrite(_bytesPerWrite) {
+            stats = new FlatStats(rootStat);
+            row = gm_calloc<uint64_t>(stats->size());
+
+            g_string names;
+            for (uint32_t i = 0; i < stats->size(); i++) {
+                names += stats->name(i);
+                names.push_back('\0');
+            }
+
+            ColumnarStatsHeader hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            strcpy(hdr.magic, COLUMNAR_STATS_MAGIC);
+            hdr.version = COLUMNAR_STATS_VERSION;
+            hdr.numCols = stats->size();
+            hdr.namesOffset = sizeof(hdr);
+            hdr.dataOffset = (hdr.namesOffset + names.size() + CACHE_LINE_BYTES - 1) & ~((uint64_t)CACHE_LINE_BYTES - 1);
+
+            out = new StatsOutputBuffer(filename, std::max(bytesPerWrite, hdr.dataOffset));
+            out->append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+            out->append(names);
+            out->append(hdr.dataOffset - hdr.namesOffset - names.size(), '\0');
+            out->flush();
+        }
+
+        void dump(bool buffered) {
+            stats->read(row);
+            out->append(reinterpret_cast<const char*>(row), stats->size()*sizeof(uint64_t));
+            if (!buffered || out->size() >= bytesPerWrite) out->flush();
+        }
+};
+
+ColumnarBackend::ColumnarBackend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite) {
+    backend = new ColumnarBackendImpl(filename, rootStat, bytesPerWrite);
+}
+
+void ColumnarBackend::dump(bool buffered) {
+    backend->dump(buffered);
+}
@@ -49,6 +49,7 @@ typedef long long lc_int64;  // NOLINT(runtime/int)
 Config::Config(const char* inFile) {
     inCfg = new libconfig::Config();
     outCfg = new libconfig::Config();
+    futex_init(&lock);
     try {
         inCfg->readFile(inFile);
     } catch (libconfig::FileIOException fioe) {
@@ -138,7 +139,10 @@ void Config::writeAndClose(const char* outFile, bool strictCheck) {
 
 
 bool Config::exists(const char* key) {
-    return inCfg->exists(key);
+    futex_lock(&lock);
+    bool res = inCfg->exists(key);
+    futex_unlock(&lock);
+    return res;
 }
 
 //Helper functions
@@ -207,6 +211,7 @@ template<typename T> static void writeVar(libconfig::Config* cfg, const char* ke
 template<typename T>
 T Config::genericGet(const char* key, T def) {
     T val;
+    futex_lock(&lock);
     if (inCfg->exists(key)) {
         if (!inCfg->lookupValue(key, val)) {
             panic("Type error on optional setting %s, expected type %s", key, getTypeName<T>());
@@ -215,12 +220,14 @@ T Config::genericGet(const char* key, T def) {
         val = def;
     }
     writeVar(outCfg, key, val);
+    futex_unlock(&lock);
     return val;
 }
 
 template<typename T>
 T Config::genericGet(const char* key) {
     T val;
+    futex_lock(&lock);
     if (inCfg->exists(key)) {
         if (!inCfg->lookupValue(key, val)) {
             panic("Type error on mandatory setting %s, expected type %s", key, getTypeName<T>());
@@ -229,6 +236,7 @@ T Config::genericGet(const char* key) {
         panic("Mandatory setting %s (%s) not found", key, getTypeName<T>())
     }
     writeVar(outCfg, key, val);
+    futex_unlock(&lock);
     return val;
 }
 
@@ -247,6 +255,7 @@ template<> double Config::get<double>(const char* key, double def) {return (doub
 
 //Get subgroups in a specific key
 void Config::subgroups(const char* key, std::vector<const char*>& grps) {
+    futex_lock(&lock);
     if (inCfg->exists(key)) {
         libconfig::Setting& s = inCfg->lookup(key);
         uint32_t n = s.getLength(); //0 if not a group or list
@@ -254,6 +263,7 @@ void Config::subgroups(const char* key, std::vector<const char*>& grps) {
             if (s[i].isGroup()) grps.push_back(s[i].getName());
         }
     }
+    futex_unlock(&lock);
 }
 
 
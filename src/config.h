@@ -30,11 +30,13 @@
  * - Reduce and simplify init code (tailored interface, not type BS, ...)
  * - Strict config: type errors, warnings on unused variables, panic on different defaults
  * - Produce a full configuration file with all the variables, including defaults (for config parsing, comparison, etc.)
+ * - Thread-safe accesses, so that independent parts of the system can be built in parallel (sim.initThreads)
  */
 
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include "locks.h"
 #include "log.h"
 
 namespace libconfig {
@@ -47,6 +49,7 @@ class Config {
     private:
         libconfig::Config* inCfg;
         libconfig::Config* outCfg;
+        lock_t lock;  // serializes accesses, as reads also write outCfg
 
     public:
         explicit Config(const char* inFile);
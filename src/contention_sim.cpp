@@ -26,15 +26,17 @@
 #include "contention_sim.h"
 #include <algorithm>
 #include <queue>
+#include <sched.h>
 #include <sstream>
 #include <string>
 #include <typeinfo>
 #include <unordered_map>
 #include <vector>
+#include "host_counters.h"
+#include "host_placement.h"
 #include "log.h"
-#include "ooo_core.h"
-#include "timing_core.h"
 #include "timing_event.h"
+#include "weave_capture.h"
 #include "zsim.h"
 
 //Set to 1 to produce a post-mortem analysis log
@@ -58,19 +60,26 @@ void ContentionSim::SimThreadTrampoline(void* arg) {
     csim->simThreadLoop(thid);
 }
 
-ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
+ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads, bool _pipelined, SimThreadSpawnFn spawnThread) {
     numDomains = _numDomains;
     numSimThreads = _numSimThreads;
+    pipelined = _pipelined;
+    skipContention = false; //until postInit()
+    capture = nullptr;
     threadsDone = 0;
     limit = 0;
     lastLimit = 0;
+    boundLimit = 0;
     inCSim = false;
+    weaveInFlight = false;
+    simThreadsBusy = false;
 
     domains = gm_calloc<DomainData>(numDomains);
     simThreads = gm_calloc<SimThreadData>(numSimThreads);
 
     for (uint32_t i = 0; i < numDomains; i++) {
         new (&domains[i].pq) PrioQueue<TimingEvent, PQ_BLOCKS>();
+        new (&domains[i].deferredEvs) g_vector<TimingEvent*>();
         domains[i].curCycle = 0;
         futex_init(&domains[i].pqLock);
     }
@@ -94,26 +103,20 @@ ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
     threadTicket = 0;
     __sync_synchronize();
     for (uint32_t i = 0; i < numSimThreads; i++) {
-        PIN_SpawnInternalThread(SimThreadTrampoline, this, 1024*1024, nullptr);
+        spawnThread(SimThreadTrampoline, this);
     }
 
     lastCrossing = gm_calloc<CrossingEventInfo>(numDomains*numDomains*MAX_THREADS); //TODO: refine... this allocs too much
 }
 
+void ContentionSim::setCapture(WeaveCapture* _capture) {
+    assert(!weaveInFlight);
+    capture = _capture;
+    TimingEvent::capture = _capture;
+}
+
 void ContentionSim::postInit() {
-    for (uint32_t i = 0; i < zinfo->numCores; i++) {
-        TimingCore* tcore = dynamic_cast<TimingCore*>(zinfo->cores[i]);
-        if (tcore) {
-            skipContention = false;
-            return;
-        }
-        OOOCore* ocore = dynamic_cast<OOOCore*>(zinfo->cores[i]);
-        if (ocore) {
-            skipContention = false;
-            return;
-        }
-    }
-    skipContention = true;
+    skipContention = clients.empty(); //without timing cores, nothing produces events
 }
 
 void ContentionSim::initStats(AggregateStat* parentStat) {
@@ -138,25 +141,48 @@ void ContentionSim::initStats(AggregateStat* parentStat) {
         new (&domains[i].profTime) ClockStat();
         domains[i].profTime.init("time", "Weave simulation time");
         domStat->append(&domains[i].profTime);
+        new (&domains[i].profSims) Counter();
+        domains[i].profSims.init("sims", "Event simulations, including requeues");
+        domStat->append(&domains[i].profSims);
         objStat->append(domStat);
     }
     parentStat->append(objStat);
 }
 
 void ContentionSim::simulatePhase(uint64_t limit) {
+    finishPhase();
+    startPhase(limit);
+    finishPhase();
+}
+
+void ContentionSim::startPhase(uint64_t limit) {
     if (skipContention) return; //fastpath when there are no cores to simulate
+    assert(!weaveInFlight);
 
     this->limit = limit;
     assert(limit >= lastLimit);
 
     //info("simulatePhase limit %ld", limit);
-    for (uint32_t i = 0; i < zinfo->numCores; i++) {
-        TimingCore* tcore = dynamic_cast<TimingCore*>(zinfo->cores[i]);
-        if (tcore) tcore->cSimStart();
-        OOOCore* ocore = dynamic_cast<OOOCore*>(zinfo->cores[i]);
-        if (ocore) ocore->cSimStart();
+    for (WeavePhaseClient* c : clients) c->cSimStart();
+    if (capture) capture->startPhase(limit);
+
+    if (pipelined) {
+        for (uint32_t i = 0; i < numDomains; i++) {
+            DomainData& dom = domains[i];
+            for (TimingEvent* ev : dom.deferredEvs) dom.pq.enqueue(ev, ev->privCycle);
+            dom.deferredEvs.clear();
+        }
+
+        // The next bound phase must not allocate from slabs the weave phase may free
+        for (uint32_t i = 0; i < zinfo->numCores; i++) {
+            if (zinfo->eventRecorders[i]) zinfo->eventRecorders[i]->retireSlab();
+        }
     }
 
+    // Everything the next bound phase records starts after this weave phase
+    boundLimit = limit;
+    weaveInFlight = true;
+    simThreadsBusy = true;
     inCSim = true;
     __sync_synchronize();
 
@@ -164,6 +190,10 @@ void ContentionSim::simulatePhase(uint64_t limit) {
     for (uint32_t i = 0; i < numSimThreads; i++) {
         futex_unlock(&simThreads[i].wakeLock);
     }
+}
+
+void ContentionSim::finishPhase() {
+    if (!weaveInFlight) return;
 
     //Sleep until phase is simulated
     futex_lock_nospin(&waitLock);
@@ -171,23 +201,23 @@ void ContentionSim::simulatePhase(uint64_t limit) {
     inCSim = false;
     __sync_synchronize();
 
-    for (uint32_t i = 0; i < zinfo->numCores; i++) {
-        TimingCore* tcore = dynamic_cast<TimingCore*>(zinfo->cores[i]);
-        if (tcore) tcore->cSimEnd();
-        OOOCore* ocore = dynamic_cast<OOOCore*>(zinfo->cores[i]);
-        if (ocore) ocore->cSimEnd();
-    }
+    for (WeavePhaseClient* c : clients) c->cSimEnd();
 
     lastLimit = limit;
+    weaveInFlight = false;
     __sync_synchronize();
 }
 
+void ContentionSim::waitForWeave() {
+    while (simThreadsBusy) sched_yield();
+}
+
 void ContentionSim::enqueue(TimingEvent* ev, uint64_t cycle) {
     assert(inCSim);
     assert(ev);
     assert_msg(cycle >= lastLimit, "Enqueued event before last limit! cycle %ld min %ld", cycle, lastLimit);
     //Hacky, but helpful to chase events scheduled too far ahead due to bugs (e.g., cycle -1). We should probably formalize this a bit more
-    assert_msg(cycle < lastLimit+10*zinfo->phaseLength+1000000, "Queued event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
+    assert_msg(cycle < lastLimit+10*zinfo->maxPhaseLength+1000000, "Queued event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
 
     assert_msg(cycle >= domains[ev->domain].curCycle, "Queued event goes back in time, cycle %ld curCycle %ld", cycle, domains[ev->domain].curCycle);
     ev->privCycle = cycle;
@@ -199,25 +229,28 @@ void ContentionSim::enqueue(TimingEvent* ev, uint64_t cycle) {
 }
 
 void ContentionSim::enqueueSynced(TimingEvent* ev, uint64_t cycle) {
-    assert(!inCSim);
+    assert(!inCSim || pipelined);
     assert(ev && ev->domain != -1);
     assert(ev->domain < (int32_t)numDomains);
     uint32_t domain = ev->domain;
 
     futex_lock(&domains[domain].pqLock);
 
-    assert_msg(cycle >= lastLimit, "Enqueued (synced) event before last limit! cycle %ld min %ld", cycle, lastLimit);
+    assert_msg(cycle >= boundLimit, "Enqueued (synced) event before last limit! cycle %ld min %ld", cycle, boundLimit);
     //Hacky, but helpful to chase events scheduled too far ahead due to bugs (e.g., cycle -1). We should probably formalize this a bit more
-    assert_msg(cycle < lastLimit+10*zinfo->phaseLength+10000, "Queued  (synced) event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
+    assert_msg(cycle < boundLimit+10*zinfo->maxPhaseLength+10000, "Queued  (synced) event too far into the future, cycle %ld lastLimit %ld", cycle, boundLimit);
     ev->privCycle = cycle;
     assert(ev->numParents == 0);
-    domains[ev->domain].pq.enqueue(ev, cycle);
+    if (pipelined) domains[ev->domain].deferredEvs.push_back(ev); //the sim threads may be using pq
+    else domains[ev->domain].pq.enqueue(ev, cycle);
 
     futex_unlock(&domains[domain].pqLock);
 }
 
 void ContentionSim::enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t srcId, uint32_t srcDomain, uint32_t dstDomain, EventRecorder* evRec) {
     CrossingStack& cs = evRec->getCrossingStack();
+    evRec->incCrossings();
+    zinfo->placement->countCrossing(srcId, srcDomain, dstDomain);
     bool isFirst = cs.empty();
     bool isResp = false;
     CrossingEvent* req = nullptr;
@@ -237,7 +270,8 @@ void ContentionSim::enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t
         req->parentEv->addChild(ev, evRec);
     } else {
         CrossingEventInfo* last = &lastCrossing[(srcId*numDomains + srcDomain)*numDomains + dstDomain];
-        uint64_t srcDomCycle = domains[srcDomain].curCycle;
+        //If a pipelined weave phase is in flight, events past boundLimit are not simulated yet, and curCycle may be older
+        uint64_t srcDomCycle = MAX(domains[srcDomain].curCycle, boundLimit);
         if (last->cycle > srcDomCycle && last->cycle <= cycle) { //NOTE: With the OOO model, last->cycle > cycle is now possible, since requests are issued in instruction order -> ooo
             //Chain to previous req
             assert_msg(last->cycle <= cycle, "last->cycle (%ld) > cycle (%ld)", last->cycle, cycle);
@@ -256,18 +290,8 @@ void ContentionSim::enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t
 
 void ContentionSim::simThreadLoop(uint32_t thid) {
     info("Started contention simulation thread %d", thid);
-#if 0
-    //Pin
-    uint32_t nprocs = sysconf(_SC_NPROCESSORS_ONLN);
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    //CPU_SET(domain % nprocs, cpuset); //basically no difference
-    //CPU_SET(0, cpuset); CPU_SET(1, cpuset); CPU_SET(2, cpuset); CPU_SET(3, cpuset); //don't use hyperthreads; confuses the scheduler to no end, does worse
-    CPU_SET(thid % nprocs, &cpuset); CPU_SET((thid % nprocs) + (nprocs/2), &cpuset); //pin to a single core but can use both its hyperthreads, works best (~20% gain)
-    //TODO: Must make this optional, or multiple simulations/machine will work horribly
-    int r = sched_setaffinity(0 /*calling thread, equiv to syscall(SYS_gettid)*/, sizeof(cpuset), &cpuset);
-    assert_msg(r == 0, "sched_setaffinity failed (%d)", r);
-#endif
+    if (zinfo->placement) zinfo->placement->bindSimThread(thid); //see sim.placement; standalone tools have none
+    HostCounterGroup* hostCtrs = zinfo->hostCounters? zinfo->hostCounters->openGroup() : nullptr;
     while (true) {
         futex_lock_nospin(&simThreads[thid].wakeLock);
 
@@ -276,15 +300,19 @@ void ContentionSim::simThreadLoop(uint32_t thid) {
         }
 
         //info("%d --- phase start", domain);
+        if (hostCtrs) zinfo->hostCounters->skip(hostCtrs);  // sleeping between phases
         simulatePhaseThread(thid);
+        if (hostCtrs) zinfo->hostCounters->addWeave(hostCtrs, thid);
         //info("%d --- phase end", domain);
 
         uint32_t val = __sync_add_and_fetch(&threadsDone, 1);
         if (val == numSimThreads) {
             threadsDone = 0;
+            simThreadsBusy = false;
             futex_unlock(&waitLock); //unblock caller
         }
     }
+    delete hostCtrs;
     info("Finished contention simulation thread %d", thid);
 }
 
@@ -305,6 +333,8 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                 domCycle = cycle;
                 domain.curCycle = cycle;
             }
+            if (unlikely(capture != nullptr)) capture->eventRun(te, cycle);
+            domain.profSims.inc();
             te->run(cycle);
             uint64_t newCycle = pq.size()? pq.firstCycle() : limit;
             assert(newCycle >= domCycle);
@@ -373,6 +403,8 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                     TimingEvent* te = pq.dequeue(cycle);
                     //uint64_t nextCycle = pq.size()? pq.firstCycle() : cycle;
                     if (cycle != domain->curCycle) domain->curCycle = cycle;
+                    if (unlikely(capture != nullptr)) capture->eventRun(te, cycle);
+                    domain->profSims.inc();
                     te->run(cycle);
                     domain->curCycle = pq.size()? pq.firstCycle() : limit;
                     domain->queuePrio = domain->curCycle;
@@ -394,6 +426,8 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                     TimingEvent* te = pq.dequeue(cycle);
                     if (cycle != domain->curCycle) domain->curCycle = cycle;
                     te->state = EV_RUNNING;
+                    if (unlikely(capture != nullptr)) capture->eventRun(te, cycle);
+                    domain->profSims.inc();
                     te->simulate(cycle);
                     domain->curCycle = pq.size()? pq.firstCycle() : limit;
                     domain->queuePrio = domain->curCycle;
@@ -406,6 +440,8 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
         }
     }
 
+    if (capture) capture->endPhase(simThreads[thid].firstDomain, simThreads[thid].supDomain);
+
     //info("Phase done");
     __sync_synchronize();
 }
@@ -46,9 +46,23 @@
 class TimingEvent;
 class DelayEvent;
 class CrossingEvent;
+class WeaveCapture;
 
 #define PQ_BLOCKS 1024
 
+/* Objects with event-driven timing models (e.g., TimingCore and OOOCore)
+ * that must sync with each weave phase. Keeps ContentionSim independent of
+ * the core models, so standalone tools (weavebench) can link it.
+ */
+class WeavePhaseClient {
+    public:
+        virtual void cSimStart() = 0; //before the weave phase starts
+        virtual void cSimEnd() = 0; //after the weave phase finishes
+};
+
+//Spawns a sim thread that runs func(arg); zsim uses Pin internal threads
+typedef void (*SimThreadSpawnFn)(void (*func)(void*), void* arg);
+
 class ContentionSim : public GlobAlloc {
     private:
         struct CompareEvents : public std::binary_function<TimingEvent*, TimingEvent*, bool> {
@@ -71,12 +85,15 @@ class ContentionSim : public GlobAlloc {
             lock_t pqLock; //used on phase 1 enqueues
             //lock_t domainLock; //used by simulation thread
 
+            g_vector<TimingEvent*> deferredEvs; //pipelined mode: events queued by the bound phase (cycle in privCycle), moved to pq when their weave phase starts
+
             uint32_t prio;
             uint64_t queuePrio;
 
             PAD();
 
             ClockStat profTime;
+            Counter profSims; //event simulations, including requeues
 
 #if PROFILE_CROSSINGS
             VectorCounter profIncomingCrossingSims;
@@ -106,6 +123,10 @@ class ContentionSim : public GlobAlloc {
         uint32_t numDomains;
         uint32_t numSimThreads;
         bool skipContention;
+        bool pipelined; //if true, the weave phase overlaps the next bound phase
+
+        g_vector<WeavePhaseClient*> clients;
+        WeaveCapture* capture; //nullptr unless sim.weaveCapture is set
 
         PAD();
 
@@ -113,12 +134,15 @@ class ContentionSim : public GlobAlloc {
         lock_t waitLock;
         volatile uint64_t limit;
         volatile uint64_t lastLimit;
+        volatile uint64_t boundLimit; //earliest cycle bound-phase events can start at; == lastLimit unless a pipelined weave phase is in flight
         volatile bool terminate;
 
         volatile uint32_t threadsDone;
         volatile uint32_t threadTicket; //used only at init
 
         volatile bool inCSim; //true when inside contention simulation
+        volatile bool weaveInFlight; //true between startPhase() and finishPhase()
+        volatile bool simThreadsBusy; //true until sim threads are done with the weave phase in flight
 
         PAD();
 
@@ -126,21 +150,50 @@ class ContentionSim : public GlobAlloc {
         lock_t postMortemLock;
 
     public:
-        ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads);
+        ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads, bool _pipelined, SimThreadSpawnFn spawnThread);
 
         void initStats(AggregateStat* parentStat);
 
+        void addClient(WeavePhaseClient* client) {clients.push_back(client);}
+
+        //Records the event graph of the weave phases (see weave_capture.h). Call before the first phase, from the process that built us (it runs the sim threads)
+        void setCapture(WeaveCapture* _capture);
+
         void postInit(); //must be called after the simulator is initialized
 
         void enqueue(TimingEvent* ev, uint64_t cycle);
         void enqueueSynced(TimingEvent* ev, uint64_t cycle);
         void enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t srcId, uint32_t srcDomain, uint32_t dstDomain, EventRecorder* evRec);
 
+        /* Weave phase, called from an event of this domain. Returns the cycle of
+         * the next queued event of the domain, or the phase limit if it's
+         * earlier. All weave phase work in a domain descends from its queued
+         * events, so nothing else can happen in the domain before this cycle.
+         */
+        inline uint64_t nextEventCycle(uint32_t domain) const {
+            const DomainData& d = domains[domain];
+            return (d.pq.size() && d.pq.firstCycle() < limit)? d.pq.firstCycle() : limit;
+        }
+
+        //Simulates the weave phase up to limit, and returns when it is done
         void simulatePhase(uint64_t limit);
 
+        /* Pipelined mode: startPhase() starts the weave phase up to limit and
+         * returns right away, so the next bound phase overlaps it.
+         * finishPhase() waits for it and applies its feedback (e.g., core
+         * skews), so this feedback reaches the cores one phase late.
+         */
+        void startPhase(uint64_t limit);
+        void finishPhase(); //no-op if no weave phase is in flight
+
+        //Blocks until the sim threads are done with the weave phase in flight, if any. Can be called from the bound phase.
+        void waitForWeave();
+
+        bool isPipelined() const {return pipelined;}
+
         void finish();
 
-        uint64_t getLastLimit() {return lastLimit;}
+        uint64_t getLastLimit() {return boundLimit;}
 
         uint64_t getCurCycle(uint32_t domain) {
             assert(domain < numDomains);
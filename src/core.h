@@ -37,6 +37,8 @@ struct BblInfo {
     DynBbl oooBbl[0]; //0 bytes, but will be 1-sized when we have an element (and that element has variable size as well)
 };
 
+struct FilterFastPath;
+
 /* Analysis function pointer struct
  * As an artifact of having a shared code cache, we need these to be the same for different core types.
  */
@@ -49,7 +51,7 @@ struct InstrFuncPtrs {  // NOLINT(whitespace)
     void (*predLoadPtr)(THREADID, ADDRINT, BOOL);
     void (*predStorePtr)(THREADID, ADDRINT, BOOL);
     uint64_t type;
-    uint64_t pad[1];
+    FilterFastPath* fastPath;  // L0 state for inlined filter hits (see filter_cache.h), nullptr if unsupported
     //NOTE: By having the struct be a power of 2 bytes, indirect calls are simpler (w/ gcc 4.4 -O3, 6->5 instructions, and those instructions are simpler)
 };
 
@@ -24,6 +24,7 @@
  */
 
 #include "core_recorder.h"
+#include "contention_sim.h"
 #include "timing_event.h"
 #include "zsim.h"
 
@@ -57,6 +58,8 @@ CoreRecorder::CoreRecorder(uint32_t _domain, g_string& _name)
     gapCycles = 0;
     eventRecorder.setGapCycles(gapCycles);
 
+    lastEventSimulatedStartCycle = 0;
+    lastEventSimulatedOrigStartCycle = 0;
     lastUnhaltedCycle = 0;
     totalGapCycles = 0;
     totalHaltedCycles = 0;
@@ -64,6 +67,21 @@ CoreRecorder::CoreRecorder(uint32_t _domain, g_string& _name)
 
 
 uint64_t CoreRecorder::notifyJoin(uint64_t curCycle) {
+    if (state == DRAINING && zinfo->contentionSim->isPipelined()) {
+        // The weave phase in flight may be simulating (and freeing) our last events
+        zinfo->contentionSim->waitForWeave();
+        if (!prevRespEvent) {
+            // Fully drained; do what cSimEnd() would, and leave it no skew to apply
+            uint64_t lastEvCycle1 = lastEventSimulatedOrigStartCycle + gapCycles;
+            uint64_t lastEvCycle2 = lastEventSimulatedStartCycle;
+            if (unlikely(lastEvCycle1 > lastEvCycle2)) panic("[%s] Contention simulation introduced a negative skew, lc1 %ld lc2 %ld", name.c_str(), lastEvCycle1, lastEvCycle2);
+            gapCycles += lastEvCycle2 - lastEvCycle1;
+            lastUnhaltedCycle = lastEventSimulatedStartCycle;
+            state = HALTED;
+            DEBUG_MSG("[%s] lastEventSimulated reached during pipelined weave, DRAINING -> HALTED", name.c_str());
+        }
+    }
+
     if (state == HALTED) {
         assert(!prevRespEvent);
         curCycle = zinfo->globPhaseCycles; //start at beginning of the phase
@@ -79,6 +97,7 @@ uint64_t CoreRecorder::notifyJoin(uint64_t curCycle) {
         prevRespEvent->setMinStartCycle(curCycle);
         prevRespEvent->queue(curCycle);
         eventRecorder.setStartSlack(0);
+        lastEventSimulatedOrigStartCycle = lastEventSimulatedStartCycle - gapCycles;  // no skew until our new events are simulated
         DEBUG_MSG("[%s] Joined, was HALTED, curCycle %ld halted %ld", name.c_str(), curCycle, totalHaltedCycles);
     } else if (state == DRAINING) {
         assert(curCycle >= zinfo->globPhaseCycles); //should not have gone out of sync...
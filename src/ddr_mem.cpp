@@ -153,10 +153,10 @@ class SchedEvent : public TimingEvent, public GlobAlloc {
 DDRMemory::DDRMemory(uint32_t _lineSize, uint32_t _colSize, uint32_t _ranksPerChannel, uint32_t _banksPerRank,
         uint32_t _sysFreqMHz, const char* tech, const char* addrMapping, uint32_t _controllerSysLatency,
         uint32_t _queueDepth, uint32_t _rowHitLimit, bool _deferredWrites, bool _closedPage,
-        uint32_t _domain, g_string& _name)
+        bool _batchTicks, uint32_t _domain, g_string& _name)
     : lineSize(_lineSize), ranksPerChannel(_ranksPerChannel), banksPerRank(_banksPerRank),
       controllerSysLatency(_controllerSysLatency), queueDepth(_queueDepth), rowHitLimit(_rowHitLimit),
-      deferredWrites(_deferredWrites), closedPage(_closedPage), domain(_domain), name(_name)
+      deferredWrites(_deferredWrites), closedPage(_closedPage), batchTicks(_batchTicks), domain(_domain), name(_name)
 {
     sysFreqKHz = 1000 * _sysFreqMHz;
     initTech(tech);  // sets all tXX and memFreqKHz
@@ -174,8 +174,8 @@ DDRMemory::DDRMemory(uint32_t _lineSize, uint32_t _colSize, uint32_t _ranksPerCh
     rdQueue.init(queueDepth);
     wrQueue.init(queueDepth);
 
-    info("%s: domain %d, %d ranks/ch %d banks/rank, tech %s, boundLat %d rd / %d wr",
-            name.c_str(), domain, ranksPerChannel, banksPerRank, tech, minRdLatency, minWrLatency);
+    info("%s: domain %d, %d ranks/ch %d banks/rank, tech %s, boundLat %d rd / %d wr%s",
+            name.c_str(), domain, ranksPerChannel, banksPerRank, tech, minRdLatency, minWrLatency, batchTicks? ", batched ticks" : "");
 
     minRespCycle = tCL + tBL + 1; // We subtract tCL + tBL from this on some checks; this avoids overflows
 
@@ -235,6 +235,8 @@ void DDRMemory::initStats(AggregateStat* parentStat) {
     profReadHits.init("rdhits", "Read row hits"); memStats->append(&profReadHits);
     profWriteHits.init("wrhits", "Write row hits"); memStats->append(&profWriteHits);
     latencyHist.init("mlh", "latency histogram for memory requests", NUMBINS); memStats->append(&latencyHist);
+    profTicks.init("ticks", "Scheduling steps"); memStats->append(&profTicks);
+    profBatchedTicks.init("batchedTicks", "Scheduling steps done in an earlier step's tick (batchTicks)"); memStats->append(&profBatchedTicks);
     parentStat->append(memStats);
 }
 
@@ -423,9 +425,29 @@ void DDRMemory::queue(Request* req, uint64_t memCycle) {
 }
 
 // For external ticks
+/* Without batchTicks, each tick does one scheduling step, which issues at
+ * most one column command, and requeues the event for the next step. Under
+ * load that is one event per burst. With batchTicks, a tick keeps doing the
+ * following steps itself while they happen strictly before the next queued
+ * event of our domain (or the phase limit). No request or refresh can reach
+ * us before then, so each step sees the same state it would have seen in its
+ * own tick, and results are identical. trySchedule() still enforces all
+ * tFAW/tRRD/bus constraints.
+ */
 uint64_t DDRMemory::tick(uint64_t sysCycle) {
-    uint64_t memCycle = sysToMemCycle(sysCycle);
+    while (true) {
+        uint64_t enqSysCycle = schedStep(sysToMemCycle(sysCycle), sysCycle);
+        // Responses we just issued may have queued events, so check every step
+        if (!enqSysCycle || !batchTicks || enqSysCycle >= zinfo->contentionSim->nextEventCycle(domain)) return enqSysCycle;
+        sysCycle = enqSysCycle;
+        profBatchedTicks.inc();
+    }
+}
+
+// Returns the sysCycle of the next step, or 0 if there are no requests left
+uint64_t DDRMemory::schedStep(uint64_t memCycle, uint64_t sysCycle) {
     assert_msg(memCycle == nextSchedCycle, "%ld != %ld", memCycle, nextSchedCycle);
+    profTicks.inc();
 
     uint64_t minSchedCycle = trySchedule(memCycle, sysCycle);
     assert(minSchedCycle >= memCycle);
@@ -192,6 +192,7 @@ class DDRMemory : public MemObject {
         const uint32_t rowHitLimit; // row hits not prioritized in FR-FCFS beyond this point
         const bool deferredWrites;
         const bool closedPage;
+        const bool batchTicks;  // issue several commands per tick, see tick()
         const uint32_t domain;
 
         // DRAM timing parameters -- initialized in initTech()
@@ -237,6 +238,7 @@ class DDRMemory : public MemObject {
         Counter profReads, profWrites;
         Counter profTotalRdLat, profTotalWrLat;
         Counter profReadHits, profWriteHits;  // row buffer hits
+        Counter profTicks, profBatchedTicks;  // scheduling steps, and those done without a tick event
         VectorCounter latencyHist;
         static const uint32_t BINSIZE = 10, NUMBINS = 100;
         PAD();
@@ -261,7 +263,7 @@ class DDRMemory : public MemObject {
         DDRMemory(uint32_t _lineSize, uint32_t _colSize, uint32_t _ranksPerChannel, uint32_t _banksPerRank,
             uint32_t _sysFreqMHz, const char* tech, const char* addrMapping, uint32_t _controllerSysLatency,
             uint32_t _queueDepth, uint32_t _rowHitLimit, bool _deferredWrites, bool _closedPage,
-            uint32_t _domain, g_string& _name);
+            bool _batchTicks, uint32_t _domain, g_string& _name);
 
         void initStats(AggregateStat* parentStat);
         const char* getName() {return name.c_str();}
@@ -282,6 +284,8 @@ class DDRMemory : public MemObject {
 
         void queue(Request* req, uint64_t memCycle);
 
+        uint64_t schedStep(uint64_t memCycle, uint64_t sysCycle);
+
         inline uint64_t trySchedule(uint64_t curCycle, uint64_t sysCycle);
         uint64_t findMinCmdCycle(const Request& r) const;
 
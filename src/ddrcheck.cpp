@@ -0,0 +1,250 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Differential check for DDRMemory's batched scheduling (sys.mem.batchTicks).
+ * Drives two identical DDR controllers, one ticked per scheduling step and
+ * one with batched ticks, through ContentionSim with the same synthetic
+ * request stream, and checks that every request completes on the same cycle.
+ *
+ * Requests arrive at random times, with a mix of reads and writes and some
+ * row locality. Some requests depend on the response of an earlier one, so
+ * responses issued by a batch of scheduling steps feed new arrivals back into
+ * the controller, as they do with cores in the loop.
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "contention_sim.h"
+#include "ddr_mem.h"
+#include "event_recorder.h"
+#include "galloc.h"
+#include "log.h"
+#include "profile_stats.h"
+#include "standalone_threads.h"
+#include "timing_event.h"
+#include "zsim.h"
+
+using std::vector;
+
+GlobSimInfo* zinfo;
+
+struct Params {
+    uint32_t requests = 200000;
+    uint32_t interarrival = 20;  // mean, in sysCycles
+    uint32_t writePct = 30;
+    uint32_t rowHitPct = 50;  // a request goes to the same row as the previous one
+    uint32_t depPct = 25;  // a request waits for the response of a recent one
+    uint32_t phaseLength = 10000;
+    uint32_t freqMHz = 2000;
+    uint32_t queueDepth = 16;
+    uint64_t seed = 1;
+    const char* tech = "DDR3-1333-CL10";
+};
+
+struct Request {
+    uint64_t arrivalCycle;
+    Address lineAddr;
+    bool write;
+    int32_t dep;  // index of the request whose response we wait for, -1 if none
+};
+
+static vector<Request> Generate(const Params& p) {
+    uint64_t s = p.seed;
+    auto rnd = [&s]() {
+        s = s*6364136223846793005ULL + 1442695040888963407ULL;
+        return (uint32_t)(s >> 33);
+    };
+
+    vector<Request> reqs(p.requests);
+    uint64_t cycle = p.phaseLength;  // leave the first phase empty
+    Address line = 0;
+    for (uint32_t i = 0; i < p.requests; i++) {
+        Request& r = reqs[i];
+        cycle += rnd() % (2*p.interarrival + 1);
+        r.arrivalCycle = cycle;
+        // Next column of the same bank & rank (rank:col:bank mapping) stays on the same row
+        line = (rnd() % 100 < p.rowHitPct)? line + 8 : (rnd() & ((1 << 26) - 1));
+        r.lineAddr = line;
+        r.write = rnd() % 100 < p.writePct;
+        r.dep = -1;
+        if (i && rnd() % 100 < p.depPct) r.dep = i - 1 - rnd() % std::min(i, 8u);
+    }
+    return reqs;
+}
+
+static uint64_t completed = 0;  // requests whose RespEvent ran
+
+static uint64_t GetCounter(AggregateStat* s, const char* name) {
+    for (uint32_t i = 0; i < s->curSize(); i++) {
+        Counter* c = dynamic_cast<Counter*>(s->get(i));
+        if (c && strcmp(c->name(), name) == 0) return c->get();
+    }
+    panic("No counter %s", name);
+}
+
+// Runs in a child process, so each controller gets a fresh global heap; fills respCycles
+static void Run(const Params& p, const vector<Request>& reqs, bool batchTicks, uint64_t* respCycles) {
+    gm_init(256 << 20);
+    zinfo = gm_calloc<GlobSimInfo>();
+    zinfo->numDomains = 1;
+    zinfo->numCores = 1;
+    zinfo->maxPhaseLength = p.phaseLength;
+    zinfo->lineSize = 64;
+    zinfo->placement = nullptr;
+    zinfo->eventRecorders = gm_calloc<EventRecorder*>(1);
+    EventRecorder* evRec = new EventRecorder();
+    zinfo->eventRecorders[0] = evRec;
+
+    AggregateStat* rootStat = new AggregateStat();
+    rootStat->init("root", "Stats");
+    zinfo->contentionSim = new ContentionSim(1, 1, false, SpawnThread);
+    zinfo->contentionSim->initStats(rootStat);
+
+    g_string name("mem-0");
+    DDRMemory* mem = new DDRMemory(64, 8*1024, 4, 8, p.freqMHz, p.tech, "rank:col:bank", 10,
+            p.queueDepth, 4, true, true, batchTicks, 0, name);
+    mem->initStats(rootStat);
+
+    vector<RespEvent*> respEvs(reqs.size(), nullptr);
+    uint32_t next = 0;
+    uint32_t phaseStart = 0;  // first request of the current phase
+    uint64_t limit = 0;
+    uint64_t weaveNs = 0;
+    while (next < reqs.size() || completed < reqs.size()) {
+        limit += p.phaseLength;
+        phaseStart = next;
+        while (next < reqs.size() && reqs[next].arrivalCycle < limit) {
+            const Request& r = reqs[next];
+            MESIState state = I;
+            MemReq req = {r.lineAddr, r.write? PUTX : GETS, 0, &state, r.arrivalCycle, nullptr, I, 0, 0};
+            mem->access(req);
+            assert(evRec->hasRecord());
+            TimingRecord tr = evRec->popRecord();
+
+            IssueEvent* iss = new (evRec) IssueEvent();  // root, or waits on the response of the request it depends on
+            iss->setMinStartCycle(r.arrivalCycle);
+            RespEvent* resp = new (evRec) RespEvent(&respCycles[next], &completed);
+            resp->setMinStartCycle(r.arrivalCycle);
+            iss->addChild(tr.startEvent, evRec)->addChild(resp, evRec);
+            respEvs[next] = resp;
+
+            // Only depend on requests whose events were created this phase, older ones may be done
+            if (r.dep >= (int32_t)phaseStart) {
+                // The response comes after the arrival of the request, so this never starts before our arrival
+                DelayEvent* dl = new (evRec) DelayEvent(r.arrivalCycle - reqs[r.dep].arrivalCycle);
+                dl->setMinStartCycle(reqs[r.dep].arrivalCycle);
+                respEvs[r.dep]->addChild(dl, evRec)->addChild(iss, evRec);
+            } else {
+                iss->queue(r.arrivalCycle);
+            }
+            next++;
+        }
+
+        uint64_t startNs = getNs();
+        zinfo->contentionSim->simulatePhase(limit);
+        weaveNs += getNs() - startNs;
+    }
+
+    AggregateStat* memStat = dynamic_cast<AggregateStat*>(rootStat->get(rootStat->curSize() - 1));
+    printf("%-8s %10.3f %12ld %12ld %12ld %12ld\n", batchTicks? "batched" : "base", weaveNs/1e9,
+            GetCounter(memStat, "rd"), GetCounter(memStat, "wr"), GetCounter(memStat, "ticks"), GetCounter(memStat, "batchedTicks"));
+    fflush(stdout);
+}
+
+static void usage(const char* argv0) {
+    info("Checks that DDRMemory with batched ticks matches one tick per scheduling step");
+    info("Usage: %s [-n requests] [-i interarrival] [-w write%%] [-r rowHit%%] [-d dep%%] [-q queueDepth] [-t tech] [-s seed]", argv0);
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog("");  // no log header
+
+    Params p;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 >= argc) usage(argv[0]);
+        const char* v = argv[++i];
+        switch (argv[i-1][1]) {
+            case 'n': p.requests = strtoul(v, nullptr, 0); break;
+            case 'i': p.interarrival = strtoul(v, nullptr, 0); break;
+            case 'w': p.writePct = strtoul(v, nullptr, 0); break;
+            case 'r': p.rowHitPct = strtoul(v, nullptr, 0); break;
+            case 'd': p.depPct = strtoul(v, nullptr, 0); break;
+            case 'q': p.queueDepth = strtoul(v, nullptr, 0); break;
+            case 't': p.tech = v; break;
+            case 's': p.seed = strtoul(v, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (!p.requests) usage(argv[0]);
+
+    vector<Request> reqs = Generate(p);
+
+    // Response cycles of each run, shared with the child processes
+    size_t bytes = 2*reqs.size()*sizeof(uint64_t);
+    uint64_t* resp = static_cast<uint64_t*>(mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (resp == MAP_FAILED) panic("mmap failed");
+    memset(resp, 0, bytes);
+
+    printf("%-8s %10s %12s %12s %12s %12s\n", "mode", "weave (s)", "reads", "writes", "steps", "batched");
+    for (uint32_t b = 0; b < 2; b++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) panic("fork failed");
+        if (pid == 0) {
+            Run(p, reqs, b, &resp[b*reqs.size()]);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) panic("Run with batchTicks = %d failed", b);
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < reqs.size(); i++) {
+        uint64_t base = resp[i];
+        uint64_t batched = resp[reqs.size() + i];
+        if (base != batched) {
+            if (!mismatches) {
+                info("First mismatch: request %d (%s 0x%lx, arrival %ld) done at %ld base, %ld batched",
+                        i, reqs[i].write? "WR" : "RD", reqs[i].lineAddr, reqs[i].arrivalCycle, base, batched);
+            }
+            mismatches++;
+        }
+    }
+
+    if (mismatches) {
+        info("FAIL: %d of %ld requests differ", mismatches, reqs.size());
+        return 1;
+    }
+    info("OK: all %ld requests complete on the same cycle", reqs.size());
+    return 0;
+}
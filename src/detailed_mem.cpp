@@ -1020,10 +1020,11 @@ MemControllerBase::MemControllerBase(g_string _memCfg, uint32_t _cacheLineSize,
         sches[i] = new MemSchedulerDefault(i, mParam, chnls[i]);
     }
 
+    tickEvent = nullptr;
     if (mParam->schedulerQueueCount != 0) {
-        TickEvent<MemControllerBase >* tickEv = new TickEvent<MemControllerBase >(this, domain);
-        tickEv->queue(0); //start the sim at time 0
-        info("MemControllerBase::tick() will be call in each %ld sysCycle", nextSysTick);
+        tickEvent = new TickEvent<MemControllerBase >(this, domain);
+        tickEvent->queue(0); //start the sim at time 0
+        info("MemControllerBase::tick() will be call in each %ld sysCycle while requests are queued", nextSysTick);
     }
 
     addrTraceLog = nullptr;
@@ -1059,6 +1060,13 @@ void MemControllerBase::enqueue(MemAccessEventBase* ev, uint64_t cycle) {
     // Write Queue Hit Check
     uint32_t channel = ReturnChannel(ev->getAddr());
     bool bRet = sches[channel]->CheckSetEvent(ev);
+
+    // Wake up the scheduler on the next tick it would have had if it never idled
+    if (!tickEvent->isActive() && !sches[channel]->IsIdle()) {
+        uint64_t tickCycle = (cycle + nextSysTick - 1) / nextSysTick * nextSysTick;
+        tickEvent->wake(tickCycle);
+        profTickWakeups.inc();
+    }
     if (ev->getType() == READ) {
         if (bRet)
             ev->done(cycle - minLatency[0] + mParam->controllerLatency);
@@ -1077,6 +1085,11 @@ uint32_t MemControllerBase::tick(uint64_t sysCycle) {
     // for memory scheduler
     if (mParam->schedulerQueueCount != 0) {
         TickScheduler(sysCycle);
+
+        // Idle ticks do nothing, so stop ticking until enqueue() queues a request
+        bool idle = true;
+        for (uint32_t i = 0; i < mParam->channelCount; i++) idle &= sches[i]->IsIdle();
+        if (idle) return 0;
     }
 
     return nextSysTick;
@@ -1148,6 +1161,8 @@ void MemControllerBase::initStats(AggregateStat* parentStat) {
     memStats->append(&profPrecharge);
     profRefresh.init("ref", "Refresh command Times");
     memStats->append(&profRefresh);
+    profTickWakeups.init("tickWakeups", "Scheduler tick wakeups after idle periods");
+    memStats->append(&profTickWakeups);
 
     if (mParam->accAvgPowerReport == true) {
         AggregateStat* apStats = new AggregateStat();
@@ -38,6 +38,8 @@
 // FIXME(dsm): This enum should not be our here, esp with such generic names!
 enum MemAccessType { READ, WRITE, NUM_ACCESS_TYPES};
 
+template <class T> class TickEvent;
+
 // DRAM rank base class
 class MemRankBase : public GlobAlloc {
     protected:
@@ -214,6 +216,9 @@ class MemSchedulerBase : public GlobAlloc {
         //
         // FIXME(dsm): refpointer? pointeref? Hmmm...
         virtual bool GetEvent(MemAccessEventBase*& ev, Address& addr, MemAccessType& type) = 0;
+
+        // True if GetEvent() has nothing to return (no queued reads or writes)
+        virtual bool IsIdle() const = 0;
 };
 
 class MemSchedulerDefault : public MemSchedulerBase {
@@ -234,6 +239,7 @@ class MemSchedulerDefault : public MemSchedulerBase {
         ~MemSchedulerDefault();
         bool CheckSetEvent(MemAccessEventBase* ev);
         bool GetEvent(MemAccessEventBase*& ev, Address& addr, MemAccessType& type);
+        bool IsIdle() const { return rdQueue.empty() && wrQueue.empty(); }
 };
 
 // DRAM controller base class
@@ -256,6 +262,9 @@ class MemControllerBase : public MemObject {
         uint64_t nextSysTick;
         uint64_t reportPeriodCycle;
 
+        // Scheduler tick; goes idle when all scheduler queues are empty, and enqueue() wakes it up
+        TickEvent<MemControllerBase>* tickEvent;
+
         // latency
         uint32_t minLatency[NUM_ACCESS_TYPES];
         uint32_t preDelay[NUM_ACCESS_TYPES];
@@ -289,6 +298,7 @@ class MemControllerBase : public MemObject {
         Counter profActivate;
         Counter profPrecharge;
         Counter profRefresh;
+        Counter profTickWakeups;
 
         static const uint32_t pwCounterNum = 7;
         Counter profAccAvgPower[pwCounterNum];
@@ -76,8 +76,8 @@ DRAMSimMemory::DRAMSimMemory(string& dramTechIni, string& dramSystemIni, string&
     dramCore->RegisterCallbacks(read_cb, write_cb, nullptr);
 
     domain = _domain;
-    TickEvent<DRAMSimMemory>* tickEv = new TickEvent<DRAMSimMemory>(this, domain);
-    tickEv->queue(0);  // start the sim at time 0
+    tickEvent = new TickEvent<DRAMSimMemory>(this, domain);
+    tickEvent->queue(0);  // start the sim at time 0
 
     name = _name;
 }
@@ -89,6 +89,7 @@ void DRAMSimMemory::initStats(AggregateStat* parentStat) {
     profWrites.init("wr", "Write requests"); memStats->append(&profWrites);
     profTotalRdLat.init("rdlat", "Total latency experienced by read requests"); memStats->append(&profTotalRdLat);
     profTotalWrLat.init("wrlat", "Total latency experienced by write requests"); memStats->append(&profTotalWrLat);
+    profIdleUpdates.init("idleUpdates", "DRAMSim updates replayed on wakeup instead of ticked"); memStats->append(&profIdleUpdates);
     parentStat->append(memStats);
 }
 
@@ -126,10 +127,24 @@ uint64_t DRAMSimMemory::access(MemReq& req) {
 uint32_t DRAMSimMemory::tick(uint64_t cycle) {
     dramCore->update();
     curCycle++;
-    return 1;
+    return inflightRequests.empty()? 0 : 1;  // stop ticking when idle, enqueue() catches up
 }
 
 void DRAMSimMemory::enqueue(DRAMSimAccEvent* ev, uint64_t cycle) {
+    if (!tickEvent->isActive()) {
+        /* Bring DRAMSim's clock up to date. It has no way to skip cycles, and
+         * refreshes and power-downs happen inside update(), so we replay the
+         * idle updates back to back. This gives the same DRAM state as
+         * ticking every cycle, without a weave event per cycle.
+         */
+        if (curCycle < cycle) profIdleUpdates.inc(cycle - curCycle);
+        while (curCycle < cycle) {
+            dramCore->update();
+            curCycle++;
+        }
+        tickEvent->wake(curCycle);  // if we went idle this cycle, curCycle == cycle+1
+    }
+
     //info("[%s] %s access to %lx added at %ld, %ld inflight reqs", getName(), ev->isWrite()? "Write" : "Read", ev->getAddr(), cycle, inflightRequests.size());
     dramCore->addTransaction(ev->isWrite(), ev->getAddr());
     inflightRequests.insert(std::pair<Address, DRAMSimAccEvent*>(ev->getAddr(), ev));
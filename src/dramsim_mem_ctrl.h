@@ -38,6 +38,7 @@ namespace DRAMSim {
 };
 
 class DRAMSimAccEvent;
+template <class T> class TickEvent;
 
 class DRAMSimMemory : public MemObject { //one DRAMSim controller
     private:
@@ -51,12 +52,16 @@ class DRAMSimMemory : public MemObject { //one DRAMSim controller
 
         uint64_t curCycle; //processor cycle, used in callbacks
 
+        // Ticks DRAMSim while requests are in flight; enqueue() wakes it up
+        TickEvent<DRAMSimMemory>* tickEvent;
+
         // R/W stats
         PAD();
         Counter profReads;
         Counter profWrites;
         Counter profTotalRdLat;
         Counter profTotalWrLat;
+        Counter profIdleUpdates;
         PAD();
 
     public:
@@ -82,17 +87,38 @@ class DRAMSimMemory : public MemObject { //one DRAMSim controller
 //DRAMSIM does not support non-pow2 channels, so:
 // - Encapsulate multiple DRAMSim controllers
 // - Fan out addresses interleaved across banks, and change the address to a "memory address"
+/* Interleaves lines across controllers. With NUMA nodes (numNodes > 1), each
+ * node owns mems.size()/numNodes controllers, and lines of node n (those with
+ * lineAddr >> nodeLineShift == n) are interleaved across node n's controllers
+ * only.
+ */
 class SplitAddrMemory : public MemObject {
     private:
         const g_vector<MemObject*> mems;
         const g_string name;
+        const uint32_t numNodes;
+        const uint32_t nodeLineShift;
+        const uint32_t memsPerNode;
     public:
-        SplitAddrMemory(const g_vector<MemObject*>& _mems, const char* _name) : mems(_mems), name(_name) {}
+        SplitAddrMemory(const g_vector<MemObject*>& _mems, const char* _name, uint32_t _numNodes = 1, uint32_t _nodeLineShift = 0)
+            : mems(_mems), name(_name), numNodes(_numNodes), nodeLineShift(_nodeLineShift), memsPerNode(_mems.size()/_numNodes)
+        {
+            assert(numNodes > 0 && memsPerNode*numNodes == mems.size());
+        }
 
         uint64_t access(MemReq& req) {
             Address addr = req.lineAddr;
-            uint32_t mem = addr % mems.size();
-            Address ctrlAddr = addr/mems.size();
+            uint32_t mem;
+            Address ctrlAddr;
+            if (numNodes == 1) {
+                mem = addr % mems.size();
+                ctrlAddr = addr/mems.size();
+            } else {
+                uint32_t node = (addr >> nodeLineShift) % numNodes;
+                Address local = addr & ((1ULL << nodeLineShift) - 1);
+                mem = node*memsPerNode + local % memsPerNode;
+                ctrlAddr = local/memsPerNode;
+            }
             req.lineAddr = ctrlAddr;
             uint64_t respCycle = mems[mem]->access(req);
             req.lineAddr = addr;
@@ -0,0 +1,199 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Reads the live stats file of a running simulation (see live_stats.h) */
+
+#include <fcntl.h>
+#include <map>
+#include <regex>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "live_stats.h"
+#include "log.h"
+
+using std::string; using std::vector;
+
+struct Snapshot {
+    LiveStatsHeader hdr;
+    vector<uint64_t> values;
+};
+
+static const char* MapFile(const char* file) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) panic("Could not open %s", file);
+    struct stat st;
+    if (fstat(fd, &st) != 0) panic("Could not stat %s", file);
+    if ((size_t)st.st_size < sizeof(LiveStatsHeader)) panic("%s is too small to be a live stats file", file);
+    void* res = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (res == MAP_FAILED) panic("Could not mmap %s", file);
+    close(fd);
+
+    const LiveStatsHeader* hdr = static_cast<const LiveStatsHeader*>(res);
+    if (hdr->magic != LIVE_STATS_MAGIC) panic("%s is not a live stats file (or zsim is still initializing it)", file);
+    if (hdr->version != LIVE_STATS_VERSION) panic("%s has version %d, expected %d", file, hdr->version, LIVE_STATS_VERSION);
+    if (hdr->fileSize != (uint64_t)st.st_size) panic("%s has size %ld, header says %ld", file, st.st_size, hdr->fileSize);
+    return static_cast<const char*>(res);
+}
+
+// Seqlock read side: copy, and retry if the writer was active during the copy
+static void Read(const char* base, Snapshot& snap) {
+    const LiveStatsHeader* hdr = reinterpret_cast<const LiveStatsHeader*>(base);
+    snap.values.resize(hdr->numValues);
+    while (true) {
+        uint64_t seq = hdr->seq;
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        __sync_synchronize();
+        memcpy(&snap.hdr, hdr, sizeof(LiveStatsHeader));
+        memcpy(&snap.values[0], base + hdr->valuesOffset, hdr->numValues*sizeof(uint64_t));
+        __sync_synchronize();
+        if (hdr->seq == seq) break;
+    }
+}
+
+static vector<string> ReadNames(const char* base) {
+    const LiveStatsHeader* hdr = reinterpret_cast<const LiveStatsHeader*>(base);
+    vector<string> names;
+    const char* p = base + hdr->namesOffset;
+    for (uint32_t i = 0; i < hdr->numValues; i++) {
+        names.push_back(p);
+        p += names.back().size() + 1;
+    }
+    return names;
+}
+
+/* Summary metrics. Per-core and per-cache stats are the third level of
+ * the tree (e.g., simple.simple-0.instrs, l1d.l1d-0.mGETS); deeper copies
+ * (e.g., per-process stats) are ignored so nothing is double-counted.
+ */
+struct Summary {
+    uint64_t instrs;
+    uint64_t cycles;
+    std::map<string, uint64_t> misses;  // by cache group
+};
+
+static Summary Summarize(const vector<string>& names, const Snapshot& snap) {
+    Summary s = {0, 0, std::map<string, uint64_t>()};
+    for (uint32_t i = 0; i < names.size(); i++) {
+        const string& n = names[i];
+        size_t d1 = n.find('.');
+        size_t d2 = (d1 == string::npos)? string::npos : n.find('.', d1 + 1);
+        if (d2 == string::npos || n.find('.', d2 + 1) != string::npos) continue;
+        string stat = n.substr(d2 + 1);
+        uint64_t v = snap.values[i];
+        if (stat == "instrs") s.instrs += v;
+        else if (stat == "cycles") s.cycles += v;
+        else if (stat == "mGETS" || stat == "mGETXIM" || stat == "mGETXSM") s.misses[n.substr(0, d1)] += v;
+    }
+    return s;
+}
+
+static void PrintSummary(const Snapshot& snap, const Summary& cur, const Summary* prev, const Snapshot* prevSnap) {
+    uint64_t instrs = cur.instrs - (prev? prev->instrs : 0);
+    uint64_t cycles = cur.cycles - (prev? prev->cycles : 0);
+    printf("phase %ld cycles %ld instrs %ld", snap.hdr.phase, snap.hdr.cycles, instrs);
+    printf(" IPC %.3f", cycles? ((double)instrs)/cycles : 0.0);
+    if (prevSnap && snap.hdr.hostNs > prevSnap->hdr.hostNs) {
+        printf(" MIPS %.2f", instrs*1e3/(snap.hdr.hostNs - prevSnap->hdr.hostNs));
+    }
+    for (auto& m : cur.misses) {
+        uint64_t misses = m.second - (prev? prev->misses.at(m.first) : 0);
+        printf(" %s-MPKI %.3f", m.first.c_str(), instrs? misses*1e3/instrs : 0.0);
+    }
+    printf("%s\n", snap.hdr.finished? " (finished)" : "");
+}
+
+int main(int argc, char* argv[]) {
+    InitLog(""); //no log header
+    const char* filter = nullptr;
+    double interval = 0.0;
+    bool summary = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:i:s")) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 'i': interval = atof(optarg); break;
+            case 's': summary = true; break;
+            default: optind = argc + 1;  // print usage
+        }
+    }
+    if (optind != argc - 1) {
+        info("Prints the live stats of a running simulation");
+        info("Usage: %s [-f <regex>] [-i <secs>] [-s] <zsim-live.bin>", argv[0]);
+        info("  -f: only print stats whose names match regex");
+        info("  -i: poll every secs, printing the stats that changed and by how much (or summary rates)");
+        info("  -s: print instructions, IPC, MIPS, and per-cache MPKI instead of raw stats");
+        exit(1);
+    }
+
+    const char* base = MapFile(argv[optind]);
+    vector<string> names = ReadNames(base);
+    vector<bool> selected(names.size(), true);
+    if (filter) {
+        std::regex re(filter);
+        for (uint32_t i = 0; i < names.size(); i++) selected[i] = std::regex_match(names[i], re);
+    }
+
+    Snapshot prev, cur;
+    Read(base, cur);
+    if (summary) {
+        PrintSummary(cur, Summarize(names, cur), nullptr, nullptr);
+    } else {
+        printf("# phase %ld cycles %ld updates %ld%s\n", cur.hdr.phase, cur.hdr.cycles, cur.hdr.updates, cur.hdr.finished? " (finished)" : "");
+        for (uint32_t i = 0; i < names.size(); i++) {
+            if (selected[i]) printf("%s: %ld\n", names[i].c_str(), cur.values[i]);
+        }
+    }
+
+    while (interval > 0.0 && !cur.hdr.finished) {
+        usleep((useconds_t)(interval*1e6));
+        prev = cur;
+        Read(base, cur);
+        if (cur.hdr.updates == prev.hdr.updates) continue;
+        if (summary) {
+            Summary prevSummary = Summarize(names, prev);
+            PrintSummary(cur, Summarize(names, cur), &prevSummary, &prev);
+        } else {
+            printf("# phase %ld cycles %ld (+%ld)%s\n", cur.hdr.phase, cur.hdr.cycles, cur.hdr.cycles - prev.hdr.cycles, cur.hdr.finished? " (finished)" : "");
+            for (uint32_t i = 0; i < names.size(); i++) {
+                if (selected[i] && cur.values[i] != prev.values[i]) {
+                    printf("%s: %ld (%+ld)\n", names[i].c_str(), cur.values[i], (int64_t)(cur.values[i] - prev.values[i]));
+                }
+            }
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
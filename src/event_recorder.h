@@ -56,6 +56,7 @@ class EventRecorder : public GlobAlloc {
         TimingRecord tr;
         CrossingStack crossingStack;
         uint32_t srcId;
+        uint64_t crossings; //produced by this recorder's core; only written in the bound phase
 
         volatile uint64_t lastGapCycles;
         PAD();
@@ -63,7 +64,7 @@ class EventRecorder : public GlobAlloc {
         PAD();
 
     public:
-        EventRecorder() {
+        EventRecorder() : crossings(0) {
             tr.clear();
         }
 
@@ -78,6 +79,11 @@ class EventRecorder : public GlobAlloc {
             return slabAlloc.alloc(sz);
         }
 
+        //Called between phases by a pipelined ContentionSim, see SlabAlloc::retireCurSlab()
+        void retireSlab() {
+            slabAlloc.retireCurSlab();
+        }
+
         //Event recording interface
 
         void pushRecord(const TimingRecord& rec) {
@@ -121,6 +127,9 @@ class EventRecorder : public GlobAlloc {
         uint32_t getSourceId() const {return srcId;}
         void setSourceId(uint32_t i) {srcId = i;}
 
+        inline void incCrossings() {crossings++;}
+        uint64_t getCrossings() const {return crossings;}
+
         inline CrossingStack& getCrossingStack() {
             return crossingStack;
         }
@@ -29,6 +29,8 @@
 #include "bithacks.h"
 #include "cache.h"
 #include "galloc.h"
+#include "mem_sampler.h"
+#include "tlb.h"
 #include "zsim.h"
 
 /* Extends Cache with an L0 direct-mapped cache, optimized to hell for hits
@@ -41,16 +43,76 @@
  * it is fine to do this without grabbing a lock.
  */
 
-class FilterCache : public Cache {
-    private:
-        struct FilterEntry {
-            volatile Address rdAddr;
-            volatile Address wrAddr;
-            volatile uint64_t availCycle;
+struct FilterEntry {
+    volatile Address rdAddr;
+    volatile Address wrAddr;
+    volatile uint64_t availCycle;
+    Address pLineAddr;  // physical line of rdAddr, to match invalidations; protected by filterLock
+
+    void clear() {wrAddr = 0; rdAddr = 0; availCycle = 0; pLineAddr = -1L;}
+};
+
+/* Filter hits without a call (sim.filterFastPath = true). zsim instruments
+ * each memory access with a Pin If-call that runs these checks inline, and
+ * calls the core's analysis routine only on filter misses.
+ *
+ * A filter hit only does curCycle = MAX(curCycle, availCycle), so hits just
+ * fold their availCycle into pendingCycle. The core applies pendingCycle
+ * before anything else touches curCycle (the next miss, BBL, join or leave).
+ * Because the core only adds instruction cycles at BBL boundaries, this gives
+ * the same timing as handling each hit in order.
+ *
+ * Must stay branch-free so that Pin inlines it.
+ */
+struct FilterFastPath {
+    const FilterEntry* entries;
+    Address setMask;
+    uint64_t lineBits;
+    uint64_t pendingCycle;
+    uint64_t loadHits;
+    uint64_t storeHits;
+    uint64_t pad[2];  // one line per core
 
-            void clear() {wrAddr = 0; rdAddr = 0; availCycle = 0;}
-        };
+    // Both return true if the access missed and must take the regular path
+    inline bool loadMiss(Address vAddr) {
+        Address vLineAddr = vAddr >> lineBits;
+        const FilterEntry& e = entries[vLineAddr & setMask];
+        uint64_t availCycle = e.availCycle; //read before, careful with ordering to avoid timing races
+        bool hit = vLineAddr == e.rdAddr;
+        pendingCycle = (hit & (availCycle > pendingCycle))? availCycle : pendingCycle;
+        loadHits += hit;
+        return !hit;
+    }
 
+    inline bool storeMiss(Address vAddr) {
+        Address vLineAddr = vAddr >> lineBits;
+        const FilterEntry& e = entries[vLineAddr & setMask];
+        uint64_t availCycle = e.availCycle;
+        bool hit = vLineAddr == e.wrAddr;
+        pendingCycle = (hit & (availCycle > pendingCycle))? availCycle : pendingCycle;
+        storeHits += hit;
+        return !hit;
+    }
+
+    // Applies pending hits; returns the updated curCycle
+    inline uint64_t apply(uint64_t curCycle) {
+        uint64_t res = MAX(curCycle, pendingCycle);
+        pendingCycle = 0;
+        return res;
+    }
+
+    // A fast path that never hits
+    void initEmpty(uint32_t _lineBits) {
+        static const FilterEntry invalidEntry = {(Address)-1L, (Address)-1L, 0, (Address)-1L};
+        entries = &invalidEntry;
+        setMask = 0;
+        lineBits = _lineBits;
+        pendingCycle = loadHits = storeHits = 0;
+    }
+};
+
+class FilterCache : public Cache {
+    private:
         //Replicates the most accessed line of each set in the cache
         FilterEntry* filterArray;
         Address setMask;
@@ -61,6 +123,11 @@ class FilterCache : public Cache {
         lock_t filterLock;
         uint64_t fGETSHit, fGETXHit;
 
+        FilterFastPath fastPath;
+
+        MMU* mmu;  // nullptr unless sys.vm.enable
+        MemSampler* sampler;  // nullptr unless sim.memSampling and this is a dcache
+
     public:
         FilterCache(uint32_t _numSets, uint32_t _numLines, CC* _cc, CacheArray* _array,
                 ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, g_string& _name)
@@ -74,6 +141,11 @@ class FilterCache : public Cache {
             fGETSHit = fGETXHit = 0;
             srcId = -1;
             reqFlags = 0;
+            fastPath.initEmpty(ilog2(zinfo->lineSize));  // lineBits may not be set yet
+            fastPath.entries = filterArray;
+            fastPath.setMask = setMask;
+            mmu = nullptr;
+            sampler = nullptr;
         }
 
         void setSourceId(uint32_t id) {
@@ -84,14 +156,33 @@ class FilterCache : public Cache {
             reqFlags = flags;
         }
 
+        void setSampler(MemSampler* _sampler) {
+            sampler = _sampler;
+        }
+
+        FilterFastPath* getFastPath() {
+            return &fastPath;
+        }
+
+        void setMMU(MMU* _mmu) {
+            // The filter array is indexed with virtual addresses, and the cache array with physical ones.
+            // They must match, or the filter could keep lines the array evicts. Same constraint as VIPT caches.
+            if (numSets > (1u << _mmu->getPageLineBits())) {
+                panic("%s: %d sets span more than a page, cannot be virtually indexed", name.c_str(), numSets);
+            }
+            mmu = _mmu;
+        }
+
         void initStats(AggregateStat* parentStat) {
             AggregateStat* cacheStat = new AggregateStat();
             cacheStat->init(name.c_str(), "Filter cache stats");
 
-            ProxyStat* fgetsStat = new ProxyStat();
-            fgetsStat->init("fhGETS", "Filtered GETS hits", &fGETSHit);
-            ProxyStat* fgetxStat = new ProxyStat();
-            fgetxStat->init("fhGETX", "Filtered GETX hits", &fGETXHit);
+            auto fgets = [this]() { return fGETSHit + fastPath.loadHits; };
+            auto fgetsStat = makeLambdaStat(fgets);
+            fgetsStat->init("fhGETS", "Filtered GETS hits");
+            auto fgetx = [this]() { return fGETXHit + fastPath.storeHits; };
+            auto fgetxStat = makeLambdaStat(fgetx);
+            fgetxStat->init("fhGETX", "Filtered GETX hits");
             cacheStat->append(fgetsStat);
             cacheStat->append(fgetxStat);
 
@@ -126,7 +217,15 @@ class FilterCache : public Cache {
         }
 
         uint64_t replace(Address vLineAddr, uint32_t idx, bool isLoad, uint64_t curCycle) {
-            Address pLineAddr = procMask | vLineAddr;
+            uint64_t startCycle = curCycle;
+            Address pLineAddr;
+            TimingRecord walkRec;
+            walkRec.clear();
+            if (mmu) pLineAddr = mmu->translate(vLineAddr, curCycle, walkRec);  // may walk, advancing curCycle
+            else pLineAddr = procMask | vLineAddr;
+
+            bool sampled = unlikely(sampler != nullptr) && sampler->startSample(srcId);  // after the walk, which also accesses caches
+
             MESIState dummyState = MESIState::I;
             futex_lock(&filterLock);
             MemReq req = {pLineAddr, isLoad? GETS : GETX, 0, &dummyState, curCycle, &filterLock, dummyState, srcId, reqFlags};
@@ -138,23 +237,45 @@ class FilterCache : public Cache {
             Address oldAddr = filterArray[idx].rdAddr;
             filterArray[idx].wrAddr = isLoad? -1L : vLineAddr;
             filterArray[idx].rdAddr = vLineAddr;
+            filterArray[idx].pLineAddr = pLineAddr;
 
             //For LSU simulation purposes, loads bypass stores even to the same line if there is no conflict,
             //(e.g., st to x, ld from x+8) and we implement store-load forwarding at the core.
             //So if this is a load, it always sets availCycle; if it is a store hit, it doesn't
             if (oldAddr != vLineAddr) filterArray[idx].availCycle = respCycle;
 
+            futex_unlock(&filterLock);
+            if (unlikely(walkRec.isValid())) mmu->mergeWalkRecord(walkRec);
+            if (unlikely(sampled)) sampler->endSample(srcId, vLineAddr, isLoad, respCycle - startCycle);
+            return respCycle;
+        }
+
+        // Page walk read of a page table entry; does not fill the filter array.
+        // The fill may evict the line the filter keeps for this set (filter and
+        // array sets match), and that eviction is never seen as an invalidation,
+        // so we drop the filter entry.
+        uint64_t walkAccess(Address pLineAddr, uint64_t curCycle) {
+            MESIState dummyState = MESIState::I;
+            futex_lock(&filterLock);
+            MemReq req = {pLineAddr, GETS, 0, &dummyState, curCycle, &filterLock, dummyState, srcId, 0 /*no flags*/};
+            uint64_t respCycle = access(req);
+            uint32_t idx = pLineAddr & setMask;
+            filterArray[idx].wrAddr = -1L;
+            filterArray[idx].rdAddr = -1L;
+            filterArray[idx].availCycle = 0;
+            filterArray[idx].pLineAddr = -1L;
             futex_unlock(&filterLock);
             return respCycle;
         }
 
         uint64_t invalidate(const InvReq& req) {
-            Cache::startInvalidate();  // grabs cache's downLock
+            Cache::startInvalidate(req.lineAddr);  // grabs cache's downLock
             futex_lock(&filterLock);
-            uint32_t idx = req.lineAddr & setMask; //works because of how virtual<->physical is done...
-            if ((filterArray[idx].rdAddr | procMask) == req.lineAddr) { //FIXME: If another process calls invalidate(), procMask will not match even though we may be doing a capacity-induced invalidation!
+            uint32_t idx = req.lineAddr & setMask; //works because virtual and physical addresses have the same index bits
+            if (filterArray[idx].pLineAddr == req.lineAddr) {
                 filterArray[idx].wrAddr = -1L;
                 filterArray[idx].rdAddr = -1L;
+                filterArray[idx].pLineAddr = -1L;
             }
             uint64_t respCycle = Cache::finishInvalidate(req); // releases cache's downLock
             futex_unlock(&filterLock);
@@ -0,0 +1,137 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks that FilterCache never keeps a line its array has evicted.
+ * Page walks (FilterCache::walkAccess) fill the cache array without going
+ * through the filter array, so a walk can evict the line the filter holds for
+ * that set. For every set, this loads a line so the filter holds it, then
+ * walks enough page table lines of the same set to evict it, and checks that
+ * the filter no longer hits on it and that reloading it misses in the array.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache_arrays.h"
+#include "coherence_ctrls.h"
+#include "event_recorder.h"
+#include "filter_cache.h"
+#include "galloc.h"
+#include "hash.h"
+#include "log.h"
+#include "mem_ctrls.h"
+#include "repl_policies.h"
+#include "zsim.h"
+
+// Process-wide globals (see zsim.h); a single process
+GlobSimInfo* zinfo;
+uint32_t procIdx = 0;
+uint32_t lineBits;
+uint64_t procMask = 0;
+
+struct Params {
+    uint32_t sizeKB = 32;
+    uint32_t ways = 8;
+    uint32_t accLat = 4;
+    uint32_t memLat = 100;
+};
+
+static void usage(const char* argv0) {
+    info("Checks that page walks that evict a line also drop it from the filter cache");
+    info("Usage: %s [-s sizeKB] [-w ways] [-l accLat] [-m memLat]", argv0);
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog("");  // no log header
+
+    Params p;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 >= argc) usage(argv[0]);
+        const char* v = argv[++i];
+        switch (argv[i-1][1]) {
+            case 's': p.sizeKB = strtoul(v, nullptr, 0); break;
+            case 'w': p.ways = strtoul(v, nullptr, 0); break;
+            case 'l': p.accLat = strtoul(v, nullptr, 0); break;
+            case 'm': p.memLat = strtoul(v, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (!p.ways || p.memLat <= p.accLat) usage(argv[0]);
+
+    gm_init(64 << 20);
+    zinfo = gm_calloc<GlobSimInfo>();
+    zinfo->numCores = 1;
+    zinfo->lineSize = 64;
+    zinfo->eventRecorders = gm_calloc<EventRecorder*>(1);  // no weave models
+    lineBits = ilog2(zinfo->lineSize);
+
+    uint32_t numLines = (p.sizeKB << 10) >> lineBits;
+    uint32_t numSets = numLines / p.ways;
+    if (!numSets || numSets * p.ways != numLines || !isPow2(numSets)) panic("Invalid geometry: %d lines, %d ways", numLines, p.ways);
+
+    g_string name("l1d");
+    g_string memName("mem");
+    ReplPolicy* rp = new LRUReplPolicy<false>(numLines);
+    CacheArray* array = new SetAssocArray(numLines, p.ways, rp, new IdHashFamily());
+    CC* cc = new MESITerminalCC(numLines, name);
+    rp->setCC(cc);
+    FilterCache* l1d = new FilterCache(numSets, numLines, cc, array, rp, p.accLat, p.accLat, name);
+    g_vector<MemObject*> parents;
+    parents.push_back(new SimpleMemory(p.memLat, memName));
+    l1d->setParents(0, parents, nullptr);
+    l1d->setSourceId(0);
+    FilterFastPath* fp = l1d->getFastPath();
+
+    uint64_t cycle = 0;
+    uint32_t failures = 0;
+    for (uint32_t set = 0; set < numSets; set++) {
+        Address vLineAddr = set;
+        Address vAddr = vLineAddr << lineBits;
+        cycle = l1d->load(vAddr, cycle) + 1;
+        if (fp->loadMiss(vAddr)) panic("Set %d: line 0x%lx not in the filter after a load", set, vLineAddr);
+
+        // Without an MMU, physical and virtual lines match (procMask is 0)
+        for (uint32_t w = 0; w < p.ways; w++) {
+            cycle = l1d->walkAccess(vLineAddr + (w + 1) * numSets, cycle) + 1;
+        }
+
+        bool stale = !fp->loadMiss(vAddr) || !fp->storeMiss(vAddr);
+        uint64_t respCycle = l1d->load(vAddr, cycle);
+        if (stale || respCycle - cycle < p.memLat) {
+            if (!failures) info("First failure: set %d, filter %s, reload took %ld cycles",
+                    set, stale? "still hits" : "misses", respCycle - cycle);
+            failures++;
+        }
+        cycle = respCycle + 1;
+    }
+
+    if (failures) {
+        info("FAIL: %d of %d sets keep a line evicted by a page walk", failures, numSets);
+        return 1;
+    }
+    info("OK: %d sets, evicting lines with %d page walks per set", numSets, p.ways);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "flat_stats.h"
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include "log.h"
+
+FlatStats::FlatStats(AggregateStat* rootStat, bool _withNames) : withNames(_withNames) {
+    for (uint32_t i = 0; i < rootStat->size(); i++) flatten(rootStat->get(i), "");
+}
+
+void FlatStats::flatten(Stat* s, const g_string& prefix) {
+    g_string name = prefix + s->name();
+    if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
+        for (uint32_t i = 0; i < as->size(); i++) flatten(as->get(i), name + ".");
+    } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(s)) {
+        entries.push_back({ss, nullptr, 0});
+        if (withNames) names.push_back(name);
+    } else if (VectorStat* vs = dynamic_cast<VectorStat*>(s)) {
+        for (uint32_t i = 0; i < vs->size(); i++) {
+            entries.push_back({nullptr, vs, i});
+            if (!withNames) continue;
+            g_string elem = vs->hasCounterNames()? g_string(vs->counterName(i)) : g_string(std::to_string(i).c_str());
+            names.push_back(name + "." + elem);
+        }
+    } else {
+        panic("Unrecognized stat type");
+    }
+}
+
+StatsOutputBuffer::StatsOutputBuffer(const char* _filename, size_t capacity) : filename(_filename) {
+    buf.reserve(capacity);
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) panic("Could not create stats file %s", filename);
+    close(fd);
+}
+
+void StatsOutputBuffer::flush() {
+    if (buf.empty()) return;
+    int fd = open(filename, O_WRONLY | O_APPEND);
+    if (fd < 0) panic("Could not open stats file %s", filename);
+    const char* p = buf.data();
+    size_t left = buf.size();
+    while (left) {
+        ssize_t res = write(fd, p, left);
+        if (res < 0) panic("Write to stats file %s failed", filename);
+        p += res;
+        left -= res;
+    }
+    close(fd);
+    buf.clear();  // keeps capacity
+}
@@ -0,0 +1,111 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLAT_STATS_H_
+#define FLAT_STATS_H_
+
+/* Helpers for stats backends that write many counters per dump */
+
+#include <stdint.h>
+#include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "log.h"
+#include "stats.h"
+
+/* A stats tree flattened into its counters, in the order of an inorder walk
+ * of the tree (the order of the text backend). Names are dot-separated paths
+ * without the root (e.g., l1d.l1d-0.mGETS); vector elements get their
+ * counter name or index appended. Flattening happens once, so dumps need no
+ * recursion or dynamic_casts.
+ */
+class FlatStats : public GlobAlloc {
+    private:
+        struct Entry {
+            ScalarStat* scalar;
+            VectorStat* vector;  // if scalar is nullptr
+            uint32_t idx;
+        };
+
+        g_vector<Entry> entries;
+        g_vector<g_string> names;  // empty unless withNames
+        bool withNames;
+
+        void flatten(Stat* s, const g_string& prefix);
+
+    public:
+        explicit FlatStats(AggregateStat* rootStat, bool _withNames = true);
+
+        uint32_t size() const {return entries.size();}
+        const g_string& name(uint32_t i) const {
+            assert(withNames);
+            return names[i];
+        }
+
+        inline uint64_t get(uint32_t i) const {
+            const Entry& e = entries[i];
+            return e.scalar? e.scalar->get() : e.vector->count(e.idx);
+        }
+
+        void read(uint64_t* values) const {
+            for (uint32_t i = 0; i < entries.size(); i++) values[i] = get(i);
+        }
+};
+
+/* Append-only output buffer in the global heap. Dumps format into it, and
+ * flush() writes it out with a single write. Since dumps can happen from any
+ * process, we cannot keep a file descriptor open across flushes.
+ */
+class StatsOutputBuffer : public GlobAlloc {
+    private:
+        const char* filename;
+        g_string buf;
+
+    public:
+        // Truncates the file
+        StatsOutputBuffer(const char* _filename, size_t capacity);
+
+        size_t size() const {return buf.size();}
+
+        inline void append(const char* s, size_t len) {buf.append(s, len);}
+        inline void append(const char* s) {buf.append(s);}
+        inline void append(const g_string& s) {buf.append(s);}
+        inline void append(char c) {buf.push_back(c);}
+        inline void append(size_t n, char c) {buf.append(n, c);}
+
+        inline void appendU64(uint64_t v) {
+            char tmp[20];
+            uint32_t pos = sizeof(tmp);
+            do {
+                tmp[--pos] = '0' + (v % 10);
+                v /= 10;
+            } while (v);
+            buf.append(tmp + pos, sizeof(tmp) - pos);
+        }
+
+        void flush();
+};
+
+#endif  // FLAT_STATS_H_
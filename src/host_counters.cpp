@@ -0,0 +1,156 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "host_counters.h"
+#include <linux/perf_event.h>
+#include <string.h>
+#include <syscall.h>
+#include <unistd.h>
+#include "log.h"
+
+static const char* eventNames[HC_NUM_EVENTS] = {"cycles", "instrs", "llcMisses", "branchMisses"};
+static const char* eventDescs[HC_NUM_EVENTS] = {"Host cycles", "Host instructions", "Host last-level cache misses", "Host branch misses"};
+static const uint64_t eventConfigs[HC_NUM_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+HostCounterGroup::HostCounterGroup() {
+    numOpen = 0;
+    for (uint32_t e = 0; e < HC_NUM_EVENTS; e++) {
+        fds[e] = -1;
+        last[e] = 0;
+        readIdx[e] = 0;
+    }
+
+    // Cycles lead the group, so all events count over the same intervals
+    for (uint32_t e = 0; e < HC_NUM_EVENTS; e++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = eventConfigs[e];
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // Raw syscall; pid 0, cpu -1 counts the calling thread on any CPU
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, (e == HC_CYCLES)? -1 : fds[HC_CYCLES], 0);
+        if (fd < 0) {
+            if (e == HC_CYCLES) return;  // invalid
+            continue;
+        }
+        fds[e] = fd;
+        readIdx[e] = numOpen++;
+    }
+    read(nullptr);
+}
+
+HostCounterGroup::~HostCounterGroup() {
+    // Members first, the leader last
+    for (int32_t e = HC_NUM_EVENTS - 1; e >= 0; e--) {
+        if (fds[e] != -1) close(fds[e]);
+    }
+}
+
+void HostCounterGroup::read(uint64_t* delta) {
+    if (!isValid()) return;
+    uint64_t buf[3 + HC_NUM_EVENTS];  // nr, time enabled, time running, values
+    ssize_t bytes = ::read(fds[HC_CYCLES], buf, sizeof(buf));
+    if (bytes < (ssize_t)((3 + numOpen)*sizeof(uint64_t))) return;
+
+    uint64_t enabled = buf[1];
+    uint64_t running = buf[2];
+    for (uint32_t e = 0; e < HC_NUM_EVENTS; e++) {
+        if (fds[e] == -1) continue;
+        uint64_t val = buf[3 + readIdx[e]];
+        // Scale up if the kernel multiplexed the counters
+        if (running && running < enabled) val = (uint64_t)(((double)val)*enabled/running);
+        if (val > last[e]) {  // scaled values can dip slightly
+            if (delta) delta[e] += val - last[e];
+            last[e] = val;
+        }
+    }
+}
+
+HostCounters::HostCounters(uint32_t _numCores, uint32_t _numSimThreads) {
+    numCores = _numCores;
+    numSimThreads = _numSimThreads;
+    bound = gm_memalign<Counts>(CACHE_LINE_BYTES, numCores);
+    weave = gm_memalign<Counts>(CACHE_LINE_BYTES, numSimThreads);
+    for (uint32_t e = 0; e < HC_NUM_EVENTS; e++) {
+        for (uint32_t c = 0; c < numCores; c++) bound[c].v[e] = 0;
+        for (uint32_t t = 0; t < numSimThreads; t++) weave[t].v[e] = 0;
+        sync.v[e] = 0;
+        phaseEnd.v[e] = 0;
+    }
+    warned = false;
+}
+
+HostCounterGroup* HostCounters::openGroup() {
+    HostCounterGroup* g = new HostCounterGroup();
+    if (!g->isValid()) {
+        if (!warned) {
+            warned = true;
+            warn("sim.hostCounters: could not open host performance counters (no PMU, or see /proc/sys/kernel/perf_event_paranoid), some threads will not be counted");
+        }
+        delete g;
+        return nullptr;
+    }
+    return g;
+}
+
+void HostCounters::add(HostCounterGroup* g, Counts* c) {
+    uint64_t delta[HC_NUM_EVENTS] = {0};
+    g->read(delta);
+    // Buckets may be shared (sync, or a core whose thread was switched out), but this happens once per phase
+    for (uint32_t e = 0; e < HC_NUM_EVENTS; e++) {
+        if (delta[e]) __sync_fetch_and_add(&c->v[e], delta[e]);
+    }
+}
+
+AggregateStat* HostCounters::makeStats(const char* name, const char* desc, Counts* counts, uint32_t size) {
+    AggregateStat* bucketStat = new AggregateStat();
+    bucketStat->init(name, desc);
+    for (uint32_t e = 0; e < HC_NUM_EVENTS; e++) {
+        if (size) {
+            auto vecStat = makeLambdaVectorStat([counts, e](uint32_t i) { return counts[i].v[e]; }, size);
+            vecStat->init(eventNames[e], eventDescs[e]);
+            bucketStat->append(vecStat);
+        } else {
+            auto scalarStat = makeLambdaStat([counts, e]() { return counts->v[e]; });
+            scalarStat->init(eventNames[e], eventDescs[e]);
+            bucketStat->append(scalarStat);
+        }
+    }
+    return bucketStat;
+}
+
+void HostCounters::initStats(AggregateStat* parentStat) {
+    AggregateStat* hcStat = new AggregateStat();
+    hcStat->init("host", "Host hardware counters");
+    hcStat->append(makeStats("bound", "Bound phase, per core", bound, numCores));
+    hcStat->append(makeStats("sync", "Barrier waits and context switches", &sync, 0));
+    hcStat->append(makeStats("phaseEnd", "End of phase actions (weave phase, event ticks, dumps)", &phaseEnd, 0));
+    hcStat->append(makeStats("weave", "Weave phase, per weave thread", weave, numSimThreads));
+    parentStat->append(hcStat);
+}
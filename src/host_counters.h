@@ -0,0 +1,120 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HOST_COUNTERS_H_
+#define HOST_COUNTERS_H_
+
+#include <stdint.h>
+#include "galloc.h"
+#include "pad.h"
+#include "stats.h"
+
+/* Host hardware counters (sim.hostCounters), to tell whether the simulator
+ * is slow because of host cache misses, lock contention, or plain
+ * instruction count without rerunning under perf. Every app thread and weave
+ * thread opens its own perf_event_open group (user-level cycles,
+ * instructions, LLC misses and branch misses) and reads it at phase
+ * transitions, adding the counts since its last read to one of these buckets:
+ *  - bound: per core, from leaving a barrier (or joining) to reaching the
+ *    next barrier (or leaving), i.e., app code plus bound phase simulation.
+ *  - sync: time in the barrier, waiting for other threads or switching
+ *    contexts. High cycles with few instructions means futex sleeps; many
+ *    instructions means spinning.
+ *  - phaseEnd: EndOfPhaseActions, run by the last thread to reach the
+ *    barrier: weave phase (waiting for the weave threads unless pipelined),
+ *    event queue ticks and stats dumps.
+ *  - weave: per weave thread, event simulation.
+ *
+ * Counts are scaled if the kernel multiplexes the counters. Threads whose
+ * counters cannot be opened (e.g., no PMU in a VM, or perf_event_paranoid)
+ * warn and are not counted.
+ */
+
+enum HostCounterEvent {
+    HC_CYCLES,
+    HC_INSTRS,
+    HC_LLC_MISSES,
+    HC_BRANCH_MISSES,
+    HC_NUM_EVENTS
+};
+
+/* Counters of one host thread. Process-local (in the regular heap), since
+ * file descriptors are per process.
+ */
+class HostCounterGroup {
+    private:
+        int fds[HC_NUM_EVENTS];  // -1 if unsupported
+        uint32_t numOpen;
+        uint32_t readIdx[HC_NUM_EVENTS];  // position of each open event in a group read
+        uint64_t last[HC_NUM_EVENTS];  // scaled
+
+    public:
+        // Opens counters for the calling thread; check isValid()
+        HostCounterGroup();
+        ~HostCounterGroup();
+
+        bool isValid() const {return fds[HC_CYCLES] != -1;}
+
+        // Reads the counters, and adds the counts since the last read to delta (if not nullptr)
+        void read(uint64_t* delta);
+};
+
+class HostCounters : public GlobAlloc {
+    private:
+        struct Counts {
+            volatile uint64_t v[HC_NUM_EVENTS];
+        } ATTR_LINE_ALIGNED;
+
+        uint32_t numCores;
+        uint32_t numSimThreads;
+        Counts* bound;  // per core
+        Counts* weave;  // per weave thread
+        Counts sync;
+        Counts phaseEnd;
+        volatile bool warned;
+
+    public:
+        HostCounters(uint32_t _numCores, uint32_t _numSimThreads);
+
+        void initStats(AggregateStat* parentStat);
+
+        // Opens counters for the calling thread; nullptr if it could not
+        HostCounterGroup* openGroup();
+
+        // Each of these adds the counts since the group's last read to a bucket
+        void addBound(HostCounterGroup* g, uint32_t cid) {add(g, &bound[cid]);}
+        void addSync(HostCounterGroup* g) {add(g, &sync);}
+        void addPhaseEnd(HostCounterGroup* g) {add(g, &phaseEnd);}
+        void addWeave(HostCounterGroup* g, uint32_t thid) {add(g, &weave[thid]);}
+
+        // Drops the counts since the last read (e.g., unsimulated code before a join)
+        void skip(HostCounterGroup* g) {g->read(nullptr);}
+
+    private:
+        void add(HostCounterGroup* g, Counts* c);
+        AggregateStat* makeStats(const char* name, const char* desc, Counts* counts, uint32_t size);
+};
+
+#endif  // HOST_COUNTERS_H_
@@ -0,0 +1,262 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "host_placement.h"
+#include <algorithm>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "bithacks.h"
+#include "config.h"
+#include "constants.h"
+
+// Host CPU each of this process's threads is pinned to, plus one (0 if unpinned)
+static uint32_t threadCpus[MAX_THREADS];
+
+static int32_t ReadSysfsInt(const char* fmt, uint32_t cpu) {
+    char path[256];
+    snprintf(path, sizeof(path), fmt, cpu);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    int32_t val = -1;
+    if (fscanf(f, "%d", &val) != 1) val = -1;
+    fclose(f);
+    return val;
+}
+
+static bool SetAffinity(const uint32_t* cpuList, uint32_t n) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (uint32_t i = 0; i < n; i++) CPU_SET(cpuList[i], &cpuset);
+    // Raw syscall with pid 0 changes the calling thread only
+    return syscall(SYS_sched_setaffinity, 0, sizeof(cpuset), &cpuset) == 0;
+}
+
+static int32_t GetCpu() {
+    uint32_t cpu;
+    if (syscall(SYS_getcpu, &cpu, nullptr, nullptr) != 0) return -1;
+    return cpu;
+}
+
+void HostPlacement::readTopology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        warn("Placement: sched_getaffinity failed, assuming all online CPUs are usable");
+        uint32_t nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+        for (uint32_t c = 0; c < nprocs && c < CPU_SETSIZE; c++) CPU_SET(c, &allowed);
+    }
+
+    // Sockets and cores by sysfs id; ids need not be dense
+    std::vector<int32_t> socketIds, coreIds;  // per cpu in cpus
+    bool missing = false;
+    for (uint32_t c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &allowed)) continue;
+        int32_t socketId = ReadSysfsInt("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+        int32_t coreId = ReadSysfsInt("/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+        if (socketId < 0 || coreId < 0) {
+            missing = true;
+            socketId = 0;
+            coreId = c;
+        }
+        cpus.push_back({c, 0, 0, 0});
+        socketIds.push_back(socketId);
+        coreIds.push_back(coreId);
+    }
+    if (missing) warn("Placement: could not read the topology of some CPUs from sysfs, treating them as separate cores on socket 0");
+    if (cpus.empty()) panic("Placement: no usable host CPUs");
+
+    // Densify
+    std::vector<int32_t> sortedSockets = socketIds;
+    std::sort(sortedSockets.begin(), sortedSockets.end());
+    sortedSockets.erase(std::unique(sortedSockets.begin(), sortedSockets.end()), sortedSockets.end());
+    numSockets = sortedSockets.size();
+
+    std::vector< std::vector<int32_t> > socketCoreIds(numSockets);
+    for (uint32_t i = 0; i < cpus.size(); i++) {
+        cpus[i].socket = std::lower_bound(sortedSockets.begin(), sortedSockets.end(), socketIds[i]) - sortedSockets.begin();
+        socketCoreIds[cpus[i].socket].push_back(coreIds[i]);
+    }
+    for (auto& ids : socketCoreIds) {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+    for (uint32_t i = 0; i < cpus.size(); i++) {
+        const std::vector<int32_t>& ids = socketCoreIds[cpus[i].socket];
+        cpus[i].core = std::lower_bound(ids.begin(), ids.end(), coreIds[i]) - ids.begin();
+        uint32_t smt = 0;
+        for (uint32_t j = 0; j < i; j++) {
+            if (cpus[j].socket == cpus[i].socket && cpus[j].core == cpus[i].core) smt++;
+        }
+        cpus[i].smt = smt;
+    }
+
+    uint32_t maxCpu = cpus.back().cpu;
+    cpuSocket.resize(maxCpu + 1, -1);
+    for (const HostCpu& hc : cpus) cpuSocket[hc.cpu] = hc.socket;
+
+    info("Placement: %ld usable host CPUs in %d sockets", cpus.size(), numSockets);
+}
+
+HostPlacement::HostPlacement(Config& config, const g_vector<uint32_t>& coreDomains, uint32_t numDomains, uint32_t numSimThreads) {
+    numCores = coreDomains.size();
+    coreCounters = gm_memalign<CoreCounters>(CACHE_LINE_BYTES, MAX(numCores, 1u));
+    for (uint32_t c = 0; c < numCores; c++) {
+        coreCounters[c].lastSocket = -1;
+        coreCounters[c].joins = 0;
+        coreCounters[c].pins = 0;
+        coreCounters[c].socketMigrations = 0;
+        coreCounters[c].crossSocketCrossings = 0;
+    }
+
+    const char* policyStr = config.get<const char*>("sim.placement", "none");
+    if (strcmp(policyStr, "none") == 0) policy = NONE;
+    else if (strcmp(policyStr, "compact") == 0) policy = COMPACT;
+    else if (strcmp(policyStr, "scatter") == 0) policy = SCATTER;
+    else if (strcmp(policyStr, "domain") == 0) policy = DOMAIN;
+    else panic("Invalid sim.placement %s (none, compact, scatter or domain)", policyStr);
+
+    readTopology();
+    resetThreads();
+
+    // ContentionSim checks this too, but later; placements index weave threads by domain
+    if (!numSimThreads || numDomains % numSimThreads != 0) {
+        panic("numDomains(%d) must be a multiple of numSimThreads(%d)", numDomains, numSimThreads);
+    }
+    coreCpus.resize(numCores, -1);
+    simThreadCpus.resize(numSimThreads, -1);
+    domainSockets.resize(numDomains, -1);
+    uint32_t domainsPerThread = numDomains/numSimThreads;
+    if (policy == NONE) return;
+
+    if (policy == COMPACT || policy == SCATTER) {
+        std::vector<HostCpu> order(cpus.begin(), cpus.end());
+        if (policy == COMPACT) {
+            std::sort(order.begin(), order.end(), [](const HostCpu& a, const HostCpu& b) {
+                return (a.socket != b.socket)? a.socket < b.socket : (a.core != b.core)? a.core < b.core : a.smt < b.smt;
+            });
+        } else {
+            std::sort(order.begin(), order.end(), [](const HostCpu& a, const HostCpu& b) {
+                return (a.smt != b.smt)? a.smt < b.smt : (a.core != b.core)? a.core < b.core : a.socket < b.socket;
+            });
+        }
+        for (uint32_t c = 0; c < numCores; c++) coreCpus[c] = order[c % order.size()].cpu;
+        for (uint32_t t = 0; t < numSimThreads; t++) simThreadCpus[t] = order[t % order.size()].cpu;
+    } else {
+        assert(policy == DOMAIN);
+        // Each socket's CPUs, one SMT sibling per physical core first
+        std::vector< std::vector<HostCpu> > socketCpus(numSockets);
+        for (const HostCpu& hc : cpus) socketCpus[hc.socket].push_back(hc);
+        for (auto& sc : socketCpus) {
+            std::sort(sc.begin(), sc.end(), [](const HostCpu& a, const HostCpu& b) {
+                return (a.smt != b.smt)? a.smt < b.smt : a.core < b.core;
+            });
+        }
+
+        std::vector<uint32_t> socketThreads(numSockets, 0);
+        for (uint32_t t = 0; t < numSimThreads; t++) {
+            uint32_t s = MIN(t*numSockets/numSimThreads, numSockets - 1);
+            simThreadCpus[t] = socketCpus[s][socketThreads[s]++ % socketCpus[s].size()].cpu;
+        }
+
+        std::vector<uint32_t> socketCores(numSockets, 0);
+        for (uint32_t c = 0; c < numCores; c++) {
+            uint32_t t = coreDomains[c]/domainsPerThread;
+            uint32_t s = cpuSocket[simThreadCpus[t]];
+            coreCpus[c] = socketCpus[s][socketCores[s]++ % socketCpus[s].size()].cpu;
+        }
+    }
+
+    for (uint32_t d = 0; d < numDomains; d++) domainSockets[d] = cpuSocket[simThreadCpus[d/domainsPerThread]];
+
+    // FF control threads go to the socket with the fewest cores
+    std::vector<uint32_t> coresPerSocket(numSockets, 0);
+    for (uint32_t c = 0; c < numCores; c++) coresPerSocket[cpuSocket[coreCpus[c]]]++;
+    uint32_t controlSocket = std::min_element(coresPerSocket.begin(), coresPerSocket.end()) - coresPerSocket.begin();
+    for (const HostCpu& hc : cpus) if (hc.socket == controlSocket) controlCpus.push_back(hc.cpu);
+
+    info("Placement: %s policy, %d cores and %d weave threads, control threads on socket %d", policyStr, numCores, numSimThreads, controlSocket);
+}
+
+void HostPlacement::initStats(AggregateStat* parentStat) {
+    AggregateStat* placementStat = new AggregateStat();
+    placementStat->init("placement", "Host thread placement stats");
+
+    auto pinsStat = makeLambdaVectorStat([this](uint32_t c) { return coreCounters[c].pins; }, numCores);
+    pinsStat->init("pins", "Times each core's threads were pinned to its host CPU");
+    auto migrationsStat = makeLambdaVectorStat([this](uint32_t c) { return coreCounters[c].socketMigrations; }, numCores);
+    migrationsStat->init("socketMigrations", "Sampled joins where each core's thread ran on a different host socket than on the previous sample");
+    auto crossingsStat = makeLambdaVectorStat([this](uint32_t c) { return coreCounters[c].crossSocketCrossings; }, numCores);
+    crossingsStat->init("crossSocketCrossings", "Weave domain crossings from each core between domains simulated on different host sockets");
+
+    placementStat->append(pinsStat);
+    placementStat->append(migrationsStat);
+    placementStat->append(crossingsStat);
+    parentStat->append(placementStat);
+}
+
+void HostPlacement::bindThread(uint32_t tid, uint32_t cid) {
+    assert(tid < MAX_THREADS && cid < numCores);
+    CoreCounters& cc = coreCounters[cid];
+    int32_t cpu = coreCpus[cid];
+    if (cpu >= 0 && threadCpus[tid] != (uint32_t)cpu + 1) {
+        uint32_t c = cpu;
+        if (SetAffinity(&c, 1)) {
+            threadCpus[tid] = c + 1;
+            cc.pins++;
+        } else {
+            warn("Placement: could not pin thread %d to host CPU %d", tid, cpu);
+            coreCpus[cid] = -1;  // don't retry
+        }
+    }
+
+    // getcpu is a syscall, too expensive to issue on every join (i.e., every phase)
+    if (cc.joins++ % MIGRATION_SAMPLE_JOINS != 0) return;
+    int32_t curCpu = GetCpu();
+    if (curCpu >= 0 && (uint32_t)curCpu < cpuSocket.size() && cpuSocket[curCpu] >= 0) {
+        int32_t socket = cpuSocket[curCpu];
+        if (cc.lastSocket >= 0 && cc.lastSocket != socket) cc.socketMigrations++;
+        cc.lastSocket = socket;
+    }
+}
+
+void HostPlacement::bindSimThread(uint32_t thid) {
+    int32_t cpu = simThreadCpus[thid];
+    if (cpu < 0) return;
+    uint32_t c = cpu;
+    if (!SetAffinity(&c, 1)) warn("Placement: could not pin weave thread %d to host CPU %d", thid, cpu);
+}
+
+void HostPlacement::bindControlThread() {
+    if (controlCpus.empty()) return;
+    if (!SetAffinity(&controlCpus[0], controlCpus.size())) warn("Placement: could not pin FF control thread");
+}
+
+void HostPlacement::resetThreads() {
+    for (uint32_t i = 0; i < MAX_THREADS; i++) threadCpus[i] = 0;
+}
@@ -0,0 +1,122 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HOST_PLACEMENT_H_
+#define HOST_PLACEMENT_H_
+
+#include <stdint.h>
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "log.h"
+#include "pad.h"
+#include "stats.h"
+
+class Config;
+
+/* Places simulation threads on host CPUs (sim.placement), so that threads
+ * that share simulated structures also share host caches, instead of letting
+ * Linux migrate them across sockets. Reads the host topology (sockets,
+ * physical cores and SMT siblings) from sysfs, restricted to the CPUs zsim
+ * may run on. Policies:
+ *  - none (default): leave placement to Linux.
+ *  - compact: consecutive cores (and weave threads) go to SMT siblings of the
+ *    same physical core, then to the same socket.
+ *  - scatter: consecutive cores go to different sockets, using one SMT
+ *    sibling of every physical core before the next.
+ *  - domain: domain-affine. Each weave thread gets a socket, and the cores of
+ *    the domains it simulates run on that socket. Cores mostly produce events
+ *    in their own domain, so each weave thread runs next to the cores whose
+ *    events it receives.
+ *
+ * App threads are pinned to the host CPU of their simulated core whenever
+ * they join it, so they follow the scheduler; weave threads are pinned once;
+ * FF control threads go to the socket with the fewest simulated cores. Bound
+ * and weave phases alternate, so cores and weave threads share CPUs (except
+ * with sim.pipelinedWeave).
+ *
+ * Stats measure cross-socket traffic: how often each core's thread ran on a
+ * different socket than on its previous sampled join (one join in
+ * MIGRATION_SAMPLE_JOINS, with any policy), and how many of each core's weave
+ * domain crossings go between domains simulated on different sockets (only
+ * with a pinning policy).
+ */
+class HostPlacement : public GlobAlloc {
+    public:
+        enum Policy {NONE, COMPACT, SCATTER, DOMAIN};
+        static const uint32_t MIGRATION_SAMPLE_JOINS = 64;
+
+    private:
+        struct HostCpu {
+            uint32_t cpu;
+            uint32_t socket;  // dense index
+            uint32_t core;  // dense index within its socket
+            uint32_t smt;  // index among the core's siblings
+        };
+
+        struct CoreCounters {
+            int32_t lastSocket;  // -1 until the first sampled join
+            uint32_t joins;
+            uint64_t pins;
+            uint64_t socketMigrations;
+            uint64_t crossSocketCrossings;
+        } ATTR_LINE_ALIGNED;
+
+        Policy policy;
+        g_vector<HostCpu> cpus;
+        g_vector<int32_t> cpuSocket;  // by host CPU id, -1 if not usable
+        uint32_t numSockets;
+
+        g_vector<int32_t> coreCpus;  // -1 if unpinned
+        g_vector<int32_t> simThreadCpus;
+        g_vector<int32_t> domainSockets;  // socket of each domain's weave thread, -1 if unpinned
+        g_vector<uint32_t> controlCpus;
+
+        uint32_t numCores;
+        CoreCounters* coreCounters;
+
+    public:
+        // coreDomains has the weave domain of each core
+        HostPlacement(Config& config, const g_vector<uint32_t>& coreDomains, uint32_t numDomains, uint32_t numSimThreads);
+
+        void initStats(AggregateStat* parentStat);
+
+        // Called by app threads when they join core cid
+        void bindThread(uint32_t tid, uint32_t cid);
+        // Called by weave thread thid when it starts
+        void bindSimThread(uint32_t thid);
+        void bindControlThread();
+        // Forget this process's bound threads (call in forked children)
+        void resetThreads();
+
+        inline void countCrossing(uint32_t srcId, uint32_t srcDomain, uint32_t dstDomain) {
+            assert(srcId < numCores);
+            if (domainSockets[srcDomain] != domainSockets[dstDomain]) coreCounters[srcId].crossSocketCrossings++;
+        }
+
+    private:
+        void readTopology();
+};
+
+#endif  // HOST_PLACEMENT_H_
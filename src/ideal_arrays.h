@@ -27,16 +27,68 @@
 #define IDEAL_ARRAYS_H_
 
 #include "cache_arrays.h"
-#include "g_std/g_unordered_map.h"
-#include "intrusive_list.h"
+#include "line_map.h"
 #include "part_repl_policies.h"
 #include "repl_policies.h"
 
 /* Fully associative cache arrays with LRU replacement (non-part; part coming up) */
 
-//We use a combination of a hash table and an intrusive list to perform fully-associative lookups and insertions in O(1) time
+//We use a combination of a flat hash table and index-linked lists to perform fully-associative lookups and insertions in O(1) time
 //TODO: Post-deadline, make it a single array with a rank(req) interface
 
+/* Doubly-linked lists of line ids. All lists over the same lines share the
+ * link arrays, and links are 32-bit ids instead of pointers, so each line
+ * costs 8 bytes and moving a line to the front touches few cache lines.
+ */
+class LineIdLists : public GlobAlloc {
+    public:
+        static const uint32_t NIL = (uint32_t)-1;
+
+        struct List {
+            uint32_t head;
+            uint32_t tail;
+            uint32_t elems;
+            List() : head(NIL), tail(NIL), elems(0) {}
+            uint32_t back() const {return tail;}
+            uint32_t size() const {return elems;}
+        };
+
+    private:
+        uint32_t* prev;
+        uint32_t* next;
+
+    public:
+        explicit LineIdLists(uint32_t numLines) {
+            prev = gm_malloc<uint32_t>(numLines);
+            next = gm_malloc<uint32_t>(numLines);
+            for (uint32_t i = 0; i < numLines; i++) prev[i] = next[i] = NIL;
+        }
+
+        inline void push_front(List& l, uint32_t id) {
+            prev[id] = NIL;
+            next[id] = l.head;
+            if (l.head != NIL) prev[l.head] = id;
+            else l.tail = id;
+            l.head = id;
+            l.elems++;
+        }
+
+        inline void remove(List& l, uint32_t id) {
+            assert(l.elems);
+            if (prev[id] != NIL) next[prev[id]] = next[id];
+            else l.head = next[id];
+            if (next[id] != NIL) prev[next[id]] = prev[id];
+            else l.tail = prev[id];
+            l.elems--;
+        }
+
+        inline void moveToFront(List& l, uint32_t id) {
+            if (l.head == id) return;
+            remove(l, id);
+            push_front(l, id);
+        }
+};
+
 class IdealLRUArray : public CacheArray {
     private:
         //We need a fake replpolicy and just want the CC...
@@ -54,60 +106,52 @@ class IdealLRUArray : public CacheArray {
                 DECL_RANK_BINDINGS
         };
 
-        struct Entry : InListNode<Entry> {
-            Address lineAddr;
-            const uint32_t lineId;
-            explicit Entry(uint32_t _lineId) : lineAddr(0), lineId(_lineId) {}
-        };
-
-        Entry* array;
-        InList<Entry> lruList;
-        g_unordered_map<Address, uint32_t> lineMap; //address->lineId; if too slow, try an AATree, which does not alloc dynamically
+        Address* lineAddrs;  // lineId -> address
+        bool* valid;  // lineId -> whether lineAddrs is in lineMap
+        LineIdLists lists;
+        LineIdLists::List lruList;
+        LineMap lineMap;  // address -> lineId
 
         uint32_t numLines;
         ProxyReplPolicy* rp;
         CC* cc;
 
     public:
-        explicit IdealLRUArray(uint32_t _numLines) : numLines(_numLines), cc(nullptr) {
-            array = gm_calloc<Entry>(numLines);
+        explicit IdealLRUArray(uint32_t _numLines) : lists(_numLines), lineMap(_numLines), numLines(_numLines), cc(nullptr) {
+            lineAddrs = gm_calloc<Address>(numLines);
+            valid = gm_calloc<bool>(numLines);
             for (uint32_t i = 0; i < numLines; i++) {
-                Entry* e = new (&array[i]) Entry(i);
-                lruList.push_front(e);
+                lists.push_front(lruList, i);
             }
             rp = new ProxyReplPolicy(this);
         }
 
         int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
-            g_unordered_map<Address, uint32_t>::iterator it = lineMap.find(lineAddr);
-            if (it == lineMap.end()) return -1;
+            int32_t lineId = lineMap.find(lineAddr);
+            if (lineId == -1) return -1;
 
-            uint32_t lineId = it->second;
             if (updateReplacement) {
-                lruList.remove(&array[lineId]);
-                lruList.push_front(&array[lineId]);
+                lists.moveToFront(lruList, lineId);
             }
             return lineId;
         }
 
         uint32_t preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr) {
-            Entry* e = lruList.back();
-            *wbLineAddr = e->lineAddr;
-            return e->lineId;
+            uint32_t lineId = lruList.back();
+            *wbLineAddr = lineAddrs[lineId];
+            return lineId;
         }
 
         void postinsert(const Address lineAddr, const MemReq* req, uint32_t lineId) {
-            Entry* e = &array[lineId];
-
             //Update addr mapping for lineId
-            lineMap.erase(e->lineAddr);
-            assert((lineMap.find(lineAddr) == lineMap.end()));
-            e->lineAddr = lineAddr;
-            lineMap[lineAddr] = lineId;
+            if (valid[lineId]) lineMap.erase(lineAddrs[lineId], lineId);
+            assert(lineMap.find(lineAddr) == -1);
+            lineAddrs[lineId] = lineAddr;
+            valid[lineId] = true;
+            lineMap.insert(lineAddr, lineId);
 
             //Update repl
-            lruList.remove(e);
-            lruList.push_front(e);
+            lists.moveToFront(lruList, lineId);
         }
 
         ReplPolicy* getRP() const {return rp;}
@@ -117,29 +161,29 @@ class IdealLRUArray : public CacheArray {
 //Goes with IdealLRUPartArray
 class IdealLRUPartReplPolicy : public PartReplPolicy {
     protected:
-        struct Entry : InListNode<Entry> {
-            const uint32_t lineId;
+        struct Entry {
             uint32_t p;
             bool used; //careful, true except when just evicted, even if invalid
-            Entry(uint32_t _id, uint32_t _p) : lineId(_id), p(_p), used(true) {}
+            Entry(uint32_t _p) : p(_p), used(true) {}
         };
 
         struct IdPartInfo : public PartInfo {
-            InList<Entry> lruList;
+            LineIdLists::List lruList;
         };
 
         Entry* array;
+        LineIdLists lists;
         IdPartInfo* partInfo;
         uint32_t partitions;
         uint32_t numLines;
         uint32_t numBuckets;
 
     public:
-        IdealLRUPartReplPolicy(PartitionMonitor* _monitor, PartMapper* _mapper, uint32_t _numLines, uint32_t _numBuckets) : PartReplPolicy(_monitor, _mapper), numLines(_numLines), numBuckets(_numBuckets) {
+        IdealLRUPartReplPolicy(PartitionMonitor* _monitor, PartMapper* _mapper, uint32_t _numLines, uint32_t _numBuckets) : PartReplPolicy(_monitor, _mapper), lists(_numLines), numLines(_numLines), numBuckets(_numBuckets) {
             partitions = mapper->getNumPartitions();
             partInfo = gm_calloc<IdPartInfo>(partitions);
 
-            for (uint32_t p = 0; p <= partitions; p++) {
+            for (uint32_t p = 0; p < partitions; p++) {
                 new (&partInfo[p]) IdPartInfo();
                 partInfo[p].targetSize = numLines/partitions;
                 partInfo[p].size = 0;
@@ -147,8 +191,8 @@ class IdealLRUPartReplPolicy : public PartReplPolicy {
 
             array = gm_calloc<Entry>(numLines);
             for (uint32_t i = 0; i < numLines; i++) {
-                Entry* e = new (&array[i]) Entry(i, 0);
-                partInfo[0].lruList.push_front(e);
+                new (&array[i]) Entry(0);
+                lists.push_front(partInfo[0].lruList, i);
                 partInfo[0].size++;
             }
         }
@@ -183,8 +227,7 @@ class IdealLRUPartReplPolicy : public PartReplPolicy {
             Entry* e = &array[id];
             if (e->used) {
                 partInfo[e->p].profHits.inc();
-                partInfo[e->p].lruList.remove(e);
-                partInfo[e->p].lruList.push_front(e);
+                lists.moveToFront(partInfo[e->p].lruList, id);
             } else {
                 uint32_t oldPart = e->p;
                 uint32_t newPart = mapper->getPartition(*req);
@@ -197,8 +240,8 @@ class IdealLRUPartReplPolicy : public PartReplPolicy {
                 }
                 partInfo[newPart].profMisses.inc();
                 e->p = newPart;
-                partInfo[oldPart].lruList.remove(e);
-                partInfo[newPart].lruList.push_front(e);
+                lists.remove(partInfo[oldPart].lruList, id);
+                lists.push_front(partInfo[newPart].lruList, id);
                 e->used = true;
             }
 
@@ -232,7 +275,7 @@ class IdealLRUPartReplPolicy : public PartReplPolicy {
             //info("rp: %d / %d %d / %d %d", victimPart, partInfo[0].size, partInfo[0].targetSize, partInfo[1].size, partInfo[1].targetSize);
             assert(partInfo[victimPart].size > 0);
             assert(partInfo[victimPart].size == partInfo[victimPart].lruList.size());
-            return partInfo[victimPart].lruList.back()->lineId;
+            return partInfo[victimPart].lruList.back();
         }
 
         template <typename C> uint32_t rank(const MemReq* req, C cands) {panic("!!");}
@@ -241,21 +284,22 @@ class IdealLRUPartReplPolicy : public PartReplPolicy {
 
 class IdealLRUPartArray : public CacheArray {
     private:
-        g_unordered_map<Address, uint32_t> lineMap; //address->lineId; if too slow, try an AATree, which does not alloc dynamically
+        LineMap lineMap; //address->lineId
         Address* lineAddrs; //lineId -> address, for replacements
+        bool* valid; //lineId -> whether lineAddrs is in lineMap
         IdealLRUPartReplPolicy* rp;
         uint32_t numLines;
 
     public:
-        IdealLRUPartArray(uint32_t _numLines, IdealLRUPartReplPolicy* _rp) : rp(_rp), numLines(_numLines) {
+        IdealLRUPartArray(uint32_t _numLines, IdealLRUPartReplPolicy* _rp) : lineMap(_numLines), rp(_rp), numLines(_numLines) {
             lineAddrs = gm_calloc<Address>(numLines);
+            valid = gm_calloc<bool>(numLines);
         }
 
         int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
-            g_unordered_map<Address, uint32_t>::iterator it = lineMap.find(lineAddr);
-            if (it == lineMap.end()) return -1;
+            int32_t lineId = lineMap.find(lineAddr);
+            if (lineId == -1) return -1;
 
-            uint32_t lineId = it->second;
             if (updateReplacement) {
                 rp->update(lineId, req);
             }
@@ -270,10 +314,11 @@ class IdealLRUPartArray : public CacheArray {
 
         void postinsert(const Address lineAddr, const MemReq* req, uint32_t lineId) {
             //Update addr mapping for lineId
-            lineMap.erase(lineAddrs[lineId]);
-            assert((lineMap.find(lineAddr) == lineMap.end()));
+            if (valid[lineId]) lineMap.erase(lineAddrs[lineId], lineId);
+            assert(lineMap.find(lineAddr) == -1);
             lineAddrs[lineId] = lineAddr;
-            lineMap[lineAddr] = lineId;
+            valid[lineId] = true;
+            lineMap.insert(lineAddr, lineId);
 
             //Update repl
             rp->replaced(lineId);
@@ -25,587 +25,94 @@
  */
 
 #include "init.h"
+#include <algorithm>
 #include <list>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
 #include <sys/time.h>
 #include <vector>
+#include "bithacks.h"
 #include "cache.h"
-#include "cache_arrays.h"
+#include "cache_builder.h"
 #include "config.h"
 #include "constants.h"
 #include "contention_sim.h"
 #include "core.h"
-#include "detailed_mem.h"
-#include "detailed_mem_params.h"
-#include "ddr_mem.h"
 #include "debug_zsim.h"
-#include "dramsim_mem_ctrl.h"
 #include "event_queue.h"
 #include "filter_cache.h"
 #include "galloc.h"
-#include "hash.h"
-#include "ideal_arrays.h"
+#include "host_counters.h"
+#include "host_placement.h"
 #include "locks.h"
 #include "log.h"
-#include "mem_ctrls.h"
-#include "network.h"
+#include "mem_sampler.h"
 #include "null_core.h"
 #include "ooo_core.h"
-#include "part_repl_policies.h"
+#include "phase_length_ctrl.h"
 #include "pin_cmd.h"
-#include "prefetcher.h"
 #include "proc_stats.h"
 #include "process_stats.h"
 #include "process_tree.h"
 #include "profile_stats.h"
-#include "repl_policies.h"
 #include "scheduler.h"
 #include "simple_core.h"
 #include "stats.h"
 #include "stats_filter.h"
 #include "str.h"
-#include "timing_cache.h"
+#include "sync_trace.h"
 #include "timing_core.h"
 #include "timing_event.h"
+#include "tlb.h"
 #include "trace_driver.h"
-#include "tracing_cache.h"
 #include "virt/port_virtualizer.h"
-#include "weave_md1_mem.h" //validation, could be taken out...
+#include "vmem.h"
+#include "weave_capture.h"
 #include "zsim.h"
 
 extern void EndOfPhaseActions(); //in zsim.cpp
 
+/* Per-stage SimInit time, printed at the end of initialization and kept in
+ * the initTime stat, so the startup cost of large systems can be tracked */
+enum InitStage {
+    INIT_GLOBAL,  // config, weave threads, scheduler, etc.
+    INIT_PROCS,  // virtual memory, process tree
+    INIT_CACHES,  // cache hierarchy and memory controllers
+    INIT_CORES,  // cores and TLBs, with their stats
+    INIT_CACHE_STATS,
+    INIT_STATS,  // remaining stats, stats backends
+    INIT_FINISH,  // out.cfg, weave threads' postInit
+    INIT_NUM_STAGES
+};
+
+static const char* initStageNames[] = {"global", "procs", "caches", "cores", "cacheStats", "stats", "finish"};
+static uint64_t initStageStartNs;
+static VectorCounter* initTimeStat;  // created in InitGlobalStats, before the first stage ends
+
+static void EndInitStage(InitStage stage) {
+    uint64_t curNs = getNs();
+    initTimeStat->inc(stage, curNs - initStageStartNs);
+    initStageStartNs = curNs;
+}
+
 /* zsim should be initialized in a deterministic and logical order, to avoid re-reading config vars
  * all over the place and give a predictable global state to constructors. Ideally, this should just
  * follow the layout of zinfo, top-down.
  */
 
-BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name, uint32_t bankSize, bool isTerminal, uint32_t domain) {
-    string type = config.get<const char*>(prefix + "type", "Simple");
-    // Shortcut for TraceDriven type
-    if (type == "TraceDriven") {
-        assert(zinfo->traceDriven);
-        assert(isTerminal);
-        return new TraceDriverProxyCache(name);
-    }
-
-    uint32_t lineSize = zinfo->lineSize;
-    assert(lineSize > 0); //avoid config deps
-    if (bankSize % lineSize != 0) panic("%s: Bank size must be a multiple of line size", name.c_str());
-
-    uint32_t numLines = bankSize/lineSize;
-
-    //Array
-    uint32_t numHashes = 1;
-    uint32_t ways = config.get<uint32_t>(prefix + "array.ways", 4);
-    string arrayType = config.get<const char*>(prefix + "array.type", "SetAssoc");
-    uint32_t candidates = (arrayType == "Z")? config.get<uint32_t>(prefix + "array.candidates", 16) : ways;
-
-    //Need to know number of hash functions before instantiating array
-    if (arrayType == "SetAssoc") {
-        numHashes = 1;
-    } else if (arrayType == "Z") {
-        numHashes = ways;
-        assert(ways > 1);
-    } else if (arrayType == "IdealLRU" || arrayType == "IdealLRUPart") {
-        ways = numLines;
-        numHashes = 0;
-    } else {
-        panic("%s: Invalid array type %s", name.c_str(), arrayType.c_str());
-    }
-
-    // Power of two sets check; also compute setBits, will be useful later
-    uint32_t numSets = numLines/ways;
-    uint32_t setBits = 31 - __builtin_clz(numSets);
-    if ((1u << setBits) != numSets) panic("%s: Number of sets must be a power of two (you specified %d sets)", name.c_str(), numSets);
-
-    //Hash function
-    HashFamily* hf = nullptr;
-    string hashType = config.get<const char*>(prefix + "array.hash", (arrayType == "Z")? "H3" : "None"); //zcaches must be hashed by default
-    if (numHashes) {
-        if (hashType == "None") {
-            if (arrayType == "Z") panic("ZCaches must be hashed!"); //double check for stupid user
-            assert(numHashes == 1);
-            hf = new IdHashFamily;
-        } else if (hashType == "H3") {
-            //STL hash function
-            size_t seed = _Fnv_hash_bytes(prefix.c_str(), prefix.size()+1, 0xB4AC5B);
-            //info("%s -> %lx", prefix.c_str(), seed);
-            hf = new H3HashFamily(numHashes, setBits, 0xCAC7EAFFA1 + seed /*make randSeed depend on prefix*/);
-        } else if (hashType == "SHA1") {
-            hf = new SHA1HashFamily(numHashes);
-        } else {
-            panic("%s: Invalid value %s on array.hash", name.c_str(), hashType.c_str());
-        }
-    }
-
-    //Replacement policy
-    string replType = config.get<const char*>(prefix + "repl.type", (arrayType == "IdealLRUPart")? "IdealLRUPart" : "LRU");
-    ReplPolicy* rp = nullptr;
-
-    if (replType == "LRU" || replType == "LRUNoSh") {
-        bool sharersAware = (replType == "LRU") && !isTerminal;
-        if (sharersAware) {
-            rp = new LRUReplPolicy<true>(numLines);
-        } else {
-            rp = new LRUReplPolicy<false>(numLines);
-        }
-    } else if (replType == "LFU") {
-        rp = new LFUReplPolicy(numLines);
-    } else if (replType == "LRUProfViol") {
-        ProfViolReplPolicy< LRUReplPolicy<true> >* pvrp = new ProfViolReplPolicy< LRUReplPolicy<true> >(numLines);
-        pvrp->init(numLines);
-        rp = pvrp;
-    } else if (replType == "TreeLRU") {
-        rp = new TreeLRUReplPolicy(numLines, candidates);
-    } else if (replType == "NRU") {
-        rp = new NRUReplPolicy(numLines, candidates);
-    } else if (replType == "Rand") {
-        rp = new RandReplPolicy(candidates);
-    } else if (replType == "WayPart" || replType == "Vantage" || replType == "IdealLRUPart") {
-        if (replType == "WayPart" && arrayType != "SetAssoc") panic("WayPart replacement requires SetAssoc array");
-
-        //Partition mapper
-        // TODO: One partition mapper per cache (not bank).
-        string partMapper = config.get<const char*>(prefix + "repl.partMapper", "Core");
-        PartMapper* pm = nullptr;
-        if (partMapper == "Core") {
-            pm = new CorePartMapper(zinfo->numCores); //NOTE: If the cache is not fully shared, trhis will be inefficient...
-        } else if (partMapper == "InstrData") {
-            pm = new InstrDataPartMapper();
-        } else if (partMapper == "InstrDataCore") {
-            pm = new InstrDataCorePartMapper(zinfo->numCores);
-        } else if (partMapper == "Process") {
-            pm = new ProcessPartMapper(zinfo->numProcs);
-        } else if (partMapper == "InstrDataProcess") {
-            pm = new InstrDataProcessPartMapper(zinfo->numProcs);
-        } else if (partMapper == "ProcessGroup") {
-            pm = new ProcessGroupPartMapper();
-        } else {
-            panic("Invalid repl.partMapper %s on %s", partMapper.c_str(), name.c_str());
-        }
-
-        // Partition monitor
-        uint32_t umonLines = config.get<uint32_t>(prefix + "repl.umonLines", 256);
-        uint32_t umonWays = config.get<uint32_t>(prefix + "repl.umonWays", ways);
-        uint32_t buckets;
-        if (replType == "WayPart") {
-            buckets = ways; //not an option with WayPart
-        } else { //Vantage or Ideal
-            buckets = config.get<uint32_t>(prefix + "repl.buckets", 256);
-        }
-
-        PartitionMonitor* mon = new UMonMonitor(numLines, umonLines, umonWays, pm->getNumPartitions(), buckets);
-
-        //Finally, instantiate the repl policy
-        PartReplPolicy* prp;
-        double allocPortion = 1.0;
-        if (replType == "WayPart") {
-            //if set, drives partitioner but doesn't actually do partitioning
-            bool testMode = config.get<bool>(prefix + "repl.testMode", false);
-            prp = new WayPartReplPolicy(mon, pm, numLines, ways, testMode);
-        } else if (replType == "IdealLRUPart") {
-            prp = new IdealLRUPartReplPolicy(mon, pm, numLines, buckets);
-        } else { //Vantage
-            uint32_t assoc = (arrayType == "Z")? candidates : ways;
-            allocPortion = .85;
-            bool smoothTransients = config.get<bool>(prefix + "repl.smoothTransients", false);
-            prp = new VantageReplPolicy(mon, pm, numLines, assoc, (uint32_t)(allocPortion * 100), 10, 50, buckets, smoothTransients);
-        }
-        rp = prp;
-
-        // Partitioner
-        // TODO: Depending on partitioner type, we want one per bank or one per cache.
-        Partitioner* p = new LookaheadPartitioner(prp, pm->getNumPartitions(), buckets, 1, allocPortion);
-
-        //Schedule its tick
-        uint32_t interval = config.get<uint32_t>(prefix + "repl.interval", 5000); //phases
-        zinfo->eventQueue->insert(new Partitioner::PartitionEvent(p, interval));
-    } else {
-        panic("%s: Invalid replacement type %s", name.c_str(), replType.c_str());
-    }
-    assert(rp);
-
-
-    //Alright, build the array
-    CacheArray* array = nullptr;
-    if (arrayType == "SetAssoc") {
-        array = new SetAssocArray(numLines, ways, rp, hf);
-    } else if (arrayType == "Z") {
-        array = new ZArray(numLines, ways, candidates, rp, hf);
-    } else if (arrayType == "IdealLRU") {
-        assert(replType == "LRU");
-        assert(!hf);
-        IdealLRUArray* ila = new IdealLRUArray(numLines);
-        rp = ila->getRP();
-        array = ila;
-    } else if (arrayType == "IdealLRUPart") {
-        assert(!hf);
-        IdealLRUPartReplPolicy* irp = dynamic_cast<IdealLRUPartReplPolicy*>(rp);
-        if (!irp) panic("IdealLRUPart array needs IdealLRUPart repl policy!");
-        array = new IdealLRUPartArray(numLines, irp);
-    } else {
-        panic("This should not happen, we already checked for it!"); //unless someone changed arrayStr...
-    }
-
-    //Latency
-    uint32_t latency = config.get<uint32_t>(prefix + "latency", 10);
-    uint32_t accLat = (isTerminal)? 0 : latency; //terminal caches has no access latency b/c it is assumed accLat is hidden by the pipeline
-    uint32_t invLat = latency;
-
-    // Inclusion?
-    bool nonInclusiveHack = config.get<bool>(prefix + "nonInclusiveHack", false);
-    if (nonInclusiveHack) assert(type == "Simple" && !isTerminal);
-
-    // Finally, build the cache
-    Cache* cache;
-    CC* cc;
-    if (isTerminal) {
-        cc = new MESITerminalCC(numLines, name);
-    } else {
-        cc = new MESICC(numLines, nonInclusiveHack, name);
-    }
-    rp->setCC(cc);
-    if (!isTerminal) {
-        if (type == "Simple") {
-            cache = new Cache(numLines, cc, array, rp, accLat, invLat, name);
-        } else if (type == "Timing") {
-            uint32_t mshrs = config.get<uint32_t>(prefix + "mshrs", 16);
-            uint32_t tagLat = config.get<uint32_t>(prefix + "tagLat", 5);
-            uint32_t timingCandidates = config.get<uint32_t>(prefix + "timingCandidates", candidates);
-            cache = new TimingCache(numLines, cc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, name);
-        } else if (type == "Tracing") {
-            g_string traceFile = config.get<const char*>(prefix + "traceFile","");
-            if (traceFile.empty()) traceFile = g_string(zinfo->outputDir) + "/" + name + ".trace";
-            cache = new TracingCache(numLines, cc, array, rp, accLat, invLat, traceFile, name);
-        } else {
-            panic("Invalid cache type %s", type.c_str());
-        }
-    } else {
-        //Filter cache optimization
-        if (type != "Simple") panic("Terminal cache %s can only have type == Simple", name.c_str());
-        if (arrayType != "SetAssoc" || hashType != "None" || replType != "LRU") panic("Invalid FilterCache config %s", name.c_str());
-        cache = new FilterCache(numSets, numLines, cc, array, rp, accLat, invLat, name);
-    }
-
-#if 0
-    info("Built L%d bank, %d bytes, %d lines, %d ways (%d candidates if array is Z), %s array, %s hash, %s replacement, accLat %d, invLat %d name %s",
-            level, bankSize, numLines, ways, candidates, arrayType.c_str(), hashType.c_str(), replType.c_str(), accLat, invLat, name.c_str());
-#endif
-
-    return cache;
-}
-
-// NOTE: frequency is SYSTEM frequency; mem freq specified in tech
-DDRMemory* BuildDDRMemory(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string name, const string& prefix) {
-    uint32_t ranksPerChannel = config.get<uint32_t>(prefix + "ranksPerChannel", 4);
-    uint32_t banksPerRank = config.get<uint32_t>(prefix + "banksPerRank", 8);  // DDR3 std is 8
-    uint32_t pageSize = config.get<uint32_t>(prefix + "pageSize", 8*1024);  // 1Kb cols, x4 devices
-    const char* tech = config.get<const char*>(prefix + "tech", "DDR3-1333-CL10");  // see cpp file for other techs
-    const char* addrMapping = config.get<const char*>(prefix + "addrMapping", "rank:col:bank");  // address splitter interleaves channels; row always on top
-
-    // If set, writes are deferred and bursted out to reduce WTR overheads
-    bool deferWrites = config.get<bool>(prefix + "deferWrites", true);
-    bool closedPage = config.get<bool>(prefix + "closedPage", true);
-
-    // Max row hits before we stop prioritizing further row hits to this bank.
-    // Balances throughput and fairness; 0 -> FCFS / high (e.g., -1) -> pure FR-FCFS
-    uint32_t maxRowHits = config.get<uint32_t>(prefix + "maxRowHits", 4);
-
-    // Request queues
-    uint32_t queueDepth = config.get<uint32_t>(prefix + "queueDepth", 16);
-    uint32_t controllerLatency = config.get<uint32_t>(prefix + "controllerLatency", 10);  // in system cycles
-
-    auto mem = new DDRMemory(zinfo->lineSize, pageSize, ranksPerChannel, banksPerRank, frequency, tech,
-            addrMapping, controllerLatency, queueDepth, maxRowHits, deferWrites, closedPage, domain, name);
-    return mem;
-}
-
-MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string& name) {
-    //Type
-    string type = config.get<const char*>("sys.mem.type", "Simple");
-
-    //Latency
-    uint32_t latency = (type == "DDR")? -1 : config.get<uint32_t>("sys.mem.latency", 100);
-
-    MemObject* mem = nullptr;
-    if (type == "Simple") {
-        mem = new SimpleMemory(latency, name);
-    } else if (type == "MD1") {
-        // The following params are for MD1 only
-        // NOTE: Frequency (in MHz) -- note this is a sys parameter (not sys.mem). There is an implicit assumption of having
-        // a single CCT across the system, and we are dealing with latencies in *core* clock cycles
-
-        // Peak bandwidth (in MB/s)
-        uint32_t bandwidth = config.get<uint32_t>("sys.mem.bandwidth", 6400);
-
-        mem = new MD1Memory(lineSize, frequency, bandwidth, latency, name);
-    } else if (type == "WeaveMD1") {
-        uint32_t bandwidth = config.get<uint32_t>("sys.mem.bandwidth", 6400);
-        uint32_t boundLatency = config.get<uint32_t>("sys.mem.boundLatency", latency);
-        mem = new WeaveMD1Memory(lineSize, frequency, bandwidth, latency, boundLatency, domain, name);
-    } else if (type == "WeaveSimple") {
-        uint32_t boundLatency = config.get<uint32_t>("sys.mem.boundLatency", 100);
-        mem = new WeaveSimpleMemory(latency, boundLatency, domain, name);
-    } else if (type == "DDR") {
-        mem = BuildDDRMemory(config, lineSize, frequency, domain, name, "sys.mem.");
-    } else if (type == "DRAMSim") {
-        uint64_t cpuFreqHz = 1000000 * frequency;
-        uint32_t capacity = config.get<uint32_t>("sys.mem.capacityMB", 16384);
-        string dramTechIni = config.get<const char*>("sys.mem.techIni");
-        string dramSystemIni = config.get<const char*>("sys.mem.systemIni");
-        string outputDir = config.get<const char*>("sys.mem.outputDir");
-        string traceName = config.get<const char*>("sys.mem.traceName");
-        mem = new DRAMSimMemory(dramTechIni, dramSystemIni, outputDir, traceName, capacity, cpuFreqHz, latency, domain, name);
-    } else if (type == "Detailed") {
-        // FIXME(dsm): Don't use a separate config file... see DDRMemory
-        g_string mcfg = config.get<const char*>("sys.mem.paramFile", "");
-        mem = new MemControllerBase(mcfg, lineSize, frequency, domain, name);
-    } else {
-        panic("Invalid memory controller type %s", type.c_str());
-    }
-    return mem;
-}
-
-typedef vector<vector<BaseCache*>> CacheGroup;
-
-CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal) {
-    CacheGroup* cgp = new CacheGroup;
-    CacheGroup& cg = *cgp;
-
-    string prefix = "sys.caches." + name + ".";
-
-    bool isPrefetcher = config.get<bool>(prefix + "isPrefetcher", false);
-    if (isPrefetcher) { //build a prefetcher group
-        uint32_t prefetchers = config.get<uint32_t>(prefix + "prefetchers", 1);
-        cg.resize(prefetchers);
-        for (vector<BaseCache*>& bg : cg) bg.resize(1);
-        for (uint32_t i = 0; i < prefetchers; i++) {
-            stringstream ss;
-            ss << name << "-" << i;
-            g_string pfName(ss.str().c_str());
-            cg[i][0] = new StreamPrefetcher(pfName);
-        }
-        return cgp;
-    }
-
-    uint32_t size = config.get<uint32_t>(prefix + "size", 64*1024);
-    uint32_t banks = config.get<uint32_t>(prefix + "banks", 1);
-    uint32_t caches = config.get<uint32_t>(prefix + "caches", 1);
-
-    uint32_t bankSize = size/banks;
-    if (size % banks != 0) {
-        panic("%s: banks (%d) does not divide the size (%d bytes)", name.c_str(), banks, size);
-    }
-
-    cg.resize(caches);
-    for (vector<BaseCache*>& bg : cg) bg.resize(banks);
-
-    for (uint32_t i = 0; i < caches; i++) {
-        for (uint32_t j = 0; j < banks; j++) {
-            stringstream ss;
-            ss << name << "-" << i;
-            if (banks > 1) {
-                ss << "b" << j;
-            }
-            g_string bankName(ss.str().c_str());
-            uint32_t domain = (i*banks + j)*zinfo->numDomains/(caches*banks); //(banks > 1)? nextDomain() : (i*banks + j)*zinfo->numDomains/(caches*banks);
-            cg[i][j] = BuildCacheBank(config, prefix, bankName, bankSize, isTerminal, domain);
-        }
-    }
-
-    return cgp;
-}
+static void SpawnSimThread(void (*func)(void*), void* arg);
 
 static void InitSystem(Config& config) {
-    unordered_map<string, string> parentMap; //child -> parent
-    unordered_map<string, vector<vector<string>>> childMap; //parent -> children (a parent may have multiple children)
-
-    auto parseChildren = [](string children) {
-        // 1st dim: concatenated caches; 2nd dim: interleaved caches
-        // Example: "l2-beefy l1i-wimpy|l1d-wimpy" produces [["l2-beefy"], ["l1i-wimpy", "l1d-wimpy"]]
-        // If there are 2 of each cache, the final vector will be l2-beefy-0 l2-beefy-1 l1i-wimpy-0 l1d-wimpy-0 l1i-wimpy-1 l1d-wimpy-1
-        vector<string> concatGroups = ParseList<string>(children);
-        vector<vector<string>> cVec;
-        for (string cg : concatGroups) cVec.push_back(ParseList<string>(cg, "|"));
-        return cVec;
-    };
-
-    // If a network file is specified, build a Network
-    string networkFile = config.get<const char*>("sys.networkFile", "");
-    Network* network = (networkFile != "")? new Network(networkFile.c_str()) : nullptr;
-
-    // Build the caches
-    vector<const char*> cacheGroupNames;
-    config.subgroups("sys.caches", cacheGroupNames);
-    string prefix = "sys.caches.";
-
-    for (const char* grp : cacheGroupNames) {
-        string group(grp);
-        if (group == "mem") panic("'mem' is an invalid cache group name");
-        if (childMap.count(group)) panic("Duplicate cache group %s", (prefix + group).c_str());
-
-        string children = config.get<const char*>(prefix + group + ".children", "");
-        childMap[group] = parseChildren(children);
-        for (auto v : childMap[group]) for (auto child : v) {
-            if (parentMap.count(child)) {
-                panic("Cache group %s can have only one parent (%s and %s found)", child.c_str(), parentMap[child].c_str(), grp);
-            }
-            parentMap[child] = group;
-        }
-    }
-
-    // Check that children are valid (another cache)
-    for (auto& it : parentMap) {
-        bool found = false;
-        for (auto& grp : cacheGroupNames) found |= it.first == grp;
-        if (!found) panic("%s has invalid child %s", it.second.c_str(), it.first.c_str());
-    }
-
-    // Get the (single) LLC
-    vector<string> parentlessCacheGroups;
-    for (auto& it : childMap) if (!parentMap.count(it.first)) parentlessCacheGroups.push_back(it.first);
-    if (parentlessCacheGroups.size() != 1) panic("Only one last-level cache allowed, found: %s", Str(parentlessCacheGroups).c_str());
-    string llc = parentlessCacheGroups[0];
-
+    CacheHierarchy* hier = BuildCacheHierarchy(config, SpawnSimThread);
+    EndInitStage(INIT_CACHES);
+    const vector<const char*>& cacheGroupNames = hier->groupNames;
+    unordered_map<string, string>& parentMap = hier->parents;
+    unordered_map<string, CacheGroup*>& cMap = hier->groups;
     auto isTerminal = [&](string group) -> bool {
-        return childMap[group].size() == 0;
+        return hier->isTerminal(group);
     };
 
-    // Build each of the groups, starting with the LLC
-    unordered_map<string, CacheGroup*> cMap;
-    list<string> fringe;  // FIFO
-    fringe.push_back(llc);
-    while (!fringe.empty()) {
-        string group = fringe.front();
-        fringe.pop_front();
-        if (cMap.count(group)) panic("The cache 'tree' has a loop at %s", group.c_str());
-        cMap[group] = BuildCacheGroup(config, group, isTerminal(group));
-        for (auto& childVec : childMap[group]) fringe.insert(fringe.end(), childVec.begin(), childVec.end());
-    }
-
-    //Check single LLC
-    if (cMap[llc]->size() != 1) panic("Last-level cache %s must have caches = 1, but %ld were specified", llc.c_str(), cMap[llc]->size());
-
-    /* Since we have checked for no loops, parent is mandatory, and all parents are checked valid,
-     * it follows that we have a fully connected tree finishing at the LLC.
-     */
-
-    //Build the memory controllers
-    uint32_t memControllers = config.get<uint32_t>("sys.mem.controllers", 1);
-    assert(memControllers > 0);
-
-    g_vector<MemObject*> mems;
-    mems.resize(memControllers);
-
-    for (uint32_t i = 0; i < memControllers; i++) {
-        stringstream ss;
-        ss << "mem-" << i;
-        g_string name(ss.str().c_str());
-        //uint32_t domain = nextDomain(); //i*zinfo->numDomains/memControllers;
-        uint32_t domain = i*zinfo->numDomains/memControllers;
-        mems[i] = BuildMemoryController(config, zinfo->lineSize, zinfo->freqMHz, domain, name);
-    }
-
-    if (memControllers > 1) {
-        bool splitAddrs = config.get<bool>("sys.mem.splitAddrs", true);
-        if (splitAddrs) {
-            MemObject* splitter = new SplitAddrMemory(mems, "mem-splitter");
-            mems.resize(1);
-            mems[0] = splitter;
-        }
-    }
-
-    //Connect everything
-    bool printHierarchy = config.get<bool>("sim.printHierarchy", false);
-
-    // mem to llc is a bit special, only one llc
-    uint32_t childId = 0;
-    for (BaseCache* llcBank : (*cMap[llc])[0]) {
-        llcBank->setParents(childId++, mems, network);
-    }
-
-    // Rest of caches
-    for (const char* grp : cacheGroupNames) {
-        if (isTerminal(grp)) continue; //skip terminal caches
-
-        CacheGroup& parentCaches = *cMap[grp];
-        uint32_t parents = parentCaches.size();
-        assert(parents);
-
-        // Linearize concatenated / interleaved caches from childMap cacheGroups
-        CacheGroup childCaches;
-
-        for (auto childVec : childMap[grp]) {
-            if (!childVec.size()) continue;
-            size_t vecSize = cMap[childVec[0]]->size();
-            for (string child : childVec) {
-                if (cMap[child]->size() != vecSize) {
-                    panic("In interleaved group %s, %s has a different number of caches", Str(childVec).c_str(), child.c_str());
-                }
-            }
-
-            CacheGroup interleavedGroup;
-            for (uint32_t i = 0; i < vecSize; i++) {
-                for (uint32_t j = 0; j < childVec.size(); j++) {
-                    interleavedGroup.push_back(cMap[childVec[j]]->at(i));
-                }
-            }
-
-            childCaches.insert(childCaches.end(), interleavedGroup.begin(), interleavedGroup.end());
-        }
-
-        uint32_t children = childCaches.size();
-        assert(children);
-
-        uint32_t childrenPerParent = children/parents;
-        if (children % parents != 0) {
-            panic("%s has %d caches and %d children, they are non-divisible. "
-                  "Use multiple groups for non-homogeneous children per parent!", grp, parents, children);
-        }
-
-        for (uint32_t p = 0; p < parents; p++) {
-            g_vector<MemObject*> parentsVec;
-            parentsVec.insert(parentsVec.end(), parentCaches[p].begin(), parentCaches[p].end()); //BaseCache* to MemObject* is a safe cast
-
-            uint32_t childId = 0;
-            g_vector<BaseCache*> childrenVec;
-            for (uint32_t c = p*childrenPerParent; c < (p+1)*childrenPerParent; c++) {
-                for (BaseCache* bank : childCaches[c]) {
-                    bank->setParents(childId++, parentsVec, network);
-                    childrenVec.push_back(bank);
-                }
-            }
-
-            if (printHierarchy) {
-                vector<string> cacheNames;
-                std::transform(childrenVec.begin(), childrenVec.end(), std::back_inserter(cacheNames),
-                        [](BaseCache* c) -> string { string s = c->getName(); return s; });
-
-                string parentName = parentCaches[p][0]->getName();
-                if (parentCaches[p].size() > 1) {
-                    parentName += "..";
-                    parentName += parentCaches[p][parentCaches[p].size()-1]->getName();
-                }
-                info("Hierarchy: %s -> %s", Str(cacheNames).c_str(), parentName.c_str());
-            }
-
-            for (BaseCache* bank : parentCaches[p]) {
-                bank->setChildren(childrenVec, network);
-            }
-        }
-    }
-
-    //Check that all the terminal caches have a single bank
-    for (const char* grp : cacheGroupNames) {
-        if (isTerminal(grp)) {
-            uint32_t banks = (*cMap[grp])[0].size();
-            if (banks != 1) panic("Terminal cache group %s needs to have a single bank, has %d", grp, banks);
-        }
-    }
-
     //Tracks how many terminal caches have been allocated to cores
     unordered_map<string, uint32_t> assignedCaches;
     for (const char* grp : cacheGroupNames) if (isTerminal(grp)) assignedCaches[grp] = 0;
@@ -616,6 +123,21 @@ static void InitSystem(Config& config) {
         unordered_map <string, vector<Core*>> coreMap;
         config.subgroups("sys.cores", coreGroupNames);
 
+        //TLBs, with virtual memory; each core gets an L1 TLB per L1 cache and a shared L2 TLB
+        AggregateStat* mmuStats = nullptr;
+        uint32_t itlbEntries = 0, itlbWays = 0, dtlbEntries = 0, dtlbWays = 0, stlbEntries = 0, stlbWays = 0, stlbLatency = 0;
+        if (zinfo->vm) {
+            itlbEntries = config.get<uint32_t>("sys.vm.itlb.entries", 128);
+            itlbWays = config.get<uint32_t>("sys.vm.itlb.ways", 8);
+            dtlbEntries = config.get<uint32_t>("sys.vm.dtlb.entries", 64);
+            dtlbWays = config.get<uint32_t>("sys.vm.dtlb.ways", 4);
+            stlbEntries = config.get<uint32_t>("sys.vm.stlb.entries", 1536);
+            stlbWays = config.get<uint32_t>("sys.vm.stlb.ways", 12);
+            stlbLatency = config.get<uint32_t>("sys.vm.stlb.latency", 7);
+            mmuStats = new AggregateStat();
+            mmuStats->init("mmu", "Per-core TLB and page walk stats");
+        }
+
         uint32_t coreIdx = 0;
         for (const char* group : coreGroupNames) {
             if (parentMap.count(group)) panic("Core group name %s is invalid, a cache group already has that name", group);
@@ -678,8 +200,25 @@ static void InitSystem(Config& config) {
                     FilterCache* dc = dynamic_cast<FilterCache*>(dgroup[assignedCaches[dcache]][0]);
                     assert(dc);
                     dc->setSourceId(coreIdx);
+                    if (zinfo->memSampler) dc->setSampler(zinfo->memSampler);
                     assignedCaches[dcache]++;
 
+                    if (zinfo->vm) {
+                        TLB* stlb = new TLB(stlbEntries, stlbWays, "sys.vm.stlb");
+                        MMU* immu = new MMU(zinfo->vm, new TLB(itlbEntries, itlbWays, "sys.vm.itlb"), stlb, stlbLatency, coreIdx, zinfo->lineSize);
+                        MMU* dmmu = new MMU(zinfo->vm, new TLB(dtlbEntries, dtlbWays, "sys.vm.dtlb"), stlb, stlbLatency, coreIdx, zinfo->lineSize);
+                        immu->setWalkCache(dc);  // walks go through the L1d
+                        dmmu->setWalkCache(dc);
+                        ic->setMMU(immu);
+                        dc->setMMU(dmmu);
+
+                        AggregateStat* coreMmuStat = new AggregateStat();
+                        coreMmuStat->init(gm_strdup(name.c_str()), "Core MMU stats");
+                        immu->initStats(coreMmuStat, "i");
+                        dmmu->initStats(coreMmuStat, "d");
+                        mmuStats->append(coreMmuStat);
+                    }
+
                     //Build the core
                     if (type == "Simple") {
                         core = new (&simpleCores[j]) SimpleCore(ic, dc, name);
@@ -688,12 +227,14 @@ static void InitSystem(Config& config) {
                         TimingCore* tcore = new (&timingCores[j]) TimingCore(ic, dc, domain, name);
                         zinfo->eventRecorders[coreIdx] = tcore->getEventRecorder();
                         zinfo->eventRecorders[coreIdx]->setSourceId(coreIdx);
+                        zinfo->contentionSim->addClient(tcore);
                         core = tcore;
                     } else {
                         assert(type == "OOO");
                         OOOCore* ocore = new (&oooCores[j]) OOOCore(ic, dc, name);
                         zinfo->eventRecorders[coreIdx] = ocore->getEventRecorder();
                         zinfo->eventRecorders[coreIdx]->setSourceId(coreIdx);
+                        zinfo->contentionSim->addClient(ocore);
                         core = ocore;
                     }
                     coreMap[group].push_back(core);
@@ -732,6 +273,8 @@ static void InitSystem(Config& config) {
             for (Core* core : coreMap[group]) core->initStats(groupStat);
             zinfo->rootStat->append(groupStat);
         }
+        if (mmuStats) zinfo->rootStat->append(mmuStats);
+        EndInitStage(INIT_CORES);
     } else {  // trace-driven: create trace driver and proxy caches
         vector<TraceDriverProxyCache*> proxies;
         for (const char* grp : cacheGroupNames) {
@@ -753,27 +296,15 @@ static void InitSystem(Config& config) {
                 config.get<bool>("sim.playPuts", true),
                 config.get<bool>("sim.playAllGets", true));
         zinfo->traceDriver->initStats(zinfo->rootStat);
+        EndInitStage(INIT_CORES);
     }
 
     //Init stats: caches, mem
-    for (const char* group : cacheGroupNames) {
-        AggregateStat* groupStat = new AggregateStat(true);
-        groupStat->init(gm_strdup(group), "Cache stats");
-        for (vector<BaseCache*>& banks : *cMap[group]) for (BaseCache* bank : banks) bank->initStats(groupStat);
-        zinfo->rootStat->append(groupStat);
-    }
-
-    //Initialize event recorders
-    //for (uint32_t i = 0; i < zinfo->numCores; i++) eventRecorders[i] = new EventRecorder();
-
-    AggregateStat* memStat = new AggregateStat(true);
-    memStat->init("mem", "Memory controller stats");
-    for (auto mem : mems) mem->initStats(memStat);
-    zinfo->rootStat->append(memStat);
+    InitCacheHierarchyStats(hier, zinfo->rootStat);
+    EndInitStage(INIT_CACHE_STATS);
 
-    //Odds and ends: BuildCacheGroup new'd the cache groups, we need to delete them
-    for (pair<string, CacheGroup*> kv : cMap) delete kv.second;
-    cMap.clear();
+    //Odds and ends: BuildCacheHierarchy new'd the cache groups, we need to delete them
+    delete hier;
 
     info("Initialized system");
 }
@@ -795,20 +326,46 @@ static void PostInitStats(bool perProcessDir, Config& config) {
     const char* evStatsFile = gm_strdup((pathStr + "zsim-ev.h5").c_str());
     const char* cmpStatsFile = gm_strdup((pathStr + "zsim-cmp.h5").c_str());
     const char* statsFile = gm_strdup((pathStr + "zsim.out").c_str());
+    const char* liveStatsFile = gm_strdup((pathStr + "zsim-live.bin").c_str());
 
     if (zinfo->statsPhaseInterval) {
         const char* periodicStatsFilter = config.get<const char*>("sim.periodicStatsFilter", "");
         AggregateStat* prStat = (!strlen(periodicStatsFilter))? zinfo->rootStat : FilterStats(zinfo->rootStat, periodicStatsFilter);
         if (!prStat) panic("No stats match sim.periodicStatsFilter regex (%s)! Set interval to 0 to avoid periodic stats", periodicStatsFilter);
-        zinfo->periodicStatsBackend = new HDF5Backend(pStatsFile, prStat, (1 << 20) /* 1MB chunks */, zinfo->skipStatsVectors, zinfo->compactPeriodicStats);
+        // Text, JSON-lines, and columnar formats buffer dumps in memory and write 1MB at a time
+        const char* periodicStatsFormat = config.get<const char*>("sim.periodicStatsFormat", "hdf5");
+        if (strcmp(periodicStatsFormat, "hdf5") == 0) {
+            zinfo->periodicStatsBackend = new HDF5Backend(pStatsFile, prStat, (1 << 20) /* 1MB chunks */, zinfo->skipStatsVectors, zinfo->compactPeriodicStats);
+        } else if (strcmp(periodicStatsFormat, "text") == 0) {
+            zinfo->periodicStatsBackend = new TextBackend(gm_strdup((pathStr + "zsim-periodic.out").c_str()), prStat, (1 << 20));
+        } else if (strcmp(periodicStatsFormat, "jsonl") == 0) {
+            zinfo->periodicStatsBackend = new JSONLinesBackend(gm_strdup((pathStr + "zsim-periodic.jsonl").c_str()), prStat, (1 << 20));
+        } else if (strcmp(periodicStatsFormat, "columnar") == 0) {
+            zinfo->periodicStatsBackend = new ColumnarBackend(gm_strdup((pathStr + "zsim-periodic.bin").c_str()), prStat, (1 << 20));
+        } else {
+            panic("Invalid sim.periodicStatsFormat %s, must be hdf5, text, jsonl, or columnar", periodicStatsFormat);
+        }
         zinfo->periodicStatsBackend->dump(true); //must have a first sample
 
+        // Dumps every statsPhaseInterval phases of the initial length, even if phase lengths change
         class PeriodicStatsDumpEvent : public Event {
+            private:
+                uint64_t intervalCycles;
+                uint64_t nextDumpCycle;
+
             public:
-                explicit PeriodicStatsDumpEvent(uint32_t period) : Event(period) {}
+                explicit PeriodicStatsDumpEvent(uint32_t period) : Event(period) {
+                    intervalCycles = ((uint64_t)period)*zinfo->phaseLength;
+                    nextDumpCycle = intervalCycles;
+                }
+
                 void callback() {
-                    zinfo->trigger = 10000;
-                    zinfo->periodicStatsBackend->dump(true /*buffered*/);
+                    if (zinfo->globPhaseCycles >= nextDumpCycle) {
+                        zinfo->trigger = 10000;
+                        zinfo->periodicStatsBackend->dump(true /*buffered*/);
+                        while (nextDumpCycle <= zinfo->globPhaseCycles) nextDumpCycle += intervalCycles;
+                    }
+                    period = std::max((nextDumpCycle - zinfo->globPhaseCycles)/zinfo->maxPhaseLength, (uint64_t)1);
                 }
         };
 
@@ -818,6 +375,28 @@ static void PostInitStats(bool perProcessDir, Config& config) {
         zinfo->periodicStatsBackend = nullptr;
     }
 
+    // Live stats are cheap (a memcpy per update), so they can be updated every phase
+    uint32_t liveStatsInterval = config.get<uint32_t>("sim.liveStatsInterval", 0);
+    if (liveStatsInterval) {
+        const char* liveStatsFilter = config.get<const char*>("sim.liveStatsFilter", "");
+        AggregateStat* lsStat = (!strlen(liveStatsFilter))? zinfo->rootStat : FilterStats(zinfo->rootStat, liveStatsFilter);
+        if (!lsStat) panic("No stats match sim.liveStatsFilter regex (%s)! Set interval to 0 to avoid live stats", liveStatsFilter);
+        StatsBackend* liveStats = new LiveStatsBackend(liveStatsFile, lsStat);
+        liveStats->dump(true);
+
+        class LiveStatsUpdateEvent : public Event {
+            private:
+                StatsBackend* liveStats;
+
+            public:
+                LiveStatsUpdateEvent(StatsBackend* _liveStats, uint32_t period) : Event(period), liveStats(_liveStats) {}
+                void callback() {liveStats->dump(true /*buffered*/);}
+        };
+
+        zinfo->eventQueue->insert(new LiveStatsUpdateEvent(liveStats, liveStatsInterval));
+        zinfo->statsBackends->push_back(liveStats);  // final update on termination
+    }
+
     zinfo->eventualStatsBackend = new HDF5Backend(evStatsFile, zinfo->rootStat, (1 << 17) /* 128KB chunks */, zinfo->skipStatsVectors, false /* don't sum regular aggregates*/);
     zinfo->eventualStatsBackend->dump(true); //must have a first sample
     zinfo->statsBackends->push_back(zinfo->eventualStatsBackend);
@@ -831,7 +410,7 @@ static void PostInitStats(bool perProcessDir, Config& config) {
                 zinfo->trigger = i;
                 zinfo->eventualStatsBackend->dump(true /*buffered*/);
             };
-            zinfo->eventQueue->insert(makeAdaptiveEvent(getInstrs, dumpStats, 0, zinfo->maxMinInstrs, MAX_IPC*zinfo->phaseLength));
+            zinfo->eventQueue->insert(makeAdaptiveEvent(getInstrs, dumpStats, 0, zinfo->maxMinInstrs, MAX_IPC*zinfo->maxPhaseLength));
         }
     }
 
@@ -855,10 +434,19 @@ static void InitGlobalStats() {
     ProxyStat* phaseStat = new ProxyStat();
     phaseStat->init("phase", "Simulated phases", &zinfo->numPhases);
     zinfo->rootStat->append(phaseStat);
+
+    initTimeStat = new VectorCounter();
+    initTimeStat->init("initTime", "Initialization time by stage (ns)", INIT_NUM_STAGES, initStageNames);
+    zinfo->rootStat->append(initTimeStat);
 }
 
 
+static void SpawnSimThread(void (*func)(void*), void* arg) {
+    PIN_SpawnInternalThread(func, arg, 1024*1024, nullptr);
+}
+
 void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
+    initStageStartNs = getNs();
     zinfo = gm_calloc<GlobSimInfo>();
     zinfo->outputDir = gm_strdup(outputDir);
     zinfo->statsBackends = new g_vector<StatsBackend*>();
@@ -900,8 +488,41 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
 
     zinfo->numDomains = config.get<uint32_t>("sim.domains", 1);
     uint32_t numSimThreads = config.get<uint32_t>("sim.contentionThreads", MAX((uint32_t)1, zinfo->numDomains/2)); //gives a bit of parallelism, TODO tune
-    zinfo->contentionSim = new ContentionSim(zinfo->numDomains, numSimThreads);
+    bool pipelinedWeave = config.get<bool>("sim.pipelinedWeave", false); //overlap each weave phase with the next bound phase
+
+    //Host placement, before weave threads start. Cores get domains as in InitSystem
+    g_vector<uint32_t> coreDomains;
+    if (!zinfo->traceDriven) {
+        vector<const char*> groups;
+        config.subgroups("sys.cores", groups);
+        for (const char* group : groups) {
+            uint32_t cores = config.get<uint32_t>(string("sys.cores.") + group + ".cores", 1);
+            for (uint32_t j = 0; j < cores; j++) coreDomains.push_back(j*zinfo->numDomains/cores);
+        }
+    }
+    zinfo->placement = new HostPlacement(config, coreDomains, zinfo->numDomains, numSimThreads);
+    zinfo->placement->initStats(zinfo->rootStat);
+
+    //Host hardware counters, before weave threads start
+    if (config.get<bool>("sim.hostCounters", false)) {
+        zinfo->hostCounters = new HostCounters(zinfo->numCores, numSimThreads);
+        zinfo->hostCounters->initStats(zinfo->rootStat);
+    } else {
+        zinfo->hostCounters = nullptr;
+    }
+
+    zinfo->contentionSim = new ContentionSim(zinfo->numDomains, numSimThreads, pipelinedWeave, SpawnSimThread);
     zinfo->contentionSim->initStats(zinfo->rootStat);
+
+    //Weave event graph capture, replayed offline by weavebench
+    if (config.get<bool>("sim.weaveCapture", false)) {
+        uint64_t firstPhase = config.get<uint64_t>("sim.weaveCaptureStart", 0);
+        uint64_t numPhases = config.get<uint64_t>("sim.weaveCapturePhases", 100);
+        string captureFile = string(zinfo->outputDir) + "/zsim-weave.bin";
+        WeaveCapture* capture = new WeaveCapture(gm_strdup(captureFile.c_str()), zinfo->numDomains, firstPhase, numPhases);
+        capture->initStats(zinfo->rootStat);
+        zinfo->contentionSim->setCapture(capture);
+    }
     zinfo->eventRecorders = gm_calloc<EventRecorder*>(zinfo->numCores);
 
     zinfo->traceWriters = new g_vector<AccessTraceWriter*>();
@@ -910,6 +531,14 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->numPhases = 0;
 
     zinfo->phaseLength = config.get<uint32_t>("sim.phaseLength", 10000);
+    zinfo->nextPhaseLength = zinfo->phaseLength;
+    zinfo->maxPhaseLength = zinfo->phaseLength;
+    if (config.get<bool>("sim.adaptivePhaseLength", false)) {
+        zinfo->phaseLengthCtrl = new PhaseLengthController(config, zinfo->phaseLength);
+        zinfo->maxPhaseLength = zinfo->phaseLengthCtrl->getMaxLength();
+    } else {
+        zinfo->phaseLengthCtrl = nullptr;
+    }
     zinfo->statsPhaseInterval = config.get<uint32_t>("sim.statsPhaseInterval", 100);
     zinfo->freqMHz = config.get<uint32_t>("sys.frequency", 2000);
 
@@ -949,7 +578,49 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
         zinfo->sched = nullptr;
     }
 
+    //Barrier and scheduler trace, read by synctrace
+    if (zinfo->sched && config.get<bool>("sim.syncTrace", false)) {
+        string traceFile = string(zinfo->outputDir) + "/zsim-sync.bin";
+        uint32_t entries = config.get<uint32_t>("sim.syncTraceEntries", 1 << 16);
+        zinfo->syncTrace = new SyncTrace(gm_strdup(traceFile.c_str()), zinfo->numCores, entries);
+    } else {
+        zinfo->syncTrace = nullptr;
+    }
+
     zinfo->blockingSyscalls = config.get<bool>("sim.blockingSyscalls", false);
+    zinfo->filterFastPath = config.get<bool>("sim.filterFastPath", false);
+    zinfo->bufferAccesses = config.get<bool>("sim.bufferAccesses", false);
+    if (zinfo->filterFastPath && zinfo->bufferAccesses) {
+        // Filter hits would be applied ahead of earlier buffered misses
+        warn("sim.bufferAccesses = True, disabling sim.filterFastPath");
+        zinfo->filterFastPath = false;
+    }
+    if (zinfo->filterFastPath && !zinfo->traceDriven) {
+        // Only Simple and Timing cores have a fast path; with others, every If-call would miss and just add overhead
+        vector<const char*> groups;
+        config.subgroups("sys.cores", groups);
+        for (const char* group : groups) {
+            string type = config.get<const char*>(string("sys.cores.") + group + ".type", "Simple");
+            if (type != "Simple" && type != "Timing") {
+                warn("sim.filterFastPath needs Simple or Timing cores, but core group %s is %s; disabling it", group, type.c_str());
+                zinfo->filterFastPath = false;
+                break;
+            }
+        }
+    }
+
+    //Memory access sampling profiler, before caches are built
+    uint32_t samplingPeriod = config.get<uint32_t>("sim.memSampling.period", 0);
+    if (samplingPeriod) {
+        if (zinfo->bufferAccesses) {
+            // Replayed accesses would all get the PC of the BBL's last access
+            warn("sim.memSampling needs the PC of each access, disabling sim.bufferAccesses");
+            zinfo->bufferAccesses = false;
+        }
+        zinfo->memSampler = new MemSampler(config, zinfo->numCores, samplingPeriod, SpawnSimThread);
+    } else {
+        zinfo->memSampler = nullptr;
+    }
 
     if (zinfo->blockingSyscalls) {
         warn("sim.blockingSyscalls = True, will likely deadlock with multi-threaded apps!");
@@ -966,6 +637,17 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->lineSize = config.get<uint32_t>("sys.lineSize", 64);
     assert(zinfo->lineSize > 0);
 
+    EndInitStage(INIT_GLOBAL);
+
+    //Virtual memory (optional); determines how many processes we can have
+    if (config.get<bool>("sys.vm.enable", false)) {
+        zinfo->vm = new VirtualMemory(config, zinfo->lineSize);
+        zinfo->maxProcs = zinfo->vm->getMaxProcs();
+    } else {
+        zinfo->vm = nullptr;
+        zinfo->maxProcs = zinfo->lineSize;
+    }
+
     //Port virtualization
     for (uint32_t i = 0; i < MAX_PORT_DOMAINS; i++) zinfo->portVirt[i] = new PortVirtualizer();
 
@@ -976,11 +658,19 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
 
     zinfo->pinCmd = new PinCmd(&config, nullptr /*don't pass config file to children --- can go either way, it's optional*/, outputDir, shmid);
 
+    EndInitStage(INIT_PROCS);
+
     //Caches, cores, memory controllers
     InitSystem(config);
+    if (zinfo->vm) zinfo->vm->initStats(zinfo->rootStat);
 
     //Sched stats (deferred because of circular deps)
     if (zinfo->sched) zinfo->sched->initStats(zinfo->rootStat);
+    if (zinfo->syncTrace) zinfo->syncTrace->initStats(zinfo->rootStat);
+
+    //Needs cache and core stats
+    if (zinfo->phaseLengthCtrl) zinfo->phaseLengthCtrl->initStats(zinfo->rootStat);
+    if (zinfo->memSampler) zinfo->memSampler->initStats(zinfo->rootStat);
 
     zinfo->processStats = new ProcessStats(zinfo->rootStat);
 
@@ -993,11 +683,12 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
 
     //It's a global stat, but I want it to be last...
     zinfo->profHeartbeats = new VectorCounter();
-    zinfo->profHeartbeats->init("heartbeats", "Per-process heartbeats", zinfo->lineSize);
+    zinfo->profHeartbeats->init("heartbeats", "Per-process heartbeats", zinfo->maxProcs);
     zinfo->rootStat->append(zinfo->profHeartbeats);
 
     bool perProcessDir = config.get<bool>("sim.perProcessDir", false);
     PostInitStats(perProcessDir, config);
+    EndInitStage(INIT_STATS);
 
     zinfo->perProcessCpuEnum = config.get<bool>("sim.perProcessCpuEnum", false);
 
@@ -1018,8 +709,15 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     config.writeAndClose((string(zinfo->outputDir) + "/out.cfg").c_str(), strictConfig);
 
     zinfo->contentionSim->postInit();
+    EndInitStage(INIT_FINISH);
 
-    info("Initialization complete");
+    std::stringstream ss;
+    uint64_t totalNs = 0;
+    for (uint32_t i = 0; i < INIT_NUM_STAGES; i++) {
+        ss << " " << initStageNames[i] << " " << (initTimeStat->count(i)/1000000) << " ms";
+        totalNs += initTimeStat->count(i);
+    }
+    info("Initialization complete in %ld ms:%s", totalNs/1000000, ss.str().c_str());
 
     //Causes every other process to wake up
     gm_set_glob_ptr(zinfo);
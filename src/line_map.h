@@ -0,0 +1,140 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINE_MAP_H_
+#define LINE_MAP_H_
+
+#include <stdint.h>
+#include "galloc.h"
+#include "log.h"
+#include "memory_hierarchy.h"
+#include "pad.h"
+
+/* Maps line addresses to line ids, for fully-associative arrays.
+ *
+ * Open addressing with Robin Hood hashing and backward-shift deletion. The
+ * table is allocated once, sized for a fixed maximum number of lines, so it
+ * never allocates or rehashes. Each slot (address, id, probe distance) is 16
+ * bytes, so a lookup usually touches a single cache line.
+ */
+class LineMap : public GlobAlloc {
+    private:
+        struct Slot {
+            Address lineAddr;
+            uint32_t lineId;  // INVALID if empty
+            uint32_t dist;  // distance from the slot lineAddr hashes to
+        };
+
+        static const uint32_t INVALID = (uint32_t)-1;
+
+        Slot* slots;
+        uint64_t mask;
+        uint32_t shift;
+
+        inline uint64_t home(Address lineAddr) const {
+            // Fibonacci hashing; high bits are the well-mixed ones
+            return (lineAddr * 0x9E3779B97F4A7C15ULL) >> shift;
+        }
+
+    public:
+        explicit LineMap(uint32_t maxLines) {
+            // Keep load factor <= 2/3; probe sequences stay very short with Robin Hood
+            uint32_t bits = 1;
+            while ((1ULL << bits) < 3ULL*maxLines/2 + 1) bits++;
+            mask = (1ULL << bits) - 1;
+            shift = 64 - bits;
+            slots = gm_memalign<Slot>(CACHE_LINE_BYTES, mask + 1);
+            for (uint64_t i = 0; i <= mask; i++) {
+                slots[i].lineAddr = 0;
+                slots[i].lineId = INVALID;
+                slots[i].dist = 0;
+            }
+        }
+
+        ~LineMap() {
+            gm_free(slots);
+        }
+
+        // Returns the line id, or -1 if lineAddr is not in the map
+        inline int32_t find(Address lineAddr) const {
+            uint64_t pos = home(lineAddr);
+            for (uint32_t dist = 0; ; dist++) {
+                const Slot& s = slots[pos];
+                // Robin Hood invariant: if lineAddr were here, it'd be before any slot closer to its home
+                if (s.lineId == INVALID || s.dist < dist) return -1;
+                if (s.lineAddr == lineAddr) return s.lineId;
+                pos = (pos + 1) & mask;
+            }
+        }
+
+        // lineAddr must not be in the map
+        inline void insert(Address lineAddr, uint32_t lineId) {
+            assert(find(lineAddr) == -1);
+            Slot cur = {lineAddr, lineId, 0};
+            uint64_t pos = home(lineAddr);
+            while (true) {
+                Slot& s = slots[pos];
+                if (s.lineId == INVALID) {
+                    s = cur;
+                    return;
+                }
+                if (s.dist < cur.dist) {  // take from the rich
+                    Slot tmp = s;
+                    s = cur;
+                    cur = tmp;
+                }
+                cur.dist++;
+                pos = (pos + 1) & mask;
+            }
+        }
+
+        // Removes lineAddr if it maps to lineId; returns whether it did
+        inline bool erase(Address lineAddr, uint32_t lineId) {
+            uint64_t pos = home(lineAddr);
+            for (uint32_t dist = 0; ; dist++) {
+                Slot& s = slots[pos];
+                if (s.lineId == INVALID || s.dist < dist) return false;
+                if (s.lineAddr == lineAddr) {
+                    if (s.lineId != lineId) return false;
+                    break;
+                }
+                pos = (pos + 1) & mask;
+            }
+
+            // Backward-shift the following displaced entries, so we need no tombstones
+            uint64_t next = (pos + 1) & mask;
+            while (slots[next].lineId != INVALID && slots[next].dist > 0) {
+                slots[pos] = slots[next];
+                slots[pos].dist--;
+                pos = next;
+                next = (next + 1) & mask;
+            }
+            slots[pos].lineId = INVALID;
+            slots[pos].dist = 0;
+            return true;
+        }
+};
+
+#endif  // LINE_MAP_H_
@@ -0,0 +1,123 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "live_stats.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "flat_stats.h"
+#include "galloc.h"
+#include "log.h"
+#include "pad.h"
+#include "profile_stats.h"
+#include "stats.h"
+#include "zsim.h"
+
+// The backend lives in the global heap, but each process maps the file at a
+// different address, so the mapping is process-local. There is a single live
+// stats backend, so a single mapping suffices.
+static LiveStatsHeader* localMap = nullptr;
+
+class LiveStatsBackendImpl : public GlobAlloc {
+    private:
+        const char* filename;
+        FlatStats* stats;
+        uint64_t* values;  // staging buffer, so the update itself is a memcpy
+        uint64_t valuesOffset;
+        uint64_t fileSize;
+
+        LiveStatsHeader* map(int prot) {
+            int fd = open(filename, (prot & PROT_WRITE)? O_RDWR : O_RDONLY);
+            if (fd < 0) panic("Could not open live stats file %s", filename);
+            void* res = mmap(nullptr, fileSize, prot, MAP_SHARED, fd, 0);
+            if (res == MAP_FAILED) panic("Could not mmap live stats file %s", filename);
+            close(fd);
+            return static_cast<LiveStatsHeader*>(res);
+        }
+
+    public:
+        LiveStatsBackendImpl(const char* _filename, AggregateStat* rootStat) : filename(_filename) {
+            stats = new FlatStats(rootStat);
+            g_string names;
+            for (uint32_t i = 0; i < stats->size(); i++) {
+                names += stats->name(i);
+                names.push_back('\0');
+            }
+
+            uint64_t namesOffset = sizeof(LiveStatsHeader);
+            valuesOffset = (namesOffset + names.size() + CACHE_LINE_BYTES - 1) & ~((uint64_t)CACHE_LINE_BYTES - 1);
+            fileSize = valuesOffset + stats->size()*sizeof(uint64_t);
+            values = gm_calloc<uint64_t>(stats->size());
+
+            int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) panic("Could not create live stats file %s", filename);
+            if (ftruncate(fd, fileSize) != 0) panic("Could not size live stats file %s to %ld bytes", filename, fileSize);
+            close(fd);
+
+            LiveStatsHeader* hdr = map(PROT_READ | PROT_WRITE);
+            memcpy(reinterpret_cast<char*>(hdr) + namesOffset, names.c_str(), names.size());
+            hdr->version = LIVE_STATS_VERSION;
+            hdr->numValues = stats->size();
+            hdr->namesOffset = namesOffset;
+            hdr->valuesOffset = valuesOffset;
+            hdr->fileSize = fileSize;
+            hdr->seq = 0;
+            __sync_synchronize();
+            hdr->magic = LIVE_STATS_MAGIC;  // last, readers wait for it
+            munmap(hdr, fileSize);
+
+            info("Live stats: %d values (%ld bytes) in %s", stats->size(), fileSize, filename);
+        }
+
+        void update(bool final) {
+            // Gather first, so readers only see the seqlock held for the copy
+            uint32_t numValues = stats->size();
+            stats->read(values);
+
+            if (!localMap) localMap = map(PROT_READ | PROT_WRITE);
+            LiveStatsHeader* hdr = localMap;
+            assert((hdr->seq & 1) == 0);
+            hdr->seq++;
+            __sync_synchronize();
+            memcpy(reinterpret_cast<char*>(hdr) + valuesOffset, values, numValues*sizeof(uint64_t));
+            hdr->updates++;
+            hdr->phase = zinfo->numPhases;
+            hdr->cycles = zinfo->globPhaseCycles;
+            hdr->hostNs = getNs();
+            if (final) hdr->finished = 1;
+            __sync_synchronize();
+            hdr->seq++;
+        }
+};
+
+LiveStatsBackend::LiveStatsBackend(const char* filename, AggregateStat* rootStat) {
+    backend = new LiveStatsBackendImpl(filename, rootStat);
+}
+
+// Buffered dumps are the periodic updates; the unbuffered one is the final dump
+void LiveStatsBackend::dump(bool buffered) {
+    backend->update(!buffered);
+}
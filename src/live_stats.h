@@ -0,0 +1,66 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIVE_STATS_H_
+#define LIVE_STATS_H_
+
+#include <stdint.h>
+
+/* Layout of the live stats file (sim.liveStatsInterval), shared by the
+ * simulator and external readers (dumplive). The file is written once at
+ * init, then mapped by every simulator process; at the end of every interval,
+ * the thread running the end-of-phase actions copies a snapshot of all
+ * scalar and vector counters into it. Readers mmap the file read-only and
+ * never block the simulation.
+ *
+ *   [LiveStatsHeader][names: numValues NUL-terminated strings][pad][values: numValues uint64_t]
+ *
+ * Names are flattened stat paths without the root (e.g., l1d.l1d-0.mGETS;
+ * vector elements get their counter name or index appended). The header
+ * fields below seq and the values are protected by a seqlock: the writer
+ * makes seq odd, copies, then makes it even again. Readers copy and retry if
+ * seq was odd or changed during the copy.
+ */
+
+#define LIVE_STATS_MAGIC 0x45564c4d49535aULL  // "ZSIMLVE"
+#define LIVE_STATS_VERSION 1
+
+struct LiveStatsHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t numValues;
+    uint64_t namesOffset;
+    uint64_t valuesOffset;  // cache line-aligned
+    uint64_t fileSize;
+
+    volatile uint64_t seq;  // odd while the writer is updating
+    uint64_t updates;
+    uint64_t phase;  // zinfo->numPhases
+    uint64_t cycles;  // zinfo->globPhaseCycles
+    uint64_t hostNs;  // CLOCK_REALTIME
+    uint64_t finished;  // 1 after the final (termination) update
+};
+
+#endif  // LIVE_STATS_H_
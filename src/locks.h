@@ -185,6 +185,37 @@ static inline void futex_lock_nospin(volatile uint32_t* lock) {
     } while (c != 0);
 }
 
+/* Futex lock that adapts how long it spins before sleeping to how long recent
+ * acquisitions of this lock had to spin (a moving average in *spins, like
+ * glibc's adaptive mutexes). Short critical sections that are often contended,
+ * like those of shared cache banks, end up spinning instead of paying for
+ * sleeps and wakeups, and uncontended locks stay cheap. *spins is only a hint
+ * and is updated without synchronization. Returns true if the lock was taken
+ * on the first try, false if it had to wait. Unlock with futex_unlock.
+ */
+#define FUTEX_MAX_ADAPTIVE_SPINS 100
+
+static inline bool futex_lock_adaptive(volatile uint32_t* lock, volatile uint32_t* spins) {
+    if (*lock == 0 && __sync_bool_compare_and_swap(lock, 0, 1)) {
+        return true;
+    }
+
+    uint32_t maxSpins = 2*(*spins) + 10;
+    if (maxSpins > FUTEX_MAX_ADAPTIVE_SPINS) maxSpins = FUTEX_MAX_ADAPTIVE_SPINS;
+    uint32_t cnt = 0;
+    bool acquired = false;
+    while (cnt < maxSpins && !acquired) {
+        _mm_pause();
+        cnt++;
+        acquired = *lock == 0 && __sync_bool_compare_and_swap(lock, 0, 1);
+    }
+
+    int32_t delta = ((int32_t)cnt - (int32_t)*spins)/8;
+    *spins = *spins + delta;
+    if (!acquired) futex_lock_nospin(lock);  // spun long enough, sleep
+    return false;
+}
+
 #define BILLION (1000000000L)
 static inline bool futex_trylock_nospin_timeout(volatile uint32_t* lock, uint64_t timeoutNs) {
     if (*lock == 0 && __sync_bool_compare_and_swap(lock, 0, 1)) {
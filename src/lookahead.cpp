@@ -24,7 +24,11 @@
  */
 
 #include <algorithm>
+#include <fcntl.h>
+#include <sstream>
+#include <string>
 #include <tuple>
+#include <unistd.h>
 #include "part_repl_policies.h"
 #include "partitioner.h"
 
@@ -115,24 +119,63 @@ void computeBestPartitioning(
 LookaheadPartitioner::LookaheadPartitioner(PartReplPolicy* _repl, uint32_t _numPartitions, uint32_t _buckets,
                                            uint32_t _minAlloc, double _allocPortion, bool* _forbidden)
         : Partitioner(_minAlloc, _allocPortion, _forbidden)
-        , repl(_repl)
         , numPartitions(_numPartitions)
-        , buckets(_buckets) {
+        , buckets(_buckets)
+        , repl(_repl) {
     assert_msg(buckets > 0, "Must have non-zero buckets to avoid divide-by-zero exception.");
 
     curAllocs = gm_calloc<uint32_t>(buckets + 1);
+    curvesFd = -1;
+    curvesPid = 0;
 
     info("LookaheadPartitioner: %d part buckets", buckets);
 }
 
+void LookaheadPartitioner::computeBestPartitioning(uint32_t* allocs, const PartitionMonitor& monitor) {
+    lookahead::computeBestPartitioning(
+        numPartitions, allocPortion*buckets, minAlloc*numPartitions,
+        forbidden, allocs, monitor);
+}
+
+void LookaheadPartitioner::setCurvesFile(const char* file) {
+    curvesFile = file;
+    curvesFd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (curvesFd < 0) panic("Could not open miss curves file %s", file);
+    curvesPid = getpid();
+}
+
+// One block per interval: "<partitions> <buckets>", then one miss curve (buckets+1 values) per line
+void LookaheadPartitioner::dumpCurves(const PartitionMonitor& monitor) {
+    std::stringstream out;
+    out << numPartitions << " " << buckets << "\n";
+    for (uint32_t p = 0; p < numPartitions; p++) {
+        for (uint32_t b = 0; b <= buckets; b++) out << monitor.get(p, b) << ((b == buckets)? "\n" : " ");
+    }
+    std::string buf = out.str();
+
+    // Partitioning runs in whichever process ends the phase; others append through their own descriptor
+    bool ownFd = getpid() == curvesPid;
+    int fd = ownFd? curvesFd : open(curvesFile.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0) panic("Could not open miss curves file %s", curvesFile.c_str());
+    const char* pos = buf.c_str();
+    size_t left = buf.size();
+    while (left) {
+        ssize_t res = write(fd, pos, left);
+        if (res < 0) panic("Write to miss curves file %s failed", curvesFile.c_str());
+        pos += res;
+        left -= res;
+    }
+    if (!ownFd) close(fd);
+}
+
 //allocs are in buckets
 void LookaheadPartitioner::partition() {
     auto& monitor = *repl->getMonitor();
 
+    if (curvesFd >= 0) dumpCurves(monitor);
+
     uint32_t bestAllocs[numPartitions];
-    lookahead::computeBestPartitioning(
-        numPartitions, allocPortion*buckets, minAlloc*numPartitions,
-        forbidden, bestAllocs, monitor);
+    computeBestPartitioning(bestAllocs, monitor);
 
     uint64_t newUtility = lookahead::computePartitioningTotalUtility(
         numPartitions, bestAllocs, monitor);
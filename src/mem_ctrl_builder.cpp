@@ -0,0 +1,110 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mem_ctrl_builder.h"
+#include <string>
+#include "config.h"
+#include "ddr_mem.h"
+#include "detailed_mem.h"
+#include "dramsim_mem_ctrl.h"
+#include "log.h"
+#include "mem_ctrls.h"
+#include "weave_md1_mem.h"
+
+using std::string;
+
+// NOTE: frequency is SYSTEM frequency; mem freq specified in tech
+DDRMemory* BuildDDRMemory(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string name, const string& prefix) {
+    uint32_t ranksPerChannel = config.get<uint32_t>(prefix + "ranksPerChannel", 4);
+    uint32_t banksPerRank = config.get<uint32_t>(prefix + "banksPerRank", 8);  // DDR3 std is 8
+    uint32_t pageSize = config.get<uint32_t>(prefix + "pageSize", 8*1024);  // 1Kb cols, x4 devices
+    const char* tech = config.get<const char*>(prefix + "tech", "DDR3-1333-CL10");  // see cpp file for other techs
+    const char* addrMapping = config.get<const char*>(prefix + "addrMapping", "rank:col:bank");  // address splitter interleaves channels; row always on top
+
+    // If set, writes are deferred and bursted out to reduce WTR overheads
+    bool deferWrites = config.get<bool>(prefix + "deferWrites", true);
+    bool closedPage = config.get<bool>(prefix + "closedPage", true);
+
+    // Max row hits before we stop prioritizing further row hits to this bank.
+    // Balances throughput and fairness; 0 -> FCFS / high (e.g., -1) -> pure FR-FCFS
+    uint32_t maxRowHits = config.get<uint32_t>(prefix + "maxRowHits", 4);
+
+    // Request queues
+    uint32_t queueDepth = config.get<uint32_t>(prefix + "queueDepth", 16);
+    uint32_t controllerLatency = config.get<uint32_t>(prefix + "controllerLatency", 10);  // in system cycles
+
+    // If set, each scheduling event issues all the commands it safely can (same results, fewer events)
+    bool batchTicks = config.get<bool>(prefix + "batchTicks", false);
+
+    auto mem = new DDRMemory(lineSize, pageSize, ranksPerChannel, banksPerRank, frequency, tech,
+            addrMapping, controllerLatency, queueDepth, maxRowHits, deferWrites, closedPage, batchTicks, domain, name);
+    return mem;
+}
+
+MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string& name, const string& prefix) {
+    //Type
+    string type = config.get<const char*>(prefix + "type", "Simple");
+
+    //Latency
+    uint32_t latency = (type == "DDR")? -1 : config.get<uint32_t>(prefix + "latency", 100);
+
+    MemObject* mem = nullptr;
+    if (type == "Simple") {
+        mem = new SimpleMemory(latency, name);
+    } else if (type == "MD1") {
+        // The following params are for MD1 only
+        // NOTE: Frequency (in MHz) -- note this is a sys parameter (not sys.mem). There is an implicit assumption of having
+        // a single CCT across the system, and we are dealing with latencies in *core* clock cycles
+
+        // Peak bandwidth (in MB/s)
+        uint32_t bandwidth = config.get<uint32_t>(prefix + "bandwidth", 6400);
+
+        mem = new MD1Memory(lineSize, frequency, bandwidth, latency, name);
+    } else if (type == "WeaveMD1") {
+        uint32_t bandwidth = config.get<uint32_t>(prefix + "bandwidth", 6400);
+        uint32_t boundLatency = config.get<uint32_t>(prefix + "boundLatency", latency);
+        mem = new WeaveMD1Memory(lineSize, frequency, bandwidth, latency, boundLatency, domain, name);
+    } else if (type == "WeaveSimple") {
+        uint32_t boundLatency = config.get<uint32_t>(prefix + "boundLatency", 100);
+        mem = new WeaveSimpleMemory(latency, boundLatency, domain, name);
+    } else if (type == "DDR") {
+        mem = BuildDDRMemory(config, lineSize, frequency, domain, name, prefix);
+    } else if (type == "DRAMSim") {
+        uint64_t cpuFreqHz = 1000000 * frequency;
+        uint32_t capacity = config.get<uint32_t>(prefix + "capacityMB", 16384);
+        string dramTechIni = config.get<const char*>(prefix + "techIni");
+        string dramSystemIni = config.get<const char*>(prefix + "systemIni");
+        string outputDir = config.get<const char*>(prefix + "outputDir");
+        string traceName = config.get<const char*>(prefix + "traceName");
+        mem = new DRAMSimMemory(dramTechIni, dramSystemIni, outputDir, traceName, capacity, cpuFreqHz, latency, domain, name);
+    } else if (type == "Detailed") {
+        // FIXME(dsm): Don't use a separate config file... see DDRMemory
+        g_string mcfg = config.get<const char*>(prefix + "paramFile", "");
+        mem = new MemControllerBase(mcfg, lineSize, frequency, domain, name);
+    } else {
+        panic("Invalid memory controller type %s", type.c_str());
+    }
+    return mem;
+}
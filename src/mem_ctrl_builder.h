@@ -0,0 +1,48 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEM_CTRL_BUILDER_H_
+#define MEM_CTRL_BUILDER_H_
+
+#include <stdint.h>
+#include <string>
+#include "g_std/g_string.h"
+
+class Config;
+class DDRMemory;
+class MemObject;
+
+/* Builds memory controllers from their config section. These do not depend
+ * on Pin, so standalone tools (e.g., membench) can build the same
+ * controllers as SimInit. prefix is the section, with a trailing dot.
+ * NOTE: frequency is the SYSTEM frequency, in MHz.
+ */
+
+DDRMemory* BuildDDRMemory(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string name, const std::string& prefix);
+
+MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string& name,
+        const std::string& prefix = "sys.mem.");
+
+#endif  // MEM_CTRL_BUILDER_H_
@@ -52,6 +52,7 @@ class SimpleMemory : public MemObject {
 class MD1Memory : public MemObject {
     private:
         uint64_t lastPhase;
+        uint64_t lastPhaseCycles; //globPhaseCycles on the last update; phases may have different lengths
         double maxRequestsPerCycle;
         double smoothedPhaseAccesses;
         uint32_t zeroLoadLatency;
@@ -0,0 +1,243 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mem_sampler.h"
+#include <algorithm>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "bithacks.h"
+#include "config.h"
+#include "zsim.h"
+
+MemSampler::MemSampler(Config& config, uint32_t _numCores, uint32_t _period, void (*spawnThread)(void (*)(void*), void*)) {
+    numCores = _numCores;
+    period = _period;
+    uint32_t bufferSize = config.get<uint32_t>("sim.memSampling.bufferSize", 4096);
+    uint32_t objectBytes = config.get<uint32_t>("sim.memSampling.objectBytes", 4096);
+    writerIntervalUs = 1000*config.get<uint32_t>("sim.memSampling.writerInterval", 10);  // ms
+
+    if (period == 0) panic("sim.memSampling.period must be > 0");
+    if (!isPow2(bufferSize)) panic("sim.memSampling.bufferSize (%d) must be a power of 2", bufferSize);
+    if (!isPow2(objectBytes) || objectBytes < zinfo->lineSize) {
+        panic("sim.memSampling.objectBytes (%d) must be a power of 2 and at least a line", objectBytes);
+    }
+    ringMask = bufferSize - 1;
+    objectBits = ilog2(objectBytes);
+    objectLineBits = objectBits - ilog2(zinfo->lineSize);
+    filename = gm_strdup((std::string(zinfo->outputDir) + "/zsim-memprof.txt").c_str());
+
+    state = gm_memalign<CoreState>(CACHE_LINE_BYTES, numCores);
+    for (uint32_t c = 0; c < numCores; c++) {
+        CoreState& cs = state[c];
+        cs.pc = 0;
+        cs.rng = 0x9E3779B97F4A7C15ULL*(c + 1);
+        cs.countdown = nextCountdown(cs);
+        cs.level = nullptr;
+        cs.invs = 0;
+        cs.active = false;
+        cs.samples = 0;
+        cs.dropped = 0;
+        cs.ring = gm_memalign<MemSample>(CACHE_LINE_BYTES, bufferSize);
+        cs.head = 0;
+        cs.tail = 0;
+    }
+
+    futex_init(&drainLock);
+    levelNames.push_back("mem");
+
+    info("Memory access sampling: 1 in %d L1d filter misses, %d-sample buffers, %d-byte data objects, profile in %s",
+            period, bufferSize, objectBytes, filename);
+    spawnThread(writerThread, this);
+}
+
+void MemSampler::initStats(AggregateStat* parentStat) {
+    AggregateStat* samplerStat = new AggregateStat();
+    samplerStat->init("memSampling", "Memory access sampling stats");
+    auto samples = [this]() {
+        uint64_t res = 0;
+        for (uint32_t c = 0; c < numCores; c++) res += state[c].samples;
+        return res;
+    };
+    auto samplesStat = makeLambdaStat(samples);
+    samplesStat->init("samples", "Sampled accesses");
+    auto dropped = [this]() {
+        uint64_t res = 0;
+        for (uint32_t c = 0; c < numCores; c++) res += state[c].dropped;
+        return res;
+    };
+    auto droppedStat = makeLambdaStat(dropped);
+    droppedStat->init("dropped", "Samples dropped on full buffers");
+    samplerStat->append(samplesStat);
+    samplerStat->append(droppedStat);
+    parentStat->append(samplerStat);
+}
+
+uint64_t MemSampler::nextCountdown(CoreState& cs) {
+    // xorshift64; uniform in [period/2, 3*period/2), so the mean stays period
+    cs.rng ^= cs.rng << 13;
+    cs.rng ^= cs.rng >> 7;
+    cs.rng ^= cs.rng << 17;
+    return MAX(period/2 + cs.rng % period, (uint64_t)1);
+}
+
+void MemSampler::endSample(uint32_t cid, Address vLineAddr, bool isLoad, uint64_t latency) {
+    CoreState& cs = state[cid];
+    assert(cs.active);
+    cs.active = false;
+    cs.samples++;
+
+    uint64_t head = cs.head;
+    if (head - cs.tail > ringMask) {
+        cs.dropped++;
+        return;
+    }
+    MemSample& s = cs.ring[head & ringMask];
+    s.pc = cs.pc;
+    s.vLineAddr = vLineAddr;
+    s.level = cs.level;
+    s.latency = MIN(latency, (uint64_t)UINT32_MAX);
+    s.invs = MIN(cs.invs, (uint32_t)UINT16_MAX);
+    s.procIdx = procIdx;
+    s.isLoad = isLoad;
+    __sync_synchronize();  // write the sample before publishing it
+    cs.head = head + 1;
+}
+
+void MemSampler::drain() {
+    for (uint32_t c = 0; c < numCores; c++) {
+        CoreState& cs = state[c];
+        uint64_t head = cs.head;
+        __sync_synchronize();  // read samples after head
+        uint64_t tail = cs.tail;
+        for (; tail < head; tail++) aggregate(cs.ring[tail & ringMask]);
+        __sync_synchronize();  // done with the samples before freeing their slots
+        cs.tail = tail;
+    }
+}
+
+uint32_t MemSampler::levelIndex(const char* cacheName) {
+    g_unordered_map<const char*, uint32_t>::iterator it = cacheLevels.find(cacheName);
+    if (it != cacheLevels.end()) return it->second;
+
+    // Caches are named <group>-<idx>[b<bank>]; samples are aggregated by group
+    g_string group(cacheName);
+    size_t dash = group.rfind('-');
+    if (dash != g_string::npos) group.resize(dash);
+
+    uint32_t idx = std::find(levelNames.begin(), levelNames.end(), group) - levelNames.begin();
+    if (idx == levelNames.size()) {
+        if (idx < MAX_SAMPLE_LEVELS) {
+            levelNames.push_back(group);
+        } else {
+            idx = MAX_SAMPLE_LEVELS - 1;
+            warn("Memory sampling: too many cache levels, counting %s as %s", group.c_str(), levelNames[idx].c_str());
+        }
+    }
+    cacheLevels[cacheName] = idx;
+    return idx;
+}
+
+void MemSampler::aggregate(const MemSample& s) {
+    uint32_t level = s.level? levelIndex(s.level) : 0;
+    uint64_t proc = ((uint64_t)s.procIdx) << 48;  // user-level virtual addresses have 47 bits
+    Address objAddr = (s.vLineAddr >> objectLineBits) << objectBits;
+    ProfileEntry* entries[] = {&pcProfile[proc | s.pc], &objProfile[proc | objAddr]};
+    for (ProfileEntry* e : entries) {
+        e->samples++;
+        if (!s.isLoad) e->stores++;
+        e->latency += s.latency;
+        e->invs += s.invs;
+        e->served[level]++;
+    }
+}
+
+void MemSampler::writeProfile(FILE* f, const Profile& profile, const char* addrName) {
+    std::vector< std::pair<uint64_t, const ProfileEntry*> > entries;
+    for (const auto& kv : profile) entries.push_back(std::make_pair(kv.first, &kv.second));
+    std::sort(entries.begin(), entries.end(), [](const std::pair<uint64_t, const ProfileEntry*>& a, const std::pair<uint64_t, const ProfileEntry*>& b) {
+        return (a.second->samples == b.second->samples)? a.first < b.first : a.second->samples > b.second->samples;
+    });
+
+    // Cache levels by name (l1d, l2, l3...), then main memory
+    std::vector<uint32_t> levels;
+    for (uint32_t l = 1; l < levelNames.size(); l++) levels.push_back(l);
+    std::sort(levels.begin(), levels.end(), [this](uint32_t a, uint32_t b) { return levelNames[a] < levelNames[b]; });
+    levels.push_back(0);
+
+    fprintf(f, "%5s %18s %10s %10s %8s %10s", "proc", addrName, "samples", "stores", "avgLat", "invs");
+    for (uint32_t l : levels) fprintf(f, " %10s", levelNames[l].c_str());
+    fprintf(f, "\n");
+    for (const auto& p : entries) {
+        const ProfileEntry* e = p.second;
+        fprintf(f, "%5ld 0x%016lx %10ld %10ld %8.1f %10ld", p.first >> 48, p.first & ((1UL << 48) - 1),
+                e->samples, e->stores, ((double)e->latency)/e->samples, e->invs);
+        for (uint32_t l : levels) fprintf(f, " %10ld", e->served[l]);
+        fprintf(f, "\n");
+    }
+}
+
+void MemSampler::dump() {
+    futex_lock(&drainLock);
+    drain();
+
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        warn("Could not open %s, not writing the memory access profile", filename);
+        futex_unlock(&drainLock);
+        return;
+    }
+
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    for (uint32_t c = 0; c < numCores; c++) {
+        samples += state[c].samples;
+        dropped += state[c].dropped;
+    }
+    fprintf(f, "# zsim memory access profile: %ld samples (1 in %d L1d filter misses), %ld dropped\n", samples, period, dropped);
+    fprintf(f, "# Per level columns count where sampled accesses were served; avgLat is in core cycles; invs are invalidations caused\n");
+    fprintf(f, "# Addresses are virtual; with sim.aslr = false, PCs can be symbolized with e.g. addr2line -f -e <binary>\n");
+    fprintf(f, "\n# By PC\n");
+    writeProfile(f, pcProfile, "pc");
+    fprintf(f, "\n# By data object (%d-byte regions)\n", 1 << objectBits);
+    writeProfile(f, objProfile, "object");
+    fclose(f);
+
+    info("Wrote memory access profile (%ld samples, %ld PCs, %ld data objects) to %s",
+            samples - dropped, pcProfile.size(), objProfile.size(), filename);
+    futex_unlock(&drainLock);
+}
+
+void MemSampler::writerThread(void* arg) {
+    MemSampler* ms = static_cast<MemSampler*>(arg);
+    info("Started memory sampling writer thread");
+    while (!zinfo->terminationConditionMet) {
+        usleep(ms->writerIntervalUs);
+        futex_lock(&ms->drainLock);
+        ms->drain();
+        futex_unlock(&ms->drainLock);
+    }
+}
@@ -0,0 +1,175 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEM_SAMPLER_H_
+#define MEM_SAMPLER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "g_std/g_string.h"
+#include "g_std/g_unordered_map.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "locks.h"
+#include "log.h"
+#include "memory_hierarchy.h"
+#include "pad.h"
+#include "stats.h"
+
+class Config;
+
+#define MAX_SAMPLE_LEVELS 8  // including main memory
+
+/* Sampled memory access, see MemSampler */
+struct MemSample {
+    Address pc;
+    Address vLineAddr;
+    const char* level;  // name of the cache that served the access, nullptr if main memory did
+    uint32_t latency;
+    uint16_t invs;
+    uint16_t procIdx;
+    bool isLoad;
+};
+
+/* Memory access sampling profiler (sim.memSampling), to find out which code
+ * and data cause misses and coherence traffic. One in every period L1d
+ * accesses that miss in the filter (those that go through
+ * FilterCache::replace; filter hits are L1 hits) is followed down the
+ * hierarchy: every cache it reaches notes whether it hit, and the deepest
+ * one that did served it. We record its PC, virtual line address, where it
+ * was served, its latency, and how many invalidations it caused. Periods are
+ * jittered to avoid aliasing with strided loops.
+ *
+ * Each core appends samples to its own single-producer, single-consumer ring
+ * buffer, and a writer thread drains them every few ms and aggregates them
+ * per PC and per data object (an aligned region of objectBytes). Samples are
+ * dropped if a ring fills up. The profile is written out as text to
+ * zsim-memprof.txt at the end of the simulation.
+ *
+ * Sampling needs the PC of each access, so the memory analysis routines pass
+ * IARG_INST_PTR when it is enabled. OOO cores simulate a basic block's
+ * accesses at the next one, so their samples are attributed to the last
+ * memory instruction of their basic block.
+ */
+class MemSampler : public GlobAlloc {
+    private:
+        struct CoreState {
+            // Written by the core's thread
+            Address pc;  // of the last memory access
+            uint64_t countdown;  // filter misses until the next sample
+            uint64_t rng;
+            const char* level;  // of the sample in flight
+            uint32_t invs;
+            bool active;  // a sample is in flight
+            uint64_t samples;
+            uint64_t dropped;
+            MemSample* ring;
+            volatile uint64_t head;
+
+            PAD();
+
+            // Written by the writer
+            volatile uint64_t tail;
+        } ATTR_LINE_ALIGNED;
+
+        struct ProfileEntry {
+            uint64_t samples;
+            uint64_t stores;
+            uint64_t latency;  // sum
+            uint64_t invs;
+            uint64_t served[MAX_SAMPLE_LEVELS];  // by level index
+        };
+
+        typedef g_unordered_map<uint64_t, ProfileEntry> Profile;  // keyed by (procIdx, address)
+
+        CoreState* state;
+        uint32_t numCores;
+        uint32_t period;
+        uint32_t ringMask;
+        uint32_t objectBits;
+        uint32_t objectLineBits;  // objectBits - lineBits
+        uint32_t writerIntervalUs;
+        const char* filename;
+
+        // Aggregated samples, owned by whoever holds drainLock
+        lock_t drainLock;
+        Profile pcProfile;
+        Profile objProfile;
+        g_unordered_map<const char*, uint32_t> cacheLevels;  // by cache name
+        g_vector<g_string> levelNames;  // 0 is main memory
+
+    public:
+        // period is sim.memSampling.period, read by the caller (tools may override it)
+        MemSampler(Config& config, uint32_t _numCores, uint32_t _period, void (*spawnThread)(void (*)(void*), void*));
+
+        void initStats(AggregateStat* parentStat);
+
+        // Called by the core's dcache on every filter miss. Returns true if this access is sampled
+        inline bool startSample(uint32_t cid) {
+            CoreState& cs = state[cid];
+            if (likely(--cs.countdown)) return false;
+            cs.countdown = nextCountdown(cs);
+            cs.level = nullptr;
+            cs.invs = 0;
+            cs.active = true;
+            return true;
+        }
+
+        void endSample(uint32_t cid, Address vLineAddr, bool isLoad, uint64_t latency);
+
+        // Called by the analysis routines on every access (the core may be invalid if the thread is not running)
+        inline void setPC(uint32_t cid, Address pc) {
+            if (likely(cid < numCores)) state[cid].pc = pc;
+        }
+
+        // Cores that simulate accesses after the analysis routines run (OOO) save it, then set it back
+        inline Address getPC(uint32_t cid) const {
+            return likely(cid < numCores)? state[cid].pc : 0;
+        }
+
+        // Called by caches on every GETS/GETX; deeper caches overwrite shallower ones
+        inline void noteAccess(uint32_t srcId, const g_string& cacheName, bool hit) {
+            if (unlikely(srcId < numCores && state[srcId].active)) {
+                state[srcId].level = hit? cacheName.c_str() : nullptr;
+            }
+        }
+
+        inline void noteInvalidations(uint32_t srcId, uint32_t invs) {
+            if (unlikely(srcId < numCores && state[srcId].active)) state[srcId].invs += invs;
+        }
+
+        // Drains all rings and writes the profile; call at termination
+        void dump();
+
+    private:
+        uint64_t nextCountdown(CoreState& cs);
+        void drain();
+        void aggregate(const MemSample& s);
+        uint32_t levelIndex(const char* cacheName);
+        void writeProfile(FILE* f, const Profile& profile, const char* addrName);
+        static void writerThread(void* arg);
+};
+
+#endif  // MEM_SAMPLER_H_
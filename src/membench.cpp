@@ -0,0 +1,372 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Memory controller microbenchmark. Builds a single controller from a zsim
+ * config section (sys.mem by default, same keys and defaults as in a full
+ * simulation), drives it with a synthetic request stream or a trace through
+ * ContentionSim, and reports simulated bandwidth and latency, and how many
+ * requests per second the model simulates. Use it to catch performance
+ * regressions in memory models without Pin or a cache hierarchy.
+ *
+ * Requests arrive open-loop, at random times with a given mean interarrival
+ * time. With -m, each request also waits for the response of the request m
+ * positions earlier, which bounds memory-level parallelism as cores do.
+ * The interarrival, write and row hit percentages take comma-separated
+ * lists; each combination runs in its own process, one output line each.
+ *
+ * Patterns:
+ *   stream: consecutive lines, stride -S (default 1)
+ *   random: uniformly random lines within the footprint (-f MB)
+ *   rowhit: like random, but with probability -r the next request is -S
+ *           lines after the previous one (default 8, i.e., same DDR row with
+ *           the default rank:col:bank mapping and 8 banks)
+ *   trace:  replays -T file, one "cycle R|W address" per line (# comments);
+ *           cycles are relative to the start of the trace
+ *
+ * Latencies are measured from when a request is issued to when its response
+ * event runs. Bound-phase only models (Simple, MD1) record no events, so
+ * their bound-phase latencies are reported instead, and -m has no effect.
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "bithacks.h"
+#include "config.h"
+#include "contention_sim.h"
+#include "event_recorder.h"
+#include "galloc.h"
+#include "log.h"
+#include "mem_ctrl_builder.h"
+#include "memory_hierarchy.h"
+#include "profile_stats.h"
+#include "standalone_threads.h"
+#include "timing_event.h"
+#include "zsim.h"
+
+using std::string;
+using std::vector;
+
+GlobSimInfo* zinfo;
+
+struct Params {
+    const char* configFile = nullptr;
+    string section = "sys.mem";
+    string pattern = "random";
+    const char* traceFile = nullptr;
+    uint32_t requests = 100000;
+    uint32_t stride = 0;  // 0 -> pattern default
+    uint32_t footprintMB = 1024;
+    uint32_t mlp = 0;  // 0 -> open-loop
+    uint32_t phaseLength = 10000;
+    uint64_t seed = 1;
+    vector<uint32_t> interarrivals = {20};  // mean, in sysCycles
+    vector<uint32_t> writePcts = {0};
+    vector<uint32_t> rowHitPcts = {50};
+};
+
+struct Request {
+    uint64_t arrivalCycle;
+    Address lineAddr;
+    bool write;
+};
+
+// Results of a run, shared with the parent
+struct Result {
+    uint64_t firstCycle, lastCycle;  // first arrival, last response
+    uint64_t latSum, latMax, latP95;
+    uint64_t boundNs, weaveNs;
+    uint32_t weaveReqs;  // requests with weave-phase timing
+};
+
+static uint64_t Rnd(uint64_t& s) {
+    s = s*6364136223846793005ULL + 1442695040888963407ULL;
+    return s >> 33;
+}
+
+static vector<Request> Generate(const Params& p, uint32_t lineSize, uint32_t interarrival, uint32_t writePct, uint32_t rowHitPct) {
+    uint64_t s = p.seed;
+    uint64_t footprintLines = std::max(((uint64_t)p.footprintMB << 20)/lineSize, 1ul);
+    uint32_t stride = p.stride? p.stride : ((p.pattern == "stream")? 1 : 8);
+
+    vector<Request> reqs(p.requests);
+    uint64_t cycle = p.phaseLength;  // leave the first phase empty
+    Address line = Rnd(s) % footprintLines;
+    for (uint32_t i = 0; i < p.requests; i++) {
+        Request& r = reqs[i];
+        cycle += Rnd(s) % (2*interarrival + 1);
+        r.arrivalCycle = cycle;
+        if (p.pattern == "stream") {
+            line = i ? line + stride : 0;
+        } else if (p.pattern == "random") {
+            line = Rnd(s) % footprintLines;
+        } else {
+            assert(p.pattern == "rowhit");
+            line = (i && Rnd(s) % 100 < rowHitPct)? line + stride : Rnd(s) % footprintLines;
+        }
+        r.lineAddr = line;
+        r.write = Rnd(s) % 100 < writePct;
+    }
+    return reqs;
+}
+
+static vector<Request> ReadTrace(const Params& p, uint32_t lineSize) {
+    FILE* f = fopen(p.traceFile, "r");
+    if (!f) panic("Could not open trace %s", p.traceFile);
+    uint32_t lineBits = ilog2(lineSize);
+    vector<Request> reqs;
+    char buf[256];
+    uint64_t lineNum = 0;
+    uint64_t firstCycle = 0;
+    while (fgets(buf, sizeof(buf), f)) {
+        lineNum++;
+        if (buf[0] == '#' || buf[0] == '\n') continue;
+        uint64_t cycle, addr;
+        char type;
+        if (sscanf(buf, "%lu %c %li", &cycle, &type, &addr) != 3 || (type != 'R' && type != 'W')) {
+            panic("%s:%ld: expected \"cycle R|W address\"", p.traceFile, lineNum);
+        }
+        if (reqs.empty()) firstCycle = cycle;
+        uint64_t arrivalCycle = cycle - firstCycle + p.phaseLength;  // leave the first phase empty
+        if (cycle < firstCycle || (!reqs.empty() && arrivalCycle < reqs.back().arrivalCycle)) {
+            panic("%s:%ld: requests must be sorted by cycle", p.traceFile, lineNum);
+        }
+        reqs.push_back({arrivalCycle, addr >> lineBits, type == 'W'});
+    }
+    fclose(f);
+    if (reqs.empty()) panic("Empty trace %s", p.traceFile);
+    return reqs;
+}
+
+static uint64_t completed = 0;  // requests whose RespEvent ran
+
+// Runs in a child process, so each run gets a fresh global heap and controller
+static void Run(const Params& p, const vector<Request>& reqs, Result* res) {
+    gm_init(256 << 20);
+    zinfo = gm_calloc<GlobSimInfo>();
+
+    Config config(p.configFile);
+    zinfo->freqMHz = config.get<uint32_t>("sys.frequency", 2000);
+    zinfo->lineSize = config.get<uint32_t>("sys.lineSize", 64);
+    zinfo->numDomains = 1;
+    zinfo->numCores = 1;
+    zinfo->phaseLength = p.phaseLength;
+    zinfo->nextPhaseLength = p.phaseLength;
+    zinfo->maxPhaseLength = p.phaseLength;
+    zinfo->placement = nullptr;
+    zinfo->eventRecorders = gm_calloc<EventRecorder*>(1);
+    EventRecorder* evRec = new EventRecorder();
+    zinfo->eventRecorders[0] = evRec;
+
+    AggregateStat* rootStat = new AggregateStat();
+    rootStat->init("root", "Stats");
+    zinfo->contentionSim = new ContentionSim(1, 1, false, SpawnThread);
+    zinfo->contentionSim->initStats(rootStat);
+
+    g_string name("mem-0");
+    MemObject* mem = BuildMemoryController(config, zinfo->lineSize, zinfo->freqMHz, 0, name, p.section + ".");
+    mem->initStats(rootStat);
+
+    vector<uint64_t> issueCycles(reqs.size());
+    vector<uint64_t> respCycles(reqs.size());
+    vector<RespEvent*> respEvs(reqs.size(), nullptr);
+    uint32_t weaveReqs = 0;
+    uint32_t next = 0;
+    uint64_t limit = 0;
+    uint64_t boundNs = 0;
+    uint64_t weaveNs = 0;
+    while (next < reqs.size() || completed < weaveReqs) {
+        zinfo->globPhaseCycles = limit;
+        limit += p.phaseLength;
+        uint32_t phaseStart = next;  // first request of this phase
+        uint64_t startNs = getNs();
+        while (next < reqs.size() && reqs[next].arrivalCycle < limit) {
+            const Request& r = reqs[next];
+            MESIState state = I;
+            MemReq req = {r.lineAddr, r.write? PUTX : GETS, 0, &state, r.arrivalCycle, nullptr, I, 0, 0};
+            issueCycles[next] = r.arrivalCycle;
+            respCycles[next] = mem->access(req);
+
+            if (evRec->hasRecord()) {
+                TimingRecord tr = evRec->popRecord();
+                IssueEvent* iss = new (evRec) IssueEvent(&issueCycles[next]);  // root, or waits on an earlier response with -m
+                iss->setMinStartCycle(r.arrivalCycle);
+                RespEvent* resp = new (evRec) RespEvent(&respCycles[next], &completed);
+                resp->setMinStartCycle(r.arrivalCycle);
+                iss->addChild(tr.startEvent, evRec);
+                tr.endEvent->addChild(resp, evRec);
+                respEvs[next] = resp;
+                weaveReqs++;
+
+                // Only depend on requests whose events were created this phase, older ones may be done
+                int64_t dep = (int64_t)next - p.mlp;
+                if (p.mlp && dep >= phaseStart && respEvs[dep]) {
+                    // The response comes after the arrival of the request, so this never starts before our arrival
+                    DelayEvent* dl = new (evRec) DelayEvent(r.arrivalCycle - reqs[dep].arrivalCycle);
+                    dl->setMinStartCycle(reqs[dep].arrivalCycle);
+                    respEvs[dep]->addChild(dl, evRec)->addChild(iss, evRec);
+                } else {
+                    iss->queue(r.arrivalCycle);
+                }
+            }
+            next++;
+        }
+        boundNs += getNs() - startNs;
+
+        startNs = getNs();
+        zinfo->contentionSim->simulatePhase(limit);
+        weaveNs += getNs() - startNs;
+        zinfo->numPhases++;
+    }
+
+    vector<uint64_t> lats(reqs.size());
+    uint64_t lastCycle = 0;
+    uint64_t latSum = 0;
+    for (uint32_t i = 0; i < reqs.size(); i++) {
+        assert(respCycles[i] >= issueCycles[i]);
+        lats[i] = respCycles[i] - issueCycles[i];
+        latSum += lats[i];
+        lastCycle = std::max(lastCycle, respCycles[i]);
+    }
+    std::sort(lats.begin(), lats.end());
+
+    res->firstCycle = reqs[0].arrivalCycle;
+    res->lastCycle = lastCycle;
+    res->latSum = latSum;
+    res->latMax = lats.back();
+    res->latP95 = lats[(lats.size() - 1)*95/100];
+    res->boundNs = boundNs;
+    res->weaveNs = weaveNs;
+    res->weaveReqs = weaveReqs;
+}
+
+static vector<uint32_t> ParseList(const char* str) {
+    vector<string> tokens;
+    Tokenize(str, tokens, ",");
+    vector<uint32_t> res;
+    for (const string& t : tokens) res.push_back(strtoul(t.c_str(), nullptr, 0));
+    return res;
+}
+
+static void usage(const char* argv0) {
+    info("Drives a memory controller from a zsim config with synthetic requests or a trace");
+    info("Usage: %s config [-c section] [-p stream|random|rowhit|trace] [-T trace] [-n requests] [-i interarrivals] "
+            "[-w write%%s] [-r rowHit%%s] [-S stride] [-f footprintMB] [-m mlp] [-l phaseLength] [-s seed]", argv0);
+    info("-i, -w and -r take comma-separated lists; each combination is a separate run");
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog("");  // no log header
+
+    Params p;
+    if (argc < 2 || argv[1][0] == '-') usage(argv[0]);
+    p.configFile = argv[1];
+    for (int i = 2; i < argc; i++) {
+        if (argv[i][0] != '-' || strlen(argv[i]) != 2 || i + 1 >= argc) usage(argv[0]);
+        const char* v = argv[++i];
+        switch (argv[i-1][1]) {
+            case 'c': p.section = v; break;
+            case 'p': p.pattern = v; break;
+            case 'T': p.traceFile = v; p.pattern = "trace"; break;
+            case 'n': p.requests = strtoul(v, nullptr, 0); break;
+            case 'i': p.interarrivals = ParseList(v); break;
+            case 'w': p.writePcts = ParseList(v); break;
+            case 'r': p.rowHitPcts = ParseList(v); break;
+            case 'S': p.stride = strtoul(v, nullptr, 0); break;
+            case 'f': p.footprintMB = strtoul(v, nullptr, 0); break;
+            case 'm': p.mlp = strtoul(v, nullptr, 0); break;
+            case 'l': p.phaseLength = strtoul(v, nullptr, 0); break;
+            case 's': p.seed = strtoul(v, nullptr, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (p.pattern != "stream" && p.pattern != "random" && p.pattern != "rowhit" && p.pattern != "trace") usage(argv[0]);
+    if (p.pattern == "trace" && !p.traceFile) usage(argv[0]);
+    if (!p.requests || !p.phaseLength || p.interarrivals.empty() || p.writePcts.empty() || p.rowHitPcts.empty()) usage(argv[0]);
+
+    // The parent reads the few sys-wide params it needs; children build the controller
+    uint32_t lineSize, freqMHz;
+    string type;
+    {
+        Config config(p.configFile);
+        lineSize = config.get<uint32_t>("sys.lineSize", 64);
+        freqMHz = config.get<uint32_t>("sys.frequency", 2000);
+        type = config.get<const char*>(p.section + ".type", "Simple");
+    }
+    info("%s: %s controller, %d MHz, %d-byte lines, %s pattern", p.configFile, type.c_str(), freqMHz, lineSize, p.pattern.c_str());
+
+    // Traces fix arrivals and types, so only run once
+    if (p.pattern == "trace") {
+        p.interarrivals.resize(1);
+        p.writePcts.resize(1);
+    }
+    if (p.pattern != "rowhit") p.rowHitPcts.resize(1);
+
+    Result* res = static_cast<Result*>(mmap(nullptr, sizeof(Result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (res == MAP_FAILED) panic("mmap failed");
+
+    printf("%6s %5s %5s %10s %12s %10s %8s %8s %8s %10s %9s %9s\n", "iarr", "wr%", "rh%", "reqs", "cycles",
+            "MB/s", "avgLat", "p95Lat", "maxLat", "Kreqs/s", "bound (s)", "weave (s)");
+    for (uint32_t ia : p.interarrivals) {
+        for (uint32_t wp : p.writePcts) {
+            for (uint32_t rh : p.rowHitPcts) {
+                vector<Request> reqs = (p.pattern == "trace")? ReadTrace(p, lineSize) : Generate(p, lineSize, ia, wp, rh);
+
+                memset(res, 0, sizeof(Result));
+                fflush(stdout);
+                pid_t pid = fork();
+                if (pid < 0) panic("fork failed");
+                if (pid == 0) {
+                    Run(p, reqs, res);
+                    _exit(0);
+                }
+                int status;
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) panic("Run failed");
+
+                uint64_t n = reqs.size();
+                uint64_t cycles = res->lastCycle - res->firstCycle;
+                double mbps = cycles? ((double)n)*lineSize*freqMHz/cycles : 0.0;
+                double hostNs = res->boundNs + res->weaveNs;
+                printf("%6d %5d %5d %10ld %12ld %10.1f %8.1f %8ld %8ld %10.1f %9.3f %9.3f\n",
+                        (p.pattern == "trace")? 0 : ia, (p.pattern == "trace")? 0 : wp, (p.pattern == "rowhit")? rh : 0,
+                        n, cycles, mbps, ((double)res->latSum)/n, res->latP95, res->latMax,
+                        hostNs? n*1e6/hostNs : 0.0, res->boundNs/1e9, res->weaveNs/1e9);
+                if (res->weaveReqs && res->weaveReqs != n) {
+                    info("  %d of %ld requests have weave-phase timing, the rest bound-phase timing", res->weaveReqs, n);
+                }
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
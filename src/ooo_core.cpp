@@ -30,6 +30,7 @@
 #include "bithacks.h"
 #include "decoder.h"
 #include "filter_cache.h"
+#include "mem_sampler.h"
 #include "zsim.h"
 
 /* Uncomment to induce backpressure to the IW when the load/store buffers fill up. In theory, more detailed,
@@ -117,7 +118,7 @@ void OOOCore::initStats(AggregateStat* parentStat) {
 }
 
 uint64_t OOOCore::getInstrs() const {return instrs;}
-uint64_t OOOCore::getPhaseCycles() const {return curCycle % zinfo->phaseLength;}
+uint64_t OOOCore::getPhaseCycles() const {return (curCycle - zinfo->globPhaseCycles) % zinfo->phaseLength;}
 
 void OOOCore::contextSwitch(int32_t gid) {
     if (gid == -1) {
@@ -134,10 +135,13 @@ void OOOCore::contextSwitch(int32_t gid) {
 InstrFuncPtrs OOOCore::GetFuncPtrs() {return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, FPTR_ANALYSIS, {0}};}
 
 inline void OOOCore::load(Address addr) {
+    // Accesses are simulated at the next BBL, when the sampler's PC is that of the last one
+    if (unlikely(zinfo->memSampler != nullptr)) loadPCs[loads] = zinfo->memSampler->getPC(getEventRecorder()->getSourceId());
     loadAddrs[loads++] = addr;
 }
 
 void OOOCore::store(Address addr) {
+    if (unlikely(zinfo->memSampler != nullptr)) storePCs[stores] = zinfo->memSampler->getPC(getEventRecorder()->getSourceId());
     storeAddrs[stores++] = addr;
 }
 
@@ -268,6 +272,7 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
                     Address addr = loadAddrs[loadIdx++];
                     uint64_t reqSatisfiedCycle = dispatchCycle;
                     if (addr != ((Address)-1L)) {
+                        if (unlikely(zinfo->memSampler != nullptr)) zinfo->memSampler->setPC(getEventRecorder()->getSourceId(), loadPCs[loadIdx-1]);
                         reqSatisfiedCycle = l1d->load(addr, dispatchCycle) + L1D_LAT;
                         cRec.record(curCycle, dispatchCycle, reqSatisfiedCycle);
                     }
@@ -305,6 +310,7 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
                     dispatchCycle = MAX(lastStoreAddrCommitCycle+1, dispatchCycle);
 
                     Address addr = storeAddrs[storeIdx++];
+                    if (unlikely(zinfo->memSampler != nullptr)) zinfo->memSampler->setPC(getEventRecorder()->getSourceId(), storePCs[storeIdx-1]);
                     uint64_t reqSatisfiedCycle = l1d->store(addr, dispatchCycle) + L1D_LAT;
                     cRec.record(curCycle, dispatchCycle, reqSatisfiedCycle);
 
@@ -504,7 +510,7 @@ void OOOCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
     core->bbl(bblAddr, bblInfo);
 
     while (core->curCycle > core->phaseEndCycle) {
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
 
         uint32_t cid = getCid(tid);
         // NOTE: TakeBarrier may take ownership of the core, and so it will be used by some other thread. If TakeBarrier context-switches us,
@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <queue>
 #include <string>
+#include "contention_sim.h"
 #include "core.h"
 #include "g_std/g_multimap.h"
 #include "memory_hierarchy.h"
@@ -358,7 +359,7 @@ class CycleQueue {
 
 struct BblInfo;
 
-class OOOCore : public Core {
+class OOOCore : public Core, public WeavePhaseClient {
     private:
         FilterCache* l1i;
         FilterCache* l1d;
@@ -373,6 +374,8 @@ class OOOCore : public Core {
         //Record load and store addresses
         Address loadAddrs[256];
         Address storeAddrs[256];
+        Address loadPCs[256];  // only with sim.memSampling, which samples accesses by PC
+        Address storePCs[256];
         uint32_t loads;
         uint32_t stores;
 
@@ -25,6 +25,7 @@
 
 #include "ooo_core_recorder.h"
 #include <string>
+#include "contention_sim.h"
 #include "timing_event.h"
 #include "zsim.h"
 
@@ -120,6 +121,22 @@ OOOCoreRecorder::OOOCoreRecorder(uint32_t _domain, g_string& _name)
 
 
 uint64_t OOOCoreRecorder::notifyJoin(uint64_t curCycle) {
+    if (state == DRAINING && zinfo->contentionSim->isPipelined()) {
+        // The weave phase in flight may be simulating (and freeing) our last events
+        zinfo->contentionSim->waitForWeave();
+        if (!lastEvProduced) {
+            // Fully drained; do what cSimEnd() would, and leave it no skew to apply
+            uint64_t lastEvCycle1 = lastEvSimulatedZllStartCycle + gapCycles;
+            uint64_t lastEvCycle2 = lastEvSimulatedStartCycle;
+            if (unlikely(lastEvCycle1 > lastEvCycle2)) panic("[%s] Contention simulation introduced a negative skew, lc1 %ld lc2 %ld", name.c_str(), lastEvCycle1, lastEvCycle2);
+            gapCycles += lastEvCycle2 - lastEvCycle1;
+            lastUnhaltedCycle = lastEvSimulatedStartCycle;
+            state = HALTED;
+            assert(futureResponses.empty());
+            DEBUG_MSG("[%s] lastEvSimulated reached during pipelined weave, DRAINING -> HALTED", name.c_str());
+        }
+    }
+
     if (state == HALTED) {
         assert(!lastEvProduced);
         curCycle = zinfo->globPhaseCycles; //start at beginning of the phase
@@ -135,6 +152,7 @@ uint64_t OOOCoreRecorder::notifyJoin(uint64_t curCycle) {
         lastEvProduced->setMinStartCycle(curCycle);
         lastEvProduced->queue(curCycle);
         eventRecorder.setStartSlack(0);
+        lastEvSimulatedZllStartCycle = lastEvSimulatedStartCycle - gapCycles;  // no skew until our new events are simulated
         DEBUG_MSG("[%s] Joined, was HALTED, curCycle %ld halted %ld", name.c_str(), curCycle, totalHaltedCycles);
     } else if (state == DRAINING) {
         assert(curCycle >= zinfo->globPhaseCycles); //should not have gone out of sync...
@@ -298,6 +316,14 @@ uint64_t OOOCoreRecorder::cSimStart(uint64_t curCycle) {
         while (!futureResponses.empty()) futureResponses.pop();
         if (curCycle < nextPhaseCycle) curCycle = nextPhaseCycle; // bring cycle up
     }
+
+    if (zinfo->contentionSim->isPipelined()) {
+        // Responses may be simulated and freed while the next bound phase
+        // runs, so we can't link to them. Issues in the next phase won't wait
+        // on misses still outstanding at the phase boundary; this is the main
+        // accuracy loss of pipelined weave phases with OOO cores.
+        for (FutureResponse& fr : GetPrioQueueContainer(futureResponses)) fr.ev = nullptr;
+    }
     return curCycle;
 }
 
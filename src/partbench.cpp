@@ -0,0 +1,223 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks the lookahead and peekahead partitioning algorithms against each
+ * other, and checks that they produce the same allocations. Miss curves are
+ * either synthetic or recorded by a simulation run with repl.dumpCurves = true.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "galloc.h"
+#include "log.h"
+#include "mtrand.h"
+#include "partitioner.h"
+#include "profile_stats.h"  // for getNs()
+
+// Miss curves from memory, in the same layout UMonMonitor exposes
+class StaticMonitor : public PartitionMonitor {
+    private:
+        uint32_t numPartitions;
+        std::vector<uint32_t> curves;  // numPartitions x (buckets+1)
+
+    public:
+        StaticMonitor(uint32_t _numPartitions, uint32_t _buckets)
+            : PartitionMonitor(_buckets), numPartitions(_numPartitions), curves(_numPartitions*(_buckets+1), 0) {}
+
+        uint32_t getNumPartitions() const { return numPartitions; }
+        void access(uint32_t partition, Address lineAddr) { panic("StaticMonitor is read-only"); }
+        uint32_t get(uint32_t partition, uint32_t bucket) const { return curves[partition*(buckets+1) + bucket]; }
+        uint32_t getNumAccesses(uint32_t partition) const { return get(partition, 0); }
+        void reset() {}
+
+        uint32_t* curve(uint32_t partition) { return &curves[partition*(buckets+1)]; }
+
+        // Both algorithms assume miss curves don't grow with size
+        bool isMonotonic() const {
+            for (uint32_t p = 0; p < numPartitions; p++) {
+                for (uint32_t b = 0; b < buckets; b++) {
+                    if (get(p, b+1) > get(p, b)) return false;
+                }
+            }
+            return true;
+        }
+};
+
+// A mix of the shapes we see from UMONs: smooth convex, cliffs (streaming
+// apps that fit at some size), plateaus, and cache-insensitive apps
+static StaticMonitor* genSyntheticCurves(uint32_t numPartitions, uint32_t buckets, MTRand& rng) {
+    StaticMonitor* mon = new StaticMonitor(numPartitions, buckets);
+    for (uint32_t p = 0; p < numPartitions; p++) {
+        uint32_t* c = mon->curve(p);
+        double accs = 1e4 + rng.randInt(1e6);
+        switch (p % 4) {
+            case 0: {  // convex
+                double decay = 0.5 + 20.0*rng.rand();
+                double floor = accs*0.1*rng.rand();
+                for (uint32_t b = 0; b <= buckets; b++) c[b] = floor + (accs-floor)*exp(-decay*b/buckets);
+                break;
+            }
+            case 1: {  // cliffs
+                uint32_t cliffs = 1 + rng.randInt(3);
+                double misses = accs;
+                uint32_t cliffPos[cliffs];
+                for (uint32_t i = 0; i < cliffs; i++) cliffPos[i] = 1 + rng.randInt(buckets-1);
+                for (uint32_t b = 0; b <= buckets; b++) {
+                    for (uint32_t i = 0; i < cliffs; i++) if (cliffPos[i] == b) misses *= 0.2 + 0.5*rng.rand();
+                    c[b] = misses;
+                }
+                break;
+            }
+            case 2: {  // random steps
+                double misses = accs;
+                for (uint32_t b = 0; b <= buckets; b++) {
+                    c[b] = misses;
+                    misses -= misses*0.05*rng.rand()*(rng.randInt(3) == 0);
+                }
+                break;
+            }
+            default: {  // insensitive, with a little noise at small sizes
+                for (uint32_t b = 0; b <= buckets; b++) c[b] = accs - ((b < 4)? 0 : rng.randInt(10));
+                for (uint32_t b = 1; b <= buckets; b++) c[b] = std::min(c[b], c[b-1]);
+            }
+        }
+    }
+    return mon;
+}
+
+// Reads the blocks written by LookaheadPartitioner::dumpCurves
+static std::vector<StaticMonitor*> readCurves(const char* file) {
+    std::vector<StaticMonitor*> res;
+    std::ifstream in(file);
+    if (!in.good()) panic("Could not open %s", file);
+    uint32_t numPartitions, buckets;
+    while (in >> numPartitions >> buckets) {
+        StaticMonitor* mon = new StaticMonitor(numPartitions, buckets);
+        for (uint32_t p = 0; p < numPartitions; p++) {
+            uint32_t* c = mon->curve(p);
+            for (uint32_t b = 0; b <= buckets; b++) in >> c[b];
+        }
+        if (!in.good()) panic("%s: truncated miss curves block %ld", file, res.size());
+        res.push_back(mon);
+    }
+    return res;
+}
+
+typedef void (*PartitionFunc)(uint32_t, uint32_t, uint32_t, bool*, uint32_t*, const PartitionMonitor&);
+
+// Returns ns per partitioning
+static double run(PartitionFunc func, const std::vector<StaticMonitor*>& mons, uint32_t reps, std::vector<uint32_t>& allocs) {
+    uint64_t startNs = getNs();
+    for (uint32_t r = 0; r < reps; r++) {
+        uint32_t* a = allocs.data();
+        for (StaticMonitor* mon : mons) {
+            // Same parameters as LookaheadPartitioner with the default minAlloc and allocPortion
+            uint32_t np = mon->getNumPartitions();
+            func(np, mon->getBuckets(), np, nullptr, a, *mon);
+            a += np;
+        }
+    }
+    return ((double)(getNs() - startNs))/(reps*mons.size());
+}
+
+static void usage(const char* argv0) {
+    info("Benchmarks lookahead vs peekahead partitioning");
+    info("Usage: %s [-p partitions] [-b buckets] [-n curveSets] [-r reps] [-s seed] [curvesFile]", argv0);
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog("");  // no log header
+
+    uint32_t numPartitions = 64;
+    uint32_t buckets = 256;
+    uint32_t sets = 16;
+    uint32_t reps = 10;
+    uint32_t seed = 42;
+    const char* curvesFile = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            if (i + 1 >= argc || strlen(argv[i]) != 2) usage(argv[0]);
+            uint32_t v = strtoul(argv[++i], nullptr, 0);
+            switch (argv[i-1][1]) {
+                case 'p': numPartitions = v; break;
+                case 'b': buckets = v; break;
+                case 'n': sets = v; break;
+                case 'r': reps = v; break;
+                case 's': seed = v; break;
+                default: usage(argv[0]);
+            }
+        } else {
+            if (curvesFile) usage(argv[0]);
+            curvesFile = argv[i];
+        }
+    }
+
+    gm_init(32<<20 /*32 MB, should be enough*/);
+
+    std::vector<StaticMonitor*> mons;
+    if (curvesFile) {
+        mons = readCurves(curvesFile);
+        if (mons.empty()) panic("No miss curves in %s", curvesFile);
+        info("Read %ld partitionings (%d partitions, %d buckets) from %s", mons.size(),
+                mons[0]->getNumPartitions(), mons[0]->getBuckets(), curvesFile);
+    } else {
+        if (buckets < numPartitions + 1) panic("Need more buckets (%d) than partitions (%d)", buckets, numPartitions);
+        MTRand rng(seed);
+        for (uint32_t i = 0; i < sets; i++) mons.push_back(genSyntheticCurves(numPartitions, buckets, rng));
+        info("Generated %ld synthetic partitionings (%d partitions, %d buckets)", mons.size(), numPartitions, buckets);
+    }
+
+    uint32_t totalPartitions = 0;
+    for (StaticMonitor* mon : mons) {
+        if (!mon->isMonotonic()) warn("Miss curves are not monotonic, results may differ");
+        totalPartitions += mon->getNumPartitions();
+    }
+
+    std::vector<uint32_t> lookaheadAllocs(totalPartitions);
+    std::vector<uint32_t> peekaheadAllocs(totalPartitions);
+
+    double lookaheadNs = run(lookahead::computeBestPartitioning, mons, reps, lookaheadAllocs);
+    double peekaheadNs = run(peekahead::computeBestPartitioning, mons, reps, peekaheadAllocs);
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < totalPartitions; i++) mismatches += lookaheadAllocs[i] != peekaheadAllocs[i];
+
+    info("Lookahead: %12.1f ns/partitioning", lookaheadNs);
+    info("Peekahead: %12.1f ns/partitioning (%.1fx)", peekaheadNs, lookaheadNs/peekaheadNs);
+    if (mismatches) {
+        info("MISMATCH: %d of %d allocations differ", mismatches, totalPartitions);
+        return 1;
+    }
+    info("Allocations match");
+    return 0;
+}
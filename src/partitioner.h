@@ -26,7 +26,9 @@
 #ifndef PARTITIONER_H_
 #define PARTITIONER_H_
 
+#include <sys/types.h>
 #include "event_queue.h"
+#include "g_std/g_string.h"
 #include "g_std/g_vector.h"
 #include "galloc.h"
 #include "memory_hierarchy.h"
@@ -56,11 +58,23 @@ class Partitioner : public GlobAlloc {
         bool* forbidden;
 };
 
+class PartitionMonitor;
+
 // Gives best partition sizes as estimated with the greedy lookahead
 // algorithm proposed in the UCP paper (Qureshi and Patt, ISCA 2006)
 namespace lookahead {
-    uint64_t computePartitioningTotalUtility(uint32_t numPartitions, const uint32_t* parts, const uint32_t* missCurves);
-    void computeBestPartitioning(uint32_t numPartitions, uint32_t* allocs, uint32_t* missCurves);
+    uint64_t computePartitioningTotalUtility(uint32_t numPartitions, const uint32_t* parts, const PartitionMonitor& monitor);
+    void computeBestPartitioning(uint32_t numPartitions, uint32_t buckets, uint32_t minAlloc, bool* forbidden,
+                                 uint32_t* allocs, const PartitionMonitor& monitor);
+}
+
+// Same allocations as lookahead, but computed from the lower convex hull of
+// each miss curve (Peekahead, Beckmann and Sanchez, PACT 2013). This is
+// O(P*B + B*log(P)) instead of O(P*B^2). Miss curves must be non-increasing,
+// which UMONs guarantee.
+namespace peekahead {
+    void computeBestPartitioning(uint32_t numPartitions, uint32_t buckets, uint32_t minAlloc, bool* forbidden,
+                                 uint32_t* allocs, const PartitionMonitor& monitor);
 }
 
 class LookaheadPartitioner : public Partitioner {
@@ -69,11 +83,33 @@ class LookaheadPartitioner : public Partitioner {
                              uint32_t _minAlloc = 1, double _allocPortion = 1.0, bool* _forbidden = nullptr);
         void partition();
 
-    private:
-        PartReplPolicy* repl;
+        // If set, appends the miss curves used on every partitioning to this file (e.g., to feed partbench)
+        void setCurvesFile(const char* file);
+
+    protected:
+        virtual void computeBestPartitioning(uint32_t* allocs, const PartitionMonitor& monitor);
+
         uint32_t numPartitions;
         uint32_t buckets;
+
+    private:
+        void dumpCurves(const PartitionMonitor& monitor);
+
+        PartReplPolicy* repl;
         uint32_t* curAllocs;
+        g_string curvesFile;
+        int curvesFd;  // -1 unless dumping curves
+        pid_t curvesPid;  // curvesFd is only valid in the process that opened it
+};
+
+class PeekaheadPartitioner : public LookaheadPartitioner {
+    public:
+        PeekaheadPartitioner(PartReplPolicy* _repl, uint32_t _numPartitions, uint32_t _buckets,
+                             uint32_t _minAlloc = 1, double _allocPortion = 1.0, bool* _forbidden = nullptr)
+            : LookaheadPartitioner(_repl, _numPartitions, _buckets, _minAlloc, _allocPortion, _forbidden) {}
+
+    protected:
+        void computeBestPartitioning(uint32_t* allocs, const PartitionMonitor& monitor);
 };
 
 // *********************************************************************
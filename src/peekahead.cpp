@@ -0,0 +1,145 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <queue>
+#include <vector>
+#include "partitioner.h"
+
+/* Peekahead: each lookahead step picks, for every partition, the allocation
+ * increment with the maximum marginal utility (misses saved per bucket). That
+ * increment always ends at the next vertex of the lower convex hull of the
+ * partition's miss curve, so we compute each hull once and walk it, keeping
+ * the partitions in a max-heap keyed by the utility of their next hull segment.
+ *
+ * To match lookahead exactly:
+ *  - Hulls keep collinear points, so we pick the smallest increment among ties
+ *    (as lookahead does).
+ *  - Utilities are computed with the same double expression as lookahead, and
+ *    ties between partitions are broken in favor of the lowest partition id.
+ *    Hulls are built with exact integer cross products; for 32-bit miss counts
+ *    and < 2^20 buckets, different slopes never round to the same double.
+ *  - Lookahead caps the increment at the remaining balance. A heap entry whose
+ *    next hull vertex is past the balance is stale (its utility can only be
+ *    higher than the capped one), so when one reaches the top, we rebuild that
+ *    partition's hull over [alloc, alloc+balance] and requeue it. Since
+ *    alloc+balance never grows for any partition, a rebuilt hull stays valid.
+ */
+namespace peekahead {
+
+struct HeapEntry {
+    double mu;
+    uint32_t part;
+
+    bool operator<(const HeapEntry& other) const {
+        // std::priority_queue pops the largest; on equal mu, the lowest id is the largest
+        return (mu < other.mu) || (mu == other.mu && part > other.part);
+    }
+};
+
+// Lower convex hull of points (x, misses[x]) for x in [start, end], left to right
+static void computeHull(const uint32_t* misses, uint32_t start, uint32_t end, std::vector<uint32_t>& hull) {
+    hull.clear();
+    for (uint32_t x = start; x <= end; x++) {
+        while (hull.size() >= 2) {
+            uint32_t x0 = hull[hull.size()-2];
+            uint32_t x1 = hull[hull.size()-1];
+            // Pop x1 only if it's strictly above the x0->x segment (keep collinear points)
+            int64_t cross = ((int64_t)(x1 - x0))*((int64_t)misses[x] - misses[x0]) -
+                            ((int64_t)misses[x1] - misses[x0])*((int64_t)(x - x0));
+            if (cross >= 0) break;
+            hull.pop_back();
+        }
+        hull.push_back(x);
+    }
+}
+
+// Same expression as lookahead::getMaxMarginalUtility
+static inline double marginalUtility(const uint32_t* misses, uint32_t from, uint32_t to) {
+    uint64_t extraHits = misses[from] - misses[to];
+    return ((double)extraHits)/((double)(to - from));
+}
+
+void computeBestPartitioning(
+    uint32_t numPartitions, uint32_t buckets, uint32_t minAlloc, bool* forbidden,
+    uint32_t* allocs, const PartitionMonitor& monitor) {
+    uint32_t balance = buckets;
+
+    for (uint32_t i = 0; i < numPartitions; i++) {
+        allocs[i] = minAlloc;
+    }
+
+    balance -= minAlloc;
+    if (balance == 0) return;
+
+    // Copy the reachable part of each miss curve once, monitor.get() is virtual and may be slow
+    uint32_t end = minAlloc + balance;
+    std::vector<uint32_t> curves(numPartitions*(end+1));
+    std::vector< std::vector<uint32_t> > hulls(numPartitions);
+    std::vector<uint32_t> hullPos(numPartitions, 0);  // index of the current alloc in hulls[p]
+    std::priority_queue<HeapEntry> heap;
+
+    for (uint32_t p = 0; p < numPartitions; p++) {
+        if (forbidden && forbidden[p]) continue;
+        uint32_t* misses = &curves[p*(end+1)];
+        for (uint32_t x = minAlloc; x <= end; x++) misses[x] = monitor.get(p, x);
+        computeHull(misses, allocs[p], end, hulls[p]);
+        assert(hulls[p].size() >= 2);
+        heap.push({marginalUtility(misses, allocs[p], hulls[p][1]), p});
+    }
+
+    while (balance > 0) {
+        assert(!heap.empty());
+        HeapEntry e = heap.top();
+        heap.pop();
+
+        uint32_t p = e.part;
+        const uint32_t* misses = &curves[p*(end+1)];
+        uint32_t next = hulls[p][hullPos[p] + 1];
+        if (next - allocs[p] > balance) {
+            // Stale, rebuild over what's still reachable
+            computeHull(misses, allocs[p], allocs[p] + balance, hulls[p]);
+            hullPos[p] = 0;
+            heap.push({marginalUtility(misses, allocs[p], hulls[p][1]), p});
+            continue;
+        }
+
+        balance -= next - allocs[p];
+        allocs[p] = next;
+        hullPos[p]++;
+        if (balance && hullPos[p] + 1 < hulls[p].size()) {
+            heap.push({marginalUtility(misses, allocs[p], hulls[p][hullPos[p] + 1]), p});
+        }
+    }
+}
+
+}  // namespace peekahead
+
+// PeekaheadPartitioner
+
+void PeekaheadPartitioner::computeBestPartitioning(uint32_t* allocs, const PartitionMonitor& monitor) {
+    peekahead::computeBestPartitioning(
+        numPartitions, allocPortion*buckets, minAlloc*numPartitions,
+        forbidden, allocs, monitor);
+}
@@ -0,0 +1,139 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "phase_length_ctrl.h"
+#include <algorithm>
+#include <string.h>
+#include "bithacks.h"
+#include "config.h"
+#include "event_recorder.h"
+#include "log.h"
+#include "zsim.h"
+
+#define LENGTH_BUCKETS 32
+
+PhaseLengthController::PhaseLengthController(Config& config, uint32_t initialLength) {
+    minLength = config.get<uint32_t>("sim.phaseLengthCtrl.min", std::max(initialLength/10, 100u));
+    maxLength = config.get<uint32_t>("sim.phaseLengthCtrl.max", initialLength*10);
+    highInteraction = config.get<double>("sim.phaseLengthCtrl.highInteraction", 2.0);
+    lowInteraction = config.get<double>("sim.phaseLengthCtrl.lowInteraction", 0.2);
+    highGap = config.get<double>("sim.phaseLengthCtrl.highGap", 0.05);
+    lowGap = config.get<double>("sim.phaseLengthCtrl.lowGap", 0.005);
+
+    if (minLength == 0 || minLength > initialLength || maxLength < initialLength) {
+        panic("sim.phaseLengthCtrl: need 0 < min (%d) <= sim.phaseLength (%d) <= max (%d)", minLength, initialLength, maxLength);
+    }
+    if (lowInteraction > highInteraction || lowGap > highGap) {
+        panic("sim.phaseLengthCtrl: low thresholds must not exceed high thresholds");
+    }
+
+    lastInvs = 0;
+    lastCrossings = 0;
+    lastGapCycles = 0;
+}
+
+// Appends every scalar stat named name under s (the tree is still mutable)
+static void FindScalarStats(AggregateStat* s, const char* name, g_vector<ScalarStat*>& res) {
+    for (uint32_t i = 0; i < s->curSize(); i++) {
+        Stat* c = s->get(i);
+        if (AggregateStat* as = dynamic_cast<AggregateStat*>(c)) {
+            FindScalarStats(as, name, res);
+        } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(c)) {
+            if (strcmp(ss->name(), name) == 0) res.push_back(ss);
+        }
+    }
+}
+
+void PhaseLengthController::initStats(AggregateStat* parentStat) {
+    FindScalarStats(parentStat, "INV", invStats);
+    FindScalarStats(parentStat, "INVX", invStats);
+    FindScalarStats(parentStat, "cCycles", gapStats);
+    info("Adaptive phase length: [%d, %d] cycles, %ld invalidation and %ld contention cycle counters",
+            minLength, maxLength, invStats.size(), gapStats.size());
+
+    AggregateStat* ctrlStat = new AggregateStat();
+    ctrlStat->init("phaseLength", "Adaptive phase length stats");
+    profShrinks.init("shrinks", "Phase length decreases");
+    profGrows.init("grows", "Phase length increases");
+    profLengthPhases.init("phases", "Phases by length, bucket i is [2^i, 2^(i+1)) cycles", LENGTH_BUCKETS);
+    profLengthCycles.init("cycles", "Cycles by phase length, bucket i is [2^i, 2^(i+1)) cycles", LENGTH_BUCKETS);
+    auto curLength = []() { return (uint64_t)zinfo->phaseLength; };
+    auto curLengthStat = makeLambdaStat(curLength);
+    curLengthStat->init("cur", "Current phase length");
+    ctrlStat->append(&profShrinks);
+    ctrlStat->append(&profGrows);
+    ctrlStat->append(&profLengthPhases);
+    ctrlStat->append(&profLengthCycles);
+    ctrlStat->append(curLengthStat);
+    parentStat->append(ctrlStat);
+}
+
+uint64_t PhaseLengthController::sumStats(const g_vector<ScalarStat*>& stats) const {
+    uint64_t res = 0;
+    for (ScalarStat* s : stats) res += s->get();
+    return res;
+}
+
+uint64_t PhaseLengthController::sumCrossings() const {
+    uint64_t res = 0;
+    for (uint32_t i = 0; i < zinfo->numCores; i++) {
+        if (zinfo->eventRecorders[i]) res += zinfo->eventRecorders[i]->getCrossings();
+    }
+    return res;
+}
+
+void PhaseLengthController::endPhase() {
+    uint32_t length = zinfo->phaseLength;  // of the phase that just ended
+    uint32_t bucket = std::min(ilog2(length), (uint32_t)LENGTH_BUCKETS - 1);
+    profLengthPhases.inc(bucket);
+    profLengthCycles.inc(bucket, length);
+
+    uint64_t invs = sumStats(invStats);
+    uint64_t crossings = sumCrossings();
+    uint64_t gapCycles = sumStats(gapStats);
+
+    // NOTE: With pipelined weave phases, gap cycles lag by a phase
+    double coreKCycles = ((double)length)*std::max(zinfo->numCores, 1u)/1000.0;
+    double interaction = (invs - lastInvs + crossings - lastCrossings)/coreKCycles;
+    double gap = (gapCycles - lastGapCycles)/(coreKCycles*1000.0);
+
+    lastInvs = invs;
+    lastCrossings = crossings;
+    lastGapCycles = gapCycles;
+
+    // Decide the length of the phase after the next one (see header)
+    uint32_t cur = zinfo->nextPhaseLength;
+    uint32_t next = cur;
+    if (interaction > highInteraction || gap > highGap) {
+        next = std::max(cur/2, minLength);
+        if (next != cur) profShrinks.inc();
+    } else if (interaction < lowInteraction && gap < lowGap) {
+        next = std::min(cur + std::max(cur/4, 1u), maxLength);
+        if (next != cur) profGrows.inc();
+    }
+
+    zinfo->phaseLength = cur;
+    zinfo->nextPhaseLength = next;
+}
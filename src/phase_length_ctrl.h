@@ -0,0 +1,85 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHASE_LENGTH_CTRL_H_
+#define PHASE_LENGTH_CTRL_H_
+
+#include <stdint.h>
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "stats.h"
+
+class Config;
+
+/* Adapts the phase length (sim.adaptivePhaseLength) to how much cores
+ * interact. Short phases bound the skew between cores, but each phase pays
+ * for a barrier, event queue ticks and a weave phase; long phases are cheap
+ * but inaccurate when cores interact a lot. Every phase, we measure
+ * interaction as coherence invalidations and downgrades plus weave domain
+ * crossings per 1K core-cycles, and contention as the fraction of cycles
+ * cores spent in gap (contention) cycles. If either is high, we halve the
+ * phase length; if both are low, we grow it by 25%; always within
+ * [min, max].
+ *
+ * Threads compute the end of their next phase before they reach the barrier,
+ * so lengths are decided one phase ahead: the decision taken at the end of
+ * phase N applies to phase N+2. zinfo->phaseLength is the length of the
+ * current phase and zinfo->nextPhaseLength that of the next one.
+ */
+class PhaseLengthController : public GlobAlloc {
+    private:
+        uint32_t minLength;
+        uint32_t maxLength;
+        double highInteraction, lowInteraction;  // events per 1K core-cycles
+        double highGap, lowGap;  // fraction of core-cycles
+
+        g_vector<ScalarStat*> invStats;  // cache invalidations and downgrades
+        g_vector<ScalarStat*> gapStats;  // core contention cycles
+
+        uint64_t lastInvs;
+        uint64_t lastCrossings;
+        uint64_t lastGapCycles;
+
+        Counter profShrinks, profGrows;
+        VectorCounter profLengthPhases, profLengthCycles;  // by log2(length) bucket
+
+    public:
+        PhaseLengthController(Config& config, uint32_t initialLength);
+
+        // Call after the memory hierarchy and cores have their stats
+        void initStats(AggregateStat* parentStat);
+
+        // Called by the phase accounting code, fully synchronized, after
+        // globPhaseCycles has advanced past the phase that just ended
+        void endPhase();
+
+        uint32_t getMaxLength() const {return maxLength;}
+
+    private:
+        uint64_t sumStats(const g_vector<ScalarStat*>& stats) const;
+        uint64_t sumCrossings() const;
+};
+
+#endif  // PHASE_LENGTH_CTRL_H_
@@ -24,11 +24,72 @@
  */
 
 #include "prefetcher.h"
+#include <emmintrin.h>  // NOLINT
 #include "bithacks.h"
+#include "pad.h"
 
 //#define DBG(args...) info(args)
 #define DBG(args...)
 
+StreamPrefetcher::StreamPrefetcher(const g_string& _name, uint32_t _numEntries, uint32_t _pageLines)
+    : numEntries(_numEntries), pageBits(ilog2(_pageLines)), timestamp(0), name(_name)
+{
+    if (numEntries == 0) panic("%s: need at least one stream entry", name.c_str());
+    if (!isPow2(_pageLines) || _pageLines < 2 || _pageLines > 256) {
+        panic("%s: page lines (%d) must be a power of 2 in [2, 256]", name.c_str(), _pageLines);
+    }
+
+    uint32_t paddedEntries = (numEntries + 1) & ~1;
+    tags = gm_memalign<Address>(CACHE_LINE_BYTES, paddedEntries);
+    lastCycles = gm_memalign<uint64_t>(CACHE_LINE_BYTES, numEntries);
+    tss = gm_memalign<uint64_t>(CACHE_LINE_BYTES, numEntries);
+    static_assert(CACHE_LINE_BYTES % alignof(Entry) == 0, "Entries need a 16B-aligned array");
+    array = gm_memalign<Entry>(CACHE_LINE_BYTES, numEntries);
+    for (uint32_t i = 0; i < paddedEntries; i++) tags[i] = -1L;  // pageAddrs never have the top bits set
+    for (uint32_t i = 0; i < numEntries; i++) {
+        lastCycles[i] = 0;
+        tss[i] = 0;
+        array[i].alloc();
+    }
+}
+
+int32_t StreamPrefetcher::Entry::findPrefetch(uint32_t pos) const {
+    __m128i eq = _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)pfPos), _mm_set1_epi8(pos));
+    uint32_t matches = _mm_movemask_epi8(eq) & pfValid;
+    return matches? __builtin_ctz(matches) : -1;  // at most one valid slot per pos
+}
+
+uint32_t StreamPrefetcher::findEntry(Address pageAddr) const {
+    // Compare two tags at a time; a 64-bit compare is two 32-bit ones (SSE2 has no pcmpeqq).
+    // No control dependences within each 64-entry chunk; tags are unique, so stop at the first match
+    __m128i key = _mm_set1_epi64x(pageAddr);
+    for (uint32_t base = 0; base < numEntries; base += 64) {
+        uint32_t end = MIN(base + 64, numEntries);
+        uint64_t matches = 0;
+        for (uint32_t i = base; i < end; i += 2) {
+            __m128i eq = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)&tags[i]), key);
+            eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            matches |= ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(eq))) << (i - base);
+        }
+        if (matches) return base + __builtin_ctzl(matches);
+    }
+    return numEntries;
+}
+
+uint32_t StreamPrefetcher::findVictim(uint64_t reqCycle) const {
+    // LRU among entries without warm prefetches. Branch-free so the compiler can keep this in registers;
+    // ineligible entries get the max score, which, as before, never wins
+    uint32_t cand = numEntries;
+    uint64_t candScore = -1;
+    for (uint32_t i = 0; i < numEntries; i++) {
+        uint64_t score = (lastCycles[i] > reqCycle + 500)? -1 : tss[i];
+        bool better = score < candScore;
+        cand = better? i : cand;
+        candScore = better? score : candScore;
+    }
+    return cand;
+}
+
 void StreamPrefetcher::setParents(uint32_t _childId, const g_vector<MemObject*>& parents, Network* network) {
     childId = _childId;
     if (parents.size() != 1) panic("Must have one parent");
@@ -67,59 +128,42 @@ uint64_t StreamPrefetcher::access(MemReq& req) {
     uint64_t reqCycle = req.cycle;
     uint64_t respCycle = parent->access(req);
 
-    Address pageAddr = req.lineAddr >> 6;
-    uint32_t pos = req.lineAddr & (64-1);
-    uint32_t idx = 16;
-    // This loop gets unrolled and there are no control dependences. Way faster than a break (but should watch for the avoidable loop-carried dep)
-    for (uint32_t i = 0; i < 16; i++) {
-        bool match = (pageAddr == tag[i]);
-        idx = match?  i : idx;  // ccmov, no branch
-    }
+    Address pageAddr = req.lineAddr >> pageBits;
+    uint32_t pageLines = 1 << pageBits;
+    uint32_t pos = req.lineAddr & (pageLines-1);
+    uint32_t idx = findEntry(pageAddr);
 
     DBG("%s: 0x%lx page %lx pos %d", name.c_str(), req.lineAddr, pageAddr, pos);
 
-    if (idx == 16) {  // entry miss
-        uint32_t cand = 16;
-        uint64_t candScore = -1;
-        //uint64_t candScore = 0;
-        for (uint32_t i = 0; i < 16; i++) {
-            if (array[i].lastCycle > reqCycle + 500) continue;  // warm prefetches, not even a candidate
-            /*uint64_t score = (reqCycle - array[i].lastCycle)*(3 - array[i].conf.counter());
-            if (score > candScore) {
-                cand = i;
-                candScore = score;
-            }*/
-            if (array[i].ts < candScore) {  // just LRU
-                cand = i;
-                candScore = array[i].ts;
-            }
-        }
-
-        if (cand < 16) {
+    if (idx == numEntries) {  // entry miss
+        uint32_t cand = findVictim(reqCycle);
+        if (cand < numEntries) {
             idx = cand;
-            array[idx].alloc(reqCycle);
+            array[idx].alloc();
             array[idx].lastPos = pos;
-            array[idx].ts = timestamp++;
-            tag[idx] = pageAddr;
+            lastCycles[idx] = reqCycle;
+            tss[idx] = timestamp++;
+            tags[idx] = pageAddr;
         }
         DBG("%s: MISS alloc idx %d", name.c_str(), idx);
     } else {  // entry hit
         profPageHits.inc();
         Entry& e = array[idx];
-        array[idx].ts = timestamp++;
+        tss[idx] = timestamp++;
         DBG("%s: PAGE HIT idx %d", name.c_str(), idx);
 
         // 1. Did we prefetch-hit?
         bool shortPrefetch = false;
-        if (e.valid[pos]) {
-            uint64_t pfRespCycle = e.times[pos].respCycle;
+        int32_t slot = e.findPrefetch(pos);
+        if (slot >= 0) {
+            uint64_t pfRespCycle = e.pfRespCycle[slot];
             shortPrefetch = pfRespCycle > respCycle;
-            e.valid[pos] = false;  // close, will help with long-lived transactions
+            e.clearPrefetch(slot);  // close, will help with long-lived transactions
             respCycle = MAX(pfRespCycle, respCycle);
-            e.lastCycle = MAX(respCycle, e.lastCycle);
+            lastCycles[idx] = MAX(respCycle, lastCycles[idx]);
             profHits.inc();
             if (shortPrefetch) profShortHits.inc();
-            DBG("%s: pos %d prefetched on %ld, pf resp %ld, demand resp %ld, short %d", name.c_str(), pos, e.times[pos].startCycle, pfRespCycle, respCycle, shortPrefetch);
+            DBG("%s: pos %d prefetched, pf resp %ld, demand resp %ld, short %d", name.c_str(), pos, pfRespCycle, respCycle, shortPrefetch);
         }
 
         // 2. Update predictors, issue prefetches
@@ -136,20 +180,18 @@ uint64_t StreamPrefetcher::access(MemReq& req) {
                 }
                 DBG("%s: pos %d stride %d conf %d lastPrefetchPos %d prefetchPos %d fetchDepth %d", name.c_str(), pos, stride, e.conf.counter(), e.lastPrefetchPos, prefetchPos, fetchDepth);
 
-                if (prefetchPos < 64 && !e.valid[prefetchPos]) {
+                if (prefetchPos < pageLines && e.findPrefetch(prefetchPos) < 0) {
                     MESIState state = I;
                     MemReq pfReq = {req.lineAddr + prefetchPos - pos, GETS, req.childId, &state, reqCycle, req.childLock, state, req.srcId, MemReq::PREFETCH};
                     uint64_t pfRespCycle = parent->access(pfReq);  // FIXME, might segfault
-                    e.valid[prefetchPos] = true;
-                    e.times[prefetchPos].fill(reqCycle, pfRespCycle);
+                    e.addPrefetch(prefetchPos, pfRespCycle);
                     profPrefetches.inc();
 
-                    if (shortPrefetch && fetchDepth < 8 && prefetchPos + stride < 64 && !e.valid[prefetchPos + stride]) {
+                    if (shortPrefetch && fetchDepth < 8 && prefetchPos + stride < pageLines && e.findPrefetch(prefetchPos + stride) < 0) {
                         prefetchPos += stride;
                         pfReq.lineAddr += stride;
                         pfRespCycle = parent->access(pfReq);
-                        e.valid[prefetchPos] = true;
-                        e.times[prefetchPos].fill(reqCycle, pfRespCycle);
+                        e.addPrefetch(prefetchPos, pfRespCycle);
                         profPrefetches.inc();
                         profDoublePrefetches.inc();
                     }
@@ -26,7 +26,7 @@
 #ifndef PREFETCHER_H_
 #define PREFETCHER_H_
 
-#include <bitset>
+#include <stddef.h>
 #include "bithacks.h"
 #include "g_std/g_string.h"
 #include "memory_hierarchy.h"
@@ -54,46 +54,69 @@ class SatCounter {
  * but (a) no up/down distinction, and (b) strided operation based on dominant stride detection
  * to try to subsume as much of the L1 IP/strided prefetcher as possible.
  *
- * FIXME: For now, mostly hardcoded; 64-line entries (4KB w/64-byte lines), fixed granularities, etc.
+ * The number of stream entries and the page (entry) granularity are configurable; defaults are 16
+ * entries of 64 lines (4KB w/64-byte lines). Tags are kept apart from entries and matched with
+ * SSE2, and each entry tracks its in-flight prefetches in a small ring instead of one slot per line,
+ * so large tables (64-256 entries) stay cheap.
+ *
  * TODO: Adapt to use weave models
  */
 class StreamPrefetcher : public BaseCache {
     private:
+        // In-flight prefetches tracked per entry. If a stream has more unclaimed prefetches than this,
+        // the oldest is forgotten (a later demand access to it just misses in the prefetcher)
+        static const uint32_t PF_SLOTS = 16;
+
         struct Entry {
+            // Positions and response cycles of in-flight prefetches; slot i is valid if bit i of pfValid is set
+            uint8_t pfPos[PF_SLOTS] __attribute__((aligned(16)));  // matched with a 16B aligned load
+            uint64_t pfRespCycle[PF_SLOTS];
+            uint32_t pfValid;
+            uint32_t pfNext;  // next slot to fill, round-robin
+
             // Two competing strides; at most one active
             int32_t stride;
             SatCounter<3, 2, 1> conf;
 
-            struct AccessTimes {
-                uint64_t startCycle;  // FIXME: Dead for now, we should use it for profiling
-                uint64_t respCycle;
-
-                void fill(uint32_t s, uint64_t r) { startCycle = s; respCycle = r; }
-            };
-
-            AccessTimes times[64];
-            std::bitset<64> valid;
-
             uint32_t lastPos;
             uint32_t lastLastPos;
             uint32_t lastPrefetchPos;
-            uint64_t lastCycle;  // updated on alloc and hit
-            uint64_t ts;
 
-            void alloc(uint64_t curCycle) {
+            void alloc() {
                 stride = 1;
                 lastPos = 0;
                 lastLastPos = 0;
                 lastPrefetchPos = 0;
                 conf.reset();
-                valid.reset();
-                lastCycle = curCycle;
+                pfValid = 0;
+                pfNext = 0;
+            }
+
+            // Returns the slot holding an in-flight prefetch to pos, or -1
+            inline int32_t findPrefetch(uint32_t pos) const;
+
+            inline void addPrefetch(uint32_t pos, uint64_t respCycle) {
+                uint32_t slot = pfNext;
+                pfNext = (pfNext + 1) % PF_SLOTS;
+                pfPos[slot] = pos;
+                pfRespCycle[slot] = respCycle;
+                pfValid |= 1 << slot;
             }
+
+            inline void clearPrefetch(int32_t slot) { pfValid &= ~(1 << slot); }
         };
+        static_assert(offsetof(Entry, pfPos) == 0 && sizeof(Entry) % 16 == 0, "Entry::pfPos must be 16B-aligned in an array of entries");
+
+        const uint32_t numEntries;
+        const uint32_t pageBits;  // log2(lines per page)
 
         uint64_t timestamp;  // for LRU
-        Address tag[16];
-        Entry array[16];
+
+        // Structure-of-arrays so the per-access scans touch contiguous memory
+        Address* tags;  // padded to an even number of entries
+        uint64_t* lastCycles;  // updated on alloc and hit
+        uint64_t* tss;
+        Entry* array;
 
         Counter profAccesses, profPrefetches, profDoublePrefetches, profPageHits, profHits, profShortHits, profStrideSwitches, profLowConfAccs;
 
@@ -103,7 +126,7 @@ class StreamPrefetcher : public BaseCache {
         g_string name;
 
     public:
-        explicit StreamPrefetcher(const g_string& _name) : timestamp(0), name(_name) {}
+        StreamPrefetcher(const g_string& _name, uint32_t _numEntries, uint32_t _pageLines);
         void initStats(AggregateStat* parentStat);
         const char* getName() { return name.c_str();}
         void setParents(uint32_t _childId, const g_vector<MemObject*>& parents, Network* network);
@@ -111,6 +134,10 @@ class StreamPrefetcher : public BaseCache {
 
         uint64_t access(MemReq& req);
         uint64_t invalidate(const InvReq& req);
+
+    private:
+        inline uint32_t findEntry(Address pageAddr) const;  // returns numEntries on miss
+        inline uint32_t findVictim(uint64_t reqCycle) const;  // returns numEntries if all are busy
 };
 
 #endif  // PREFETCHER_H_
@@ -24,37 +24,53 @@
  */
 
 #include "proc_stats.h"
+#include "flat_stats.h"
 #include "process_tree.h"
 #include "scheduler.h"
 #include "str.h"
 #include "zsim.h"
 
-class ProcStats::ProcessCounter : public Counter {
+class ProcStats::ProcessCounter : public ScalarStat {
     private:
         ProcStats* ps;
+        uint64_t idx;  // in procBuf
 
     public:
-        ProcessCounter(ProcStats* _ps) : Counter(), ps(_ps) {}
+        ProcessCounter(ProcStats* _ps, uint64_t _idx) : ScalarStat(), ps(_ps), idx(_idx) {}
 
         uint64_t get() const {
             ps->update();
-            return Counter::get();
+            return ps->procBuf[idx];
         }
 };
 
-class ProcStats::ProcessVectorCounter : public VectorCounter {
+class ProcStats::ProcessVectorCounter : public VectorStat {
     private:
         ProcStats* ps;
+        uint64_t idx;  // of the first element in procBuf
+        uint32_t sz;
 
     public:
-        ProcessVectorCounter(ProcStats* _ps) : VectorCounter(), ps(_ps) {}
+        ProcessVectorCounter(ProcStats* _ps, uint64_t _idx, VectorStat* src) : VectorStat(), ps(_ps), idx(_idx), sz(src->size()) {
+            if (src->hasCounterNames()) {
+                const char** names = gm_calloc<const char*>(sz);
+                for (uint32_t i = 0; i < sz; i++) names[i] = src->counterName(i);
+                _counterNames = names;
+            }
+        }
 
-        uint64_t count(uint32_t idx) const {
+        uint64_t count(uint32_t i) const {
+            assert(i < sz);
             ps->update();
-            return VectorCounter::count(idx);
+            return ps->procBuf[idx + i];
+        }
+
+        uint32_t size() const {
+            return sz;
         }
 };
 
+// Only used during initialization; updates work on flattened stats
 static uint64_t StatSize(Stat* s) {
     uint64_t sz = 0;
      if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
@@ -69,58 +85,26 @@ static uint64_t StatSize(Stat* s) {
      return sz;
 }
 
-static uint64_t* DumpWalk(Stat* s, uint64_t* curPtr) {
-    if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
-        for (uint32_t i = 0; i < as->size(); i++) {
-            curPtr = DumpWalk(as->get(i), curPtr);
-        }
-    } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(s)) {
-        *(curPtr++) = ss->get();
-    } else if (VectorStat* vs = dynamic_cast<VectorStat*>(s)) {
-        for (uint32_t i = 0; i < vs->size(); i++) {
-            *(curPtr++) = vs->count(i);
-        }
-    } else {
-        panic("Unrecognized stat type");
-    }
-    return curPtr;
-}
-
-static uint64_t* IncWalk(Stat* s, uint64_t* curPtr) {
-    if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
-        for (uint32_t i = 0; i < as->size(); i++) {
-            curPtr = IncWalk(as->get(i), curPtr);
-        }
-    } else if (Counter* cs = dynamic_cast<Counter*>(s)) {
-        cs->inc(*(curPtr++));
-    } else if (VectorCounter* vs = dynamic_cast<VectorCounter*>(s)) {
-        for (uint32_t i = 0; i < vs->size(); i++) {
-            vs->inc(i, *(curPtr++));
-        }
-    } else {
-        panic("Unrecognized stat type (this should be called on our own tree...)");
-    }
-    return curPtr;
-}
-
-Stat* ProcStats::replStat(Stat* s, const char* name, const char* desc) {
+// Replicates s with counters that read procBuf, starting at idx
+Stat* ProcStats::replStat(Stat* s, uint64_t& idx, const char* name, const char* desc) {
     if (!name) name = s->name();
     if (!desc) desc = s->desc();
     if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
         AggregateStat* res = new AggregateStat(as->isRegular());
         res->init(name, desc);
         for (uint32_t i = 0; i < as->size(); i++) {
-            res->append(replStat(as->get(i)));
+            res->append(replStat(as->get(i), idx));
         }
         return res;
     } else if (dynamic_cast<ScalarStat*>(s)) {
-        Counter* res = new ProcessCounter(this);
+        ScalarStat* res = new ProcessCounter(this, idx);
         res->init(name, desc);
+        idx++;
         return res;
     } else if (VectorStat* vs = dynamic_cast<VectorStat*>(s)) {
-        VectorCounter* res = new ProcessVectorCounter(this);
-        assert(!vs->hasCounterNames());  // FIXME: Implement counter name copying
-        res->init(name, desc, vs->size());
+        VectorStat* res = new ProcessVectorCounter(this, idx, vs);
+        res->init(name, desc);
+        idx += vs->size();
         return res;
     } else {
         panic("Unrecognized stat type");
@@ -130,11 +114,13 @@ Stat* ProcStats::replStat(Stat* s, const char* name, const char* desc) {
 
 
 ProcStats::ProcStats(AggregateStat* parentStat, AggregateStat* _coreStats) : coreStats(_coreStats) {
-    uint32_t maxProcs = zinfo->lineSize;
+    uint32_t maxProcs = zinfo->maxProcs;
     lastUpdatePhase = 0;
 
-    // Check that coreStats are appropriate
+    // Check that coreStats are appropriate, and compute the flattened layout
     assert(coreStats);
+    uint64_t offset = 0;
+    procSize = 0;
     for (uint32_t i = 0; i < coreStats->size(); i++) {
         Stat* s = coreStats->get(i);
         AggregateStat* as = dynamic_cast<AggregateStat*>(s);
@@ -144,12 +130,26 @@ ProcStats::ProcStats(AggregateStat* parentStat, AggregateStat* _coreStats) : cor
         if (!as) err("not aggregate stat");
         if (!as->isRegular()) err("irregular aggregate");
         if (as->size() != zinfo->numCores) err("elems != cores");
+
+        uint64_t sz = StatSize(as->get(0));
+        for (uint32_t c = 1; c < as->size(); c++) {
+            if (StatSize(as->get(c)) != sz) err("per-core stats differ in size");
+        }
+        statOffsets.push_back(offset);
+        statSizes.push_back(sz);
+        procOffsets.push_back(procSize);
+        offset += sz*as->size();
+        procSize += sz;
     }
 
     // Initialize all the buffers
-    bufSize = StatSize(coreStats);
+    flatCoreStats = new FlatStats(coreStats, false /*no names*/);
+    bufSize = flatCoreStats->size();
+    assert(bufSize == offset);
     buf = gm_calloc<uint64_t>(bufSize);
     lastBuf = gm_calloc<uint64_t>(bufSize);
+    procBuf = gm_calloc<uint64_t>(((uint64_t)maxProcs)*procSize);
+    coreProcs = gm_calloc<uint32_t>(zinfo->numCores);
 
     // Create the procStats
     procStats = new AggregateStat(true);
@@ -158,11 +158,13 @@ ProcStats::ProcStats(AggregateStat* parentStat, AggregateStat* _coreStats) : cor
         AggregateStat* ps = new AggregateStat(false);
         const char* name = gm_strdup(("procStats-" + Str(p)).c_str());
         ps->init(name, "Per-process stats");
+        uint64_t idx = ((uint64_t)p)*procSize;
         for (uint32_t i = 0; i < coreStats->size(); i++) {
             AggregateStat* as = dynamic_cast<AggregateStat*>(coreStats->get(i));
             assert(as && as->isRegular());
-            ps->append(replStat(as->get(0), as->name(), as->desc()));
+            ps->append(replStat(as->get(0), idx, as->name(), as->desc()));
         }
+        assert(idx == ((uint64_t)p + 1)*procSize);
         procStats->append(ps);
     }
     parentStat->append(procStats);
@@ -172,31 +174,30 @@ void ProcStats::update() {
     if (likely(lastUpdatePhase == zinfo->numPhases)) return;
     assert(lastUpdatePhase < zinfo->numPhases);
 
-    uint64_t* endBuf = DumpWalk(coreStats, buf);
-    assert(buf + bufSize == endBuf);
-
+    flatCoreStats->read(buf);
     for (uint64_t i = 0; i < bufSize; i++) {
         lastBuf[i] = buf[i] - lastBuf[i];
     }
     std::swap(lastBuf, buf);
 
     // Now lastBuf has been updated and buf has the differences of all the counters
-    uint64_t start = 0;
-    for (uint32_t i = 0; i < coreStats->size(); i++) {
-        AggregateStat* as = dynamic_cast<AggregateStat*>(coreStats->get(i));
-
-        for (uint32_t c = 0; c < as->size(); c++) {
-            AggregateStat* cs = dynamic_cast<AggregateStat*>(as->get(c));
-            uint32_t p = zinfo->sched->getScheduledPid(c);
-            if (p == (uint32_t)-1) p = zinfo->lineSize - 1;  // FIXME
-            else p = zinfo->procArray[p]->getGroupIdx();
-            Stat* ps = dynamic_cast<AggregateStat*>(procStats->get(p))->get(i);
-            assert(StatSize(cs) == StatSize(ps));
-            IncWalk(ps, buf + start);
-            start += StatSize(cs);
+    uint32_t numCores = zinfo->numCores;
+    for (uint32_t c = 0; c < numCores; c++) {
+        uint32_t p = zinfo->sched->getScheduledPid(c);
+        if (p == (uint32_t)-1) p = zinfo->maxProcs - 1;  // FIXME
+        else p = zinfo->procArray[p]->getGroupIdx();
+        coreProcs[c] = p;
+    }
+
+    for (uint32_t i = 0; i < statSizes.size(); i++) {
+        uint32_t sz = statSizes[i];
+        const uint64_t* src = buf + statOffsets[i];
+        for (uint32_t c = 0; c < numCores; c++) {
+            uint64_t* dst = procBuf + ((uint64_t)coreProcs[c])*procSize + procOffsets[i];
+            for (uint32_t j = 0; j < sz; j++) dst[j] += src[j];
+            src += sz;
         }
     }
-    assert(start == bufSize);
 
     lastUpdatePhase = zinfo->numPhases;
 }
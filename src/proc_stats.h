@@ -26,9 +26,12 @@
 #ifndef PROC_STATS_H_
 #define PROC_STATS_H_
 
+#include "g_std/g_vector.h"
 #include "galloc.h"
 #include "stats.h"
 
+class FlatStats;
+
 class ProcStats : public GlobAlloc {
     private:
 
@@ -40,10 +43,26 @@ class ProcStats : public GlobAlloc {
         AggregateStat* coreStats;  // each member must be a regular aggregate with numCores elems
         AggregateStat* procStats;  // stats produced
 
+        /* coreStats is flattened once, so updates are straight-line loops over
+         * flat arrays. In a snapshot of coreStats, the counters of member i
+         * for core c are statSizes[i] consecutive values at
+         * statOffsets[i] + c*statSizes[i]. Per-process counters live in
+         * procBuf, procSize values per process, with those of member i at
+         * procOffsets[i].
+         */
+        FlatStats* flatCoreStats;
+        g_vector<uint64_t> statOffsets;
+        g_vector<uint32_t> statSizes;
+        g_vector<uint32_t> procOffsets;
+        uint32_t procSize;
+
         uint64_t* buf;
         uint64_t* lastBuf;
         uint64_t bufSize;
 
+        uint64_t* procBuf;
+        uint32_t* coreProcs;  // process (group) each core was running, per update
+
     public:
         explicit ProcStats(AggregateStat* parentStat, AggregateStat* _coreStats); //includes initStats, called post-system init
 
@@ -51,9 +70,9 @@ class ProcStats : public GlobAlloc {
         void notifyDeschedule();
 
     private:
-        Stat* replStat(Stat* s, const char* name = nullptr, const char* desc = nullptr);
+        Stat* replStat(Stat* s, uint64_t& idx, const char* name = nullptr, const char* desc = nullptr);
 
-        void update();  // transparent
+        void update();  // transparent, at most once per phase
 };
 
 #endif  // PROCESS_STATS_H_
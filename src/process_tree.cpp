@@ -191,7 +191,7 @@ static void PopulateLevel(Config& config, const std::string& prefix, std::vector
             if (dumpHeartbeats) warn("Dumping eventual stats on both heartbeats AND instructions; you won't be able to distinguish both!");
             auto getInstrs = [procIdx]() { return zinfo->processStats->getProcessInstrs(procIdx); };
             auto dumpStats = [procIdx]() { DumpEventualStats(procIdx, "instructions"); };
-            zinfo->eventQueue->insert(makeAdaptiveEvent(getInstrs, dumpStats, 0, dumpInstrs, MAX_IPC*zinfo->phaseLength*zinfo->numCores /*all cores can be on*/));
+            zinfo->eventQueue->insert(makeAdaptiveEvent(getInstrs, dumpStats, 0, dumpInstrs, MAX_IPC*zinfo->maxPhaseLength*zinfo->numCores /*all cores can be on*/));
         } //NOTE: trivial to do the same with cycles
 
         if (clockDomain >= MAX_CLOCK_DOMAINS) panic("Invalid clock domain %d", clockDomain);
@@ -236,15 +236,15 @@ void CreateProcessTree(Config& config) {
 
     PopulateLevel(config, std::string(""), globProcVector, rootNode, procIdx, groupIdx);
 
-    if (procIdx > (uint32_t)zinfo->lineSize) panic("Cannot simulate more than sys.lineSize=%d processes (address spaces will get aliased), %d specified", zinfo->lineSize, procIdx);
+    if (procIdx > zinfo->maxProcs) panic("Cannot simulate more than %d processes (sys.lineSize without virtual memory, sys.vm.maxProcs with it), %d specified", zinfo->maxProcs, procIdx);
 
     zinfo->procTree = rootNode;
     zinfo->numProcs = procIdx;
     zinfo->numProcGroups = groupIdx;
 
-    zinfo->procArray = gm_calloc<ProcessTreeNode*>(zinfo->lineSize /*max procs*/); //note we can add processes later, so we size it to the maximum
+    zinfo->procArray = gm_calloc<ProcessTreeNode*>(zinfo->maxProcs); //note we can add processes later, so we size it to the maximum
     for (uint32_t i = 0; i < procIdx; i++) zinfo->procArray[i] = globProcVector[i];
 
-    zinfo->procExited = gm_calloc<ProcExitStatus>(zinfo->lineSize /*max procs*/);
+    zinfo->procExited = gm_calloc<ProcExitStatus>(zinfo->maxProcs);
 }
 
@@ -75,8 +75,8 @@ class ProcessTreeNode : public GlobAlloc {
         ProcessTreeNode* getNextChild() {
             if (curChildren == children.size()) { //allocate a new child
                 uint32_t childProcIdx = __sync_fetch_and_add(&zinfo->numProcs, 1);
-                if (childProcIdx >= (uint32_t)zinfo->lineSize) {
-                    panic("Cannot simulate more than sys.lineSize=%d processes (to avoid aliasing), limit reached", zinfo->lineSize);
+                if (childProcIdx >= zinfo->maxProcs) {
+                    panic("Cannot simulate more than %d processes (sys.lineSize without virtual memory, sys.vm.maxProcs with it), limit reached", zinfo->maxProcs);
                 }
                 ProcessTreeNode* child = new ProcessTreeNode(*this);
                 child->procIdx = childProcIdx;
@@ -0,0 +1,92 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPL_META_H_
+#define REPL_META_H_
+
+#include <stdint.h>
+#include "galloc.h"
+#include "log.h"
+#include "pad.h"
+
+/* Packed per-line replacement metadata: one 64-bit word per line, indexed by
+ * line id, with the coherence state the replacement policy cares about next
+ * to its recency info:
+ *
+ *   [63:48] number of sharers (kept by the CC)
+ *   [47]    valid (kept by the CC)
+ *   [46:0]  recency timestamp (kept by the replacement policy)
+ *
+ * Set-associative arrays give each set contiguous line ids, so ranking a
+ * 16-way set reads two cache lines, and never calls into the CC.
+ */
+class ReplMeta : public GlobAlloc {
+    public:
+        static const uint32_t SHARERS_SHIFT = 48;
+        static const uint64_t VALID_BIT = 1ULL << 47;
+        static const uint64_t TS_MASK = VALID_BIT - 1;
+        static const uint64_t SHARERS_MASK = ~(TS_MASK | VALID_BIT);
+
+    private:
+        uint64_t* words;
+
+    public:
+        explicit ReplMeta(uint32_t numLines) {
+            words = gm_memalign<uint64_t>(CACHE_LINE_BYTES, numLines);
+            for (uint32_t i = 0; i < numLines; i++) words[i] = 0;  // invalid, no sharers
+        }
+
+        ~ReplMeta() {
+            gm_free(words);
+        }
+
+        inline const uint64_t* get() const {return words;}
+
+        // CC side
+        inline void setCoherence(uint32_t id, bool valid, uint32_t sharers) {
+            assert(sharers < (1 << 16));
+            words[id] = (words[id] & TS_MASK) | (valid? VALID_BIT : 0) | (((uint64_t)sharers) << SHARERS_SHIFT);
+        }
+
+        // Replacement policy side
+        inline uint64_t getTs(uint32_t id) const {return words[id] & TS_MASK;}
+
+        inline void setTs(uint32_t id, uint64_t ts) {
+            assert(ts <= TS_MASK);
+            words[id] = (words[id] & ~TS_MASK) | ts;
+        }
+
+        /* LRU eviction priority, lower is more evictable. Orders lines by
+         * (sharers, valid? ts : 0), i.e., invalid lines first, then those
+         * without sharers, then by recency. Branch-free.
+         */
+        template <bool sharersAware>
+        static inline uint64_t lruKey(uint64_t w) {
+            uint64_t validMask = -((w >> 47) & 1);
+            return (sharersAware? (w & SHARERS_MASK) : 0) | (w & TS_MASK & validMask);
+        }
+};
+
+#endif  // REPL_META_H_
@@ -32,6 +32,7 @@
 #include "coherence_ctrls.h"
 #include "memory_hierarchy.h"
 #include "mtrand.h"
+#include "repl_meta.h"
 
 /* Generic replacement policy interface. A replacement policy is initialized by the cache (by calling setTop/BottomCC) and used by the cache array. Usage follows two models:
  * - On lookups, update() is called if the replacement policy is to be updated on a hit
@@ -93,52 +94,68 @@ class LegacyReplPolicy : public virtual ReplPolicy {
 
 /* Plain ol' LRU, though this one is sharers-aware, prioritizing lines that have
  * sharers down in the hierarchy vs lines not shared by anyone.
+ *
+ * Timestamps live in a ReplMeta array, next to the valid bit and sharer count
+ * that the CC keeps there, so ranking needs no CC calls. On set-associative
+ * arrays, a set's candidates are contiguous, so rank() is a branch-free
+ * min-reduction over a couple of cache lines.
  */
 template <bool sharersAware>
 class LRUReplPolicy : public ReplPolicy {
     protected:
         uint64_t timestamp; // incremented on each access
-        uint64_t* array;
+        ReplMeta* meta;
         uint32_t numLines;
+        bool concurrentSets;  // with CC lock stripes, different sets are updated concurrently, so timestamps are taken atomically
 
     public:
-        explicit LRUReplPolicy(uint32_t _numLines) : timestamp(1), numLines(_numLines) {
-            array = gm_calloc<uint64_t>(numLines);
+        explicit LRUReplPolicy(uint32_t _numLines, bool _concurrentSets = false) : timestamp(1), numLines(_numLines), concurrentSets(_concurrentSets) {
+            meta = new ReplMeta(numLines);
         }
 
         ~LRUReplPolicy() {
-            gm_free(array);
+            delete meta;
+        }
+
+        void setCC(CC* _cc) {
+            cc = _cc;
+            cc->setReplMeta(meta);
         }
 
         void update(uint32_t id, const MemReq* req) {
-            array[id] = timestamp++;
+            meta->setTs(id, concurrentSets? __sync_fetch_and_add(&timestamp, 1) : timestamp++);
         }
 
         void replaced(uint32_t id) {
-            array[id] = 0;
+            meta->setTs(id, 0);
         }
 
         template <typename C> inline uint32_t rank(const MemReq* req, C cands) {
+            const uint64_t* words = meta->get();
             uint32_t bestCand = -1;
             uint64_t bestScore = (uint64_t)-1L;
             for (auto ci = cands.begin(); ci != cands.end(); ci.inc()) {
-                uint32_t s = score(*ci);
+                uint64_t s = ReplMeta::lruKey<sharersAware>(words[*ci]);
                 bestCand = (s < bestScore)? *ci : bestCand;
                 bestScore = MIN(s, bestScore);
             }
             return bestCand;
         }
 
-        DECL_RANK_BINDINGS;
-
-    private:
-        inline uint64_t score(uint32_t id) { //higher is least evictable
-            //array[id] < timestamp always, so this prioritizes by:
-            // (1) valid (if not valid, it's 0)
-            // (2) sharers, and
-            // (3) timestamp
-            return (sharersAware? cc->numSharers(id) : 0)*timestamp + array[id]*cc->isValid(id);
+        inline uint32_t rank(const MemReq* req, SetAssocCands cands) {
+            // Candidates are contiguous: find the min score, then the first line that has it
+            const uint64_t* words = meta->get() + cands.b;
+            uint32_t n = cands.numCands();
+            uint64_t bestScore = (uint64_t)-1L;
+            for (uint32_t i = 0; i < n; i++) {
+                bestScore = MIN(ReplMeta::lruKey<sharersAware>(words[i]), bestScore);
+            }
+            uint32_t i = 0;
+            while (ReplMeta::lruKey<sharersAware>(words[i]) != bestScore) i++;
+            return cands.b + i;
         }
+
+        DECL_RANK_BINDINGS;
 };
 
 //This is VERY inefficient, uses LRU timestamps to do something that in essence requires a few bits.
@@ -172,8 +189,8 @@ class TreeLRUReplPolicy : public LRUReplPolicy<true> {
                 uint32_t pivot = start + (end - start)/2;
                 uint64_t t1 = 0;
                 uint64_t t2 = 0;
-                for (uint32_t i = start; i < pivot; i++) t1 = MAX(t1, array[candArray[i]]);
-                for (uint32_t i = pivot; i < end; i++)   t2 = MAX(t2, array[candArray[i]]);
+                for (uint32_t i = start; i < pivot; i++) t1 = MAX(t1, meta->getTs(candArray[i]));
+                for (uint32_t i = pivot; i < end; i++)   t2 = MAX(t2, meta->getTs(candArray[i]));
                 if (t1 > t2) start = pivot;
                 else end = pivot;
             }
@@ -184,7 +201,7 @@ class TreeLRUReplPolicy : public LRUReplPolicy<true> {
 
         void replaced(uint32_t id) {
             candIdx = 0;
-            array[id] = 0;
+            meta->setTs(id, 0);
         }
 };
 
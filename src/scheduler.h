@@ -39,9 +39,11 @@
 #include "g_std/g_unordered_set.h"
 #include "g_std/g_vector.h"
 #include "intrusive_list.h"
+#include "phase_length_ctrl.h"
 #include "proc_stats.h"
 #include "process_stats.h"
 #include "stats.h"
+#include "sync_trace.h"
 #include "zsim.h"
 
 /**
@@ -324,6 +326,7 @@ class Scheduler : public GlobAlloc, public Callee {
                 }
             }
 
+            if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_JOIN, gid, th->cid);
             return th->cid;
         }
 
@@ -335,6 +338,7 @@ class Scheduler : public GlobAlloc, public Callee {
             assert(th->gid == gid);
             assert(th->state == RUNNING);
             zinfo->cores[cid]->leave();
+            if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_LEAVE, gid, cid);
 
             if (th->markedForSleep) { //transition to SLEEPING, eagerly deschedule
                 trace(Sched, "Sched: %d going to SLEEP, wakeup on phase %ld", gid, th->wakeupPhase);
@@ -357,6 +361,7 @@ class Scheduler : public GlobAlloc, public Callee {
 
                 ThreadInfo* inTh = schedContext(ctx);
                 if (inTh) {
+                    if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_HANDOFF, gid, cid, inTh->gid);
                     schedule(inTh, ctx);
                     zinfo->cores[ctx->cid]->join(); //inTh does not do a sched->join, so we need to notify the core since we just called leave() on it
                     wakeup(inTh, false /*no join, we did not leave*/);
@@ -368,6 +373,7 @@ class Scheduler : public GlobAlloc, public Callee {
                 ContextInfo* ctx = &contexts[cid];
                 ThreadInfo* inTh = schedContext(ctx);
                 if (inTh) { //transition to BLOCKED, sched inTh
+                    if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_HANDOFF, gid, cid, inTh->gid);
                     deschedule(th, ctx, BLOCKED);
                     schedule(inTh, ctx);
                     zinfo->cores[ctx->cid]->join(); //inTh does not do a sched->join, so we need to notify the core since we just called leave() on it
@@ -390,6 +396,7 @@ class Scheduler : public GlobAlloc, public Callee {
             futex_lock(&schedLock);
             ThreadInfo* th = contexts[cid].curThread;
             assert(!th->markedForSleep);
+            if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_ARRIVE, th->gid, cid);
             bar.sync(cid, &schedLock); //releases lock, may trigger end of phase, may block us
 
             //No locks at this point; we need to check whether we need to hand off our context
@@ -398,6 +405,7 @@ class Scheduler : public GlobAlloc, public Callee {
                 ThreadInfo* dst = const_cast<ThreadInfo*>(th->handoffThread);  // de-volatilize
                 th->handoffThread = nullptr;
                 ContextInfo* ctx = &contexts[th->cid];
+                if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_HANDOFF, th->gid, ctx->cid, dst->gid);
                 deschedule(th, ctx, QUEUED);
                 schedule(dst, ctx);
                 wakeup(dst, false /*no join needed*/);
@@ -420,6 +428,7 @@ class Scheduler : public GlobAlloc, public Callee {
             }
 
             assert(th->state == RUNNING);
+            if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_DEPART, th->gid, th->cid);
             return th->cid;
         }
 
@@ -427,6 +436,7 @@ class Scheduler : public GlobAlloc, public Callee {
         virtual void callback() {
             //End of phase stats
             assert(scheduledThreads <= numCores);
+            if (unlikely(zinfo->syncTrace != nullptr)) zinfo->syncTrace->record(SYNC_PHASE_END, -1, -1);
             occHist.inc(scheduledThreads);
             uint32_t rqPos = (runQueue.size() < (runQueueHist.size()-1))? runQueue.size() : (runQueueHist.size()-1);
             runQueueHist.inc(rqPos);
@@ -436,6 +446,8 @@ class Scheduler : public GlobAlloc, public Callee {
             /* End of phase accounting */
             zinfo->numPhases++;
             zinfo->globPhaseCycles += zinfo->phaseLength;
+            if (zinfo->phaseLengthCtrl) zinfo->phaseLengthCtrl->endPhase();
+            if (zinfo->syncTrace) zinfo->syncTrace->endPhase();
             curPhase++;
 
             assert(curPhase == zinfo->numPhases); //check they don't skew
@@ -44,20 +44,21 @@ void SimpleCore::initStats(AggregateStat* parentStat) {
 }
 
 uint64_t SimpleCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return (curCycle - zinfo->globPhaseCycles) % zinfo->phaseLength;
 }
 
 void SimpleCore::load(Address addr) {
-    curCycle = l1d->load(addr, curCycle);
+    curCycle = l1d->load(addr, l1d->getFastPath()->apply(curCycle));
 }
 
 void SimpleCore::store(Address addr) {
-    curCycle = l1d->store(addr, curCycle);
+    curCycle = l1d->store(addr, l1d->getFastPath()->apply(curCycle));
 }
 
 void SimpleCore::bbl(Address bblAddr, BblInfo* bblInfo) {
     //info("BBL %s %p", name.c_str(), bblInfo);
     //info("%d %d", bblInfo->instrs, bblInfo->bytes);
+    curCycle = l1d->getFastPath()->apply(curCycle);
     instrs += bblInfo->instrs;
     curCycle += bblInfo->instrs;
 
@@ -76,6 +77,7 @@ void SimpleCore::contextSwitch(int32_t gid) {
 
 void SimpleCore::join() {
     //info("[%s] Joining, curCycle %ld phaseEnd %ld haltedCycles %ld", name.c_str(), curCycle, phaseEndCycle, haltedCycles);
+    curCycle = l1d->getFastPath()->apply(curCycle);
     if (curCycle < zinfo->globPhaseCycles) { //carry up to the beginning of the phase
         haltedCycles += (zinfo->globPhaseCycles - curCycle);
         curCycle = zinfo->globPhaseCycles;
@@ -89,7 +91,7 @@ void SimpleCore::join() {
 //Static class functions: Function pointers and trampolines
 
 InstrFuncPtrs SimpleCore::GetFuncPtrs() {
-    return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, FPTR_ANALYSIS, {0}};
+    return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, FPTR_ANALYSIS, l1d->getFastPath()};
 }
 
 void SimpleCore::LoadFunc(THREADID tid, ADDRINT addr) {
@@ -114,7 +116,7 @@ void SimpleCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
 
     while (core->curCycle > core->phaseEndCycle) {
         assert(core->phaseEndCycle == zinfo->globPhaseCycles + zinfo->phaseLength);
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
 
         uint32_t cid = getCid(tid);
         //NOTE: TakeBarrier may take ownership of the core, and so it will be used by some other thread. If TakeBarrier context-switches us,
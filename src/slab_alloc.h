@@ -117,6 +117,16 @@ class SlabAlloc {
 
         template <typename T> T* alloc() { return (T*)alloc(sizeof(T)); }
 
+        /* Stops allocating from the current slab if it has live elems. With a
+         * pipelined weave phase, those elems are freed while the next bound
+         * phase allocates, and Slab::alloc() is unsynchronized. Must be called
+         * with no concurrent frees.
+         */
+        void retireCurSlab() {
+            if (curSlab->liveElems == 0) return;  // nothing to free concurrently
+            allocSlab();
+        }
+
     private:
         void allocSlab() {
             scoped_mutex sm(freeLock);
@@ -160,6 +170,15 @@ inline void Slab::freeElem() {
     }
 }
 
+/* Adds a reference to elem's slab, for objects that are freed more than once
+ * (e.g., a CrossingEvent and its embedded source-domain event both free
+ * themselves). Otherwise the slab could be recycled while elems are live.
+ */
+inline void retainElem(void* elem) {
+    Slab* s = (Slab*)(((uintptr_t)elem) & SLAB_MASK);
+    __sync_fetch_and_add(&s->liveElems, 1);
+}
+
 inline void freeElem(void* elem, size_t minSz) {
 #ifdef DEBUG_SLAB_ALLOC
     memset(elem, 0, minSz);
@@ -0,0 +1,97 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STANDALONE_THREADS_H_
+#define STANDALONE_THREADS_H_
+
+/* Pieces shared by the Pin-free tools (cachebench, ddrcheck, membench,
+ * weavebench), which drive simulator components from plain host threads
+ * instead of from instrumented app threads.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include "log.h"
+#include "timing_event.h"
+
+/* Spawns a detached thread, for components that take a thread spawn function
+ * (ContentionSim's sim threads, parallel cache building, MemSampler's writer).
+ * In zsim, these run as Pin internal threads.
+ */
+struct ThreadArgs {
+    void (*func)(void*);
+    void* arg;
+};
+
+static inline void* ThreadTrampoline(void* arg) {
+    ThreadArgs* ta = static_cast<ThreadArgs*>(arg);
+    ta->func(ta->arg);
+    delete ta;
+    return nullptr;
+}
+
+static inline void SpawnThread(void (*func)(void*), void* arg) {
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&th, &attr, ThreadTrampoline, new ThreadArgs {func, arg}) != 0) panic("pthread_create failed");
+    pthread_attr_destroy(&attr);
+}
+
+/* Events the tools chain before and after the timing record of each access
+ * they issue, playing the core. Both run in domain 0. IssueEvent is the root
+ * of the access's events and optionally notes the cycle it starts at.
+ * RespEvent follows the access's last event, notes its response cycle, and
+ * counts completed accesses (the tools' ContentionSim has a single domain, so
+ * no atomics are needed).
+ */
+class IssueEvent : public TimingEvent {
+    private:
+        uint64_t* issueCycle;
+
+    public:
+        explicit IssueEvent(uint64_t* _issueCycle = nullptr) : TimingEvent(0, 0, 0), issueCycle(_issueCycle) {}
+        void simulate(uint64_t startCycle) {
+            if (issueCycle) *issueCycle = startCycle;
+            done(startCycle);
+        }
+};
+
+class RespEvent : public TimingEvent {
+    private:
+        uint64_t* respCycle;
+        uint64_t* completed;
+
+    public:
+        RespEvent(uint64_t* _respCycle, uint64_t* _completed) : TimingEvent(0, 0, 0), respCycle(_respCycle), completed(_completed) {}
+        void simulate(uint64_t startCycle) {
+            *respCycle = startCycle;
+            (*completed)++;
+            done(startCycle);
+        }
+};
+
+#endif  // STANDALONE_THREADS_H_
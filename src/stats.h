@@ -155,6 +155,12 @@ class AggregateStat : public Stat {
             _children.push_back(child);
         }
 
+        // Preallocates room for n children (e.g., when appending thousands of cache banks)
+        void reserve(uint32_t n) {
+            assert(_isMutable);
+            _children.reserve(n);
+        }
+
         uint32_t size() const {
             assert(!_isMutable);
             return _children.size();
@@ -398,7 +404,32 @@ class TextBackend : public StatsBackend {
         TextBackendImpl* backend;
 
     public:
-        TextBackend(const char* filename, AggregateStat* rootStat);
+        TextBackend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite = (1 << 20));
+        virtual void dump(bool buffered);
+};
+
+
+class JSONLinesBackendImpl;
+
+class JSONLinesBackend : public StatsBackend {
+    private:
+        JSONLinesBackendImpl* backend;
+
+    public:
+        JSONLinesBackend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite);
+        virtual void dump(bool buffered);
+};
+
+
+class ColumnarBackendImpl;
+
+// Binary, one row of counters per dump; see columnar_stats.cpp for the format
+class ColumnarBackend : public StatsBackend {
+    private:
+        ColumnarBackendImpl* backend;
+
+    public:
+        ColumnarBackend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite);
         virtual void dump(bool buffered);
 };
 
@@ -414,4 +445,17 @@ class HDF5Backend : public StatsBackend {
         virtual void dump(bool buffered);
 };
 
+
+class LiveStatsBackendImpl;
+
+// Publishes a snapshot of all counters to an mmap-able file; see live_stats.h
+class LiveStatsBackend : public StatsBackend {
+    private:
+        LiveStatsBackendImpl* backend;
+
+    public:
+        LiveStatsBackend(const char* filename, AggregateStat* rootStat);
+        virtual void dump(bool buffered);
+};
+
 #endif  // STATS_H_
@@ -0,0 +1,168 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STRIPED_LOCK_H_
+#define STRIPED_LOCK_H_
+
+#include <stdint.h>
+#include "bithacks.h"
+#include "galloc.h"
+#include "hash.h"
+#include "locks.h"
+#include "log.h"
+#include "memory_hierarchy.h"
+#include "pad.h"
+#include "rdtsc.h"
+#include "stats.h"
+
+/* The lock of a coherence controller, optionally striped by set
+ * (sys.caches.<group>.lockStripes) so that accesses to different sets of a
+ * shared cache bank proceed in parallel. Lines map to stripes with the array's
+ * set hash, and the number of stripes divides the number of sets, so a line
+ * and every line it may evict share a stripe. Each level thus still
+ * serializes all operations on a set, and the hand-over-hand protocol between
+ * levels works as with a single lock.
+ *
+ * Stripes are adaptive futex locks. With sim.profileCCLocks, each stripe also
+ * counts its acquisitions, and the host cycles (rdtsc) threads spent waiting
+ * for and holding it. Each stripe keeps its own counters, updated only by its
+ * holder, so they need no atomics.
+ */
+class StripedLock : public GlobAlloc {
+    private:
+        struct Stripe {
+            lock_t lock;
+            volatile uint32_t spins;  // adaptive spin estimate
+            uint64_t acqTicks;  // when the current holder got it
+            uint64_t acquires;
+            uint64_t waits;  // acquisitions that found the stripe taken
+            uint64_t waitTicks;
+            uint64_t holdTicks;
+        } ATTR_LINE_ALIGNED;
+
+        Stripe* stripes;
+        HashFamily* hf;
+        uint32_t numStripes;
+        uint32_t stripeMask;
+        bool profile;
+
+    public:
+        // hf is the array's set hash (function 0); it is only used with multiple stripes
+        StripedLock(uint32_t _numStripes, HashFamily* _hf, bool _profile)
+            : hf(_hf), numStripes(_numStripes), stripeMask(_numStripes - 1), profile(_profile)
+        {
+            assert_msg(numStripes && (numStripes & stripeMask) == 0, "Lock stripes must be a power of 2, %d given", numStripes);
+            assert(numStripes == 1 || hf);
+            stripes = gm_memalign<Stripe>(CACHE_LINE_BYTES, numStripes);
+            for (uint32_t i = 0; i < numStripes; i++) {
+                futex_init(&stripes[i].lock);
+                stripes[i].spins = 0;
+                stripes[i].acqTicks = 0;
+                stripes[i].acquires = 0;
+                stripes[i].waits = 0;
+                stripes[i].waitTicks = 0;
+                stripes[i].holdTicks = 0;
+            }
+        }
+
+        inline uint32_t stripeOf(Address lineAddr) {
+            return stripeMask? (hf->hash(0, lineAddr) & stripeMask) : 0;
+        }
+
+        // The lock word of a stripe, e.g., to pass as a request's childLock
+        inline lock_t* get(uint32_t stripe) {
+            return &stripes[stripe].lock;
+        }
+
+        inline void lock(uint32_t stripe) {
+            Stripe* s = &stripes[stripe];
+            if (likely(!profile)) {
+                futex_lock_adaptive(&s->lock, &s->spins);
+            } else {
+                uint64_t startTicks = rdtsc();
+                bool uncontended = futex_lock_adaptive(&s->lock, &s->spins);
+                uint64_t curTicks = rdtsc();
+                s->acquires++;
+                if (!uncontended) {
+                    s->waits++;
+                    s->waitTicks += curTicks - startTicks;
+                }
+                s->acqTicks = curTicks;
+            }
+        }
+
+        inline void unlock(uint32_t stripe) {
+            Stripe* s = &stripes[stripe];
+            if (unlikely(profile)) s->holdTicks += rdtsc() - s->acqTicks;
+            futex_unlock(&s->lock);
+        }
+
+        /* Bracket calls to a parent cache, which releases the stripe while
+         * it handles the request (see MESICC::startAccess), so that hold
+         * times only include the time this level actually holds it.
+         */
+        inline void pauseHold(uint32_t stripe) {
+            if (unlikely(profile)) stripes[stripe].holdTicks += rdtsc() - stripes[stripe].acqTicks;
+        }
+
+        inline void resumeHold(uint32_t stripe) {
+            if (unlikely(profile)) stripes[stripe].acqTicks = rdtsc();
+        }
+
+        void initStats(AggregateStat* parentStat, const char* name, const char* desc) {
+            if (!profile) return;
+            AggregateStat* lockStat = new AggregateStat();
+            lockStat->init(name, desc);
+
+            auto sum = [this](uint64_t Stripe::* field) {
+                uint64_t res = 0;
+                for (uint32_t i = 0; i < numStripes; i++) res += stripes[i].*field;
+                return res;
+            };
+            auto acqStat = makeLambdaStat([sum]() { return sum(&Stripe::acquires); });
+            acqStat->init("acq", "Acquisitions");
+            auto waitsStat = makeLambdaStat([sum]() { return sum(&Stripe::waits); });
+            waitsStat->init("waits", "Contended acquisitions");
+            auto waitStat = makeLambdaStat([sum]() { return sum(&Stripe::waitTicks); });
+            waitStat->init("waitCycles", "Host cycles spent waiting to acquire");
+            auto holdStat = makeLambdaStat([sum]() { return sum(&Stripe::holdTicks); });
+            holdStat->init("holdCycles", "Host cycles held");
+            auto maxWaitStat = makeLambdaStat([this]() {
+                uint64_t res = 0;
+                for (uint32_t i = 0; i < numStripes; i++) res = MAX(res, stripes[i].waitTicks);
+                return res;
+            });
+            maxWaitStat->init("maxStripeWaitCycles", "Host cycles spent waiting on the most contended stripe");
+
+            lockStat->append(acqStat);
+            lockStat->append(waitsStat);
+            lockStat->append(waitStat);
+            lockStat->append(holdStat);
+            lockStat->append(maxWaitStat);
+            parentStat->append(lockStat);
+        }
+};
+
+#endif  // STRIPED_LOCK_H_
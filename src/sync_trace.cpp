@@ -0,0 +1,91 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sync_trace.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include "bithacks.h"
+#include "log.h"
+
+static void WriteAll(int fd, const void* buf, size_t bytes, const char* filename) {
+    const char* p = static_cast<const char*>(buf);
+    while (bytes) {
+        ssize_t res = write(fd, p, bytes);
+        if (res < 0) panic("Write to sync trace %s failed", filename);
+        p += res;
+        bytes -= res;
+    }
+}
+
+SyncTrace::SyncTrace(const char* _filename, uint32_t numCores, uint32_t entries) {
+    if (!isPow2(entries) || entries < 2) panic("sim.syncTraceEntries (%d) must be a power of 2", entries);
+    filename = _filename;
+    ring = gm_memalign<SyncTraceEvent>(CACHE_LINE_BYTES, entries);
+    ringMask = entries - 1;
+    head = 0;
+    written = 0;
+    lost = 0;
+
+    // Since the trace can be flushed from any process, we cannot keep the file open
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0660);
+    if (fd < 0) panic("Could not open sync trace %s", filename);
+    SyncTraceHeader hdr = {SYNC_TRACE_MAGIC, SYNC_TRACE_VERSION, numCores, zinfo->phaseLength, 0};
+    WriteAll(fd, &hdr, sizeof(hdr), filename);
+    close(fd);
+    info("Tracing barrier and scheduler events to %s (%d-event ring)", filename, entries);
+}
+
+void SyncTrace::initStats(AggregateStat* parentStat) {
+    AggregateStat* traceStat = new AggregateStat();
+    traceStat->init("syncTrace", "Barrier and scheduler trace stats");
+    auto eventsStat = makeLambdaStat([this]() { return (uint64_t)head; });
+    eventsStat->init("events", "Recorded events");
+    auto lostStat = makeLambdaStat([this]() { return lost; });
+    lostStat->init("lost", "Events overwritten before being written out");
+    traceStat->append(eventsStat);
+    traceStat->append(lostStat);
+    parentStat->append(traceStat);
+}
+
+void SyncTrace::flush() {
+    uint64_t end = head;
+    uint64_t entries = ringMask + 1;
+    if (end - written > entries) {
+        lost += end - written - entries;
+        written = end - entries;
+    }
+    if (end == written) return;
+
+    int fd = open(filename, O_WRONLY | O_APPEND);
+    if (fd < 0) panic("Could not open sync trace %s", filename);
+    // At most two contiguous chunks
+    while (written < end) {
+        uint64_t first = written & ringMask;
+        uint64_t count = MIN(end - written, entries - first);
+        WriteAll(fd, &ring[first], count*sizeof(SyncTraceEvent), filename);
+        written += count;
+    }
+    close(fd);
+}
@@ -0,0 +1,133 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNC_TRACE_H_
+#define SYNC_TRACE_H_
+
+#include <stdint.h>
+#include "galloc.h"
+#include "pad.h"
+#include "profile_stats.h"
+#include "stats.h"
+#include "zsim.h"
+
+/* Barrier and scheduler trace (sim.syncTrace), to find the threads that hold
+ * up phases. The scheduler records an event whenever a thread arrives at or
+ * departs from the end-of-phase barrier, joins or leaves, or hands its core
+ * off to another thread, and when a phase ends. Events are fixed-size
+ * records stamped with host time, appended to a ring in the global heap by
+ * reserving slots with an atomic add, so recording never takes a lock.
+ *
+ * Arrivals, leaves and handoffs happen with the scheduler lock held. Joins
+ * and departures do not: a join is recorded once the barrier has made the
+ * thread run (after the scheduler lock is released), and a departure after
+ * it wakes up. Either way, the thread is running in the current phase, which
+ * cannot end until the thread arrives or leaves, and it records those after
+ * its join or departure. So when a phase ends (with the scheduler lock held)
+ * no event is being written. At that point, if the ring is at least half
+ * full, its events are appended to zsim-sync.bin in the output directory,
+ * next to the stats; the rest are written at termination. Events overwritten
+ * before being written out are counted as lost.
+ *
+ *   [SyncTraceHeader][SyncTraceEvent]*
+ *
+ * synctrace reads the file and derives, for each thread and phase, its
+ * arrival order, bound phase time (from departure or join to arrival or
+ * leave) and barrier wait time (from arrival to departure), and summarizes
+ * which threads are chronic stragglers.
+ */
+
+#define SYNC_TRACE_MAGIC 0x4e59534d49535aULL  // "ZSIMSYN"
+#define SYNC_TRACE_VERSION 1
+
+struct SyncTraceHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t numCores;
+    uint32_t phaseLength;  // initial, in cycles
+    uint32_t pad;
+};
+
+enum SyncEventType {
+    SYNC_ARRIVE,     // thread reaches the barrier
+    SYNC_DEPART,     // thread leaves the barrier, in the next phase (cid may differ after a handoff)
+    SYNC_JOIN,       // thread joins after a leave (e.g., a syscall) or at start
+    SYNC_LEAVE,      // thread leaves mid-phase
+    SYNC_HANDOFF,    // thread gives its core (cid) to thread arg
+    SYNC_PHASE_END,  // all threads arrived or left (no gid or cid)
+    SYNC_NUM_TYPES
+};
+
+struct SyncTraceEvent {
+    uint64_t ns;  // CLOCK_REALTIME, as getNs()
+    uint64_t phase;  // zinfo->numPhases when recorded
+    uint32_t gid;  // scheduler thread id, (pid << 16) | tid
+    uint32_t cid;
+    uint32_t arg;
+    uint32_t type;
+};
+
+class SyncTrace : public GlobAlloc {
+    private:
+        SyncTraceEvent* ring;
+        uint64_t ringMask;
+        const char* filename;
+
+        PAD();
+
+        volatile uint64_t head;  // next slot to reserve
+
+        PAD();
+
+        uint64_t written;  // next event to write out
+        uint64_t lost;
+
+    public:
+        // Truncates the file and writes the header
+        SyncTrace(const char* _filename, uint32_t numCores, uint32_t entries);
+
+        void initStats(AggregateStat* parentStat);
+
+        inline void record(SyncEventType type, uint32_t gid, uint32_t cid, uint32_t arg = 0) {
+            uint64_t idx = __sync_fetch_and_add(&head, 1);
+            SyncTraceEvent& ev = ring[idx & ringMask];
+            ev.ns = getNs();
+            ev.phase = zinfo->numPhases;
+            ev.gid = gid;
+            ev.cid = cid;
+            ev.arg = arg;
+            ev.type = type;
+        }
+
+        // Called at the end of each phase, with the scheduler lock held
+        void endPhase() {
+            if (head - written >= (ringMask + 1)/2) flush();
+        }
+
+        // Appends all recorded events to the file
+        void flush();
+};
+
+#endif  // SYNC_TRACE_H_
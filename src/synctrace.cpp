@@ -0,0 +1,238 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Summarizes a barrier and scheduler trace (sim.syncTrace, see sync_trace.h)
+ * to find the threads that hold up phases */
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "log.h"
+#include "sync_trace.h"
+
+using std::vector;
+
+GlobSimInfo* zinfo;  // sync_trace.h needs it to record, we only read
+
+struct ThreadSummary {
+    uint32_t lastCid;
+    uint64_t phases;  // arrivals
+    uint64_t last;  // times it was the last to arrive
+    uint64_t boundNs;
+    uint64_t waitNs;
+    uint64_t maxBoundNs;
+    uint64_t joins, leaves;
+    uint64_t handoffsIn, handoffsOut;
+
+    // Replay state
+    uint64_t startNs;  // of the current bound interval, 0 if not running
+    uint64_t arriveNs;  // 0 if not in the barrier
+};
+
+struct Arrival {
+    uint32_t key;
+    uint64_t ns;
+    uint64_t boundNs;
+};
+
+static vector<SyncTraceEvent> ReadTrace(const char* file, SyncTraceHeader& hdr) {
+    FILE* f = fopen(file, "r");
+    if (!f) panic("Could not open %s", file);
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1) panic("%s is too small to be a sync trace", file);
+    if (hdr.magic != SYNC_TRACE_MAGIC) panic("%s is not a sync trace", file);
+    if (hdr.version != SYNC_TRACE_VERSION) panic("%s has version %d, expected %d", file, hdr.version, SYNC_TRACE_VERSION);
+    vector<SyncTraceEvent> events;
+    SyncTraceEvent ev;
+    while (fread(&ev, sizeof(ev), 1, f) == 1) {
+        if (ev.type < SYNC_NUM_TYPES) events.push_back(ev);  // skip a torn final event
+    }
+    fclose(f);
+    // Slots are reserved in order, but timestamps may be taken slightly out of it
+    std::stable_sort(events.begin(), events.end(), [](const SyncTraceEvent& a, const SyncTraceEvent& b) { return a.ns < b.ns; });
+    return events;
+}
+
+static void PrintKey(uint32_t key, bool byCore) {
+    if (byCore) printf("%8d", key);
+    else printf("%5d:%-5d", key >> 16, key & 0xffff);
+}
+
+int main(int argc, char* argv[]) {
+    InitLog("");  // no log header
+    bool byCore = false;
+    bool perPhase = false;
+    uint32_t top = 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "cpn:")) != -1) {
+        switch (opt) {
+            case 'c': byCore = true; break;
+            case 'p': perPhase = true; break;
+            case 'n': top = atoi(optarg); break;
+            default: optind = argc + 1;  // print usage
+        }
+    }
+    if (optind != argc - 1) {
+        info("Summarizes a barrier and scheduler trace, finding the threads that hold up phases");
+        info("Usage: %s [-c] [-p] [-n <top>] <zsim-sync.bin>", argv[0]);
+        info("  -c: summarize by simulated core instead of by thread (pid:tid)");
+        info("  -p: print each phase's arrival order, with bound phase times in us");
+        info("  -n: print the top stragglers only (default 20, 0 for all)");
+        exit(1);
+    }
+
+    SyncTraceHeader hdr;
+    vector<SyncTraceEvent> events = ReadTrace(argv[optind], hdr);
+
+    std::map<uint32_t, ThreadSummary> threads;  // by gid
+    std::map<uint32_t, ThreadSummary> cores;  // by cid, only the totals
+    vector<Arrival> arrivals;  // of the current phase
+    uint64_t phases = 0;
+    double imbalanceSum = 0.0;  // per phase, 1 - mean/max bound time
+    uint64_t spreadNs = 0;  // first to last arrival, summed over phases
+    uint64_t firstNs = events.empty()? 0 : events.front().ns;
+    uint64_t lastNs = events.empty()? 0 : events.back().ns;
+
+    for (const SyncTraceEvent& ev : events) {
+        if (ev.type == SYNC_PHASE_END) {
+            if (arrivals.empty()) continue;
+            uint64_t maxBound = 0;
+            uint64_t sumBound = 0;
+            for (const Arrival& a : arrivals) {
+                maxBound = std::max(maxBound, a.boundNs);
+                sumBound += a.boundNs;
+            }
+            if (maxBound) imbalanceSum += 1.0 - ((double)sumBound)/arrivals.size()/maxBound;
+            spreadNs += arrivals.back().ns - arrivals.front().ns;
+            (byCore? cores : threads)[arrivals.back().key].last++;
+            if (perPhase) {
+                printf("phase %ld:", ev.phase);
+                for (const Arrival& a : arrivals) {
+                    printf(" ");
+                    if (byCore) printf("%d", a.key);
+                    else printf("%d:%d", a.key >> 16, a.key & 0xffff);
+                    printf("(%.1f)", a.boundNs/1e3);
+                }
+                printf("\n");
+            }
+            arrivals.clear();
+            phases++;
+            continue;
+        }
+
+        ThreadSummary& th = threads[ev.gid];
+        ThreadSummary& core = cores[ev.cid];
+        th.lastCid = ev.cid;
+        uint32_t key = byCore? ev.cid : ev.gid;
+        switch (ev.type) {
+            case SYNC_ARRIVE:
+                {
+                    uint64_t bound = th.startNs? ev.ns - th.startNs : 0;
+                    th.phases++;
+                    core.phases++;
+                    th.boundNs += bound;
+                    core.boundNs += bound;
+                    th.maxBoundNs = std::max(th.maxBoundNs, bound);
+                    core.maxBoundNs = std::max(core.maxBoundNs, bound);
+                    th.startNs = 0;
+                    th.arriveNs = ev.ns;
+                    arrivals.push_back({key, ev.ns, bound});
+                }
+                break;
+            case SYNC_DEPART:
+                if (th.arriveNs) {
+                    th.waitNs += ev.ns - th.arriveNs;
+                    core.waitNs += ev.ns - th.arriveNs;
+                }
+                th.arriveNs = 0;
+                th.startNs = ev.ns;
+                break;
+            case SYNC_JOIN:
+                th.joins++;
+                core.joins++;
+                th.startNs = ev.ns;
+                break;
+            case SYNC_LEAVE:
+                if (th.startNs) {
+                    // A partial bound interval; count the time, not the phase
+                    th.boundNs += ev.ns - th.startNs;
+                    core.boundNs += ev.ns - th.startNs;
+                }
+                th.leaves++;
+                core.leaves++;
+                th.startNs = 0;
+                break;
+            case SYNC_HANDOFF:
+                th.handoffsOut++;
+                threads[ev.arg].handoffsIn++;
+                core.handoffsOut++;  // switches on this core
+                break;
+        }
+    }
+
+    std::map<uint32_t, ThreadSummary>& summaries = byCore? cores : threads;
+    uint32_t numKeys = 0;
+    for (auto& kv : summaries) numKeys += kv.second.phases? 1 : 0;
+
+    printf("# %ld events, %ld phases over %.3f s, %d %s, %d simulated cores\n", events.size(), phases, (lastNs - firstNs)/1e9,
+            numKeys, byCore? "cores" : "threads", hdr.numCores);
+    if (phases) {
+        printf("# Imbalance: %.1f%% of the slowest thread's bound phase time is wasted by the average thread\n", 100.0*imbalanceSum/phases);
+        printf("# Arrival spread (first to last arrival): %.1f us per phase\n", spreadNs/1e3/phases);
+    }
+
+    vector<std::pair<uint32_t, const ThreadSummary*>> sorted;
+    for (auto& kv : summaries) sorted.push_back(std::make_pair(kv.first, &kv.second));
+    std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, const ThreadSummary*>& a,
+                const std::pair<uint32_t, const ThreadSummary*>& b) {
+        return (a.second->last != b.second->last)? a.second->last > b.second->last : a.second->boundNs > b.second->boundNs;
+    });
+
+    // A thread is a chronic straggler if it is last far more often than its fair share
+    double fairShare = numKeys? 1.0/numKeys : 0.0;
+    printf("%11s %8s %8s %7s %11s %11s %11s %7s %7s", byCore? "core" : "pid:tid", "phases", "last", "last%",
+            "avgBound", "maxBound", "avgWait", "joins", "leaves");
+    if (byCore) printf(" %7s\n", "switch");
+    else printf(" %7s %7s %7s\n", "hoIn", "hoOut", "core");
+    printf("%11s %8s %8s %7s %11s %11s %11s\n", "", "", "", "", "(us)", "(us)", "(us)");
+    uint32_t printed = 0;
+    for (auto& p : sorted) {
+        const ThreadSummary& s = *p.second;
+        if (!s.phases && !s.joins) continue;
+        if (top && printed++ == top) break;
+        double lastFrac = s.phases? ((double)s.last)/s.phases : 0.0;
+        printf("%s", (numKeys > 1 && lastFrac > 2*fairShare && s.last > 1)? "*" : " ");
+        PrintKey(p.first, byCore);
+        printf(" %8ld %8ld %6.1f%% %11.1f %11.1f %11.1f %7ld %7ld", s.phases, s.last, 100.0*lastFrac,
+                s.phases? s.boundNs/1e3/s.phases : 0.0, s.maxBoundNs/1e3, s.phases? s.waitNs/1e3/s.phases : 0.0, s.joins, s.leaves);
+        if (byCore) printf(" %7ld\n", s.handoffsOut);
+        else printf(" %7ld %7ld %7d\n", s.handoffsIn, s.handoffsOut, s.lastCid);
+    }
+    printf("# * = chronic straggler, last to arrive more than twice as often as its fair share (%.1f%%)\n", 200.0*fairShare);
+    return 0;
+}
@@ -23,39 +23,58 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <fstream>
-#include <iostream>
+#include "flat_stats.h"
 #include "galloc.h"
 #include "log.h"
 #include "stats.h"
-#include "zsim.h"
 
-using std::endl;
+/* Text backends. Both preformat everything but the values once, format each
+ * dump into a global-heap buffer, and write it out with a single write, either
+ * on unbuffered dumps or once the buffer exceeds bytesPerWrite.
+ */
 
 class TextBackendImpl : public GlobAlloc {
     private:
-        const char* filename;
-        AggregateStat* rootStat;
+        FlatStats* stats;
+        g_vector<g_string> texts;  // texts[i] precedes value i; the last one follows the last value
+        StatsOutputBuffer* out;
+        size_t bytesPerWrite;
+
+        static void indent(g_string& cur, uint32_t level) {
+            cur.append(level, ' ');
+        }
 
-        void dumpStat(Stat* s, uint32_t level, std::ofstream* out) {
-            for (uint32_t i = 0; i < level; i++) *out << " ";
-            *out << s->name() << ": ";
+        // Must walk in the same order as FlatStats
+        void formatStat(Stat* s, uint32_t level, g_string& cur) {
+            indent(cur, level);
+            cur += s->name();
+            cur += ": ";
             if (AggregateStat* as = dynamic_cast<AggregateStat*>(s)) {
-                *out << "# " << as->desc() << endl;
+                cur += "# ";
+                cur += as->desc();
+                cur += "\n";
                 for (uint32_t i = 0; i < as->size(); i++) {
-                    dumpStat(as->get(i), level+1, out);
+                    formatStat(as->get(i), level+1, cur);
                 }
             } else if (ScalarStat* ss = dynamic_cast<ScalarStat*>(s)) {
-                *out << ss->get() << " # " << ss->desc() << endl;
+                texts.push_back(cur);
+                cur = " # ";
+                cur += ss->desc();
+                cur += "\n";
             } else if (VectorStat* vs = dynamic_cast<VectorStat*>(s)) {
-                *out << "# " << vs->desc() << endl;
+                cur += "# ";
+                cur += vs->desc();
+                cur += "\n";
                 for (uint32_t i = 0; i < vs->size(); i++) {
-                    for (uint32_t j = 0; j < level+1; j++) *out << " ";
+                    indent(cur, level+1);
                     if (vs->hasCounterNames()) {
-                        *out << vs->counterName(i) << ": " << vs->count(i) << endl;
+                        cur += vs->counterName(i);
                     } else {
-                        *out << i << ": " << vs->count(i) << endl;
+                        cur += std::to_string(i).c_str();
                     }
+                    cur += ": ";
+                    texts.push_back(cur);
+                    cur = "\n";
                 }
             } else {
                 panic("Unrecognized stat type");
@@ -63,26 +82,71 @@ class TextBackendImpl : public GlobAlloc {
         }
 
     public:
-        TextBackendImpl(const char* _filename, AggregateStat* _rootStat) :
-            filename(_filename), rootStat(_rootStat)
-        {
-            std::ofstream out(filename, std::ios_base::out);
-            out << "# zsim stats" << endl;
-            out << "===" << endl;
+        TextBackendImpl(const char* filename, AggregateStat* rootStat, size_t _bytesPerWrite) : bytesPerWrite(_bytesPerWrite) {
+            stats = new FlatStats(rootStat);
+            g_string cur;
+            formatStat(rootStat, 0, cur);
+            cur += "===\n";
+            texts.push_back(cur);
+            assert(texts.size() == stats->size() + 1);
+
+            out = new StatsOutputBuffer(filename, bytesPerWrite);
+            out->append("# zsim stats\n===\n");
+            out->flush();
         }
 
         void dump(bool buffered) {
-            std::ofstream out(filename, std::ios_base::app);
-            dumpStat(rootStat, 0, &out);
-            out << "===" << endl;
+            for (uint32_t i = 0; i < stats->size(); i++) {
+                out->append(texts[i]);
+                out->appendU64(stats->get(i));
+            }
+            out->append(texts.back());
+            if (!buffered || out->size() >= bytesPerWrite) out->flush();
         }
 };
 
-TextBackend::TextBackend(const char* filename, AggregateStat* rootStat) {
-    backend = new TextBackendImpl(filename, rootStat);
+TextBackend::TextBackend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite) {
+    backend = new TextBackendImpl(filename, rootStat, bytesPerWrite);
 }
 
 void TextBackend::dump(bool buffered) {
     backend->dump(buffered);
 }
 
+
+/* One JSON object per dump and line, keyed by flattened stat names */
+class JSONLinesBackendImpl : public GlobAlloc {
+    private:
+        FlatStats* stats;
+        g_vector<g_string> keys;  // with the separator before them
+        StatsOutputBuffer* out;
+        size_t bytesPerWrite;
+
+    public:
+        JSONLinesBackendImpl(const char* filename, AggregateStat* rootStat, size_t _bytesPerWrite) : bytesPerWrite(_bytesPerWrite) {
+            stats = new FlatStats(rootStat);
+            for (uint32_t i = 0; i < stats->size(); i++) {
+                // Stat names have no quotes or backslashes, so they need no escaping
+                keys.push_back(g_string(i? ", \"" : "{\"") + stats->name(i) + "\": ");
+            }
+            out = new StatsOutputBuffer(filename, bytesPerWrite);
+        }
+
+        void dump(bool buffered) {
+            if (!stats->size()) out->append('{');
+            for (uint32_t i = 0; i < stats->size(); i++) {
+                out->append(keys[i]);
+                out->appendU64(stats->get(i));
+            }
+            out->append("}\n");
+            if (!buffered || out->size() >= bytesPerWrite) out->flush();
+        }
+};
+
+JSONLinesBackend::JSONLinesBackend(const char* filename, AggregateStat* rootStat, size_t bytesPerWrite) {
+    backend = new JSONLinesBackendImpl(filename, rootStat, bytesPerWrite);
+}
+
+void JSONLinesBackend::dump(bool buffered) {
+    backend->dump(buffered);
+}
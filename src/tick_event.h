@@ -31,6 +31,10 @@
 #include "zsim.h"
 
 //FIXME: Rearchitect this SENSIBLY
+/* Calls obj->tick(cycle) and requeues itself after the returned delay. A
+ * delay of 0 deactivates the event; event-driven objects return 0 when they
+ * go idle and call wake() from the weave phase when they get work again.
+ */
 template <class T>
 class TickEvent : public TimingEvent, public GlobAlloc { //this one should be allocated from glob mem
     private:
@@ -52,12 +56,22 @@ class TickEvent : public TimingEvent, public GlobAlloc { //this one should be al
             zinfo->contentionSim->enqueueSynced(this, startCycle);
         }
 
+        // Weave phase, from the domain of the event
+        void wake(uint64_t cycle) {
+            assert(!active);
+            active = true;
+            requeue(cycle);
+        }
+
+        bool isActive() const {return active;}
+
         void simulate(uint64_t startCycle) {
             uint32_t delay = obj->tick(startCycle);
             if (delay) {
                 requeue(startCycle+delay);
             } else {
                 active = false;
+                hold();
             }
         }
 
@@ -25,6 +25,7 @@
 
 #include "timing_cache.h"
 #include "event_recorder.h"
+#include "mem_sampler.h"
 #include "timing_event.h"
 #include "zsim.h"
 
@@ -79,7 +80,7 @@ class ReplAccessEvent : public TimingEvent {
 };
 
 TimingCache::TimingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp,
-        uint32_t _accLat, uint32_t _invLat, uint32_t mshrs, uint32_t _tagLat, uint32_t _ways, uint32_t _cands, uint32_t _domain, const g_string& _name)
+        uint32_t _accLat, uint32_t _invLat, uint32_t mshrs, uint32_t _tagLat, uint32_t _ways, uint32_t _cands, uint32_t _domain, bool _elideHits, const g_string& _name)
     : Cache(_numLines, _cc, _array, _rp, _accLat, _invLat, _name), numMSHRs(mshrs), tagLat(_tagLat), ways(_ways), cands(_cands)
 {
     lastFreeCycle = 0;
@@ -87,7 +88,8 @@ TimingCache::TimingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPo
     assert(numMSHRs > 0);
     activeMisses = 0;
     domain = _domain;
-    info("%s: mshrs %d domain %d", name.c_str(), numMSHRs, domain);
+    elideHits = _elideHits;
+    info("%s: mshrs %d domain %d%s", name.c_str(), numMSHRs, domain, elideHits? " (eliding hits)" : "");
 }
 
 void TimingCache::initStats(AggregateStat* parentStat) {
@@ -107,6 +109,11 @@ void TimingCache::initStats(AggregateStat* parentStat) {
     cacheStat->append(&profMissRespLat);
     cacheStat->append(&profMissLat);
 
+    if (elideHits) {
+        profElidedHits.init("elidedHits", "Hits that did not produce weave phase events");
+        cacheStat->append(&profElidedHits);
+    }
+
     parentStat->append(cacheStat);
 }
 
@@ -126,6 +133,7 @@ uint64_t TimingCache::access(MemReq& req) {
         bool updateReplacement = (req.type == GETS) || (req.type == GETX);
         int32_t lineId = array->lookup(req.lineAddr, &req, updateReplacement);
         respCycle += accLat;
+        if (unlikely(zinfo->memSampler != nullptr) && updateReplacement) zinfo->memSampler->noteAccess(req.srcId, name, lineId != -1);
 
         if (lineId == -1 /*&& cc->shouldAllocate(req)*/) {
             assert(cc->shouldAllocate(req)); //dsm: for now, we don't deal with non-inclusion in TimingCache
@@ -156,10 +164,21 @@ uint64_t TimingCache::access(MemReq& req) {
             // Hit
             assert(!writebackRecord.isValid());
             assert(!accessRecord.isValid());
-            uint64_t hitLat = respCycle - req.cycle; // accLat + invLat
-            HitEvent* ev = new (evRec) HitEvent(this, hitLat, domain);
-            ev->setMinStartCycle(req.cycle);
-            tr.startEvent = tr.endEvent = ev;
+            if (elideHits) {
+                /* Only this core accesses a private cache, so the hit can
+                 * only be delayed by the core's own misses holding MSHRs or
+                 * the tag port. We ignore that, leave no record, and the
+                 * core's recorder covers the hit with the delay to its next
+                 * recorded access. Only accesses that miss here, and so reach
+                 * shared caches, the network, or memory, produce events.
+                 */
+                profElidedHits.inc();
+            } else {
+                uint64_t hitLat = respCycle - req.cycle; // accLat + invLat
+                HitEvent* ev = new (evRec) HitEvent(this, hitLat, domain);
+                ev->setMinStartCycle(req.cycle);
+                tr.startEvent = tr.endEvent = ev;
+            }
         } else {
             assert_msg(getDoneCycle == respCycle, "gdc %ld rc %ld", getDoneCycle, respCycle);
 
@@ -256,7 +275,7 @@ uint64_t TimingCache::access(MemReq& req) {
             tr.startEvent = mse;
             tr.endEvent = mre; // note the end event is the response, not the wback
         }
-        evRec->pushRecord(tr);
+        if (tr.isValid()) evRec->pushRecord(tr);
     }
 
     cc->endAccess(req);
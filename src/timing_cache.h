@@ -48,6 +48,10 @@ class TimingCache : public Cache {
 
         uint32_t domain;
 
+        // Private caches can skip hit events (sim.elidePrivateHits), see access()
+        bool elideHits;
+        Counter profElidedHits;
+
         // For zcache replacement simulation (pessimistic, assumes we walk the whole tree)
         uint32_t tagLat, ways, cands;
 
@@ -57,7 +61,7 @@ class TimingCache : public Cache {
 
     public:
         TimingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, uint32_t mshrs,
-                uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t _domain, const g_string& _name);
+                uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t _domain, bool _elideHits, const g_string& _name);
         void initStats(AggregateStat* parentStat);
 
         uint64_t access(MemReq& req);
@@ -34,7 +34,7 @@ TimingCore::TimingCore(FilterCache* _l1i, FilterCache* _l1d, uint32_t _domain, g
     : Core(_name), l1i(_l1i), l1d(_l1d), instrs(0), curCycle(0), cRec(_domain, _name) {}
 
 uint64_t TimingCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return (curCycle - zinfo->globPhaseCycles) % zinfo->phaseLength;
 }
 
 void TimingCore::initStats(AggregateStat* parentStat) {
@@ -68,28 +68,33 @@ void TimingCore::contextSwitch(int32_t gid) {
 
 void TimingCore::join() {
     DEBUG_MSG("[%s] Joining, curCycle %ld phaseEnd %ld", name.c_str(), curCycle, phaseEndCycle);
+    curCycle = l1d->getFastPath()->apply(curCycle);
     curCycle = cRec.notifyJoin(curCycle);
     phaseEndCycle = zinfo->globPhaseCycles + zinfo->phaseLength;
     DEBUG_MSG("[%s] Joined, curCycle %ld phaseEnd %ld", name.c_str(), curCycle, phaseEndCycle);
 }
 
 void TimingCore::leave() {
+    curCycle = l1d->getFastPath()->apply(curCycle);
     cRec.notifyLeave(curCycle);
 }
 
 void TimingCore::loadAndRecord(Address addr) {
+    curCycle = l1d->getFastPath()->apply(curCycle);
     uint64_t startCycle = curCycle;
     curCycle = l1d->load(addr, curCycle);
     cRec.record(startCycle);
 }
 
 void TimingCore::storeAndRecord(Address addr) {
+    curCycle = l1d->getFastPath()->apply(curCycle);
     uint64_t startCycle = curCycle;
     curCycle = l1d->store(addr, curCycle);
     cRec.record(startCycle);
 }
 
 void TimingCore::bblAndRecord(Address bblAddr, BblInfo* bblInfo) {
+    curCycle = l1d->getFastPath()->apply(curCycle);
     instrs += bblInfo->instrs;
     curCycle += bblInfo->instrs;
 
@@ -103,7 +108,7 @@ void TimingCore::bblAndRecord(Address bblAddr, BblInfo* bblInfo) {
 
 
 InstrFuncPtrs TimingCore::GetFuncPtrs() {
-    return {LoadAndRecordFunc, StoreAndRecordFunc, BblAndRecordFunc, BranchFunc, PredLoadAndRecordFunc, PredStoreAndRecordFunc, FPTR_ANALYSIS, {0}};
+    return {LoadAndRecordFunc, StoreAndRecordFunc, BblAndRecordFunc, BranchFunc, PredLoadAndRecordFunc, PredStoreAndRecordFunc, FPTR_ANALYSIS, l1d->getFastPath()};
 }
 
 void TimingCore::LoadAndRecordFunc(THREADID tid, ADDRINT addr) {
@@ -119,7 +124,7 @@ void TimingCore::BblAndRecordFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInf
     core->bblAndRecord(bblAddr, bblInfo);
 
     while (core->curCycle > core->phaseEndCycle) {
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
         uint32_t cid = getCid(tid);
         uint32_t newCid = TakeBarrier(tid, cid);
         if (newCid != cid) break; /*context-switch*/
@@ -26,6 +26,7 @@
 #ifndef TIMING_CORE_H_
 #define TIMING_CORE_H_
 
+#include "contention_sim.h"
 #include "core.h"
 #include "core_recorder.h"
 #include "event_recorder.h"
@@ -34,7 +35,7 @@
 
 class FilterCache;
 
-class TimingCore : public Core {
+class TimingCore : public Core, public WeavePhaseClient {
     private:
         FilterCache* l1i;
         FilterCache* l1d;
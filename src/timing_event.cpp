@@ -27,10 +27,17 @@
 #include <sstream>
 #include <typeinfo>
 #include "contention_sim.h"
+#include "weave_capture.h"
 #include "zsim.h"
 
 /* TimingEvent */
 
+WeaveCapture* TimingEvent::capture = nullptr;
+
+void TimingEvent::captureDone(uint64_t doneCycle) {
+    capture->eventDone(this, doneCycle);
+}
+
 void TimingEvent::parentDone(uint64_t startCycle) {
     cycle = MAX(cycle, startCycle);
     assert(numParents);
@@ -89,6 +96,7 @@ CrossingEvent::CrossingEvent(TimingEvent* parent, TimingEvent* child, uint64_t _
     : TimingEvent(0, 0, child->domain), cpe(this, parent->domain)
 {
     assert(parent->domain != child->domain);
+    slab::retainElem(this); //cpe frees itself too
     parentEv = parent;
     evRec = _evRec;
     srcDomain = parent->domain;
@@ -63,6 +63,7 @@ struct TimingEventBlock {
 enum EventState {EV_INVALID, EV_NONE, EV_QUEUED, EV_RUNNING, EV_HELD, EV_DONE};
 
 class CrossingEvent;
+class WeaveCapture;
 
 class TimingEvent {
     private:
@@ -179,6 +180,7 @@ class TimingEvent {
         void done(uint64_t doneCycle) {
             assert(state == EV_RUNNING); //ContentionSim sets it when calling simulate()
             state = EV_DONE;
+            if (unlikely(capture != nullptr)) captureDone(doneCycle);
             auto vLambda = [this, doneCycle](TimingEvent** childPtr) {
                 checkDomain(*childPtr);
                 (*childPtr)->parentDone(doneCycle+postDelay);
@@ -213,8 +215,13 @@ class TimingEvent {
         virtual std::string str() { std::string res; return res; }
 
     private:
+        //Set by ContentionSim::setCapture(). Process-local: only the process that runs the sim threads finishes events
+        static WeaveCapture* capture;
+
         void* operator new (size_t);
 
+        void captureDone(uint64_t doneCycle); //see cpp
+
         void propagateDomain(int32_t dom) {
             assert(domain == -1);
             domain = dom;
@@ -282,6 +289,7 @@ class TimingEvent {
     friend class ContentionSim;
     friend class DelayEvent; //DelayEvent is, for now, the only child of TimingEvent that should do anything other than implement simulate
     friend class CrossingEvent;
+    friend class WeaveCapture;
 };
 
 class DelayEvent : public TimingEvent {
@@ -357,6 +365,7 @@ class CrossingEvent : public TimingEvent {
         void markSrcEventDone(uint64_t cycle);
 
         friend class ContentionSim;
+        friend class WeaveCapture;
 };
 
 
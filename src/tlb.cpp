@@ -0,0 +1,110 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tlb.h"
+#include "bithacks.h"
+#include "filter_cache.h"
+#include "timing_event.h"
+
+#define MAX_WALK_LEVELS 8
+
+TLB::TLB(uint32_t entries, uint32_t _ways, const char* name) : curTs(0), ways(_ways) {
+    if (ways == 0 || entries % ways != 0) panic("%s: entries (%d) must be a multiple of ways (%d)", name, entries, ways);
+    uint32_t numSets = entries/ways;
+    if (!isPow2(numSets)) panic("%s: number of sets (%d) must be a power of two", name, numSets);
+    setMask = numSets - 1;
+    keys = gm_calloc<uint64_t>(entries);
+    frames = gm_calloc<uint64_t>(entries);
+    ts = gm_calloc<uint64_t>(entries);
+}
+
+MMU::MMU(VirtualMemory* _vm, TLB* _l1, TLB* _l2, uint32_t _l2Latency, uint32_t _cid, uint32_t lineSize)
+    : vm(_vm), l1(_l1), l2(_l2), walkCache(nullptr), l2Latency(_l2Latency), cid(_cid)
+{
+    lineBits = ilog2(lineSize);
+    pageLineBits = vm->getPageBits() - lineBits;
+    vpnMask = (1ULL << vm->getVpnBits()) - 1;
+    assert(vm->getLevels() <= MAX_WALK_LEVELS);
+}
+
+void MMU::initStats(AggregateStat* parentStat, const char* name) {
+    AggregateStat* mmuStat = new AggregateStat();
+    mmuStat->init(name, "MMU stats");
+    profL1Hits.init("l1Hits", "L1 TLB hits");
+    profL2Hits.init("l2Hits", "L2 TLB hits (L1 TLB misses)");
+    profWalks.init("walks", "Page walks (L2 TLB misses)");
+    profWalkCycles.init("walkCycles", "Cycles spent in page walks");
+    mmuStat->append(&profL1Hits);
+    mmuStat->append(&profL2Hits);
+    mmuStat->append(&profWalks);
+    mmuStat->append(&profWalkCycles);
+    parentStat->append(mmuStat);
+}
+
+// Chains next after acc, as Cache::access does with writebacks
+static void ChainRecords(TimingRecord& acc, const TimingRecord& next, EventRecorder* evRec) {
+    if (!acc.isValid()) {
+        acc = next;
+        return;
+    }
+    assert(acc.endEvent);
+    assert(next.reqCycle >= acc.respCycle);
+    DelayEvent* dEv = new (evRec) DelayEvent(next.reqCycle - acc.respCycle);
+    dEv->setMinStartCycle(acc.respCycle);
+    acc.endEvent->addChild(dEv, evRec)->addChild(next.startEvent, evRec);
+    acc.respCycle = next.respCycle;
+    acc.type = next.type;
+    acc.endEvent = next.endEvent;
+}
+
+uint64_t MMU::translateMiss(uint64_t key, Address vpn, uint64_t& cycle, TimingRecord& walkRec) {
+    uint64_t frame;
+    cycle += l2Latency;
+    if (l2->lookup(key, &frame)) {
+        profL2Hits.inc();
+    } else {
+        profWalks.inc();
+        uint64_t startCycle = cycle;
+        Address pteAddrs[MAX_WALK_LEVELS];
+        uint32_t levels = vm->getWalkAddrs(procIdx, vpn, cid, pteAddrs);
+        EventRecorder* evRec = zinfo->eventRecorders[cid];
+        for (uint32_t i = 0; i < levels; i++) {
+            cycle = walkCache->walkAccess(pteAddrs[i] >> lineBits, cycle);
+            if (evRec && evRec->hasRecord()) ChainRecords(walkRec, evRec->popRecord(), evRec);
+        }
+        frame = vm->getFrame(procIdx, vpn, cid);
+        profWalkCycles.inc(cycle - startCycle);
+        l2->insert(key, frame);
+    }
+    l1->insert(key, frame);
+    return frame;
+}
+
+void MMU::mergeWalkRecord(TimingRecord& walkRec) {
+    EventRecorder* evRec = zinfo->eventRecorders[cid];
+    assert(evRec);  // only recorders produce walk records
+    if (evRec->hasRecord()) ChainRecords(walkRec, evRec->popRecord(), evRec);
+    evRec->pushRecord(walkRec);
+}
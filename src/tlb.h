@@ -0,0 +1,138 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TLB_H_
+#define TLB_H_
+
+#include <stdint.h>
+#include "event_recorder.h"
+#include "galloc.h"
+#include "log.h"
+#include "memory_hierarchy.h"
+#include "stats.h"
+#include "vmem.h"
+#include "zsim.h"
+
+class FilterCache;
+
+/* Set-associative, LRU TLB. Entries are tagged with the address space, so
+ * context switches need no flushes.
+ */
+class TLB : public GlobAlloc {
+    private:
+        uint64_t* keys;  // 0 if invalid
+        uint64_t* frames;
+        uint64_t* ts;  // last use, for LRU
+        uint64_t curTs;
+        uint64_t setMask;
+        uint32_t ways;
+
+    public:
+        TLB(uint32_t entries, uint32_t _ways, const char* name);
+
+        static inline uint64_t makeKey(uint32_t asid, Address vpn) {
+            assert(vpn < (1ULL << 48));
+            return (((uint64_t)asid + 1) << 48) | vpn;
+        }
+
+        inline bool lookup(uint64_t key, uint64_t* frame) {
+            uint64_t base = (key & setMask)*ways;
+            for (uint32_t w = 0; w < ways; w++) {
+                if (keys[base + w] == key) {
+                    ts[base + w] = ++curTs;
+                    *frame = frames[base + w];
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        inline void insert(uint64_t key, uint64_t frame) {
+            uint64_t base = (key & setMask)*ways;
+            uint64_t victim = base;
+            for (uint32_t w = 1; w < ways; w++) {
+                if (ts[base + w] < ts[victim]) victim = base + w;  // invalid entries have ts 0
+            }
+            keys[victim] = key;
+            frames[victim] = frame;
+            ts[victim] = ++curTs;
+        }
+};
+
+/* Translates the addresses of a core's L1 cache misses (L1 caches are
+ * virtually indexed and tagged, so hits need no translation). Each L1 has its
+ * own L1 TLB, and the core's instruction and data MMUs share an L2 TLB. L2
+ * TLB misses walk the page table, reading each level's entry through the
+ * core's L1 data cache, so walks hit or miss in the hierarchy like any other
+ * access. Walks are serialized with the access that caused them, also in the
+ * weave phase: their timing records are chained before the access's record.
+ */
+class MMU : public GlobAlloc {
+    private:
+        VirtualMemory* vm;
+        TLB* l1;
+        TLB* l2;
+        FilterCache* walkCache;
+        uint32_t l2Latency;
+        uint32_t cid;
+        uint32_t pageLineBits;  // log2(lines per page)
+        uint32_t lineBits;
+        Address vpnMask;  // drops the sign extension of kernel-half addresses
+
+        Counter profL1Hits, profL2Hits, profWalks, profWalkCycles;
+
+    public:
+        MMU(VirtualMemory* _vm, TLB* _l1, TLB* _l2, uint32_t _l2Latency, uint32_t _cid, uint32_t lineSize);
+
+        void setWalkCache(FilterCache* _walkCache) {walkCache = _walkCache;}
+        uint32_t getPageLineBits() const {return pageLineBits;}
+
+        void initStats(AggregateStat* parentStat, const char* name);
+
+        /* Returns the physical line address of vLineAddr in the current
+         * process. Advances cycle by the translation latency. If a page walk
+         * produced timing records, they are chained in walkRec, which the
+         * caller must merge with its own access (see mergeWalkRecord()).
+         */
+        inline Address translate(Address vLineAddr, uint64_t& cycle, TimingRecord& walkRec) {
+            Address vpn = (vLineAddr >> pageLineBits) & vpnMask;
+            uint64_t key = TLB::makeKey(procIdx, vpn);
+            uint64_t frame;
+            if (likely(l1->lookup(key, &frame))) {
+                profL1Hits.inc();
+            } else {
+                frame = translateMiss(key, vpn, cycle, walkRec);
+            }
+            return (frame << pageLineBits) | (vLineAddr & ((1ULL << pageLineBits) - 1));
+        }
+
+        // Chains the access's timing record (if any) after walkRec, and leaves the result as the core's record
+        void mergeWalkRecord(TimingRecord& walkRec);
+
+    private:
+        uint64_t translateMiss(uint64_t key, Address vpn, uint64_t& cycle, TimingRecord& walkRec);
+};
+
+#endif  // TLB_H_
@@ -24,7 +24,10 @@
  */
 
 #include "utility_monitor.h"
+#include <algorithm>
+#include <emmintrin.h>  // NOLINT
 #include "hash.h"
+#include "pad.h"
 
 #define DEBUG_UMON 0
 //#define DEBUG_UMON 1
@@ -35,20 +38,21 @@ UMon::UMon(uint32_t _bankLines, uint32_t _umonLines, uint32_t _buckets) {
     samplingFactor = _bankLines/umonLines;
     sets = umonLines/buckets;
 
-    heads = gm_calloc<Node*>(sets);
-    array = gm_calloc<Node*>(sets);
+    assert_msg(buckets <= 256, "UMon ranks are 8-bit, so it can't have more than 256 buckets (%d)", buckets);
+    setWays = (buckets + 1) & ~1;
+    setRankBytes = (buckets + 15) & ~15;
+    tags = gm_memalign<Address>(CACHE_LINE_BYTES, sets*setWays);
+    ranks = gm_memalign<uint8_t>(CACHE_LINE_BYTES, sets*setRankBytes);
     for (uint32_t i = 0; i < sets; i++) {
-        array[i] = gm_calloc<Node>(buckets);
-        heads[i] = &array[i][0];
-        for (uint32_t j = 0; j < buckets-1; j++) {
-            array[i][j].next = &array[i][j+1];
-        }
+        for (uint32_t j = 0; j < setWays; j++) tags[i*setWays + j] = 0;
+        // Padding ranks are 255, so they're never younger than the accessed line
+        for (uint32_t j = 0; j < setRankBytes; j++) ranks[i*setRankBytes + j] = (j < buckets)? j : 255;
     }
 
     curWayHits = gm_calloc<uint64_t>(buckets);
     curMisses = 0;
 
-    hf = new H3HashFamily(2, 32, 0xF000BAAD);
+    hf = new H3HashFamily(1, 32, 0xF000BAAD);
 
     samplingFactorBits = 0;
     uint32_t tmp = samplingFactor;
@@ -57,6 +61,9 @@ UMon::UMon(uint32_t _bankLines, uint32_t _umonLines, uint32_t _buckets) {
     setsBits = 0;
     tmp = sets;
     while (tmp >>= 1) setsBits++;
+
+    assert_msg(samplingFactorBits + setsBits <= 32, "UMon needs %ld hash bits, only 32 available",
+            samplingFactorBits + setsBits);
 }
 
 void UMon::initStats(AggregateStat* parentStat) {
@@ -64,11 +71,37 @@ void UMon::initStats(AggregateStat* parentStat) {
     profMisses.init("misses", "Sampled misses"); parentStat->append(&profMisses);
 }
 
+// Returns the way holding lineAddr, or buckets if it's not in the set
+inline uint32_t UMon::findWay(const Address* setTags, const uint8_t* setRanks, Address lineAddr) const {
+    uint32_t way = buckets;
+    __m128i key = _mm_set1_epi64x(lineAddr);
+    for (uint32_t base = 0; base < setWays; base += 64) {
+        // Branch once per 64 ways; in the common case there's one match or none
+        uint64_t matches = 0;
+        uint32_t chunkWays = std::min(64u, setWays - base);
+        for (uint32_t w = 0; w < chunkWays; w += 2) {
+            // SSE2 has no 64-bit compare, so AND each 32-bit half's result with the other half's
+            __m128i eq = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)&setTags[base + w]), key);
+            eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            matches |= ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(eq))) << w;
+        }
+
+        // Empty ways have a 0 tag, so several ways may match; like a walk
+        // from MRU to LRU, pick the one closest to MRU
+        while (matches) {
+            uint32_t m = base + __builtin_ctzll(matches);
+            matches &= matches - 1;
+            if (m < buckets && (way == buckets || setRanks[m] < setRanks[way])) way = m;
+        }
+    }
+    return way;
+}
 
 void UMon::access(Address lineAddr) {
     //1. Hash to decide if it should go in the cache
+    uint64_t hash = hf->hash(0, lineAddr);
     uint64_t sampleMask = ~(((uint64_t)-1LL) << samplingFactorBits);
-    uint64_t sampleSel = (hf->hash(0, lineAddr)) & sampleMask;
+    uint64_t sampleSel = hash & sampleMask;
 
     //info("0x%lx 0x%lx", sampleMask, sampleSel);
 
@@ -78,38 +111,45 @@ void UMon::access(Address lineAddr) {
 
     //2. Insert; hit or miss?
     uint64_t setMask = ~(((uint64_t)-1LL) << setsBits);
-    uint64_t set = (hf->hash(1, lineAddr)) & setMask;
+    uint64_t set = (hash >> samplingFactorBits) & setMask;
 
-    // Check hit
-    Node* prev = nullptr;
-    Node* cur = heads[set];
-    bool hit = false;
-    for (uint32_t b = 0; b < buckets; b++) {
-        if (cur->addr == lineAddr) { //Hit at position b, profile
-            //profHits.inc();
-            //profWayHits.inc(b);
-            curWayHits[b]++;
-            hit = true;
-            break;
-        } else if (b < buckets-1) {
-            prev = cur;
-            cur = cur->next;
-        }
-    }
+    Address* setTags = &tags[set*setWays];
+    uint8_t* setRanks = &ranks[set*setRankBytes];
 
-    //Profile miss, kick cur out, put lineAddr in
-    if (!hit) {
+    // Check hit
+    uint32_t way = findWay(setTags, setRanks, lineAddr);
+    uint32_t rank;
+    if (way < buckets) { //Hit at position rank, profile
+        rank = setRanks[way];
+        //profHits.inc();
+        //profWayHits.inc(rank);
+        curWayHits[rank]++;
+    } else { //Profile miss, kick the LRU line out, put lineAddr in
         curMisses++;
         //profMisses.inc();
-        assert(cur->next == nullptr);
-        cur->addr = lineAddr;
+        rank = buckets - 1;
+        __m128i lru = _mm_set1_epi8(rank);
+        for (uint32_t w = 0; w < setRankBytes; w += 16) {
+            uint32_t match = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)&setRanks[w]), lru));
+            if (match) {
+                way = w + __builtin_ctz(match);
+                break;
+            }
+        }
+        assert(way < buckets);
+        setTags[way] = lineAddr;
     }
 
-    //Move cur to MRU (happens regardless of whether this is a hit or a miss)
-    if (prev) {
-        prev->next = cur->next;
-        cur->next = heads[set];
-        heads[set] = cur;
+    //Move to MRU (happens regardless of whether this is a hit or a miss)
+    if (rank) {
+        // SSE2 has no unsigned byte compare, but r < rank <=> min(r, rank-1) == r
+        __m128i maxYounger = _mm_set1_epi8(rank - 1);
+        for (uint32_t w = 0; w < setRankBytes; w += 16) {
+            __m128i r = _mm_load_si128((const __m128i*)&setRanks[w]);
+            __m128i younger = _mm_cmpeq_epi8(_mm_min_epu8(r, maxYounger), r);  // 0xff if r < rank
+            _mm_store_si128((__m128i*)&setRanks[w], _mm_sub_epi8(r, younger));
+        }
+        setRanks[way] = 0;
     }
 }
 
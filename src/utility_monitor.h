@@ -54,16 +54,23 @@ class UMon : public GlobAlloc {
         Counter profMisses;
         VectorCounter profWayHits;
 
-        //Even for high associativity/number of buckets, performance of this is not important because we downsample so much (so this is a LL)
-        struct Node {
-            Address addr;
-            struct Node* next;
-        };
-        Node** array;
-        Node** heads;
-
+        // Per-set LRU stacks. Each set keeps its tags contiguously (padded to
+        // an even count, so SSE2 can compare two tags per instruction), and
+        // the LRU stack position of each way in a separate byte array (0 =
+        // MRU, padded to 16 bytes). A hit at way w tells us the stack distance
+        // directly from ranks[w], and moving w to MRU just increments all
+        // smaller ranks, 16 ways per instruction.
+        Address* tags;  // sets x setWays
+        uint8_t* ranks;  // sets x setRankBytes
+        uint32_t setWays;  // buckets rounded up to even
+        uint32_t setRankBytes;  // buckets rounded up to a multiple of 16
+
+        // A single hash: the low samplingFactorBits decide whether to sample
+        // the line, and the next setsBits select the set
         HashFamily* hf;
 
+        uint32_t findWay(const Address* setTags, const uint8_t* setRanks, Address lineAddr) const;
+
     public:
         UMon(uint32_t _bankLines, uint32_t _umonLines, uint32_t _buckets);
         void initStats(AggregateStat* parentStat);
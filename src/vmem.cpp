@@ -0,0 +1,145 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vmem.h"
+#include <string.h>
+#include <string>
+#include "bithacks.h"
+#include "config.h"
+#include "constants.h"
+#include "zsim.h"
+
+VirtualMemory::VirtualMemory(Config& config, uint32_t lineSize) {
+    bool hugePages = config.get<bool>("sys.vm.hugePages", false);
+    pageBits = hugePages? 21 : 12;
+    levels = hugePages? 3 : 4;
+    if ((1u << pageBits) < lineSize) panic("sys.vm: pages must be larger than lines");
+
+    maxProcs = config.get<uint32_t>("sys.vm.maxProcs", 1024);
+    if (maxProcs == 0 || maxProcs > MAX_THREADS) panic("sys.vm.maxProcs must be in [1, %d]", MAX_THREADS);
+
+    numNodes = config.get<uint32_t>("sys.vm.numaNodes", 1);
+    if (numNodes == 0) panic("sys.vm.numaNodes must be > 0");
+    std::string policyStr = config.get<const char*>("sys.vm.numaPolicy", "firstTouch");
+    if (policyStr == "firstTouch") policy = FIRST_TOUCH;
+    else if (policyStr == "interleave") policy = INTERLEAVE;
+    else panic("Invalid sys.vm.numaPolicy %s, must be firstTouch or interleave", policyStr.c_str());
+
+    // Physical memory, split evenly across nodes
+    uint64_t memMB = config.get<uint64_t>("sys.vm.memMB", 16384);
+    framesPerNode = std::max((memMB << 20) >> pageBits, (uint64_t)1)/numNodes;
+    if (framesPerNode == 0) panic("sys.vm.memMB (%ld) is too small for %d NUMA nodes", memMB, numNodes);
+    nodeShift = ilog2(framesPerNode);
+    if ((1ULL << nodeShift) < framesPerNode) nodeShift++;  // round up to a power of two
+    nextFrame = gm_calloc<uint64_t>(numNodes);
+    for (uint32_t n = 0; n < numNodes; n++) nextFrame[n] = ((uint64_t)n) << nodeShift;
+    nextFrame[0] = 1;  // frame 0 is reserved, cache arrays use line address 0 for empty lines
+    nextNode = 0;
+
+    // Page table hash table, kept at most 3/4 full
+    uint64_t maxPages = config.get<uint64_t>("sys.vm.maxPages", 1 << 20);
+    uint32_t bits = 1;
+    while ((1ULL << bits) < 4*maxPages/3 + 1) bits++;
+    slotMask = (1ULL << bits) - 1;
+    slotShift = 64 - bits;
+    slots = gm_calloc<Slot>(slotMask + 1);  // all keys 0 (empty)
+    usedSlots = 0;
+    futex_init(&insertLock);
+
+    info("Virtual memory: %d KB pages, %d-level tables, %d NUMA nodes (%s), up to %d processes and %ld mapped pages",
+            1 << (pageBits - 10), levels, numNodes, policyStr.c_str(), maxProcs, maxPages);
+}
+
+void VirtualMemory::initStats(AggregateStat* parentStat) {
+    AggregateStat* vmStat = new AggregateStat();
+    vmStat->init("vm", "Virtual memory stats");
+    profPages.init("pages", "Mapped data pages");
+    profTablePages.init("tablePages", "Mapped page table pages");
+    profNodeFrames.init("nodeFrames", "Allocated frames per NUMA node", numNodes);
+    vmStat->append(&profPages);
+    vmStat->append(&profTablePages);
+    vmStat->append(&profNodeFrames);
+    parentStat->append(vmStat);
+}
+
+uint32_t VirtualMemory::getWalkAddrs(uint32_t asid, Address vpn, uint32_t cid, Address* pteAddrs) {
+    for (uint32_t l = levels; l > 0; l--) {
+        // The level-l table that maps vpn covers a 9*l-bit range of vpns
+        Address tablePrefix = (l == levels)? 0 : (vpn >> (9*l));
+        uint64_t tableFrame = lookup(makeKey(asid, l, tablePrefix), cid);
+        uint32_t pteIdx = (vpn >> (9*(l-1))) & 511;
+        pteAddrs[levels - l] = (tableFrame << pageBits) | (pteIdx*8);
+    }
+    return levels;
+}
+
+uint64_t VirtualMemory::insert(uint64_t key, uint32_t cid) {
+    futex_lock(&insertLock);
+    // Re-probe, someone may have inserted it since our lookup
+    uint64_t pos = (key * 0x9E3779B97F4A7C15ULL) >> slotShift;
+    while (slots[pos].key != 0 && slots[pos].key != key) pos = (pos + 1) & slotMask;
+    if (slots[pos].key == key) {
+        futex_unlock(&insertLock);
+        return slots[pos].frame;
+    }
+
+    if (4*(usedSlots + 1) > 3*(slotMask + 1)) {
+        panic("Page table full (%ld pages mapped), increase sys.vm.maxPages", usedSlots);
+    }
+    usedSlots++;
+
+    uint64_t frame = allocFrame(cid);
+    bool isData = ((key >> 45) & 0x7) == 0;
+    if (isData) profPages.inc();
+    else profTablePages.inc();
+
+    slots[pos].frame = frame;
+    __sync_synchronize();
+    slots[pos].key = key;  // publishes the mapping to lock-free lookups
+    futex_unlock(&insertLock);
+    return frame;
+}
+
+// Called with insertLock held
+uint64_t VirtualMemory::allocFrame(uint32_t cid) {
+    uint32_t node;
+    if (policy == INTERLEAVE) {
+        node = nextNode;
+        nextNode = (nextNode + 1) % numNodes;
+    } else {
+        node = ((uint64_t)cid)*numNodes/std::max(zinfo->numCores, 1u);
+    }
+
+    // Spill to other nodes when a node is full, like Linux's default policy
+    for (uint32_t i = 0; i < numNodes; i++) {
+        uint32_t n = (node + i) % numNodes;
+        if (nextFrame[n] < (((uint64_t)n) << nodeShift) + framesPerNode) {
+            profNodeFrames.inc(n);
+            return nextFrame[n]++;
+        }
+    }
+    panic("Out of physical memory, increase sys.vm.memMB");
+    return 0;
+}
@@ -0,0 +1,135 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VMEM_H_
+#define VMEM_H_
+
+#include <stdint.h>
+#include "galloc.h"
+#include "locks.h"
+#include "log.h"
+#include "memory_hierarchy.h"
+#include "stats.h"
+
+class Config;
+
+/* Virtual-to-physical mapping (sys.vm.enable). Without it, each process's
+ * physical addresses are its virtual addresses with the process index in the
+ * top bits (procMask), which limits us to sys.lineSize processes and has no
+ * translation costs.
+ *
+ * Instead, this keeps a page table per process and a physical frame
+ * allocator, and allocates frames on first touch. All page tables live in a
+ * single hash table keyed by (process, level, virtual page number prefix):
+ * level 0 entries map data pages, and higher levels map the pages of the
+ * radix page table that a hardware walker would read (4 levels with 4KB
+ * pages, 3 with 2MB huge pages). Those pages get frames too, so page walks
+ * access real, cacheable addresses (see MMU in tlb.h).
+ *
+ * Physical memory is split in NUMA nodes, each a power-of-two range of
+ * frames. Frames are allocated from the node of the core that touches the
+ * page first (firstTouch), or round-robin across nodes (interleave).
+ *
+ * Lookups are lock-free; inserts take a lock. Mappings are never removed.
+ *
+ * Virtual addresses have VA_BITS bits, as in x86-64's 4-level paging;
+ * callers drop the sign-extended upper bits of kernel-half addresses (e.g.,
+ * the vsyscall page), so vpns have getVpnBits() bits.
+ */
+class VirtualMemory : public GlobAlloc {
+    public:
+        enum NUMAPolicy {FIRST_TOUCH, INTERLEAVE};
+        static const uint32_t VA_BITS = 48;
+
+    private:
+        struct Slot {
+            volatile uint64_t key;  // 0 if empty; written after frame
+            volatile uint64_t frame;  // volatile to keep reads ordered after key
+        };
+
+        uint32_t pageBits;
+        uint32_t levels;
+        uint32_t maxProcs;
+
+        uint32_t numNodes;
+        uint64_t framesPerNode;
+        uint32_t nodeShift;  // each node spans 2^nodeShift frames, >= framesPerNode
+        NUMAPolicy policy;
+        uint64_t* nextFrame;  // per node
+        uint32_t nextNode;  // for interleaving
+
+        Slot* slots;
+        uint64_t slotMask;
+        uint32_t slotShift;
+        uint64_t usedSlots;
+        lock_t insertLock;
+
+        Counter profPages, profTablePages;
+        VectorCounter profNodeFrames;
+
+    public:
+        VirtualMemory(Config& config, uint32_t lineSize);
+        void initStats(AggregateStat* parentStat);
+
+        uint32_t getPageBits() const {return pageBits;}
+        uint32_t getVpnBits() const {return VA_BITS - pageBits;}
+        uint32_t getLevels() const {return levels;}
+        uint32_t getMaxProcs() const {return maxProcs;}
+        uint32_t getNumNodes() const {return numNodes;}
+
+        // Physical line addresses of node n are those with (lineAddr >> getNodeLineShift()) == n
+        uint32_t getNodeLineShift(uint32_t lineBits) const {return nodeShift + pageBits - lineBits;}
+
+        // Frame of a data page, allocated on first touch from the node of cid
+        inline uint64_t getFrame(uint32_t asid, Address vpn, uint32_t cid) {
+            return lookup(makeKey(asid, 0, vpn), cid);
+        }
+
+        /* Physical addresses of the page table entries that a walk for vpn
+         * reads, from the root down. Returns the number of entries (levels).
+         */
+        uint32_t getWalkAddrs(uint32_t asid, Address vpn, uint32_t cid, Address* pteAddrs);
+
+    private:
+        static inline uint64_t makeKey(uint32_t asid, uint32_t level, Address prefix) {
+            assert(prefix < (1ULL << 45));
+            return (((uint64_t)asid + 1) << 48) | (((uint64_t)level) << 45) | prefix;
+        }
+
+        inline uint64_t lookup(uint64_t key, uint32_t cid) {
+            uint64_t pos = (key * 0x9E3779B97F4A7C15ULL) >> slotShift;
+            while (true) {
+                uint64_t k = slots[pos].key;
+                if (k == key) return slots[pos].frame;
+                if (k == 0) return insert(key, cid);
+                pos = (pos + 1) & slotMask;
+            }
+        }
+
+        uint64_t insert(uint64_t key, uint32_t cid);
+        uint64_t allocFrame(uint32_t cid);
+};
+
+#endif  // VMEM_H_
@@ -0,0 +1,203 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "weave_capture.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "log.h"
+#include "timing_event.h"
+
+static_assert(sizeof(WeaveCaptureRecord) % sizeof(uint64_t) == 0, "records are buffered as 64-bit words");
+
+static void WriteAll(int fd, const void* buf, size_t bytes, const char* filename) {
+    const char* p = static_cast<const char*>(buf);
+    while (bytes) {
+        ssize_t res = write(fd, p, bytes);
+        if (res < 0) panic("Write to weave capture file %s failed", filename);
+        p += res;
+        bytes -= res;
+    }
+}
+
+WeaveCapture::WeaveCapture(const char* _filename, uint32_t _numDomains, uint64_t _firstPhase, uint64_t numPhases)
+    : numDomains(_numDomains), filename(_filename), firstPhase(_firstPhase), supPhase(_firstPhase + numPhases),
+      phase(0), limit(0), active(false)
+{
+    domains = gm_calloc<DomainCapture>(numDomains);
+    for (uint32_t i = 0; i < numDomains; i++) {
+        new (&domains[i].buf) g_vector<uint64_t>();
+        new (&domains[i].running) g_unordered_map<TimingEvent*, RunInfo>();
+        new (&domains[i].typeIds) g_unordered_map<const std::type_info*, uint16_t>();
+        domains[i].records = 0;
+    }
+    futex_init(&fileLock);
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) panic("Could not create weave capture file %s", filename);
+    WeaveCaptureHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = WEAVE_CAPTURE_MAGIC;
+    hdr.version = WEAVE_CAPTURE_VERSION;
+    hdr.numDomains = numDomains;
+    hdr.firstPhase = firstPhase;
+    WriteAll(fd, &hdr, sizeof(hdr), filename);
+    close(fd);
+    info("Capturing weave phases [%ld, %ld) to %s", firstPhase, supPhase, filename);
+}
+
+void WeaveCapture::initStats(AggregateStat* parentStat) {
+    AggregateStat* capStat = new AggregateStat();
+    capStat->init("weaveCapture", "Weave event graph capture stats");
+    profRecords.init("events", "Events captured");
+    profEdges.init("edges", "Parent-child edges captured");
+    profBytes.init("bytes", "Bytes written");
+    capStat->append(&profRecords);
+    capStat->append(&profEdges);
+    capStat->append(&profBytes);
+    parentStat->append(capStat);
+}
+
+void WeaveCapture::startPhase(uint64_t _limit) {
+    bool wasActive = active;
+    active = phase >= firstPhase && phase < supPhase;
+    limit = _limit;
+    phase++;
+    if (wasActive && !active) info("Weave capture done, %ld events", profRecords.get());
+}
+
+void WeaveCapture::eventRun(TimingEvent* ev, uint64_t cycle) {
+    if (!active) return;
+    DomainCapture& dc = domains[ev->domain];
+    auto it = dc.running.find(ev);
+    if (it == dc.running.end()) {
+        dc.running[ev] = {cycle, 1};
+    } else {
+        it->second.sims++;
+    }
+}
+
+uint16_t WeaveCapture::typeId(DomainCapture& dc, TimingEvent* ev) {
+    const std::type_info* ti = &typeid(*ev);
+    auto it = dc.typeIds.find(ti);
+    if (it != dc.typeIds.end()) return it->second;
+
+    // New to this domain; intern it globally
+    futex_lock(&fileLock);
+    uint32_t id = 0;
+    while (id < types.size() && *types[id] != *ti) id++;
+    if (id == types.size()) {
+        if (id > UINT16_MAX) panic("Weave capture: too many event types");
+        types.push_back(ti);
+        const char* name = ti->name();
+        uint32_t len = strlen(name);
+        uint32_t paddedLen = (len + 8) & ~7;  // at least one NUL
+        char* payload = gm_calloc<char>(paddedLen);
+        memcpy(payload, name, len);
+        WeaveCaptureChunk chunk = {WCC_TYPE, id, phase - 1, limit, paddedLen};
+        append(chunk, payload);
+        gm_free(payload);
+    }
+    futex_unlock(&fileLock);
+    dc.typeIds[ti] = id;
+    return id;
+}
+
+void WeaveCapture::eventDone(TimingEvent* ev, uint64_t doneCycle) {
+    if (!active) return;
+    assert(ev->domain >= 0 && (uint32_t)ev->domain < numDomains);
+    DomainCapture& dc = domains[ev->domain];
+
+    WeaveCaptureRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.ev = (uint64_t)ev;
+    rec.minStartCycle = ev->minStartCycle;
+    rec.doneCycle = doneCycle;
+    rec.preDelay = ev->preDelay;
+    rec.postDelay = ev->postDelay;
+    rec.typeId = typeId(dc, ev);
+    rec.numChildren = ev->numChildren;
+
+    auto it = dc.running.find(ev);
+    if (it != dc.running.end()) {
+        rec.readyCycle = it->second.readyCycle;
+        rec.sims = it->second.sims;
+        dc.running.erase(it);
+    }
+
+    const std::type_info& ti = typeid(*ev);
+    if (ti == typeid(CrossingEvent)) {
+        CrossingEvent* ce = static_cast<CrossingEvent*>(ev);
+        rec.kind = WEK_CROSSING;
+        rec.src = (uint64_t)&ce->cpe;
+        rec.srcDomain = ce->srcDomain;
+        rec.preDelay = ce->preSlack;
+        rec.postDelay = ce->postSlack;
+        rec.slackCycle = ce->evRec->getSlack(ce->origStartCycle) + ce->postSlack;
+    } else if (ti == typeid(CrossingEvent::CrossingSrcEvent)) {
+        rec.kind = WEK_CROSSING_SRC;
+    } else if (ti == typeid(DelayEvent)) {
+        rec.kind = WEK_DELAY;
+    } else {
+        rec.kind = WEK_EVENT;
+    }
+
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(&rec);
+    dc.buf.insert(dc.buf.end(), words, words + sizeof(rec)/sizeof(uint64_t));
+    auto vLambda = [&dc](TimingEvent** childPtr) { dc.buf.push_back((uint64_t)*childPtr); };
+    ev->visitChildren< decltype(vLambda) >(vLambda);
+    dc.records++;
+}
+
+void WeaveCapture::endPhase(uint32_t firstDomain, uint32_t supDomain) {
+    uint64_t records = 0;
+    uint64_t words = 0;
+    futex_lock(&fileLock);
+    for (uint32_t d = firstDomain; d < supDomain; d++) {
+        DomainCapture& dc = domains[d];
+        if (!active) dc.running.clear();  // window closed
+        if (dc.buf.empty()) continue;
+        WeaveCaptureChunk chunk = {WCC_EVENTS, d, phase - 1, limit, dc.buf.size()*sizeof(uint64_t)};
+        append(chunk, &dc.buf[0]);
+        records += dc.records;
+        words += dc.buf.size();
+        dc.buf.clear();
+        dc.records = 0;
+    }
+    futex_unlock(&fileLock);
+
+    profRecords.atomicInc(records);
+    profEdges.atomicInc(words - records*sizeof(WeaveCaptureRecord)/sizeof(uint64_t));
+}
+
+void WeaveCapture::append(const WeaveCaptureChunk& chunk, const void* payload) {
+    // Reopen every time, as StatsOutputBuffer does; this is once per phase and domain
+    int fd = open(filename, O_WRONLY | O_APPEND);
+    if (fd < 0) panic("Could not open weave capture file %s", filename);
+    WriteAll(fd, &chunk, sizeof(chunk), filename);
+    WriteAll(fd, payload, chunk.bytes, filename);
+    close(fd);
+    profBytes.atomicInc(sizeof(chunk) + chunk.bytes);
+}
@@ -0,0 +1,167 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEAVE_CAPTURE_H_
+#define WEAVE_CAPTURE_H_
+
+#include <stdint.h>
+#include <typeinfo>
+#include "g_std/g_unordered_map.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "locks.h"
+#include "pad.h"
+#include "stats.h"
+
+/* Layout of the weave capture file (sim.weaveCapture), shared by the
+ * simulator and weavebench, which replays it offline:
+ *
+ *   [WeaveCaptureHeader][WeaveCaptureChunk][payload][WeaveCaptureChunk][payload]...
+ *
+ * TYPE chunks name an event type: the type id is in the domain field, and
+ * the payload is its mangled name, NUL-padded to 8 bytes. A TYPE chunk comes
+ * before any record that uses its id.
+ *
+ * EVENTS chunks hold the events of one domain that finished in one weave
+ * phase, in the order they finished. Each is a WeaveCaptureRecord followed by
+ * numChildren child addresses. Events are identified by their addresses,
+ * which are reused once an event is freed, but a parent always finishes
+ * before its children, in the same domain (domain changes go through
+ * crossings). So a child is the first record after its parent's in the
+ * domain's stream with the child's address. Chunks of a domain are in
+ * phase order, so a domain's stream is its chunks concatenated.
+ *
+ * A crossing is recorded in its destination domain, and its source-domain
+ * half (a CROSSING_SRC record in srcDomain) has address src. Since the
+ * crossing is alive until it finishes, its source event is the last
+ * CROSSING_SRC record with address src in srcDomain's stream that finished
+ * in the same phase or earlier. While a crossing waits for its source half,
+ * it polls no earlier than the source domain's cycle or the core's slack
+ * bound (slackCycle), whichever is later.
+ */
+
+#define WEAVE_CAPTURE_MAGIC 0x5645574d49535aULL  // "ZSIMWEV"
+#define WEAVE_CAPTURE_VERSION 2
+
+struct WeaveCaptureHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t numDomains;
+    uint64_t firstPhase;  // weave phases are numbered from 0
+};
+
+enum WeaveCaptureChunkType {WCC_TYPE, WCC_EVENTS};
+
+struct WeaveCaptureChunk {
+    uint32_t type;  // WeaveCaptureChunkType
+    uint32_t domain;  // type id for TYPE chunks
+    uint64_t phase;
+    uint64_t limit;  // cycle the phase simulated up to
+    uint64_t bytes;  // of the payload
+};
+
+enum WeaveEventKind {
+    WEK_EVENT,  // simulated by its simulate() method
+    WEK_DELAY,  // DelayEvent, wakes its children directly
+    WEK_CROSSING,  // CrossingEvent, waits for its source-domain half
+    WEK_CROSSING_SRC,  // source-domain half of a crossing
+};
+
+struct WeaveCaptureRecord {
+    uint64_t ev;  // address
+    uint64_t src;  // crossings: address of the source-domain half
+    uint64_t minStartCycle;
+    uint64_t readyCycle;  // of the first simulate() call; 0 if none was seen
+    uint64_t doneCycle;
+    uint32_t preDelay;  // crossings: preSlack
+    uint32_t postDelay;  // crossings: postSlack
+    uint32_t sims;  // simulate() calls seen
+    uint16_t typeId;
+    uint8_t kind;  // WeaveEventKind
+    uint8_t pad;
+    uint32_t srcDomain;  // crossings only
+    uint32_t numChildren;  // followed by numChildren uint64_t addresses
+    uint64_t slackCycle;  // crossings: the core's slack bound on polling, when it finished
+};
+
+class TimingEvent;
+
+/* Serializes the event graph of a window of weave phases to a file. Sim
+ * threads record each event when it runs and finishes into per-domain
+ * buffers, and append them to the file at the end of the phase, so there is
+ * no cross-thread synchronization besides the file lock.
+ */
+class WeaveCapture : public GlobAlloc {
+    private:
+        struct RunInfo {
+            uint64_t readyCycle;
+            uint32_t sims;
+        };
+
+        struct DomainCapture {
+            g_vector<uint64_t> buf;  // records of the current phase
+            g_unordered_map<TimingEvent*, RunInfo> running;  // events simulated but not done
+            g_unordered_map<const std::type_info*, uint16_t> typeIds;  // cache of types
+            uint64_t records;
+            PAD();
+        };
+
+        DomainCapture* domains;
+        uint32_t numDomains;
+        const char* filename;
+        uint64_t firstPhase, supPhase;
+
+        lock_t fileLock;  // serializes appends and protects types
+        g_vector<const std::type_info*> types;
+
+        // Written when each phase starts, read-only in the phase
+        uint64_t phase;
+        uint64_t limit;
+        volatile bool active;
+
+        Counter profRecords, profEdges, profBytes;
+
+    public:
+        // Truncates the file and writes its header
+        WeaveCapture(const char* _filename, uint32_t _numDomains, uint64_t _firstPhase, uint64_t numPhases);
+
+        void initStats(AggregateStat* parentStat);
+
+        // Called by ContentionSim, before the sim threads start each weave phase
+        void startPhase(uint64_t _limit);
+
+        // Called by the domain's sim thread on every simulate() call and when events finish
+        void eventRun(TimingEvent* ev, uint64_t cycle);
+        void eventDone(TimingEvent* ev, uint64_t doneCycle);
+
+        // Called by each sim thread when it finishes the phase, appends its domains' records
+        void endPhase(uint32_t firstDomain, uint32_t supDomain);
+
+    private:
+        uint16_t typeId(DomainCapture& dc, TimingEvent* ev);
+        void append(const WeaveCaptureChunk& chunk, const void* payload);  // call with fileLock held
+};
+
+#endif  // WEAVE_CAPTURE_H_
@@ -0,0 +1,582 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Replays weave phases captured with sim.weaveCapture (see weave_capture.h)
+ * through ContentionSim, without Pin or the rest of the simulator, to
+ * benchmark the weave phase with different numbers of sim threads.
+ *
+ * Events are replayed by generic events that mimic what the captured ones
+ * did: an event that was simulated N times, from its first simulate() call
+ * to when it finished, is simulated N times over the same number of cycles.
+ * Delay events are replayed as such, and crossings wait for their source
+ * half as CrossingEvent does, polling no earlier than the captured core slack
+ * bound, so the synchronization between domains is simulated rather than
+ * replayed. Replayed cycles can thus drift from the captured ones, but the
+ * work per event and the graph are the same: every replay finishes the same
+ * events, running extra phases past the captured ones if needed.
+ */
+
+#include <algorithm>
+#include <cxxabi.h>
+#include <fcntl.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "contention_sim.h"
+#include "event_recorder.h"
+#include "galloc.h"
+#include "log.h"
+#include "profile_stats.h"
+#include "standalone_threads.h"
+#include "timing_event.h"
+#include "weave_capture.h"
+#include "zsim.h"
+
+using std::string; using std::vector;
+
+GlobSimInfo* zinfo;
+
+#define NO_STEP ((uint32_t)-1)
+
+/* Loaded capture */
+
+struct Node {
+    WeaveCaptureRecord rec;
+    uint32_t domain;
+    uint32_t step;  // index of the phase the event finished in
+    uint32_t allocStep;  // when the replay creates it
+    uint32_t queueStep;  // roots: when the replay queues it, NO_STEP otherwise
+    uint32_t numParents;
+    uint32_t minParentStep;  // NO_STEP if no parents
+    int64_t pair;  // crossing <-> its source half, -1 if unpaired
+};
+
+struct Capture {
+    uint32_t numDomains;
+    vector<uint64_t> limits;  // per step
+    vector<string> types;
+    vector<Node> nodes;
+    vector<std::pair<uint32_t, uint32_t>> edges;  // parent, child
+    uint64_t baseCycle;  // where the replay starts
+    uint32_t maxPhaseLength;
+};
+
+static const char* MapFile(const char* file, size_t& size) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) panic("Could not open %s", file);
+    struct stat st;
+    if (fstat(fd, &st) != 0) panic("Could not stat %s", file);
+    if ((size_t)st.st_size < sizeof(WeaveCaptureHeader)) panic("%s is too small to be a weave capture", file);
+    void* res = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (res == MAP_FAILED) panic("Could not mmap %s", file);
+    close(fd);
+    size = st.st_size;
+    return static_cast<const char*>(res);
+}
+
+static void Load(const char* file, Capture& cap) {
+    size_t size;
+    const char* base = MapFile(file, size);
+    const WeaveCaptureHeader* hdr = reinterpret_cast<const WeaveCaptureHeader*>(base);
+    if (hdr->magic != WEAVE_CAPTURE_MAGIC) panic("%s is not a weave capture", file);
+    if (hdr->version != WEAVE_CAPTURE_VERSION) panic("%s has version %d, expected %d", file, hdr->version, WEAVE_CAPTURE_VERSION);
+    cap.numDomains = hdr->numDomains;
+
+    // Per-domain streams, in file order
+    vector<vector<uint32_t>> streams(cap.numDomains);
+    vector<vector<uint64_t>> childAddrs;  // per node
+    vector<uint64_t> nodePhases;
+    std::map<uint64_t, uint64_t> phaseLimits;
+
+    size_t pos = sizeof(WeaveCaptureHeader);
+    while (pos < size) {
+        if (pos + sizeof(WeaveCaptureChunk) > size) panic("%s: truncated chunk header at offset %ld", file, pos);
+        const WeaveCaptureChunk* chunk = reinterpret_cast<const WeaveCaptureChunk*>(base + pos);
+        pos += sizeof(WeaveCaptureChunk);
+        if (pos + chunk->bytes > size) panic("%s: truncated chunk at offset %ld", file, pos);
+        const char* payload = base + pos;
+        pos += chunk->bytes;
+
+        if (chunk->type == WCC_TYPE) {
+            if (cap.types.size() <= chunk->domain) cap.types.resize(chunk->domain + 1);
+            cap.types[chunk->domain] = string(payload, strnlen(payload, chunk->bytes));
+        } else if (chunk->type == WCC_EVENTS) {
+            if (chunk->domain >= cap.numDomains) panic("%s: chunk for domain %d, capture has %d", file, chunk->domain, cap.numDomains);
+            phaseLimits[chunk->phase] = chunk->limit;
+            const uint64_t* words = reinterpret_cast<const uint64_t*>(payload);
+            const uint64_t* end = words + chunk->bytes/sizeof(uint64_t);
+            while (words < end) {
+                Node n;
+                memcpy(&n.rec, words, sizeof(WeaveCaptureRecord));
+                words += sizeof(WeaveCaptureRecord)/sizeof(uint64_t);
+                if (words + n.rec.numChildren > end) panic("%s: truncated record", file);
+                n.domain = chunk->domain;
+                n.numParents = 0;
+                n.minParentStep = NO_STEP;
+                n.queueStep = NO_STEP;
+                n.pair = -1;
+                streams[n.domain].push_back(cap.nodes.size());
+                cap.nodes.push_back(n);
+                childAddrs.push_back(vector<uint64_t>(words, words + n.rec.numChildren));
+                nodePhases.push_back(chunk->phase);
+                words += n.rec.numChildren;
+            }
+        } else {
+            panic("%s: unknown chunk type %d", file, chunk->type);
+        }
+    }
+    munmap(const_cast<char*>(base), size);
+
+    // Replay steps are the captured phases, in order
+    std::map<uint64_t, uint32_t> phaseSteps;
+    for (auto& pl : phaseLimits) {
+        phaseSteps[pl.first] = cap.limits.size();
+        cap.limits.push_back(pl.second);
+    }
+    for (uint32_t i = 0; i < cap.nodes.size(); i++) cap.nodes[i].step = phaseSteps[nodePhases[i]];
+
+    // Resolve children: the first later record in the same stream with the child's address
+    for (uint32_t d = 0; d < cap.numDomains; d++) {
+        const vector<uint32_t>& stream = streams[d];
+        std::unordered_map<uint64_t, uint32_t> next;
+        for (int64_t i = stream.size() - 1; i >= 0; i--) {
+            uint32_t id = stream[i];
+            for (uint64_t addr : childAddrs[id]) {
+                auto it = next.find(addr);
+                if (it != next.end()) cap.edges.push_back(std::make_pair(id, it->second));
+            }
+            next[cap.nodes[id].rec.ev] = id;
+        }
+    }
+
+    // Pair crossings with their source halves: the last one in the source stream that finished no later
+    vector<std::unordered_map<uint64_t, vector<uint32_t>>> srcHalves(cap.numDomains);
+    for (uint32_t d = 0; d < cap.numDomains; d++) {
+        for (uint32_t id : streams[d]) {
+            if (cap.nodes[id].rec.kind == WEK_CROSSING_SRC) srcHalves[d][cap.nodes[id].rec.ev].push_back(id);
+        }
+    }
+    for (Node& n : cap.nodes) {
+        if (n.rec.kind != WEK_CROSSING || n.rec.srcDomain >= cap.numDomains) continue;
+        auto it = srcHalves[n.rec.srcDomain].find(n.rec.src);
+        if (it == srcHalves[n.rec.srcDomain].end()) continue;
+        int64_t best = -1;
+        for (uint32_t id : it->second) {
+            if (cap.nodes[id].step <= n.step && cap.nodes[id].pair == -1) best = id;
+        }
+        if (best != -1) {
+            n.pair = best;
+            cap.nodes[best].pair = &n - &cap.nodes[0];
+        }
+    }
+
+    for (auto& e : cap.edges) {
+        Node& c = cap.nodes[e.second];
+        c.numParents++;
+        c.minParentStep = std::min(c.minParentStep, cap.nodes[e.first].step);
+    }
+
+    // When to create and queue each event. All its parent edges must be in place before any of its parents finishes
+    for (Node& n : cap.nodes) {
+        n.allocStep = std::min(n.step, n.minParentStep);
+        if (n.numParents == 0 && !(n.rec.kind == WEK_CROSSING_SRC && n.pair != -1)) {
+            uint64_t ready = n.rec.readyCycle? n.rec.readyCycle : n.rec.doneCycle;
+            n.queueStep = std::upper_bound(cap.limits.begin(), cap.limits.end(), ready) - cap.limits.begin();
+            n.queueStep = std::min(n.queueStep, n.step);
+            n.allocStep = std::min(n.allocStep, n.queueStep);
+        }
+    }
+    for (auto& e : cap.edges) {
+        Node& p = cap.nodes[e.first];
+        p.allocStep = std::min(p.allocStep, cap.nodes[e.second].minParentStep);
+    }
+    for (Node& n : cap.nodes) {
+        if (n.rec.kind == WEK_CROSSING && n.pair != -1) {
+            Node& s = cap.nodes[n.pair];
+            n.allocStep = s.allocStep = std::min(n.allocStep, s.allocStep);
+        }
+    }
+
+    // Start one phase before the first captured one, early enough for every root
+    cap.maxPhaseLength = 1;
+    for (uint32_t i = 1; i < cap.limits.size(); i++) {
+        cap.maxPhaseLength = std::max(cap.maxPhaseLength, (uint32_t)(cap.limits[i] - cap.limits[i-1]));
+    }
+    cap.baseCycle = cap.limits.empty()? 0 : cap.limits[0];
+    for (const Node& n : cap.nodes) {
+        if (n.queueStep == 0) cap.baseCycle = std::min(cap.baseCycle, n.rec.readyCycle? n.rec.readyCycle : n.rec.doneCycle);
+    }
+}
+
+/* Replay events */
+
+struct DomainCounters {
+    uint64_t sims;
+    uint64_t done;
+    PAD();
+};
+
+static DomainCounters* domCounters;  // process-local, each entry written only by its domain's thread
+
+/* Replayed events can run ahead of the captured ones, but must not finish
+ * before the phase they finished in: the replay creates and links events
+ * phase by phase, and an event's children must be linked before it finishes.
+ * So events first simulated before the start of that phase (minCycle) wait
+ * for it.
+ */
+class ReplayEvent : public TimingEvent {
+    private:
+        uint64_t minCycle;
+        uint64_t stepCycles;
+        uint64_t lastCycles;
+        uint32_t simsLeft;
+
+    public:
+        ReplayEvent(const WeaveCaptureRecord& rec, int32_t domain, uint64_t _minCycle)
+            : TimingEvent(rec.preDelay, rec.postDelay, domain), minCycle(_minCycle)
+        {
+            uint32_t sims = std::max(rec.sims, 1u);
+            uint64_t service = (rec.sims && rec.doneCycle > rec.readyCycle)? rec.doneCycle - rec.readyCycle : 0;
+            stepCycles = service/sims;
+            lastCycles = service - stepCycles*(sims - 1);
+            simsLeft = sims;
+            setMinStartCycle(0);
+        }
+
+        void simulate(uint64_t startCycle) {
+            DomainCounters& dc = domCounters[getDomain()];
+            dc.sims++;
+            if (startCycle < minCycle) {
+                requeue(minCycle);
+            } else if (simsLeft > 1) {
+                simsLeft--;
+                requeue(startCycle + stepCycles);
+            } else {
+                dc.done++;
+                done(startCycle + lastCycles);
+            }
+        }
+};
+
+class ReplayCrossing : public TimingEvent {
+    private:
+        // Source half: its only parent is the event that had the crossing as a child
+        class SrcEvent : public DelayEvent {
+            private:
+                ReplayCrossing* rc;
+            public:
+                explicit SrcEvent(ReplayCrossing* _rc) : DelayEvent(0), rc(_rc) {}
+
+                void parentDone(uint64_t startCycle) {
+                    rc->markSrcEventDone(startCycle);
+                    DelayEvent::parentDone(startCycle);
+                }
+        };
+
+        uint32_t srcDomain;
+        uint32_t slack;
+        uint64_t slackCycle;  // core's slack bound, capped so polling never runs past the captured done cycle
+        volatile bool called;
+        volatile uint64_t doneCycle;
+        uint64_t minStartCycle;  // as in CrossingEvent
+        uint64_t minCycle;  // as in ReplayEvent
+        SrcEvent src;
+
+    public:
+        ReplayCrossing(const WeaveCaptureRecord& rec, int32_t domain, uint64_t _minCycle)
+            : TimingEvent(0, 0, domain), srcDomain(rec.srcDomain), slack(rec.preDelay + rec.postDelay),
+              slackCycle(MIN(rec.slackCycle, rec.doneCycle)), called(false), doneCycle(0),
+              minStartCycle(rec.minStartCycle), minCycle(_minCycle), src(this)
+        {
+            setMinStartCycle(0);
+            slab::retainElem(this);  // src frees itself too
+        }
+
+        TimingEvent* getSrcDomainEvent() {return &src;}
+
+        void parentDone(uint64_t startCycle) {
+            uint64_t cycle = MAX(startCycle, minStartCycle);
+            if (called && doneCycle < cycle) doneCycle = cycle;
+            TimingEvent::parentDone(cycle);
+        }
+
+        void simulate(uint64_t simCycle) {
+            DomainCounters& dc = domCounters[getDomain()];
+            dc.sims++;
+            ContentionSim* csim = zinfo->contentionSim;
+            if (simCycle < minCycle) {
+                requeue(minCycle);
+                return;
+            }
+            if (!called) {
+                uint64_t curSrcCycle = csim->getCurCycle(srcDomain) + slack;
+                uint64_t nextCycle = MAX(slackCycle, MAX(curSrcCycle, simCycle));
+                __sync_synchronize();
+                if (!called) {
+                    csim->setPrio(getDomain(), (nextCycle == simCycle)? 1 : 2);
+                    requeue(nextCycle);
+                    return;
+                }
+            }
+            csim->setPrio(getDomain(), 0);
+            dc.done++;
+            done(MAX(simCycle, doneCycle));
+        }
+
+    private:
+        void markSrcEventDone(uint64_t cycle) {
+            doneCycle = cycle;
+            called = true;
+        }
+};
+
+/* Replay driver */
+
+// Runs in a child process, so every run starts with a fresh global heap and sim threads.
+// Returns the number of replayed events that finished, which must not depend on simThreads.
+static uint64_t Replay(const Capture& cap, uint32_t simThreads, size_t heapBytes) {
+    gm_init(heapBytes);
+    zinfo = gm_calloc<GlobSimInfo>();
+    zinfo->numDomains = cap.numDomains;
+    zinfo->maxPhaseLength = cap.maxPhaseLength;
+    zinfo->placement = nullptr;
+
+    domCounters = gm_calloc<DomainCounters>(cap.numDomains);
+    AggregateStat* rootStat = new AggregateStat();
+    rootStat->init("root", "Stats");
+    zinfo->contentionSim = new ContentionSim(cap.numDomains, simThreads, false, SpawnThread);
+    zinfo->contentionSim->initStats(rootStat);
+    EventRecorder* evRec = new EventRecorder();
+
+    // Bucket work by step
+    uint32_t steps = cap.limits.size();
+    vector<vector<uint32_t>> allocs(steps), queues(steps);
+    vector<vector<std::pair<uint32_t, uint32_t>>> links(steps);
+    for (uint32_t i = 0; i < cap.nodes.size(); i++) {
+        const Node& n = cap.nodes[i];
+        if (n.rec.kind == WEK_CROSSING_SRC && n.pair != -1) continue;  // created with its crossing
+        allocs[n.allocStep].push_back(i);
+        if (n.queueStep != NO_STEP) queues[n.queueStep].push_back(i);
+    }
+    for (auto& e : cap.edges) {
+        uint32_t s = std::max(cap.nodes[e.first].allocStep, cap.nodes[e.second].allocStep);
+        links[s].push_back(e);
+    }
+
+    vector<TimingEvent*> evs(cap.nodes.size(), nullptr);
+    uint64_t numReplayed = 0;  // ReplayEvents and ReplayCrossings, which count when done
+    zinfo->contentionSim->simulatePhase(cap.baseCycle);  // nothing queued, just sets the starting cycle
+
+    uint64_t weaveNs = 0;
+    for (uint32_t s = 0; s < steps; s++) {
+        // Bound: create, link and queue this step's events
+        for (uint32_t id : allocs[s]) {
+            const Node& n = cap.nodes[id];
+            uint64_t minCycle = (n.step? cap.limits[n.step - 1] : cap.baseCycle) + 1;  // threads with several domains run events at the limit
+            if (n.rec.kind == WEK_CROSSING && n.pair != -1) {
+                ReplayCrossing* rc = new (evRec) ReplayCrossing(n.rec, n.domain, minCycle);
+                evs[id] = rc;
+                evs[n.pair] = rc->getSrcDomainEvent();
+                numReplayed++;
+            } else if (n.rec.kind == WEK_DELAY || n.rec.kind == WEK_CROSSING_SRC) {
+                // Parentless delays (parents not captured) become regular events
+                if (n.numParents) {
+                    evs[id] = new (evRec) DelayEvent(n.rec.preDelay);
+                } else {
+                    evs[id] = new (evRec) ReplayEvent(n.rec, n.domain, minCycle);
+                    numReplayed++;
+                }
+            } else {
+                evs[id] = new (evRec) ReplayEvent(n.rec, n.domain, minCycle);
+                numReplayed++;
+            }
+        }
+        for (auto& e : links[s]) evs[e.first]->addChild(evs[e.second], evRec);
+        uint64_t minCycle = zinfo->contentionSim->getLastLimit();
+        for (uint32_t id : queues[s]) {
+            const Node& n = cap.nodes[id];
+            uint64_t ready = n.rec.readyCycle? n.rec.readyCycle : n.rec.doneCycle;
+            evs[id]->queue(MAX(ready, minCycle));
+        }
+
+        // Weave
+        uint64_t startNs = getNs();
+        zinfo->contentionSim->simulatePhase(cap.limits[s]);
+        weaveNs += getNs() - startNs;
+    }
+
+    // Replayed events may finish after the last captured phase; run extra phases
+    // until all have finished, so the work does not depend on how far they drift
+    auto countDone = [&]() {
+        uint64_t res = 0;
+        for (uint32_t d = 0; d < cap.numDomains; d++) res += domCounters[d].done;
+        return res;
+    };
+    uint32_t extraPhases = 0;
+    uint64_t limit = cap.limits.empty()? cap.baseCycle : cap.limits.back();
+    while (countDone() < numReplayed) {
+        if (extraPhases == MAX(steps, 1u)) {
+            panic("Replay with %d sim threads did not finish: %ld of %ld events done after %d extra phases",
+                    simThreads, countDone(), numReplayed, extraPhases);
+        }
+        limit += cap.maxPhaseLength;
+        uint64_t startNs = getNs();
+        zinfo->contentionSim->simulatePhase(limit);
+        weaveNs += getNs() - startNs;
+        extraPhases++;
+    }
+
+    uint64_t totalSims = 0, totalDone = countDone();
+    for (uint32_t d = 0; d < cap.numDomains; d++) totalSims += domCounters[d].sims;
+    if (totalDone != numReplayed) panic("Replay with %d sim threads finished %ld events, expected %ld", simThreads, totalDone, numReplayed);
+    double secs = weaveNs/1e9;
+    printf("%d sim threads: %.3f s weave, %ld events (%.0f events/s), %ld simulate calls (%.0f sims/s), %d extra phases\n",
+            simThreads, secs, totalDone, totalDone/secs, totalSims, totalSims/secs, extraPhases);
+
+    // Per-domain load; weave time is only tracked when threads have a single domain
+    AggregateStat* contStat = dynamic_cast<AggregateStat*>(rootStat->get(0));
+    printf("  %6s %12s %7s %12s %10s\n", "domain", "events", "share", "sims", "time (ms)");
+    for (uint32_t d = 0; d < cap.numDomains; d++) {
+        AggregateStat* domStat = dynamic_cast<AggregateStat*>(contStat->get(d));
+        ScalarStat* timeStat = dynamic_cast<ScalarStat*>(domStat->get(domStat->curSize() - 1));
+        printf("  %6d %12ld %6.2f%% %12ld ", d, domCounters[d].done, 100.0*domCounters[d].done/MAX(totalDone, 1ul), domCounters[d].sims);
+        if (simThreads == cap.numDomains) printf("%10.2f\n", timeStat->get()/1e6);
+        else printf("%10s\n", "-");
+    }
+    fflush(stdout);
+    return totalDone;
+}
+
+static string Demangle(const string& name) {
+    int status;
+    char* res = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status != 0) return name;
+    string str(res);
+    free(res);
+    return str;
+}
+
+static void PrintSummary(const char* file, const Capture& cap) {
+    uint64_t crossings = 0, delays = 0;
+    vector<uint64_t> typeCounts(cap.types.size());
+    for (const Node& n : cap.nodes) {
+        if (n.rec.kind == WEK_CROSSING) crossings++;
+        if (n.rec.kind == WEK_DELAY) delays++;
+        if (n.rec.typeId < typeCounts.size()) typeCounts[n.rec.typeId]++;
+    }
+    info("%s: %ld events, %ld edges, %ld crossings, %ld delays; %ld phases up to cycle %ld, %d domains",
+            file, cap.nodes.size(), cap.edges.size(), crossings, delays, cap.limits.size(),
+            cap.limits.empty()? 0 : cap.limits.back(), cap.numDomains);
+    vector<uint32_t> order(cap.types.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return typeCounts[a] > typeCounts[b]; });
+    for (uint32_t i = 0; i < MIN(order.size(), 10ul); i++) {
+        info("  %10ld %s", typeCounts[order[i]], Demangle(cap.types[order[i]]).c_str());
+    }
+}
+
+static void usage(const char* argv0) {
+    info("Replays weave phases captured with sim.weaveCapture");
+    info("Usage: %s [-t simThreads[,simThreads...]] [-m heapMB] captureFile", argv0);
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog("");  // no log header
+
+    vector<uint32_t> threadCounts;
+    size_t heapMB = 1024;
+    const char* file = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            if (i + 1 >= argc || strlen(argv[i]) != 2) usage(argv[0]);
+            const char* v = argv[++i];
+            switch (argv[i-1][1]) {
+                case 't':
+                    for (const char* p = v; *p; p++) {
+                        threadCounts.push_back(strtoul(p, const_cast<char**>(&p), 0));
+                        if (*p != ',') break;
+                    }
+                    break;
+                case 'm': heapMB = strtoul(v, nullptr, 0); break;
+                default: usage(argv[0]);
+            }
+        } else {
+            if (file) usage(argv[0]);
+            file = argv[i];
+        }
+    }
+    if (!file) usage(argv[0]);
+
+    Capture cap;
+    Load(file, cap);
+    PrintSummary(file, cap);
+    if (cap.nodes.empty()) panic("No events to replay");
+
+    // By default, every divisor of the number of domains
+    if (threadCounts.empty()) {
+        for (uint32_t t = 1; t <= cap.numDomains; t++) {
+            if (cap.numDomains % t == 0) threadCounts.push_back(t);
+        }
+    }
+
+    // Every replay must finish the same events; children report them through shared memory
+    uint64_t* doneEvents = static_cast<uint64_t*>(mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (doneEvents == MAP_FAILED) panic("mmap failed");
+    uint64_t refEvents = 0;
+    uint32_t refThreads = 0;
+    for (uint32_t t : threadCounts) {
+        if (t == 0 || cap.numDomains % t != 0) {
+            warn("Skipping %d sim threads, must divide the number of domains (%d)", t, cap.numDomains);
+            continue;
+        }
+        *doneEvents = 0;
+        pid_t pid = fork();
+        if (pid < 0) panic("fork failed");
+        if (pid == 0) {
+            *doneEvents = Replay(cap, t, heapMB << 20);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) panic("Replay with %d sim threads failed", t);
+        if (!refThreads) {
+            refEvents = *doneEvents;
+            refThreads = t;
+        } else if (*doneEvents != refEvents) {
+            panic("Replay with %d sim threads finished %ld events, but %ld with %d sim threads", t, *doneEvents, refEvents, refThreads);
+        }
+    }
+    return 0;
+}
@@ -48,15 +48,21 @@
 #include "cpuid.h"
 #include "debug_zsim.h"
 #include "event_queue.h"
+#include "filter_cache.h"
 #include "galloc.h"
+#include "host_counters.h"
+#include "host_placement.h"
 #include "init.h"
 #include "log.h"
+#include "mem_sampler.h"
 #include "pin.H"
+#include "phase_length_ctrl.h"
 #include "pin_cmd.h"
 #include "process_tree.h"
 #include "profile_stats.h"
 #include "scheduler.h"
 #include "stats.h"
+#include "sync_trace.h"
 #include "trace_driver.h"
 #include "virt/virt.h"
 
@@ -125,6 +131,16 @@ static inline void setCid(uint32_t tid, uint32_t cid) {
     assert(cid < zinfo->numCores);
     cids[tid] = cid;
     cores[tid] = zinfo->cores[cid];
+    zinfo->placement->bindThread(tid, cid);
+}
+
+// Per TID host counters, nullptr unless sim.hostCounters
+static HostCounterGroup* hostCtrs[MAX_THREADS];
+
+// EndOfPhaseActions runs on whichever thread ends the phase, which may not be an app thread
+static HostCounterGroup* CurHostCounters() {
+    THREADID tid = PIN_ThreadId();
+    return (tid < MAX_THREADS)? hostCtrs[tid] : nullptr;
 }
 
 uint32_t getCid(uint32_t tid) {
@@ -173,7 +189,81 @@ VOID PIN_FAST_ANALYSIS_CALL IndirectStoreSingle(THREADID tid, ADDRINT addr) {
     fPtrs[tid].storePtr(tid, addr);
 }
 
+/* Per-BBL access buffering (sim.bufferAccesses). Memory operands just append
+ * their address to a per-thread buffer, with a routine Pin can inline, and
+ * we replay the buffer through fPtrs in a tight loop at the next BBL. Cores
+ * see exactly the same sequence of calls as without buffering, just later,
+ * so anything that can change the thread's state or read its core's clock
+ * mid-BBL (syscalls, magic ops, signals, rdtsc, vDSO time calls, thread exit)
+ * flushes first. Conditional branches also flush before recording the branch,
+ * so they still follow the BBL's accesses.
+ *
+ * BBLs with too many memory operands or with REPs (which call the analysis
+ * routines once per iteration) are not buffered.
+ */
+#define MAX_BUFFERED_ACCESSES (128)
+
+enum BufferedAccessType {
+    BUF_LOAD = 0,
+    BUF_STORE = 1,
+    BUF_PRED_LOAD = 2,
+    BUF_PRED_STORE = 3,
+    BUF_EXECUTING = 4,  // or'd with BUF_PRED_*
+};
+
+struct AccessBuffer {
+    uint64_t count;
+    uint8_t types[MAX_BUFFERED_ACCESSES];
+    Address addrs[MAX_BUFFERED_ACCESSES];
+} ATTR_LINE_ALIGNED;  // padded to whole lines, so threads' buffers do not false-share
+
+AccessBuffer accessBuffers[MAX_THREADS];
+
+VOID PIN_FAST_ANALYSIS_CALL BufferLoad(THREADID tid, ADDRINT addr) {
+    AccessBuffer& b = accessBuffers[tid];
+    b.types[b.count] = BUF_LOAD;
+    b.addrs[b.count++] = addr;
+}
+
+VOID PIN_FAST_ANALYSIS_CALL BufferStore(THREADID tid, ADDRINT addr) {
+    AccessBuffer& b = accessBuffers[tid];
+    b.types[b.count] = BUF_STORE;
+    b.addrs[b.count++] = addr;
+}
+
+VOID PIN_FAST_ANALYSIS_CALL BufferPredLoad(THREADID tid, ADDRINT addr, BOOL pred) {
+    AccessBuffer& b = accessBuffers[tid];
+    b.types[b.count] = BUF_PRED_LOAD | ((pred != 0) << 2);
+    b.addrs[b.count++] = addr;
+}
+
+VOID PIN_FAST_ANALYSIS_CALL BufferPredStore(THREADID tid, ADDRINT addr, BOOL pred) {
+    AccessBuffer& b = accessBuffers[tid];
+    b.types[b.count] = BUF_PRED_STORE | ((pred != 0) << 2);
+    b.addrs[b.count++] = addr;
+}
+
+// Reloads fPtrs on every access, as any call may change them (e.g., join)
+static void FlushAccesses(THREADID tid) {
+    AccessBuffer& b = accessBuffers[tid];
+    uint32_t count = b.count;
+    for (uint32_t i = 0; i < count; i++) {
+        Address addr = b.addrs[i];
+        switch (b.types[i]) {
+            case BUF_LOAD: fPtrs[tid].loadPtr(tid, addr); break;
+            case BUF_STORE: fPtrs[tid].storePtr(tid, addr); break;
+            case BUF_PRED_LOAD: fPtrs[tid].predLoadPtr(tid, addr, false); break;
+            case BUF_PRED_STORE: fPtrs[tid].predStorePtr(tid, addr, false); break;
+            case BUF_PRED_LOAD | BUF_EXECUTING: fPtrs[tid].predLoadPtr(tid, addr, true); break;
+            case BUF_PRED_STORE | BUF_EXECUTING: fPtrs[tid].predStorePtr(tid, addr, true); break;
+            default: panic("Invalid buffered access type %d", b.types[i]);
+        }
+    }
+    b.count = 0;
+}
+
 VOID PIN_FAST_ANALYSIS_CALL IndirectBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
+    if (accessBuffers[tid].count) FlushAccesses(tid);
     fPtrs[tid].bblPtr(tid, bblAddr, bblInfo);
 }
 
@@ -181,6 +271,31 @@ VOID PIN_FAST_ANALYSIS_CALL IndirectRecordBranch(THREADID tid, ADDRINT branchPc,
     fPtrs[tid].branchPtr(tid, branchPc, taken, takenNpc, notTakenNpc);
 }
 
+VOID PIN_FAST_ANALYSIS_CALL BufferedRecordBranch(THREADID tid, ADDRINT branchPc, BOOL taken, ADDRINT takenNpc, ADDRINT notTakenNpc) {
+    if (accessBuffers[tid].count) FlushAccesses(tid);
+    fPtrs[tid].branchPtr(tid, branchPc, taken, takenNpc, notTakenNpc);
+}
+
+/* Inlined filter hit checks (sim.filterFastPath), used as Pin If-calls before
+ * IndirectLoadSingle/IndirectStoreSingle. SimInit only enables them if all
+ * cores have a fast path; threads whose fPtrs have none (ff, join, nop) use a
+ * per-thread one that never hits, so this stays branch-free and writes only
+ * thread-private lines.
+ */
+FilterFastPath noFastPaths[MAX_THREADS] ATTR_LINE_ALIGNED;
+
+ADDRINT PIN_FAST_ANALYSIS_CALL FilterLoadMiss(THREADID tid, ADDRINT addr) {
+    FilterFastPath* fp = fPtrs[tid].fastPath;
+    fp = fp? fp : &noFastPaths[tid];
+    return fp->loadMiss(addr);
+}
+
+ADDRINT PIN_FAST_ANALYSIS_CALL FilterStoreMiss(THREADID tid, ADDRINT addr) {
+    FilterFastPath* fp = fPtrs[tid].fastPath;
+    fp = fp? fp : &noFastPaths[tid];
+    return fp->storeMiss(addr);
+}
+
 VOID PIN_FAST_ANALYSIS_CALL IndirectPredLoadSingle(THREADID tid, ADDRINT addr, BOOL pred) {
     fPtrs[tid].predLoadPtr(tid, addr, pred);
 }
@@ -189,6 +304,30 @@ VOID PIN_FAST_ANALYSIS_CALL IndirectPredStoreSingle(THREADID tid, ADDRINT addr,
     fPtrs[tid].predStorePtr(tid, addr, pred);
 }
 
+/* Variants for memory access sampling (sim.memSampling), which tell the
+ * sampler the PC of each access before simulating it. Only instrumented when
+ * sampling is on, so the common case does not pay for the extra argument.
+ */
+VOID PIN_FAST_ANALYSIS_CALL SampledLoadSingle(THREADID tid, ADDRINT addr, ADDRINT pc) {
+    zinfo->memSampler->setPC(cids[tid], pc);
+    fPtrs[tid].loadPtr(tid, addr);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL SampledStoreSingle(THREADID tid, ADDRINT addr, ADDRINT pc) {
+    zinfo->memSampler->setPC(cids[tid], pc);
+    fPtrs[tid].storePtr(tid, addr);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL SampledPredLoadSingle(THREADID tid, ADDRINT addr, BOOL pred, ADDRINT pc) {
+    zinfo->memSampler->setPC(cids[tid], pc);
+    fPtrs[tid].predLoadPtr(tid, addr, pred);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL SampledPredStoreSingle(THREADID tid, ADDRINT addr, BOOL pred, ADDRINT pc) {
+    zinfo->memSampler->setPC(cids[tid], pc);
+    fPtrs[tid].predStorePtr(tid, addr, pred);
+}
+
 
 //Non-simulation variants of analysis functions
 
@@ -197,6 +336,7 @@ void Join(uint32_t tid) {
     assert(fPtrs[tid].type == FPTR_JOIN);
     uint32_t cid = zinfo->sched->join(procIdx, tid); //can block
     setCid(tid, cid);
+    if (hostCtrs[tid]) zinfo->hostCounters->addSync(hostCtrs[tid]);
 
     if (unlikely(zinfo->terminationConditionMet)) {
         info("Caught termination condition on join, exiting");
@@ -299,7 +439,7 @@ VOID FFITrackNFFInterval() {
         *_ffiPrevFFStartInstrs = *_ffiFFStartInstrs;
         *_ffiFFStartInstrs = zinfo->processStats->getProcessInstrs(p);
     };
-    zinfo->eventQueue->insert(makeAdaptiveEvent(ffiGet, ffiFire, 0, ffiInstrsLimit - ffiInstrsDone, MAX_IPC*zinfo->phaseLength));
+    zinfo->eventQueue->insert(makeAdaptiveEvent(ffiGet, ffiFire, 0, ffiInstrsLimit - ffiInstrsDone, MAX_IPC*zinfo->maxPhaseLength));
 
     ffiNFF = true;
 }
@@ -470,6 +610,8 @@ VOID CheckForTermination() {
  */
 VOID EndOfPhaseActions() {
     zinfo->profSimTime->transition(PROF_WEAVE);
+    HostCounterGroup* hostCtrGroup = zinfo->hostCounters? CurHostCounters() : nullptr;
+    if (hostCtrGroup) zinfo->hostCounters->addSync(hostCtrGroup);
     if (zinfo->globalPauseFlag) {
         info("Simulation entering global pause");
         zinfo->profSimTime->transition(PROF_FF);
@@ -488,16 +630,28 @@ VOID EndOfPhaseActions() {
     }
 
     CheckForTermination();
-    zinfo->contentionSim->simulatePhase(zinfo->globPhaseCycles + zinfo->phaseLength);
-    zinfo->eventQueue->tick();
+    uint64_t limit = zinfo->globPhaseCycles + zinfo->phaseLength;
+    if (zinfo->contentionSim->isPipelined() && !zinfo->terminationConditionMet) {
+        // Overlap this weave phase with the next bound phase. Finish the
+        // previous one first, so events (e.g., stats dumps) see no weave in flight.
+        zinfo->contentionSim->finishPhase();
+        zinfo->eventQueue->tick();
+        zinfo->contentionSim->startPhase(limit);
+    } else {
+        zinfo->contentionSim->simulatePhase(limit);
+        zinfo->eventQueue->tick();
+    }
+    if (hostCtrGroup) zinfo->hostCounters->addPhaseEnd(hostCtrGroup);
     zinfo->profSimTime->transition(PROF_BOUND);
 }
 
 
 uint32_t TakeBarrier(uint32_t tid, uint32_t cid) {
+    if (hostCtrs[tid]) zinfo->hostCounters->addBound(hostCtrs[tid], cid);
     uint32_t newCid = zinfo->sched->sync(procIdx, tid, cid);
     clearCid(tid); //this is after the sync for a hack needed to make EndOfPhase reliable
     setCid(tid, newCid);
+    if (hostCtrs[tid]) zinfo->hostCounters->addSync(hostCtrs[tid]);
 
     if (procTreeNode->isInFastForward()) {
         info("Thread %d entering fast-forward", tid);
@@ -528,46 +682,95 @@ static void PrintIp(THREADID tid, ADDRINT ip) {
 }
 #endif
 
-VOID Instruction(INS ins) {
-    //Uncomment to print an instruction trace
-    //INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)PrintIp, IARG_THREAD_ID, IARG_REG_VALUE, REG_INST_PTR, IARG_END);
+static void InsertMemCall(INS ins, bool isLoad, IARG_TYPE eaArg) {
+    AFUNPTR funcPtr = isLoad? (AFUNPTR) IndirectLoadSingle : (AFUNPTR) IndirectStoreSingle;
+    AFUNPTR sampledPtr = isLoad? (AFUNPTR) SampledLoadSingle : (AFUNPTR) SampledStoreSingle;
+    if (zinfo->filterFastPath) {
+        // Pin inlines the check; the regular analysis call only runs on filter misses
+        // (filter hits are never sampled, so they need no PC)
+        AFUNPTR missPtr = isLoad? (AFUNPTR) FilterLoadMiss : (AFUNPTR) FilterStoreMiss;
+        INS_InsertIfCall(ins, IPOINT_BEFORE, missPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_END);
+        if (zinfo->memSampler) {
+            INS_InsertThenCall(ins, IPOINT_BEFORE, sampledPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_INST_PTR, IARG_END);
+        } else {
+            INS_InsertThenCall(ins, IPOINT_BEFORE, funcPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_END);
+        }
+    } else if (zinfo->memSampler) {
+        INS_InsertCall(ins, IPOINT_BEFORE, sampledPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_INST_PTR, IARG_END);
+    } else {
+        INS_InsertCall(ins, IPOINT_BEFORE, funcPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_END);
+    }
+}
 
-    if (!procTreeNode->isInFastForward() || !zinfo->ffReinstrument) {
-        AFUNPTR LoadFuncPtr = (AFUNPTR) IndirectLoadSingle;
-        AFUNPTR StoreFuncPtr = (AFUNPTR) IndirectStoreSingle;
+static void InsertPredMemCall(INS ins, bool isLoad, IARG_TYPE eaArg) {
+    if (zinfo->memSampler) {
+        AFUNPTR funcPtr = isLoad? (AFUNPTR) SampledPredLoadSingle : (AFUNPTR) SampledPredStoreSingle;
+        INS_InsertCall(ins, IPOINT_BEFORE, funcPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_EXECUTING, IARG_INST_PTR, IARG_END);
+    } else {
+        AFUNPTR funcPtr = isLoad? (AFUNPTR) IndirectPredLoadSingle : (AFUNPTR) IndirectPredStoreSingle;
+        INS_InsertCall(ins, IPOINT_BEFORE, funcPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_EXECUTING, IARG_END);
+    }
+}
+
+static void InsertBufferedMemCall(INS ins, bool isLoad, IARG_TYPE eaArg) {
+    if (!INS_IsPredicated(ins)) {
+        AFUNPTR funcPtr = isLoad? (AFUNPTR) BufferLoad : (AFUNPTR) BufferStore;
+        INS_InsertCall(ins, IPOINT_BEFORE, funcPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_END);
+    } else {
+        AFUNPTR funcPtr = isLoad? (AFUNPTR) BufferPredLoad : (AFUNPTR) BufferPredStore;
+        INS_InsertCall(ins, IPOINT_BEFORE, funcPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, eaArg, IARG_EXECUTING, IARG_END);
+    }
+}
+
+// Whether we can buffer this BBL's accesses; see AccessBuffer
+static bool CanBufferAccesses(BBL bbl) {
+    uint32_t accesses = 0;
+    for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
+        if (INS_HasRealRep(ins)) return false;
+        accesses += INS_IsMemoryRead(ins) + INS_HasMemoryRead2(ins) + INS_IsMemoryWrite(ins);
+    }
+    return accesses <= MAX_BUFFERED_ACCESSES;
+}
 
-        AFUNPTR PredLoadFuncPtr = (AFUNPTR) IndirectPredLoadSingle;
-        AFUNPTR PredStoreFuncPtr = (AFUNPTR) IndirectPredStoreSingle;
+VOID Instruction(INS ins, bool bufferAccesses) {
+    //Uncomment to print an instruction trace
+    //INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)PrintIp, IARG_THREAD_ID, IARG_REG_VALUE, REG_INST_PTR, IARG_END);
 
+    if ((!procTreeNode->isInFastForward() || !zinfo->ffReinstrument) && bufferAccesses) {
+        if (INS_IsMemoryRead(ins)) InsertBufferedMemCall(ins, true, IARG_MEMORYREAD_EA);
+        if (INS_HasMemoryRead2(ins)) InsertBufferedMemCall(ins, true, IARG_MEMORYREAD2_EA);
+        if (INS_IsMemoryWrite(ins)) InsertBufferedMemCall(ins, false, IARG_MEMORYWRITE_EA);
+    } else if (!procTreeNode->isInFastForward() || !zinfo->ffReinstrument) {
         if (INS_IsMemoryRead(ins)) {
             if (!INS_IsPredicated(ins)) {
-                INS_InsertCall(ins, IPOINT_BEFORE, LoadFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_MEMORYREAD_EA, IARG_END);
+                InsertMemCall(ins, true, IARG_MEMORYREAD_EA);
             } else {
-                INS_InsertCall(ins, IPOINT_BEFORE, PredLoadFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_MEMORYREAD_EA, IARG_EXECUTING, IARG_END);
+                InsertPredMemCall(ins, true, IARG_MEMORYREAD_EA);
             }
         }
 
         if (INS_HasMemoryRead2(ins)) {
             if (!INS_IsPredicated(ins)) {
-                INS_InsertCall(ins, IPOINT_BEFORE, LoadFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_MEMORYREAD2_EA, IARG_END);
+                InsertMemCall(ins, true, IARG_MEMORYREAD2_EA);
             } else {
-                INS_InsertCall(ins, IPOINT_BEFORE, PredLoadFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_MEMORYREAD2_EA, IARG_EXECUTING, IARG_END);
+                InsertPredMemCall(ins, true, IARG_MEMORYREAD2_EA);
             }
         }
 
         if (INS_IsMemoryWrite(ins)) {
             if (!INS_IsPredicated(ins)) {
-                INS_InsertCall(ins, IPOINT_BEFORE,  StoreFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_MEMORYWRITE_EA, IARG_END);
+                InsertMemCall(ins, false, IARG_MEMORYWRITE_EA);
             } else {
-                INS_InsertCall(ins, IPOINT_BEFORE,  PredStoreFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_MEMORYWRITE_EA, IARG_EXECUTING, IARG_END);
+                InsertPredMemCall(ins, false, IARG_MEMORYWRITE_EA);
             }
         }
+    }
 
-        // Instrument only conditional branches
-        if (INS_Category(ins) == XED_CATEGORY_COND_BR && !INS_IsXend(ins)) {
-            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR) IndirectRecordBranch, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID,
-                    IARG_INST_PTR, IARG_BRANCH_TAKEN, IARG_BRANCH_TARGET_ADDR, IARG_FALLTHROUGH_ADDR, IARG_END);
-        }
+    // Instrument only conditional branches
+    if ((!procTreeNode->isInFastForward() || !zinfo->ffReinstrument) && INS_Category(ins) == XED_CATEGORY_COND_BR && !INS_IsXend(ins)) {
+        AFUNPTR branchPtr = bufferAccesses? (AFUNPTR) BufferedRecordBranch : (AFUNPTR) IndirectRecordBranch;
+        INS_InsertCall(ins, IPOINT_BEFORE, branchPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID,
+                IARG_INST_PTR, IARG_BRANCH_TAKEN, IARG_BRANCH_TARGET_ADDR, IARG_FALLTHROUGH_ADDR, IARG_END);
     }
 
     //Intercept and process magic ops
@@ -608,8 +811,9 @@ VOID Trace(TRACE trace, VOID *v) {
 
     //Instruction instrumentation now here to ensure proper ordering
     for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+        bool bufferAccesses = zinfo->bufferAccesses && CanBufferAccesses(bbl);
         for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
-            Instruction(ins);
+            Instruction(ins, bufferAccesses);
         }
     }
 }
@@ -752,6 +956,7 @@ VOID VdsoRetPoint(THREADID tid, REG* raxPtr) {
         // info("vDSO return post level %d, skipping ret handling", vdsoPatchData[tid].level); //common
         return;
     }
+    FlushAccesses(tid);  // we may read the core's clock, like rdtsc
     if (fPtrs[tid].type != FPTR_NOP || vdsoPatchData[tid].func == VF_GETCPU) {
         // info("vDSO patching for func %d", vdsoPatchData[tid].func);  // common
         ADDRINT arg0 = vdsoPatchData[tid].arg0;
@@ -838,6 +1043,7 @@ void SimThreadStart(THREADID tid) {
     //Initialize this thread's process-local data
     fPtrs[tid] = joinPtrs; //delayed, MT-safe barrier join
     clearCid(tid); //just in case, set an invalid cid
+    if (zinfo->hostCounters && !hostCtrs[tid]) hostCtrs[tid] = zinfo->hostCounters->openGroup();  // counts the calling thread
 }
 
 VOID ThreadStart(THREADID tid, CONTEXT *ctxt, INT32 flags, VOID *v) {
@@ -871,9 +1077,12 @@ VOID SimThreadFini(THREADID tid) {
     zinfo->sched->finish(procIdx, tid);
     activeThreads[tid] = false;
     cids[tid] = UNINITIALIZED_CID; //clear this cid, it might get reused
+    delete hostCtrs[tid];
+    hostCtrs[tid] = nullptr;
 }
 
 VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 flags, VOID *v) {
+    FlushAccesses(tid);
     //NOTE: Thread has no valid cid here!
     if (fPtrs[tid].type == FPTR_NOP) {
         info("Shadow/NOP thread %d finished", tid);
@@ -886,6 +1095,7 @@ VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 flags, VOID *v) {
 
 //Need to remove ourselves from running threads in case the syscall is blocking
 VOID SyscallEnter(THREADID tid, CONTEXT *ctxt, SYSCALL_STANDARD std, VOID *v) {
+    FlushAccesses(tid);
     bool isNopThread = fPtrs[tid].type == FPTR_NOP;
     bool isRetryThread = fPtrs[tid].type == FPTR_RETRY;
 
@@ -904,6 +1114,7 @@ VOID SyscallEnter(THREADID tid, CONTEXT *ctxt, SYSCALL_STANDARD std, VOID *v) {
      */
     if (fPtrs[tid].type != FPTR_JOIN && !zinfo->blockingSyscalls) {
         uint32_t cid = getCid(tid);
+        if (hostCtrs[tid]) zinfo->hostCounters->addBound(hostCtrs[tid], cid);
         // set an invalid cid, ours is property of the scheduler now!
         clearCid(tid);
 
@@ -953,6 +1164,7 @@ VOID SyscallExit(THREADID tid, CONTEXT *ctxt, SYSCALL_STANDARD std, VOID *v) {
  * to figure out how to make syscall post-patching work in this case.
  */
 VOID ContextChange(THREADID tid, CONTEXT_CHANGE_REASON reason, const CONTEXT* from, CONTEXT* to, INT32 info, VOID* v) {
+    FlushAccesses(tid);
     const char* reasonStr = "?";
     switch (reason) {
         case CONTEXT_CHANGE_REASON_FATALSIGNAL:
@@ -1057,14 +1269,18 @@ VOID AfterForkInChild(THREADID tid, const CONTEXT* ctxt, VOID * arg) {
     InitLog(header, KnobLogToFile.Value()? logfile_ss.str().c_str() : nullptr);
 
     info("Forked child (tid %d/%d), PID %d, parent PID %d", tid, PIN_ThreadId(), PIN_GetPid(), getppid());
+    zinfo->placement->resetThreads(); //our threads inherit the parent's bindings, but not its per-thread state
 
     //Initialize process-local per-thread state, even if ThreadStart does so later
     for (uint32_t i = 0; i < MAX_THREADS; i++) {
         fPtrs[i] = joinPtrs;
+        noFastPaths[i].initEmpty(lineBits);
         cids[i] = UNINITIALIZED_CID;
         activeThreads[i] = false;
         inSyscall[i] = false;
         cores[i] = nullptr;
+        delete hostCtrs[i];  // count the parent's threads; closes our copies of their descriptors
+        hostCtrs[i] = nullptr;
     }
 
     //We need to launch another copy of the FF control thread
@@ -1110,10 +1326,13 @@ VOID SimEnd() {
             info("All other processes done, terminating");
         }
 
+        zinfo->contentionSim->finishPhase();  // in case we exit with a pipelined weave phase in flight; applies its feedback
         info("Dumping termination stats");
         zinfo->trigger = 20000;
         for (StatsBackend* backend : *(zinfo->statsBackends)) backend->dump(false /*unbuffered, write out*/);
         for (AccessTraceWriter* t : *(zinfo->traceWriters)) t->dump(false);  // flushes trace writer
+        if (zinfo->memSampler) zinfo->memSampler->dump();
+        if (zinfo->syncTrace) zinfo->syncTrace->flush();
 
         if (zinfo->sched) zinfo->sched->notifyTermination();
     }
@@ -1135,6 +1354,7 @@ VOID SimEnd() {
 #define ZSIM_MAGIC_OP_HEARTBEAT         (1028)
 
 VOID HandleMagicOp(THREADID tid, ADDRINT op) {
+    FlushAccesses(tid);
     switch (op) {
         case ZSIM_MAGIC_OP_ROI_BEGIN:
             if (!zinfo->ignoreHooks) {
@@ -1263,6 +1483,7 @@ VOID FakeCPUIDPost(THREADID tid, ADDRINT* eax, ADDRINT* ebx, ADDRINT* ecx, ADDRI
 
 //RDTSC faking
 VOID FakeRDTSCPost(THREADID tid, REG* eax, REG* edx) {
+    FlushAccesses(tid);
     if (fPtrs[tid].type == FPTR_NOP) return; //avoid virtualizing NOP threads.
 
     uint32_t cid = getCid(tid);
@@ -1322,6 +1543,7 @@ class SyncEvent: public Event {
 VOID FFThread(VOID* arg) {
     futex_lock(&zinfo->ffToggleLocks[procIdx]); //initialize
     info("FF control Thread TID %ld", syscall(SYS_gettid));
+    zinfo->placement->bindControlThread();
 
     while (true) {
         //block ourselves until someone wakes us up with an unlock
@@ -1506,6 +1728,7 @@ int main(int argc, char *argv[]) {
     //Initialize process-local per-thread state, even if ThreadStart does so later
     for (uint32_t i = 0; i < MAX_THREADS; i++) {
         fPtrs[i] = joinPtrs;
+        noFastPaths[i].initEmpty(lineBits);
         cids[i] = UNINITIALIZED_CID;
     }
 
@@ -1559,6 +1782,7 @@ int main(int argc, char *argv[]) {
             EndOfPhaseActions();
             zinfo->numPhases++;
             zinfo->globPhaseCycles += zinfo->phaseLength;
+            if (zinfo->phaseLengthCtrl) zinfo->phaseLengthCtrl->endPhase();
         }
         info("Finished trace-driven simulation");
         SimEnd();
@@ -37,17 +37,23 @@ class Core;
 class Scheduler;
 class AggregateStat;
 class StatsBackend;
+class SyncTrace;
 class ProcessTreeNode;
 class ProcessStats;
 class ProcStats;
 class EventQueue;
 class ContentionSim;
+class HostCounters;
+class HostPlacement;
+class PhaseLengthController;
 class EventRecorder;
+class MemSampler;
 class PinCmd;
 class PortVirtualizer;
 class VectorCounter;
 class AccessTraceWriter;
 class TraceDriver;
+class VirtualMemory;
 template <typename T> class g_vector;
 
 struct ClockDomainInfo {
@@ -88,12 +94,19 @@ struct GlobSimInfo {
     //Contention simulation
     uint32_t numDomains;
     ContentionSim* contentionSim;
+    HostPlacement* placement; //pins app and weave threads to host CPUs (sim.placement)
+    PhaseLengthController* phaseLengthCtrl; //nullptr unless sim.adaptivePhaseLength
+    HostCounters* hostCounters; //nullptr unless sim.hostCounters
+    SyncTrace* syncTrace; //nullptr unless sim.syncTrace
     EventRecorder** eventRecorders; //CID->EventRecorder* array
+    MemSampler* memSampler; //nullptr unless sim.memSampling
 
     PAD();
 
     //World-readable
-    uint32_t phaseLength;
+    uint32_t phaseLength; //of the current phase
+    uint32_t nextPhaseLength; //of the next phase, threads use it before the barrier; == phaseLength unless adaptive
+    uint32_t maxPhaseLength;
     uint32_t statsPhaseInterval;
     uint32_t freqMHz;
 
@@ -106,6 +119,8 @@ struct GlobSimInfo {
 
     bool ignoreHooks;
     bool blockingSyscalls;
+    bool filterFastPath; //if true, L0 filter cache hits are checked inline and skip the core's analysis routines (Simple and Timing cores only)
+    bool bufferAccesses; //if true, memory accesses are buffered and simulated at the next basic block
     bool perProcessCpuEnum; //if true, cpus are enumerated according to per-process masks (e.g., a 16-core mask in a 64-core sim sees 16 cores)
     bool oooDecode; //if true, Decoder does OOO (instr->uop) decoding
 
@@ -150,6 +165,9 @@ struct GlobSimInfo {
     ProcExitStatus* procExited; //starts with all set to PROC_RUNNING, each process sets to PROC_EXITED or PROC_RESTARTME on exit. Used to detect untimely deaths (that don;t go thropugh SimEnd) in the harness and abort.
     uint32_t numProcs;
     uint32_t numProcGroups;
+    uint32_t maxProcs; //sys.lineSize without virtual memory, to avoid aliasing address spaces
+
+    VirtualMemory* vm; //nullptr unless sys.vm.enable
 
     PinCmd* pinCmd; //enables calls to exec() to modify Pin's calling arguments, see zsim.cpp
 